@@ -24,6 +24,7 @@
 #include <limits.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <atomic>
 #include <string>
 
@@ -117,16 +118,76 @@ inline void SetThreadName(const std::string &name, pthread_t thread = invalid_pt
   pthread_setname_np(thread, name.c_str());
 }
 
+/*
+  the name of a thread of a module, "cn-" + the module name + the index. The module name is cut to 10 characters,
+  or fewer when the index is long, so the name always fits in the 15 characters SetThreadName takes.
+ */
+inline std::string GetModuleThreadName(const std::string &module_name, uint32_t index) {
+  std::string idx = std::to_string(index);
+  return "cn-" + module_name.substr(0, std::min<size_t>(10, 12 - idx.size())) + idx;
+}
+
 /*pipeline capacities*/
 const size_t INVALID_MODULE_ID = (size_t)(-1);
+/* the max number of modules in one pipeline, including the pipeline itself */
 uint32_t GetMaxModuleNumber();
 
 const uint32_t INVALID_STREAM_IDX = (uint32_t)(-1);
 uint32_t GetMaxStreamNumber();
+/*
+ * Sets the size of the stream index space, 64 by default. The space is shared by all the pipelines of
+ * the process, modules size their per-stream structures with GetMaxStreamNumber() when they are opened.
+ * Prefer the "max_stream_num" parameter of the source modules, which is applied when the pipeline starts.
+ * Returns false if num is 0, a pipeline is running or some stream indexes are in use.
+ */
+bool SetMaxStreamNumber(uint32_t num);
+
+/**
+ * The data queue backend used by the conveyors of a link.
+ */
+enum LinkQueueType {
+  LINK_QUEUE_MUTEX = 0,  ///< A std::deque guarded by a mutex. The default backend.
+  LINK_QUEUE_MPMC,       ///< A lock-free bounded multi-producer multi-consumer ring buffer.
+  LINK_QUEUE_SPSC        ///< A lock-free bounded single-producer single-consumer ring buffer.
+};
+
+/**
+ * What a link does with new data when the data queue is full. The drop policies never drop EOS frames
+ * and use the LINK_QUEUE_MUTEX backend.
+ */
+enum LinkOverflowPolicy {
+  LINK_OVERFLOW_BLOCK = 0,     ///< The upstream module waits for free space. The default policy.
+  LINK_OVERFLOW_DROP_OLDEST,   ///< Drops the oldest frame in the queue.
+  LINK_OVERFLOW_DROP_NEWEST,   ///< Drops the new frame.
+  LINK_OVERFLOW_KEEP_LATEST_N  ///< Keeps the latest N frames of each stream in the queue, older ones are dropped.
+};
+
+/**
+ * What a pipeline does with a new frame from a source when the memory budget is used up.
+ *
+ * @see Pipeline::SetMemoryBudget
+ */
+enum MemoryBudgetPolicy {
+  MEMORY_BUDGET_BLOCK = 0,  ///< The source waits for the frames in flight to be released. The default policy.
+  MEMORY_BUDGET_DROP        ///< The new frame is dropped.
+};
+
+/**
+ * The memory budget status of a pipeline.
+ */
+struct MemoryBudgetStatus {
+  size_t budget_bytes = 0;        ///< The budget, 0 means unlimited.
+  size_t in_flight_bytes = 0;     ///< The bytes of the frame buffers in flight.
+  size_t peak_bytes = 0;          ///< The max of in_flight_bytes.
+  uint64_t throttled_frames = 0;  ///< Frames the sources waited for by MEMORY_BUDGET_BLOCK.
+  uint64_t dropped_frames = 0;    ///< Frames dropped by MEMORY_BUDGET_DROP.
+};
 
 /**
  * Limit the resource for each stream,
  * there will be no more than "parallelism" frames simultaneously.
+ * CNFrameInfo::Create() returns NULL when the limit is reached, CNFrameInfo::WaitAndCreate() waits for a frame
+ * of the stream to be released.
  * Disabled by default.
  */
 void SetParallelism(int parallelism);
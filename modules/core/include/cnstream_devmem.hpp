@@ -0,0 +1,168 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_DEVMEM_HPP_
+#define CNSTREAM_DEVMEM_HPP_
+
+/**
+ * @file cnstream_devmem.hpp
+ *
+ * This file contains the device memory operations used by CNSyncedMemory, CNDataFrame and the inference stages.
+ *
+ * The operations are backed by CNRT by default. Building with -DCNS_HOST_DEVICE (cmake -DWITH_HOST_DEVICE=ON)
+ * selects the host-emulated backend, which keeps device memory in host memory and throttles the copies to a
+ * simulated bandwidth, so the device-side data movement runs and can be profiled without an MLU.
+ */
+
+#include <cstddef>
+
+#include "cnstream_common.hpp"
+
+namespace cnstream {
+
+/**
+ * The direction of a device memory copy.
+ */
+enum DevMemcpyDir {
+  DEV_MEMCPY_HOST2DEV = 0,  ///< From host memory to device memory.
+  DEV_MEMCPY_DEV2HOST,      ///< From device memory to host memory.
+  DEV_MEMCPY_DEV2DEV        ///< Between two device buffers.
+};
+
+/**
+ * Gets the name of the backend, "cnrt" or "host".
+ */
+const char* GetDevMemBackend();
+
+/**
+ * Checks whether the device exists.
+ */
+bool DevCheck(int dev_id);
+
+/**
+ * Allocates device memory.
+ *
+ * @param size The size in bytes.
+ * @param dev_id The device, -1 means the current device of the calling thread.
+ * @param ddr_chn The DDR channel, -1 means the current channel of the calling thread.
+ *
+ * @return Returns the device memory, or nullptr if it fails.
+ */
+void* DevMalloc(size_t size, int dev_id = -1, int ddr_chn = -1);
+
+/**
+ * Frees device memory allocated by DevMalloc.
+ */
+void DevFree(void* ptr, int dev_id = -1, int ddr_chn = -1);
+
+/**
+ * Copies memory synchronously, the device side must be allocated by DevMalloc.
+ *
+ * @return Returns false if the copy fails.
+ */
+bool DevMemcpy(void* dst, const void* src, size_t size, DevMemcpyDir dir, int dev_id = -1, int ddr_chn = -1);
+
+/**
+ * Checks whether DevQueue::MemcpyAsync can copy from or to pageable host memory, which is not allocated pinned.
+ * The host buffers of CNStream are pageable. The cnrt backend needs pinned memory for an asynchronous copy,
+ * so it returns false and the callers copy synchronously.
+ */
+bool DevAsyncCopyPageable();
+
+class DevQueuePrivate;
+class DevNotifier;
+
+/**
+ * @class DevQueue
+ *
+ * A device task queue. The tasks put into a queue are executed in order, asynchronously to the host.
+ */
+class DevQueue {
+ public:
+  explicit DevQueue(int dev_id = -1, int ddr_chn = -1);
+  ~DevQueue();
+  /**
+   * Puts a copy into the queue. The memory must stay valid until the copy is done.
+   *
+   * @return Returns false if the copy can not be put into the queue.
+   */
+  bool MemcpyAsync(void* dst, const void* src, size_t size, DevMemcpyDir dir);
+  /**
+   * Waits for all the tasks put into the queue.
+   *
+   * @return Returns false if any task failed since the last Sync.
+   */
+  bool Sync();
+
+ private:
+  friend class DevNotifier;
+  DECLARE_PRIVATE(d_ptr_, DevQueue);
+  DISABLE_COPY_AND_ASSIGN(DevQueue);
+};  // class DevQueue
+
+class DevNotifierPrivate;
+
+/**
+ * @class DevNotifier
+ *
+ * Marks a point in a DevQueue, to wait for the tasks before it or to time them.
+ */
+class DevNotifier {
+ public:
+  DevNotifier();
+  ~DevNotifier();
+  /**
+   * Puts the notifier into the queue. The notifier is reached when all the tasks put before it are done.
+   */
+  bool Place(DevQueue* queue);
+  /**
+   * Waits until the notifier is reached.
+   */
+  bool Wait();
+  /**
+   * Gets the time between two notifiers in milliseconds.
+   *
+   * @return Returns -1 if either notifier has not been reached.
+   */
+  static float Duration(DevNotifier* start, DevNotifier* end);
+
+ private:
+  DECLARE_PRIVATE(d_ptr_, DevNotifier);
+  DISABLE_COPY_AND_ASSIGN(DevNotifier);
+};  // class DevNotifier
+
+#ifdef CNS_HOST_DEVICE
+/**
+ * The bandwidths of the host-emulated device in bytes per second, 0 means unlimited. Copies in the same direction
+ * share one link and are done one after another, like DMA transfers over PCIe.
+ */
+struct EmulatedDevBandwidth {
+  double host2dev = 8e9;
+  double dev2host = 8e9;
+  double dev2dev = 100e9;
+};
+
+void SetEmulatedDevBandwidth(const EmulatedDevBandwidth& bandwidth);
+EmulatedDevBandwidth GetEmulatedDevBandwidth();
+#endif
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_DEVMEM_HPP_
@@ -30,9 +30,12 @@
 #include "opencv2/opencv.hpp"
 #endif
 
+#include <atomic>
+#include <chrono>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <ostream>
 #include <string>
 #include <utility>
 #include <vector>
@@ -110,13 +113,62 @@ class IDataDeallocator {
   virtual ~IDataDeallocator() {}
 };
 
+const uint32_t INVALID_STREAM_HANDLE = (uint32_t)(-1);
+/**
+ * Interns a stream id. The same stream id always gets the same handle, handles are allocated
+ * from 0 and stay valid until the process exits.
+ *
+ * @param stream_id The data stream alias.
+ *
+ * @return Returns the handle of the stream id, or INVALID_STREAM_HANDLE if stream_id is empty.
+ */
+uint32_t InternStreamId(const std::string& stream_id);
+/**
+ * Gets the stream id of a handle returned by InternStreamId(). It does not lock.
+ *
+ * @return Returns the stream id, or an empty string if the handle is invalid.
+ */
+const std::string& GetInternedStreamId(uint32_t stream_handle);
+
+/**
+ * The stream id of a frame. It refers to the string interned by InternStreamId(), so creating a frame
+ * does not copy the string. It reads like a const std::string.
+ */
+class StreamIdRef {
+ public:
+  StreamIdRef() : str_(&GetInternedStreamId(INVALID_STREAM_HANDLE)) {}
+  explicit StreamIdRef(uint32_t stream_handle) : str_(&GetInternedStreamId(stream_handle)) {}
+  operator const std::string&() const { return *str_; }
+  const std::string& str() const { return *str_; }
+  const char* c_str() const { return str_->c_str(); }
+  size_t size() const { return str_->size(); }
+  bool empty() const { return str_->empty(); }
+
+ private:
+  const std::string* str_;
+};  // class StreamIdRef
+
+inline bool operator==(const StreamIdRef& lhs, const StreamIdRef& rhs) { return lhs.str() == rhs.str(); }
+inline bool operator==(const StreamIdRef& lhs, const std::string& rhs) { return lhs.str() == rhs; }
+inline bool operator==(const std::string& lhs, const StreamIdRef& rhs) { return lhs == rhs.str(); }
+inline bool operator==(const StreamIdRef& lhs, const char* rhs) { return lhs.str() == rhs; }
+inline bool operator==(const char* lhs, const StreamIdRef& rhs) { return lhs == rhs.str(); }
+template <typename T>
+inline bool operator!=(const StreamIdRef& lhs, const T& rhs) { return !(lhs == rhs); }
+inline bool operator!=(const std::string& lhs, const StreamIdRef& rhs) { return !(lhs == rhs); }
+inline bool operator!=(const char* lhs, const StreamIdRef& rhs) { return !(lhs == rhs); }
+inline std::ostream& operator<<(std::ostream& os, const StreamIdRef& stream_id) { return os << stream_id.str(); }
+
 class Module;
 class Pipeline;
+class FrameMemoryBudget;
+class Connector;
 /**
  * The structure contains a frame of the data and the description of this frame.
  */
 struct CNDataFrame {
-  std::string stream_id;  ///< The data stream alias where this frame is located to.
+  StreamIdRef stream_id;  ///< The data stream alias where this frame is located to.
+  uint32_t stream_handle = INVALID_STREAM_HANDLE;  ///< The interned stream_id, compare it instead of the string.
   size_t flags = 0;       ///< The mask for this frame, CNFrameFlag.
   int64_t frame_id;       ///< The frame index that incremented from 0.
   int64_t timestamp;      ///< The timestamp of this frame.
@@ -132,7 +184,7 @@ struct CNDataFrame {
   void* ptr[CN_MAX_PLANES];                                  ///< The CPU or MLU data addresses for planes.
   std::shared_ptr<IDataDeallocator> deAllocator_ = nullptr;  ///< The dedicated deallocator for CNDecoder Buffer.
 
-  CNDataFrame() {}
+  CNDataFrame() { ResetModuleMask(); }
 
   ~CNDataFrame();
 
@@ -170,30 +222,117 @@ struct CNDataFrame {
   std::shared_ptr<CNSyncedMemory> data[CN_MAX_PLANES];  ///< Synce data helper.
 
 #ifdef HAVE_OPENCV
-  /*Called after CopyToSyncMem() is invoked.*/
+  /**
+   * Gets the frame in BGR24. Called after CopyToSyncMem() is invoked.
+   * The conversion runs once per frame, the modules calling it concurrently share the result.
+   */
   cv::Mat* ImageBGR();
+  /**
+   * Gets the frame in BGR24 to write to, e.g. to draw on it. Called after CopyToSyncMem() is invoked.
+   *
+   * The image is copied on write. If another branch of the pipeline still holds the frame, the module gets
+   * a private copy, the modules downstream of it read the copy by ImageBGR() and the other branches keep
+   * the original. Otherwise the image is written in place, and the images GetDerivedImage() derived from
+   * it are derived again. The copies are counted by the links into the module, see LinkStatus::cow_copies.
+   */
+  cv::Mat* MutableImageBGR();
+  /**
+   * Gets the frame converted to fmt and scaled to width x height. Each size and format is derived at most
+   * once per frame and shared by the modules, do not write to the returned image.
+   * The images are cached until the frame is released, up to the capacity set by SetDerivedImageCacheCapacity().
+   * Called after CopyToSyncMem() is invoked.
+   *
+   * @param fmt The format of the image, CN_PIXEL_FORMAT_BGR24 or CN_PIXEL_FORMAT_RGB24.
+   * @param width The width of the image.
+   * @param height The height of the image.
+   *
+   * @return Returns the image, or an empty image if the frame can not be converted.
+   */
+  cv::Mat GetDerivedImage(CNDataFormat fmt, int width, int height);
 
  private:
-  cv::Mat* bgr_mat = nullptr;
+  /* the image shared by the branches */
+  cv::Mat* SharedImageBGR();
+  /* the latest copy visible to the module, nullptr if there is none. Called with bgr_mutex_ held */
+  cv::Mat* BranchImageBGR(const Module* module);
+  /* drops the derived images which are not views of the shared image, before it is written in place */
+  void ClearDerivedImages();
+
+  std::atomic<cv::Mat*> bgr_mat{nullptr};
+  std::mutex bgr_mutex_;
+  struct BranchImage {
+    size_t owner;  // the module that copied the image, the modules downstream of it read the copy
+    std::unique_ptr<cv::Mat> image;
+  };
+  std::vector<BranchImage> branch_images_;
+  std::atomic<size_t> branch_image_num_{0};
+  struct DerivedImage {
+    CNDataFormat fmt;
+    cv::Mat image;
+    size_t bytes;  // 0 for a view of the BGR image
+  };
+  std::vector<DerivedImage> derived_images_;
+  size_t derived_bytes_ = 0;
+  std::mutex derived_mutex_;
 #endif
 
  private:
+#ifdef TEST
+ public:  // NOLINT
+#endif
   /**
    * The below methods and members are used by the framework
    */
   friend class Pipeline;
+  friend class PipelinePrivate;
+  friend struct CNFrameInfo;
+  friend class FrameMemoryBudget;
+  friend class Conveyor;
+  /* the module processing frames on this thread and the link the frame came from, set by the pipeline */
+  static void SetProcessContext(const Module* module, Connector* link);
+  /* branches of the pipeline holding the frame are forked (num > 0) or ended (num < 0) */
+  void AddBranches(int num) { branch_num_.fetch_add(num, std::memory_order_acq_rel); }
+  int GetBranchNum() const { return branch_num_.load(std::memory_order_acquire); }
+  /* clears the frame for reuse, releases the buffers and planes */
+  void Reset();
+  void ReleaseBuffers();
   void SetModuleMask(Module* module, Module* current);
   uint64_t GetModulesMask(Module* module);
-  void ClearModuleMask(Module* module);
-  uint64_t AddEOSMask(Module* module);
+  /* returns the mask cleared */
+  uint64_t ClearModuleMask(Module* module);
+  /* clears the mask if all the upstream modules have transmitted the frame to module, returns whether it did */
+  bool ClaimModuleMask(Module* module);
+  /* returns how many modules have received the eos of this frame */
+  uint32_t AddEOSCount();
+  void ResetModuleMask();
 
  private:
-  CNSpinLock mask_lock_;
-  /*The mask map of the module. It identifies which modules the data can already be processed by.*/
-  std::map<unsigned int, uint64_t> module_mask_map_;
+  std::atomic<uint64_t>* ModuleMask(size_t module_id, bool create);
 
-  CNSpinLock eos_lock_;
-  uint64_t eos_mask = 0;
+  static constexpr size_t kInlineModuleNum = 64;
+  /*
+    The mask of each module indexed by module id. It identifies which upstream modules have
+    finished with the data. No locks and no allocations, so the join of branches is cheap.
+   */
+  std::atomic<uint64_t> module_mask_[kInlineModuleNum];
+  /* masks of the module ids beyond kInlineModuleNum, only allocated for very large pipelines */
+  std::atomic<std::atomic<uint64_t>*> ext_module_mask_{nullptr};
+
+  std::atomic<uint32_t> eos_cnt{0};
+
+  /*
+    bytes allocated by CopyToSyncMem. the frame is charged them, or the bytes of its planes if it references
+    a buffer of its own, when it enters a pipeline with a memory budget.
+   */
+  size_t alloc_bytes_ = 0;
+  std::shared_ptr<FrameMemoryBudget> budget_;
+  std::atomic<size_t> budget_bytes_{0};
+  /* charges the images the frame allocates in the pipeline, e.g. ImageBGR, if it is charged already */
+  void ChargeBudget(size_t bytes);
+  /* gives back the bytes of the images the frame frees before it is released */
+  void UnchargeBudget(size_t bytes);
+  /* branches holding the frame, the images written by one of them are copied while there are others */
+  std::atomic<int> branch_num_{1};
 };  // struct CNDataFrame
 
 /**
@@ -218,6 +357,194 @@ typedef struct {
  */
 typedef std::vector<float> CNInferFeature;
 
+/**
+ * The types of values kept in metadata slots.
+ */
+enum CNMetaType {
+  CN_META_TYPE_ATTR = 0,  ///< CNInferAttr.
+  CN_META_TYPE_STRING,    ///< std::string.
+  CN_META_TYPE_INT64,     ///< int64_t.
+  CN_META_TYPE_DOUBLE,    ///< double.
+  CN_META_TYPE_NUM
+};
+
+template <typename T>
+struct CNMetaTypeOf;
+template <>
+struct CNMetaTypeOf<CNInferAttr> {
+  static constexpr CNMetaType value = CN_META_TYPE_ATTR;
+};
+template <>
+struct CNMetaTypeOf<std::string> {
+  static constexpr CNMetaType value = CN_META_TYPE_STRING;
+};
+template <>
+struct CNMetaTypeOf<int64_t> {
+  static constexpr CNMetaType value = CN_META_TYPE_INT64;
+};
+template <>
+struct CNMetaTypeOf<double> {
+  static constexpr CNMetaType value = CN_META_TYPE_DOUBLE;
+};
+
+const uint32_t INVALID_META_SLOT = (uint32_t)(-1);
+/* the max number of metadata keys of all the types, the keys registered beyond it are invalid */
+const uint32_t MAX_META_SLOT_NUM = 4096;
+
+/**
+ * The key of a metadata slot, returned by RegisterMetaKey. The value type is part of the key.
+ */
+template <typename T>
+struct CNMetaKey {
+  uint32_t slot = INVALID_META_SLOT;
+  bool IsValid() const { return INVALID_META_SLOT != slot; }
+};
+
+/* registers a (name, type) pair, returns its slot. Registering it again returns the same slot. */
+uint32_t RegisterMetaSlot(const std::string& name, CNMetaType type);
+/* returns the slot of a (name, type) pair, INVALID_META_SLOT if it is not registered */
+uint32_t FindMetaSlot(const std::string& name, CNMetaType type);
+/**
+ * Gets the number of metadata slots registered.
+ */
+uint32_t GetMetaSlotNum();
+
+/**
+ * Registers a metadata key. Modules register their keys once, usually in Open, and read or write the slots
+ * of objects and frames by the key, without hashing strings or allocating memory.
+ *
+ * @param name The name of the key. The same name with different types are different keys.
+ *
+ * @return Returns the key. Registering the same name and type again returns the same key. The key is invalid
+ *         if MAX_META_SLOT_NUM keys are registered already, so never register names made of the data.
+ */
+template <typename T>
+CNMetaKey<T> RegisterMetaKey(const std::string& name) {
+  CNMetaKey<T> key;
+  key.slot = RegisterMetaSlot(name, CNMetaTypeOf<T>::value);
+  return key;
+}
+
+/**
+ * Finds a registered metadata key.
+ *
+ * @return Returns the key, or an invalid key if the name is not registered with the type.
+ */
+template <typename T>
+CNMetaKey<T> FindMetaKey(const std::string& name) {
+  CNMetaKey<T> key;
+  key.slot = FindMetaSlot(name, CNMetaTypeOf<T>::value);
+  return key;
+}
+
+/**
+ * @class CNMetaSlots
+ *
+ * The metadata of an object or a frame. Only the slots written are stored, as (slot, value) pairs searched
+ * linearly, an object carries a few of them however many keys are registered. The memory is kept for reuse
+ * by Clear.
+ *
+ * Values can also be added by names which are not registered, for the names made of the data. They are stored
+ * with the slots, the names are compared when searching them.
+ *
+ * @note All the functions are thread-safe.
+ */
+class CNMetaSlots {
+ public:
+  CNMetaSlots() {}
+  /**
+   * Sets the value of a slot.
+   *
+   * @return Returns false if the key is invalid.
+   */
+  template <typename T>
+  bool Set(const CNMetaKey<T>& key, const T& value) {
+    return Write(key.slot, value, true);
+  }
+  /**
+   * Sets the value of a slot if it is not set yet.
+   *
+   * @return Returns false if the key is invalid or the slot is set.
+   */
+  template <typename T>
+  bool Add(const CNMetaKey<T>& key, const T& value) {
+    return Write(key.slot, value, false);
+  }
+  /**
+   * Gets the value of a slot.
+   *
+   * @return Returns false if the key is invalid or the slot is not set, the value is not changed then.
+   */
+  template <typename T>
+  bool Get(const CNMetaKey<T>& key, T* value) const {
+    return Read(key.slot, value);
+  }
+  /**
+   * Checks whether a slot is set.
+   */
+  template <typename T>
+  bool Has(const CNMetaKey<T>& key) const {
+    return IsSet(key.slot);
+  }
+  /**
+   * Adds a value by a name which is not registered, if the name is not added yet.
+   *
+   * @return Returns false if the name is added already.
+   */
+  bool AddNamed(const std::string& name, const CNInferAttr& value);
+  bool AddNamed(const std::string& name, const std::string& value);
+  /**
+   * Gets a value added by AddNamed.
+   *
+   * @return Returns false if the name is not added, the value is not changed then.
+   */
+  bool GetNamed(const std::string& name, CNInferAttr* value) const;
+  bool GetNamed(const std::string& name, std::string* value) const;
+  /**
+   * Clears all the slots and the values added by names, keeps the memory for reuse.
+   */
+  void Clear();
+
+ private:
+  /* a slot written, the strings are kept aside in strs_ */
+  struct Entry {
+    uint32_t slot;
+    uint32_t name;  // the index of the name in strs_, for the values added by names
+    union {
+      CNInferAttr attr;
+      int64_t i64;
+      double f64;
+      size_t str;  // the index in strs_
+    };
+    explicit Entry(uint32_t s) : slot(s), name(0), i64(0) {}
+  };
+  /* the values added by names take the slots after the registered ones, one per type */
+  static constexpr uint32_t NamedSlot(CNMetaType type) { return MAX_META_SLOT_NUM + type; }
+  const Entry* Find(uint32_t slot) const;
+  const Entry* FindNamed(uint32_t slot, const std::string& name) const;
+  /* returns nullptr if the slot is invalid, or it is set and not to be overwritten */
+  Entry* FindOrAdd(uint32_t slot, bool overwrite, bool* added);
+  /* returns nullptr if the name is added already */
+  Entry* AddNamedEntry(uint32_t slot, const std::string& name);
+  /* returns the index of a string in strs_, reuses the string cleared last with its capacity */
+  uint32_t NewStr(const std::string& value);
+  bool Write(uint32_t slot, const CNInferAttr& value, bool overwrite);
+  bool Write(uint32_t slot, const std::string& value, bool overwrite);
+  bool Write(uint32_t slot, const int64_t& value, bool overwrite);
+  bool Write(uint32_t slot, const double& value, bool overwrite);
+  bool Read(uint32_t slot, CNInferAttr* value) const;
+  bool Read(uint32_t slot, std::string* value) const;
+  bool Read(uint32_t slot, int64_t* value) const;
+  bool Read(uint32_t slot, double* value) const;
+  bool IsSet(uint32_t slot) const;
+
+  mutable CNSpinLock lock_;
+  std::vector<Entry> entries_;
+  std::vector<std::string> strs_;  // the first str_num_ are in use, the others keep their capacity for reuse
+  size_t str_num_ = 0;
+  DISABLE_COPY_AND_ASSIGN(CNMetaSlots);
+};  // class CNMetaSlots
+
 /**
  * A structure holding the information for an object.
  */
@@ -323,15 +650,100 @@ struct CNInferObject {
 
   void* user_data_ = nullptr;  ///< User data. User can store their own data here.
 
+  /**
+   * The typed metadata of the object, read and written by registered keys. The attributes and extended
+   * attributes above are stored in it by names, which are not registered.
+   *
+   * @see RegisterMetaKey
+   */
+  CNMetaSlots meta;
+
  private:
-  // name >>> attribute
-  std::map<std::string, CNInferAttr> attributes_;
-  std::map<std::string, std::string> extra_attributes_;
   std::vector<CNInferFeature> features_;
-  std::mutex attribute_mutex_;
-  std::mutex feature_mutex_;
+  CNSpinLock feature_lock_;
 };
 
+/**
+ * @class CNDetections
+ *
+ * The compact storage of the detections of a frame. Bounding boxes, scores, class ids and track ids are
+ * kept in separate arrays indexed by the detection, the features of all the detections share one arena.
+ * Nothing is allocated per detection, and the memory is kept for reuse when the frame is recycled.
+ *
+ * Postprocessors write detections here instead of creating CNInferObject instances. The modules reading
+ * CNFrameInfo::objs get the detections by ToObjects.
+ *
+ * @note It is not thread-safe. The modules process a frame one after another.
+ */
+class CNDetections {
+ public:
+  CNDetections() {}
+  /**
+   * Gets the number of detections.
+   */
+  size_t Size() const { return scores_.size(); }
+  bool Empty() const { return scores_.empty(); }
+  /**
+   * Reserves the memory for num detections.
+   */
+  void Reserve(size_t num);
+  /**
+   * Adds a detection.
+   *
+   * @param bbox The normalized bounding box.
+   * @param score The score.
+   * @param class_id The label value, -1 if it is unknown.
+   * @param track_id The track id, -1 if it is not tracked.
+   *
+   * @return Returns the index of the detection.
+   */
+  size_t Add(const CNInferBoundingBox& bbox, float score, int class_id, int track_id = -1);
+  void SetTrackId(size_t index, int track_id) { track_ids_[index] = track_id; }
+  /**
+   * Sets the feature of a detection. The feature is copied to the arena, setting it again leaves the
+   * old one in the arena until Clear is called.
+   */
+  void SetFeature(size_t index, const float* feature, size_t len);
+  /**
+   * Gets the feature of a detection.
+   *
+   * @param index The index of the detection.
+   * @param len The length of the feature, 0 if the detection has no feature.
+   *
+   * @return Returns the feature, valid until the detections are changed. nullptr if there is no feature.
+   */
+  const float* GetFeature(size_t index, size_t* len) const;
+  const std::vector<CNInferBoundingBox>& BBoxes() const { return bboxes_; }
+  const std::vector<float>& Scores() const { return scores_; }
+  const std::vector<int>& ClassIds() const { return class_ids_; }
+  const std::vector<int>& TrackIds() const { return track_ids_; }
+  /**
+   * Removes all the detections, keeps the memory for reuse.
+   */
+  void Clear();
+  /**
+   * Appends a CNInferObject for each detection, for the modules reading CNFrameInfo::objs.
+   * The label value and the track id are converted to CNInferObject::id and CNInferObject::track_id,
+   * an empty string for -1.
+   */
+  void ToObjects(std::vector<std::shared_ptr<CNInferObject>>* objs) const;
+  /**
+   * Appends the objects as detections. Ids that are not numbers are converted to -1, only the first
+   * feature of each object is kept. Attributes are not converted.
+   */
+  void FromObjects(const std::vector<std::shared_ptr<CNInferObject>>& objs);
+
+ private:
+  std::vector<CNInferBoundingBox> bboxes_;
+  std::vector<float> scores_;
+  std::vector<int> class_ids_;
+  std::vector<int> track_ids_;
+  /* (offset, length) of the feature of each detection in feature_arena_ */
+  std::vector<std::pair<uint32_t, uint32_t>> features_;
+  std::vector<float> feature_arena_;
+  DISABLE_COPY_AND_ASSIGN(CNDetections);
+};  // class CNDetections
+
 /**
  *  A structure holding the information of a frame.
  */
@@ -347,21 +759,87 @@ struct CNFrameInfo {
    * @return Returns a shared_ptr of CNFrameInfo if runs successfully. Otherwise, returns NULL.
    */
   static std::shared_ptr<CNFrameInfo> Create(const std::string& stream_id, bool eos = false);
+  /**
+   * Create an CNFrameInfo instance by the stream handle. It saves interning the stream id for each frame.
+   *
+   * @param stream_handle The handle returned by InternStreamId().
+   * @param eos If true, CNDataFrame::flags will set to CN_FRAME_FLAG_EOS.
+   *
+   * @return Returns a shared_ptr of CNFrameInfo if runs successfully. Otherwise, returns NULL.
+   */
+  static std::shared_ptr<CNFrameInfo> Create(uint32_t stream_handle, bool eos = false);
+  /**
+   * Create an CNFrameInfo instance, waits while the stream has "parallelism" frames in flight.
+   * The sources call it instead of polling Create(), the frames being released wake them up.
+   *
+   * @param stream_handle The handle returned by InternStreamId().
+   * @param timeout The max time to wait.
+   *
+   * @return Returns a shared_ptr of CNFrameInfo if runs successfully. Returns NULL if it timed out.
+   *
+   * @see SetParallelism
+   */
+  static std::shared_ptr<CNFrameInfo> WaitAndCreate(uint32_t stream_handle, const std::chrono::milliseconds& timeout);
   uint32_t channel_idx = INVALID_STREAM_IDX;         ///< The index of the channel, stream_index
   CNDataFrame frame;                                 ///< The data of the frame.
   std::vector<std::shared_ptr<CNInferObject>> objs;  ///< Structured information of the objects for this frame.
+  CNMetaSlots meta;                                  ///< Typed metadata of this frame. See RegisterMetaKey.
+  CNDetections dets;                                 ///< Compact detections of this frame. See CNDetections.
+  int64_t create_ns = 0;  ///< The time the frame was created, in nanoseconds of std::chrono::steady_clock.
   ~CNFrameInfo();
 
  private:
   CNFrameInfo() {}
   DISABLE_COPY_AND_ASSIGN(CNFrameInfo);
-  static cnstream::CNSpinLock spinlock_;
-  static std::map<std::string, int> stream_count_map_;
+  static std::shared_ptr<CNFrameInfo> Create(uint32_t stream_handle, bool eos, bool has_credit);
+  /* the deleter of the shared_ptr returned by Create, clears the frame and puts it back to the pool */
+  static void Recycle(CNFrameInfo* frame_info);
+  /* gives back the in-flight credit of the stream, no global lock */
+  void ReleaseCredit();
+  bool has_credit_ = false;
+  /* the time each module transmitted the frame, indexed by module id, see Pipeline::QueryModuleLatency */
+  std::vector<int64_t> transmit_ns_;
+  friend class Pipeline;
+  friend class PipelinePrivate;
 
  public:
   static int parallelism_;
 };
 
+/**
+ * Counters of CNDataFrame::GetDerivedImage.
+ */
+struct DerivedImageCacheStats {
+  uint64_t hits = 0;      ///< Images found in the cache.
+  uint64_t misses = 0;    ///< Images derived.
+  uint64_t uncached = 0;  ///< Images derived but not cached because the cache of the frame was full.
+};
+
+/**
+ * Sets the max bytes of the images cached by CNDataFrame::GetDerivedImage for each frame, 32MB by default.
+ * 0 disables the cache.
+ */
+void SetDerivedImageCacheCapacity(size_t bytes);
+size_t GetDerivedImageCacheCapacity();
+DerivedImageCacheStats GetDerivedImageCacheStats();
+
+/**
+ * Allocation counters of CNFrameInfo::Create and CNSyncedMemory::Create.
+ * Released frames and planes are recycled, so the heap counters stop growing once the pipeline
+ * runs in steady state.
+ */
+struct CNFramePoolStats {
+  uint64_t frame_heap_allocs = 0;  ///< CNFrameInfo objects allocated from the heap.
+  uint64_t frame_reuses = 0;       ///< CNFrameInfo objects recycled from the pool.
+  uint64_t block_heap_allocs = 0;  ///< Reference counts and CNSyncedMemory objects allocated from the heap.
+  uint64_t block_reuses = 0;       ///< Reference counts and CNSyncedMemory objects recycled from the pool.
+};
+
+/**
+ * Gets the allocation counters of the frame pool.
+ */
+CNFramePoolStats GetFramePoolStats();
+
 }  // namespace cnstream
 
 #endif  // CNSTREAM_FRAME_HPP_
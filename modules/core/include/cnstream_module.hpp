@@ -68,6 +68,16 @@ __attribute__((unused)) inline std::string GetPathRelativeToTheJSONFile(const st
   return ret;
 }
 
+/**
+ * Where a module accesses the frame data. The pipeline prefetches the planes of a frame to that side when
+ * the frame is queued for the module, so the copy is hidden behind the queueing time.
+ */
+enum ModuleDataAccess {
+  MODULE_DATA_ACCESS_ANY = 0,  ///< Unknown, or both sides. No prefetch. The default.
+  MODULE_DATA_ACCESS_CPU,      ///< The module reads the CPU data.
+  MODULE_DATA_ACCESS_MLU       ///< The module reads the MLU data.
+};
+
 /**
  * @brief Module virtual base class.
  *
@@ -123,8 +133,8 @@ class Module {
    * @param name The name of a module. Modules defined in a pipeline should
    *             have different names.
    */
-  explicit Module(const std::string &name) : name_(name) { this->GetId(); }
-  virtual ~Module() { this->ReturnId(); }
+  explicit Module(const std::string &name) : name_(name) {}
+  virtual ~Module() {}
 
   /**
    * Opens resources for a module.
@@ -218,19 +228,39 @@ class Module {
    */
   inline void SetContainer(Pipeline *container) { container_ = container; }
 
-  /* useless for users */
-  size_t GetId();
+  /* useless for users, the id is unique inside the pipeline, INVALID_MODULE_ID before the module is added */
+  size_t GetId() const { return id_.load(std::memory_order_acquire); }
+  /* useless for users, set by the pipeline */
+  void SetId(size_t id) { id_.store(id, std::memory_order_release); }
   /* useless for users */
   std::vector<size_t> GetParentIds() const { return parent_ids_; }
+  /* useless for users */
+  size_t GetParentNum() const { return parent_ids_.size(); }
   /* useless for users, set upstream node id to this module */
   void SetParentId(size_t id) {
+    if (GetParentMask(id)) return;
     parent_ids_.push_back(id);
-    mask_ = 0;
-    for (auto &v : parent_ids_) mask_ |= (uint64_t)1 << v;
+    mask_ = parent_ids_.size() >= kMaxParentNum ? ~(uint64_t)0 : ((uint64_t)1 << parent_ids_.size()) - 1;
+  }
+  /*
+    useless for users, returns the bit of an upstream node in the modules mask, 0 if it is not an upstream node.
+    Bits are indexed by the order of upstream nodes rather than module ids, so the mask is one word
+    no matter how many modules the pipeline holds.
+   */
+  uint64_t GetParentMask(size_t id) const {
+    for (size_t i = 0; i < parent_ids_.size(); ++i) {
+      if (parent_ids_[i] == id) return (uint64_t)1 << i;
+    }
+    return 0;
   }
 
   /* useless for users */
   uint64_t GetModulesMask() const { return mask_; }
+  /* useless for users, whether the module is this module or upstream of it, set by the pipeline when it starts */
+  bool IsUpstream(size_t id) const { return id < upstream_ids_.size() && upstream_ids_[id]; }
+
+  /* a module has no more than kMaxParentNum upstream nodes */
+  static constexpr size_t kMaxParentNum = 64;
 
   /**
    * @return Returns whether this module has permission to transmit data by itself.
@@ -247,21 +277,33 @@ class Module {
   bool ShowPerfInfo() { return showPerfInfo_.load(); }
   void ShowPerfInfo(bool enable) { showPerfInfo_.store(enable); }
 
+ public:
+  /**
+   * @return Returns where this module accesses the frame data.
+   *
+   * @see ModuleDataAccess
+   */
+  ModuleDataAccess GetDataAccess() const { return data_access_.load(); }
+
  protected:
+  /**
+   * Declares where this module accesses the frame data, usually in the constructor or Open.
+   */
+  void SetDataAccess(ModuleDataAccess access) { data_access_.store(access); }
+
   Pipeline *container_ = nullptr;         ///< The container.
   std::string name_;                      ///< The name of the module.
   std::atomic<bool> hasTransmit_{false};  ///< If it has permission to transmit data.
   std::atomic<bool> isSource_{false};     ///< If it is a source module.
+  std::atomic<ModuleDataAccess> data_access_{MODULE_DATA_ACCESS_ANY};  ///< Where it accesses the frame data.
 
  private:
-  void ReturnId();
-  size_t id_ = -1;
-  /* supports no more than 64 modules */
-  static CNSpinLock module_id_spinlock_;
-  static uint64_t module_id_mask_;
+  std::atomic<size_t> id_{INVALID_MODULE_ID};
 
   std::vector<size_t> parent_ids_;
   uint64_t mask_ = 0;
+  /* indexed by module id, this module and all the modules upstream of it */
+  std::vector<bool> upstream_ids_;
 
  protected:
   StreamFpsStat fps_stat_;
@@ -29,6 +29,7 @@
 
 #include <atomic>
 #include <future>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -95,12 +96,54 @@ class StreamMsgObserver {
 
 class PipelinePrivate;
 
+/**
+ * The way module threads are scheduled in a pipeline.
+ *
+ * @see Pipeline::SetExecutor.
+ */
+enum ExecutorType {
+  EXECUTOR_THREAD_PER_CONVEYOR = 0,  ///< Each conveyor of each module has a dedicated thread. The default mode.
+  EXECUTOR_WORK_STEALING             ///< All modules share a fixed pool of workers, idle workers steal tasks.
+};
+
 /**
  * THE link status between modules.
  */
 struct LinkStatus {
   bool stopped;                      ///< Whether the data transmissions between the modules are stopped.
   std::vector<uint32_t> cache_size;  ///< Number of data cache data in each data transmission queue between modules.
+  std::map<std::string, uint64_t> drop_count;  ///< Number of frames dropped by the overflow policy, keyed by stream id.
+  uint64_t cow_copies = 0;  ///< Number of frame images copied on write by the downstream module.
+  LatencyStats queue_latency;  ///< The time frames wait in the queues, see ModuleLatencyStats::queue.
+};
+
+/**
+ * The depth distribution and the backpressure of a conveyor of a link, sampled by the queue sampler.
+ *
+ * @see Pipeline::SetQueueSampler
+ */
+struct QueueTelemetry {
+  uint32_t capacity = 0;           ///< The capacity of the conveyor.
+  uint64_t samples = 0;            ///< The number of samples.
+  double mean_depth = 0;           ///< The mean number of frames in the conveyor.
+  uint32_t p50_depth = 0;          ///< The median depth.
+  uint32_t p90_depth = 0;          ///< The 90th percentile depth.
+  uint32_t p99_depth = 0;          ///< The 99th percentile depth.
+  uint32_t max_depth = 0;          ///< The max depth.
+  double at_capacity_percent = 0;  ///< The percentage of the samples in which the conveyor was full.
+  uint64_t blocked_pushes = 0;     ///< The pushes that found the conveyor full and waited for free space.
+  double blocked_ms = 0;           ///< The total time the producers waited for free space.
+};
+
+/**
+ * The latencies of the frames processed by a module. EOS frames are not counted.
+ *
+ * @see Pipeline::QueryModuleLatency
+ */
+struct ModuleLatencyStats {
+  LatencyStats queue;        ///< From the upstream module transmitting a frame to the module popping it.
+  LatencyStats process;      ///< From the module popping a frame to Process() returning.
+  LatencyStats from_source;  ///< From the frame being created to the module transmitting it.
 };
 
 /**
@@ -118,6 +161,9 @@ struct LinkStatus {
  *   }
  *  "parallelism(CNModuleConfig::parallelism)": 3,
  *  "max_input_queue_size(CNModuleConfig::maxInputQueueSize)": 20,
+ *  "queue_type(CNModuleConfig::inputQueueType)": "mutex",
+ *  "overflow_policy(CNModuleConfig::inputOverflowPolicy)": "block",
+ *  "keep_latest_num(CNModuleConfig::inputKeepLatestNum)": 1,
  *  "class_name(CNModuleConfig::className)": "Inferencer",
  *  "next_modules": ["module0(CNModuleConfig::name)", "module1(CNModuleConfig::name)", ...],
  * }
@@ -134,6 +180,9 @@ struct CNModuleConfig {
   std::string className;          ///< The class name of the module.
   std::vector<std::string> next;  ///< The name of the downstream modules.
   bool showPerfInfo;              ///< whether to show performance information or not.
+  LinkQueueType inputQueueType;   ///< The backend of the input data queues. LINK_QUEUE_MUTEX by default.
+  LinkOverflowPolicy inputOverflowPolicy;  ///< What the input links do when full. LINK_OVERFLOW_BLOCK by default.
+  uint32_t inputKeepLatestNum;             ///< Frames kept per stream by LINK_OVERFLOW_KEEP_LATEST_N. 1 by default.
 
   /**
    * Parses members from JSON string except CNModuleConfig::name.
@@ -150,6 +199,19 @@ struct CNModuleConfig {
   void ParseByJSONFile(const std::string& jfname) noexcept(false);
 };
 
+/**
+ * Parses the configurations of the modules of a pipeline from a JSON file, the format is the one
+ * Pipeline::BuildPipelineByJSONFile takes. The configurations can be changed before being passed to
+ * Pipeline::BuildPipeline.
+ *
+ * @param config_file The path of the JSON file.
+ *
+ * @return Returns the configurations of the modules.
+ *
+ * @note If the JSON file is parsed unsuccessfully, std::string will be thrown.
+ */
+std::vector<CNModuleConfig> ParsePipelineJSONFile(const std::string& config_file) noexcept(false);
+
 /**
  * The manager of the modules.
  * Manages data transmission between modules, and
@@ -188,9 +250,10 @@ class Pipeline : public Module {
    * @param data The data transmits to pipeline.
    *
    * @return Returns true if this function run successfully. Returns false if the module
-   *         is not added in pipeline or the pipeline has been stopped.
+   *         is not added in pipeline, the pipeline has been stopped, or the frame is dropped
+   *         by the memory budget.
    *
-   * @see Module::Process.
+   * @see Module::Process Pipeline::SetMemoryBudget.
    */
   bool ProvideData(const Module* module, std::shared_ptr<CNFrameInfo> data);
 
@@ -203,12 +266,14 @@ class Pipeline : public Module {
   /**
    * Starts a pipeline.
    * Starts data transmission in a pipeline.
+   * Sizes the stream index space with the "max_stream_num" parameter of the source modules, if any.
    * Calls the Open function for all modules, see Module::Open.
    * Links modules.
    *
    * @return Returns true if this function run successfully. Returns false if the Open
-   *         function did not run successfully in one of the modules, or
-   *         the link modules failed.
+   *         function did not run successfully in one of the modules,
+   *         the link modules failed, or "max_stream_num" is invalid or differs from
+   *         the one of the other running pipelines.
    */
   bool Start();
   /**
@@ -224,6 +289,51 @@ class Pipeline : public Module {
    *         not running.
    */
   inline bool IsRunning() const { return running_; }
+  /**
+   * Selects how module threads are scheduled.
+   *
+   * In EXECUTOR_WORK_STEALING mode, each (module, conveyor) pair is a task that runs on a fixed
+   * pool of workers. A task never runs on two workers at the same time, so the frames of one
+   * channel keep their order within a module as in the default mode.
+   *
+   * @param type The executor type, EXECUTOR_THREAD_PER_CONVEYOR by default.
+   * @param worker_num The number of workers in EXECUTOR_WORK_STEALING mode. 0 means the number of cpu cores.
+   *
+   * @return Returns false if the pipeline is running. Otherwise, returns true.
+   *
+   * @note You must call this function before calling Pipeline::Start.
+   */
+  bool SetExecutor(ExecutorType type, uint32_t worker_num = 0);
+  /**
+   * Gets the executor type.
+   *
+   * @return Returns the executor type.
+   */
+  ExecutorType GetExecutorType() const;
+  /**
+   * Sets the memory budget, the max bytes of the frame buffers in flight in the pipeline.
+   *
+   * A frame is charged the buffers allocated by CNDataFrame::CopyToSyncMem, or the bytes of its planes if it
+   * references a buffer of its own, when it is provided to the pipeline. The images it allocates in the pipeline,
+   * e.g. by CNDataFrame::ImageBGR, are charged as they are allocated. The charges are given back when the frame
+   * is released. When a new frame does not fit in the budget, the source
+   * waits for the frames in flight to be released, or the frame is dropped, depending on the policy.
+   * A frame is always admitted when nothing is in flight.
+   *
+   * @param bytes The budget. 0 means unlimited, the default.
+   * @param policy What to do with a frame that does not fit in the budget.
+   *
+   * @note It can be called while the pipeline is running. The waiting sources are woken up when the pipeline stops.
+   *
+   * @see MemoryBudgetPolicy Pipeline::ProvideData.
+   */
+  void SetMemoryBudget(size_t bytes, MemoryBudgetPolicy policy = MEMORY_BUDGET_BLOCK);
+  /**
+   * Gets the memory budget and the bytes in flight.
+   *
+   * @return Returns the memory budget status.
+   */
+  MemoryBudgetStatus GetMemoryBudgetStatus() const;
 
  public:
   /**
@@ -349,6 +459,14 @@ class Pipeline : public Module {
    *
    * @param up_node The upstream module.
    * @param down_node The downstream module.
+   * @param queue_capacity The maximum size of each data queue of the link.
+   * @param queue_type The data queue backend of the link. LINK_QUEUE_SPSC is only honored when
+   *                   up_node is pushed by a single thread (parallelism 1, not a source module, and
+   *                   not transmitting by itself). Otherwise LINK_QUEUE_MPMC is used.
+   * @param policy What the link does with new data when a data queue is full. The drop policies
+   *               use LINK_QUEUE_MUTEX whatever queue_type is. Dropped frames are counted per stream,
+   *               see Pipeline::QueryLinkStatus.
+   * @param keep_latest_num Frames kept for each stream in a data queue, used by LINK_OVERFLOW_KEEP_LATEST_N.
    *
    * @return Returns the link-index if this function run successfully. The link-index can
    *         used to query link status between up_node and down_node,
@@ -361,7 +479,8 @@ class Pipeline : public Module {
    * @see Pipeline::QueryStatus.
    */
   std::string LinkModules(std::shared_ptr<Module> up_node, std::shared_ptr<Module> down_node,
-                          size_t queue_capacity = 20);
+                          size_t queue_capacity = 20, LinkQueueType queue_type = LINK_QUEUE_MUTEX,
+                          LinkOverflowPolicy policy = LINK_OVERFLOW_BLOCK, uint32_t keep_latest_num = 1);
 
  public:
   /**
@@ -376,6 +495,64 @@ class Pipeline : public Module {
    * @see Pipeline::LinkModules.
    */
   bool QueryLinkStatus(LinkStatus* status, const std::string& link_id);
+  /**
+   * Queries the latencies of the frames processed by a module, the queue wait and the processing time
+   * locate where the latency lives.
+   *
+   * @param stats The latencies to be query.
+   * @param module_name The name of the module.
+   *
+   * @return Returns true if this function run successfully. Otherwise, returns false.
+   *
+   * @see ModuleLatencyStats.
+   */
+  bool QueryModuleLatency(ModuleLatencyStats* stats, const std::string& module_name) const;
+  /**
+   * Gets the end-to-end latencies, from a frame being created to a module without downstream modules
+   * transmitting it. A frame reaching n such modules is counted n times.
+   *
+   * @return Returns the end-to-end latencies.
+   */
+  LatencyStats GetEndToEndLatency() const;
+  /**
+   * Clears the latencies of the modules, the links and the end-to-end ones.
+   */
+  void ResetLatencyStats();
+  /**
+   * Samples the depth of each conveyor in the background while the pipeline is running. Disabled by default.
+   * Each sample also checks for a bottleneck module: its input queue is full while its output queues are empty.
+   *
+   * @param interval_ms The sampling interval. 0 disables the sampler.
+   * @param summary_interval_s The interval of logging the telemetry and the bottleneck. 0 disables the log.
+   *
+   * @note It takes effect when the pipeline starts, and the telemetry of the last run is cleared then.
+   *
+   * @see Pipeline::QueryQueueTelemetry Pipeline::GetBottleneckModule.
+   */
+  void SetQueueSampler(uint32_t interval_ms, uint32_t summary_interval_s = 0);
+  /**
+   * Queries the telemetry of each conveyor of a link, sampled by the queue sampler.
+   *
+   * @param telemetry The telemetry to be query, one for each conveyor.
+   * @param link_id Link-index returned by Pipeline::LinkModules.
+   *
+   * @return Returns true if this function run successfully. Otherwise, returns false.
+   */
+  bool QueryQueueTelemetry(std::vector<QueueTelemetry>* telemetry, const std::string& link_id) const;
+  /**
+   * Clears the telemetry and the bottleneck counts sampled so far, e.g. at the end of a warmup. The sampling
+   * goes on if the pipeline is running.
+   */
+  void ResetQueueTelemetry();
+  /**
+   * Gets the module that was the bottleneck in the most samples: its input queue was full while
+   * its output queues were empty. A module without downstream modules counts as having empty output queues.
+   *
+   * @param percent If not nullptr, it is set to the percentage of the samples in which the module was the bottleneck.
+   *
+   * @return Returns the name of the module, or an empty string if no module was.
+   */
+  std::string GetBottleneckModule(double* percent = nullptr) const;
 
   /**
    * Prints the performance information for all modules.
@@ -41,7 +41,12 @@ namespace cnstream {
 class SourceHandler;
 class SourceModule : public Module {
  public:
-  explicit SourceModule(const std::string &name) : Module(name) { isSource_.store(true); }
+  explicit SourceModule(const std::string &name) : Module(name) {
+    isSource_.store(true);
+    param_register_.Register("max_stream_num",
+                             "Size of the stream index space, applied when the pipeline starts. "
+                             "All the pipelines running at once must agree on it. 64 by default.");
+  }
   /**
    * @brief Add one stream to DataSource module, should be called after pipeline starts.
    * @param
@@ -91,6 +96,15 @@ class SourceModule : public Module {
   int RemoveSources();
 
  private:
+  friend class Pipeline;
+  /*
+    called by the pipeline when it starts, resizes the stream index space to num unless num is 0.
+    returns false if it has to be resized while another pipeline is running or indexes are in use.
+   */
+  static bool AcquireStreamIndexSpace(uint32_t num);
+  /* called by the pipeline when it stops */
+  static void ReleaseStreamIndexSpace();
+
   std::mutex mutex_;
   std::map<std::string /*stream_id*/, std::shared_ptr<SourceHandler>> source_map_;
 };
@@ -100,6 +114,7 @@ class SourceHandler {
   explicit SourceHandler(SourceModule *module, const std::string &stream_id, int frame_rate, bool loop)
       : module_(module), stream_id_(stream_id), frame_rate_(frame_rate), loop_(loop) {
     stream_index_ = module_->GetStreamIndex(stream_id_);
+    stream_handle_ = InternStreamId(stream_id_);
   }
   virtual ~SourceHandler() { module_->ReturnStreamIndex(stream_id_); }
 
@@ -109,6 +124,8 @@ class SourceHandler {
  public:
   std::string GetStreamId() const { return stream_id_; }
   uint32_t GetStreamIndex() const { return stream_index_; }
+  /* creates the frames with it, see CNFrameInfo::Create(uint32_t, bool) */
+  uint32_t GetStreamHandle() const { return stream_handle_; }
   bool SendData(std::shared_ptr<CNFrameInfo> data) {
     if (this->module_) {
       return this->module_->SendData(data);
@@ -122,6 +139,7 @@ class SourceHandler {
   int frame_rate_ = 0;
   bool loop_ = false;
   uint32_t stream_index_;
+  uint32_t stream_handle_;
 };
 
 }  // namespace cnstream
@@ -29,8 +29,10 @@
 
 #include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 
@@ -39,73 +41,82 @@
 
 namespace cnstream {
 
+/*
+  the fps of each stream seen by a module. the streams are indexed by stream handle, Update takes no lock
+  and looks nothing up but the chunk of the handle.
+ */
 struct StreamFpsStat {
-  void Update(const std::shared_ptr<CNFrameInfo> data) {
-    std::unique_lock<std::mutex> lock(mutex_);
-    std::string stream_id = data->frame.stream_id;
-    auto it = map_fps_.find(stream_id);
-    if (it == map_fps_.end()) {
-      StreamFps stat;
-      map_fps_[stream_id] = stat;
-    }
-    map_fps_[stream_id].Update(data);
-  }
-
-  double Fps(const std::string &stream_id) {
-    std::unique_lock<std::mutex> lock(mutex_);
-    auto it = map_fps_.find(stream_id);
-    if (it == map_fps_.end()) {
-      return 0.0f;
-    }
-    return map_fps_[stream_id].Fps();
-  }
-
-  void PrintFps(const std::string &moduleName) {
-    double total_fps = 0.0;
-    std::unique_lock<std::mutex> lock(mutex_);
-    std::cout << "-----------------------";
-    std::cout << moduleName;
-    std::cout << " -- show Fps Statistics -------------------------" << std::endl;
-    for (auto &it : map_fps_) {
-      std::cout << it.second.stream_id_;
-      std::cout << " -- fps: ";
-      std::cout << it.second.Fps();
-      std::cout << ",  frame_count :";
-      std::cout << it.second.frame_count_;
-      std::cout << std::endl;
-      total_fps += it.second.Fps();
-    }
-    std::cout << "Total fps:" << total_fps << std::endl;
-  }
+  StreamFpsStat();
+  ~StreamFpsStat();
+  void Update(const std::shared_ptr<CNFrameInfo> data);
+  double Fps(const std::string &stream_id);
+  void PrintFps(const std::string &moduleName);
 
  private:
+  static constexpr uint32_t kChunkSize = 1024;
+  static constexpr uint32_t kMaxChunkNum = 1024;
   struct StreamFps {
-    std::chrono::time_point<std::chrono::high_resolution_clock> start_time_;
-    std::chrono::time_point<std::chrono::high_resolution_clock> end_time_;
-    std::string stream_id_;
-    uint64_t frame_count_ = 0;
-    void Update(std::shared_ptr<CNFrameInfo> data) {
-      if (stream_id_.empty()) {
-        stream_id_ = data->frame.stream_id;
-        start_time_ = end_time_ = std::chrono::high_resolution_clock::now();
-      }
-      if (!(data->frame.flags & CN_FRAME_FLAG_EOS)) {
-        ++frame_count_;
-        end_time_ = std::chrono::high_resolution_clock::now();
-      }
-    }
-    double Fps() {
-      std::chrono::duration<double, std::milli> diff = end_time_ - start_time_;
-      if (diff.count()) {
-        return (frame_count_ * 1000 * 1.f / diff.count());
-      }
-      return 0.0f;
-    }
+    std::atomic<int64_t> start_ns{0};  // 0 until the stream is seen
+    std::atomic<int64_t> end_ns{0};
+    std::atomic<uint64_t> frame_count{0};
+    double Fps() const;
   };
-  std::mutex mutex_;
-  std::map<std::string, StreamFps> map_fps_;
+  /* returns nullptr if the handle is invalid */
+  StreamFps *Get(uint32_t stream_handle, bool create);
+  std::mutex mutex_;  // creates the chunks
+  std::atomic<StreamFps *> chunks_[kMaxChunkNum];
+  DISABLE_COPY_AND_ASSIGN(StreamFpsStat);
+};
+
+/**
+ * The percentiles of the latencies recorded by a LatencyHistogram, in microseconds.
+ */
+struct LatencyStats {
+  uint64_t count = 0;   ///< The number of latencies recorded.
+  double mean_us = 0;   ///< The mean latency.
+  double p50_us = 0;    ///< The median latency.
+  double p90_us = 0;    ///< The 90th percentile latency.
+  double p99_us = 0;    ///< The 99th percentile latency.
+  double max_us = 0;    ///< The max latency.
 };
 
+/**
+ * A latency histogram with log-linear buckets, like HdrHistogram. Each power of 2 is split into
+ * kSubBucketNum buckets, so the percentiles are off by less than 1/kSubBucketNum. Record() is lock-free
+ * and may be called by any number of threads.
+ */
+class LatencyHistogram {
+ public:
+  static constexpr int kSubBucketBits = 4;
+  static constexpr int kSubBucketNum = 1 << kSubBucketBits;
+  static constexpr int kBucketNum = (64 - kSubBucketBits + 1) * kSubBucketNum;
+
+  LatencyHistogram() { Reset(); }
+  /**
+   * Records a latency.
+   *
+   * @param ns The latency in nanoseconds, negative ones are taken as 0.
+   */
+  void Record(int64_t ns);
+  /**
+   * Gets the percentiles of the latencies recorded since the last Reset().
+   */
+  LatencyStats GetStats() const;
+  /**
+   * Clears the latencies. The latencies recorded at the same time may be lost.
+   */
+  void Reset();
+
+ private:
+  DISABLE_COPY_AND_ASSIGN(LatencyHistogram);
+  static int BucketIndex(uint64_t value);
+  /* the highest value of the bucket */
+  static uint64_t BucketValue(int idx);
+  std::atomic<uint64_t> counts_[kBucketNum];
+  std::atomic<uint64_t> sum_{0};
+  std::atomic<uint64_t> max_{0};
+};  // class LatencyHistogram
+
 }  // namespace cnstream
 
 #endif  // CNSTREAM_STATISTIC_HPP_
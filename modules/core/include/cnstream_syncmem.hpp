@@ -37,11 +37,93 @@
  */
 
 #include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "cnstream_devmem.hpp"
 
 namespace cnstream {
 
 /**
- * Allocates data on a host.
+ * The statistics of a MemoryPool.
+ */
+struct MemoryPoolStats {
+  uint64_t hits = 0;          ///< Allocations served by the buffers cached in the pool.
+  uint64_t misses = 0;        ///< Allocations served by the system allocator.
+  uint64_t bytes_in_use = 0;  ///< Bytes allocated and not freed yet.
+  uint64_t bytes_cached = 0;  ///< Bytes freed and cached for reuse. Bytes resident are bytes_in_use + bytes_cached.
+};
+
+/**
+ * @class MemoryPool
+ * The interface of the allocators backing CNStreamMallocHost.
+ */
+class MemoryPool {
+ public:
+  virtual ~MemoryPool() {}
+  /**
+   * Allocates a buffer.
+   *
+   * @return Returns the buffer, or nullptr if it fails.
+   */
+  virtual void* Alloc(size_t size) = 0;
+  /**
+   * Frees a buffer allocated by this pool.
+   *
+   * @param ptr The buffer.
+   * @param size The size passed to Alloc.
+   */
+  virtual void Free(void* ptr, size_t size) = 0;
+  virtual MemoryPoolStats GetStats() = 0;
+};
+
+/**
+ * Sets the pool used by CNStreamMallocHost. The buffers allocated before are still freed by their own pool,
+ * so a pool must live until all the buffers allocated from it are freed.
+ *
+ * @param pool The pool, nullptr restores the default pool, which caches frame sized buffers by size classes.
+ */
+void SetHostMemoryPool(MemoryPool* pool);
+/**
+ * Gets the pool used by CNStreamMallocHost.
+ */
+MemoryPool* GetHostMemoryPool();
+
+/**
+ * The huge page backing of the host memory pool buffers.
+ */
+enum HostHugePageMode {
+  HOST_HUGE_PAGE_NONE = 0,     ///< Allocated by malloc. The default.
+  HOST_HUGE_PAGE_TRANSPARENT,  ///< 2MB aligned anonymous mappings advised with MADV_HUGEPAGE.
+  HOST_HUGE_PAGE_EXPLICIT      ///< MAP_HUGETLB mappings, falls back to HOST_HUGE_PAGE_TRANSPARENT if none is reserved.
+};
+
+/**
+ * The options of the pools created by CreateHostMemoryPool.
+ */
+struct HostMemoryPoolOptions {
+  HostHugePageMode huge_page = HOST_HUGE_PAGE_NONE;  ///< The backing of the buffers of 2MB or larger.
+  /**
+   * Binds the buffers of 2MB or larger to the NUMA node of the allocating thread, usually the source thread
+   * calling CNDataFrame::CopyToSyncMem. The cached buffers are only reused on the node they are bound to.
+   */
+  bool numa_local = false;
+  size_t max_cached_bytes = 512 << 20;  ///< The max bytes of the buffers cached for reuse.
+};
+
+/**
+ * Creates a pool caching the buffers by size classes like the default pool, with the options.
+ * Set it by SetHostMemoryPool, and delete it after all the buffers allocated from it are freed.
+ *
+ * @param options The options of the pool.
+ *
+ * @return Returns the pool.
+ */
+MemoryPool* CreateHostMemoryPool(const HostMemoryPoolOptions& options);
+
+/**
+ * Allocates data on a host from the host memory pool.
  *
  * @param ptr Outputs data pointer.
  * @param size Size of the data to allocate.
@@ -49,11 +131,13 @@ namespace cnstream {
 void CNStreamMallocHost(void** ptr, size_t size);
 
 /**
- * Frees the data allocated by CNStreamMallocHost.
+ * Frees the data allocated by CNStreamMallocHost, the data goes back to its pool.
  *
  * @param ptr The data address to be freed.
  */
-inline void CNStreamFreeHost(void* ptr) { free(ptr); }
+void CNStreamFreeHost(void* ptr);
+
+class PrefetchQueue;
 
 /*
   @attention
@@ -87,6 +171,19 @@ class CNSyncedMemory {
    */
   CNSyncedMemory(size_t size, int mlu_dev_id, int mlu_ddr_chn);
   ~CNSyncedMemory();
+  /**
+   * Creates a CNSyncedMemory from the recycling pool. The object and its reference count share
+   * one pooled block, prefer it to new for the planes created for every frame.
+   *
+   * @param size The size of the memory.
+   */
+  static std::shared_ptr<CNSyncedMemory> Create(size_t size);
+  /**
+   * Creates a CNSyncedMemory on an MLU from the recycling pool.
+   *
+   * @see CNSyncedMemory(size_t size, int mlu_dev_id, int mlu_ddr_chn)
+   */
+  static std::shared_ptr<CNSyncedMemory> Create(size_t size, int mlu_dev_id, int mlu_ddr_chn);
   /**
    * Gets the CPU data.
    *
@@ -151,6 +248,24 @@ class CNSyncedMemory {
    * @return Returns the MLU data pointer.
    */
   void* GetMutableMluData();
+  /**
+   * Starts copying the data to CPU and returns immediately. The head becomes SYNCED at once,
+   * GetCpuData and GetMutableCpuData wait only until the copy is done.
+   * The data is copied at once if the backend can not copy pageable host memory asynchronously,
+   * see DevAsyncCopyPageable.
+   *
+   * @note Does nothing unless the head is at MLU.
+   */
+  void PrefetchToCpu();
+  /**
+   * Starts copying the data to MLU and returns immediately. The head becomes SYNCED at once,
+   * GetMluData and GetMutableMluData wait only until the copy is done.
+   * The data is copied at once if the backend can not copy pageable host memory asynchronously,
+   * see DevAsyncCopyPageable.
+   *
+   * @note Does nothing unless the head is at CPU.
+   */
+  void PrefetchToMlu();
   /**
    * Synced head.
    */
@@ -182,6 +297,13 @@ class CNSyncedMemory {
    * Synchronizes the memory data to MLU.
    */
   void ToMlu();
+  void Prefetch(void* dst, const void* src, DevMemcpyDir dir);
+  /* waits for the prefetch in progress, mutex_ must be held */
+  void WaitPrefetch();
+
+  std::mutex mutex_;                         ///< Guards the head changes.
+  DevNotifier* prefetch_ = nullptr;          ///< Reached when the prefetch in progress is done.
+  PrefetchQueue* prefetch_queue_ = nullptr;  ///< The queue of the prefetch in progress, it takes the notifier back.
 
   void* cpu_ptr_ = nullptr;  ///< CPU data pointer.
   void* mlu_ptr_ = nullptr;  ///< MLU data pointer.
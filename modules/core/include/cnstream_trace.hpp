@@ -0,0 +1,124 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_TRACE_HPP_
+#define CNSTREAM_TRACE_HPP_
+
+/**
+ * @file cnstream_trace.hpp
+ *
+ * This file contains the tracing of the pipeline execution. The spans are exported as Chrome trace events,
+ * which can be viewed by chrome://tracing or https://ui.perfetto.dev.
+ */
+
+#include <cstdint>
+#include <string>
+
+namespace cnstream {
+
+/**
+ * Enables or disables the tracing, disabled by default. The spans are kept in a ring buffer of each thread
+ * recording them, the oldest ones are overwritten. A disabled span costs an atomic load.
+ *
+ * @param enable Whether to record the spans.
+ */
+void SetTraceEnabled(bool enable);
+bool IsTraceEnabled();
+/**
+ * Sets the number of spans kept by each thread, 65536 by default. The buffers allocated already are not resized.
+ *
+ * @param events The number of spans.
+ */
+void SetTraceBufferSize(size_t events);
+/**
+ * Interns the name of spans. The ids are never released, register the names once instead of for each span.
+ *
+ * @param name The name of the spans, such as the name of a module.
+ *
+ * @return Returns the id of the name.
+ */
+uint32_t RegisterTraceName(const std::string& name);
+/**
+ * Records a span on the calling thread.
+ *
+ * @param category The category of the span. It must be a string literal, the pointer is kept.
+ * @param name The id returned by RegisterTraceName.
+ * @param begin_ns The begin time, in nanoseconds of std::chrono::steady_clock.
+ * @param end_ns The end time, in nanoseconds of std::chrono::steady_clock.
+ * @param arg Shown as the arg of the span, such as the frame id. Not shown if it is negative.
+ */
+void TraceSpan(const char* category, uint32_t name, int64_t begin_ns, int64_t end_ns, int64_t arg = -1);
+/**
+ * Writes the spans ended in the last seconds to a file in the Chrome trace event JSON format.
+ *
+ * @param path The path of the file.
+ * @param last_seconds The spans ended before it are not written.
+ *
+ * @note The spans of a thread exited more than 60 seconds ago may have been dropped to reuse its buffer.
+ *
+ * @return Returns true if the file is written. Otherwise, returns false.
+ */
+bool DumpTrace(const std::string& path, double last_seconds = 10);
+/**
+ * Dumps the trace to a file each time the process receives SIGUSR2, e.g. `kill -USR2 <pid>` when a pipeline
+ * stalls. The file is overwritten by each dump.
+ *
+ * @param path The path of the file.
+ * @param last_seconds The spans ended before it are not written.
+ *
+ * @return Returns true if the signal handler is installed. Otherwise, returns false.
+ *
+ * @note It replaces the handler of SIGUSR2 installed by the application.
+ */
+bool SetTraceDumpSignal(const std::string& path, double last_seconds = 10);
+
+/**
+ * Records a span from the construction to the destruction, if the tracing is enabled at the construction.
+ */
+class TraceScope {
+ public:
+  TraceScope(const char* category, uint32_t name, int64_t arg = -1);
+  ~TraceScope();
+
+ private:
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+  const char* category_;
+  uint32_t name_;
+  int64_t arg_;
+  int64_t begin_ns_ = 0;
+};  // class TraceScope
+
+}  // namespace cnstream
+
+#define CNS_TRACE_CONCAT_IMPL(a, b) a##b
+#define CNS_TRACE_CONCAT(a, b) CNS_TRACE_CONCAT_IMPL(a, b)
+
+/**
+ * Records a span named by a string literal until the end of the scope, the name is registered once.
+ * CNS_TRACE_SCOPE_ARG shows the arg as well, such as the frame id.
+ */
+#define CNS_TRACE_SCOPE_ARG(category, name, arg)                                                           \
+  static const uint32_t CNS_TRACE_CONCAT(cns_trace_name_, __LINE__) = cnstream::RegisterTraceName(name); \
+  cnstream::TraceScope CNS_TRACE_CONCAT(cns_trace_scope_, __LINE__)(                                     \
+      category, CNS_TRACE_CONCAT(cns_trace_name_, __LINE__), arg)
+#define CNS_TRACE_SCOPE(category, name) CNS_TRACE_SCOPE_ARG(category, name, -1)
+
+#endif  // CNSTREAM_TRACE_HPP_
@@ -0,0 +1,138 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnstream_devmem.hpp"
+
+#ifndef CNS_HOST_DEVICE
+
+#include <cnrt.h>
+#include <glog/logging.h>
+
+namespace cnstream {
+
+static bool SetDevContext(int dev_id, int ddr_chn) {
+  if (dev_id >= 0) {
+    cnrtDev_t dev;
+    if (CNRT_RET_SUCCESS != cnrtGetDeviceHandle(&dev, dev_id)) return false;
+    if (CNRT_RET_SUCCESS != cnrtSetCurrentDevice(dev)) return false;
+  }
+  if (ddr_chn >= 0) {
+    if (CNRT_RET_SUCCESS != cnrtSetCurrentChannel(static_cast<cnrtChannelType_t>(ddr_chn))) return false;
+  }
+  return true;
+}
+
+static cnrtMemTransDir_t ToCnrtDir(DevMemcpyDir dir) {
+  switch (dir) {
+    case DEV_MEMCPY_HOST2DEV:
+      return CNRT_MEM_TRANS_DIR_HOST2DEV;
+    case DEV_MEMCPY_DEV2HOST:
+      return CNRT_MEM_TRANS_DIR_DEV2HOST;
+    default:
+      return CNRT_MEM_TRANS_DIR_DEV2DEV;
+  }
+}
+
+const char* GetDevMemBackend() { return "cnrt"; }
+
+bool DevCheck(int dev_id) {
+  cnrtDev_t dev;
+  return CNRT_RET_SUCCESS == cnrtGetDeviceHandle(&dev, dev_id);
+}
+
+void* DevMalloc(size_t size, int dev_id, int ddr_chn) {
+  void* ptr = nullptr;
+  if (!SetDevContext(dev_id, ddr_chn) || CNRT_RET_SUCCESS != cnrtMalloc(&ptr, size)) {
+    LOG(ERROR) << "cnrtMalloc failed, size: " << size << " device: " << dev_id << " ddr channel: " << ddr_chn;
+    return nullptr;
+  }
+  return ptr;
+}
+
+void DevFree(void* ptr, int dev_id, int ddr_chn) {
+  if (!ptr) return;
+  LOG_IF(FATAL, !SetDevContext(dev_id, ddr_chn)) << "Can not set device context: " << dev_id << ", " << ddr_chn;
+  CNS_CNRT_CHECK(cnrtFree(ptr));
+}
+
+bool DevMemcpy(void* dst, const void* src, size_t size, DevMemcpyDir dir, int dev_id, int ddr_chn) {
+  if (!SetDevContext(dev_id, ddr_chn)) return false;
+  return CNRT_RET_SUCCESS == cnrtMemcpy(dst, const_cast<void*>(src), size, ToCnrtDir(dir));
+}
+
+bool DevAsyncCopyPageable() { return false; }
+
+class DevQueuePrivate {
+ public:
+  cnrtQueue_t queue = nullptr;
+  int dev_id;
+  int ddr_chn;
+};  // class DevQueuePrivate
+
+DevQueue::DevQueue(int dev_id, int ddr_chn) {
+  d_ptr_ = new DevQueuePrivate;
+  d_ptr_->dev_id = dev_id;
+  d_ptr_->ddr_chn = ddr_chn;
+  LOG_IF(FATAL, !SetDevContext(dev_id, ddr_chn)) << "Can not set device context: " << dev_id << ", " << ddr_chn;
+  CNS_CNRT_CHECK(cnrtCreateQueue(&d_ptr_->queue));
+}
+
+DevQueue::~DevQueue() {
+  if (d_ptr_->queue) cnrtDestroyQueue(d_ptr_->queue);
+  delete d_ptr_;
+}
+
+bool DevQueue::MemcpyAsync(void* dst, const void* src, size_t size, DevMemcpyDir dir) {
+  if (!SetDevContext(d_ptr_->dev_id, d_ptr_->ddr_chn)) return false;
+  return CNRT_RET_SUCCESS == cnrtMemcpyAsync(dst, const_cast<void*>(src), size, d_ptr_->queue, ToCnrtDir(dir));
+}
+
+bool DevQueue::Sync() { return CNRT_RET_SUCCESS == cnrtSyncQueue(d_ptr_->queue); }
+
+class DevNotifierPrivate {
+ public:
+  cnrtNotifier_t notifier = nullptr;
+};  // class DevNotifierPrivate
+
+DevNotifier::DevNotifier() {
+  d_ptr_ = new DevNotifierPrivate;
+  CNS_CNRT_CHECK(cnrtCreateNotifier(&d_ptr_->notifier));
+}
+
+DevNotifier::~DevNotifier() {
+  if (d_ptr_->notifier) cnrtDestroyNotifier(&d_ptr_->notifier);
+  delete d_ptr_;
+}
+
+bool DevNotifier::Place(DevQueue* queue) {
+  return CNRT_RET_SUCCESS == cnrtPlaceNotifier(d_ptr_->notifier, queue->d_ptr_->queue);
+}
+
+bool DevNotifier::Wait() { return CNRT_RET_SUCCESS == cnrtWaitNotifier(d_ptr_->notifier); }
+
+float DevNotifier::Duration(DevNotifier* start, DevNotifier* end) {
+  float us = 0;
+  if (CNRT_RET_SUCCESS != cnrtNotifierDuration(start->d_ptr_->notifier, end->d_ptr_->notifier, &us)) return -1;
+  return us / 1000;
+}
+
+}  // namespace cnstream
+
+#endif  // CNS_HOST_DEVICE
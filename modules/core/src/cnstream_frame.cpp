@@ -20,75 +20,254 @@
 
 #include "cnstream_frame.hpp"
 
-#include <cnrt.h>
 #include <glog/logging.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
+#include "cnstream_devmem.hpp"
 #include "cnstream_module.hpp"
+#include "color_convert.hpp"
+#include "connector.hpp"
+#include "memory_budget.hpp"
+#include "pool_allocator.hpp"
 
-#define ROUND_UP(addr, boundary) (((u32_t)(addr) + (boundary)-1) & ~((boundary)-1))
+#define ROUND_UP(addr, boundary) (((uint32_t)(addr) + (boundary)-1) & ~((boundary)-1))
 
 namespace cnstream {
 
 CNDataFrame::~CNDataFrame() {
+  ReleaseBuffers();
+  delete[] ext_module_mask_.load();
+}
+
+void CNDataFrame::ReleaseBuffers() {
   if (nullptr != mlu_data) {
-    CALL_CNRT_BY_CONTEXT(cnrtFree(mlu_data), ctx.dev_id, ctx.ddr_channel);
+    DevFree(mlu_data, ctx.dev_id, ctx.ddr_channel);
+    mlu_data = nullptr;
   }
   if (nullptr != cpu_data) {
     CNStreamFreeHost(cpu_data), cpu_data = nullptr;
   }
 #ifdef HAVE_OPENCV
-  if (nullptr != bgr_mat) {
-    delete bgr_mat, bgr_mat = nullptr;
-  }
+  delete bgr_mat.exchange(nullptr);
+  branch_images_.clear();
+  branch_image_num_.store(0, std::memory_order_relaxed);
+  derived_images_.clear();
+  derived_bytes_ = 0;
 #endif
+  alloc_bytes_ = 0;
+  if (budget_) {
+    budget_->Release(budget_bytes_.exchange(0));
+    budget_.reset();
+  }
+}
+
+void CNDataFrame::ChargeBudget(size_t bytes) {
+  if (!budget_ || 0 == bytes) return;
+  budget_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+  budget_->Charge(bytes);
+}
+
+void CNDataFrame::UnchargeBudget(size_t bytes) {
+  if (!budget_ || 0 == bytes) return;
+  budget_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+  budget_->Release(bytes);
+}
+
+void CNDataFrame::Reset() {
+  ReleaseBuffers();
+  for (int i = 0; i < CN_MAX_PLANES; ++i) {
+    data[i].reset();
+    ptr[i] = nullptr;
+    stride[i] = 0;
+  }
+  deAllocator_.reset();
+  stream_id = StreamIdRef();
+  stream_handle = INVALID_STREAM_HANDLE;
+  flags = 0;
+  frame_id = 0;
+  timestamp = 0;
+  fmt = CN_INVALID;
+  width = 0;
+  height = 0;
+  ctx = DevContext();
+  branch_num_.store(1, std::memory_order_relaxed);
+  ResetModuleMask();
+}
+
+static thread_local const Module* process_module = nullptr;
+static thread_local Connector* process_link = nullptr;
+
+void CNDataFrame::SetProcessContext(const Module* module, Connector* link) {
+  process_module = module;
+  process_link = link;
 }
 
 #ifdef HAVE_OPENCV
 cv::Mat* CNDataFrame::ImageBGR() {
-  if (bgr_mat != nullptr) {
-    return bgr_mat;
+  if (0 != branch_image_num_.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lk(bgr_mutex_);
+    cv::Mat* image = BranchImageBGR(process_module);
+    // the copies are kept until the frame is released
+    if (nullptr != image) return image;
   }
-  int stride_ = stride[0];
-  cv::Mat bgr(height, stride_, CV_8UC3);
-  uint8_t* img_data = new uint8_t[GetBytes()];
-  uint8_t* t = img_data;
-  for (int i = 0; i < GetPlanes(); ++i) {
-    memcpy(t, data[i]->GetCpuData(), GetPlaneBytes(i));
-    t += GetPlaneBytes(i);
+  return SharedImageBGR();
+}
+
+cv::Mat* CNDataFrame::BranchImageBGR(const Module* module) {
+  if (nullptr == module) return nullptr;
+  // the later copies are made downstream of the earlier ones
+  for (auto it = branch_images_.rbegin(); it != branch_images_.rend(); ++it) {
+    if (module->IsUpstream(it->owner)) return it->image.get();
+  }
+  return nullptr;
+}
+
+cv::Mat* CNDataFrame::MutableImageBGR() {
+  const Module* module = process_module;
+  cv::Mat* image = ImageBGR();
+  if (nullptr == image) return image;
+  // no other branch reads the image, or the module is not run by a pipeline
+  if (nullptr == module || GetBranchNum() <= 1) {
+    // written in place, only the images derived from the shared one are cached
+    if (image == bgr_mat.load(std::memory_order_acquire)) ClearDerivedImages();
+    return image;
+  }
+  std::lock_guard<std::mutex> lk(bgr_mutex_);
+  for (auto& it : branch_images_) {
+    // copied by the module already
+    if (it.owner == module->GetId() && it.image.get() == image) return image;
+  }
+  BranchImage copy;
+  copy.owner = module->GetId();
+  copy.image.reset(new cv::Mat(image->clone()));
+  ChargeBudget(copy.image->total() * copy.image->elemSize());
+  branch_images_.push_back(std::move(copy));
+  branch_image_num_.store(branch_images_.size(), std::memory_order_release);
+  if (nullptr != process_link) process_link->AddCowCopy();
+  return branch_images_.back().image.get();
+}
+
+void CNDataFrame::ClearDerivedImages() {
+  std::lock_guard<std::mutex> lk(derived_mutex_);
+  // the views of the BGR image see the writes, the others are derived again when asked for
+  size_t bytes = 0;
+  auto end = std::remove_if(derived_images_.begin(), derived_images_.end(), [&bytes](const DerivedImage& it) {
+    bytes += it.bytes;
+    return 0 != it.bytes;
+  });
+  derived_images_.erase(end, derived_images_.end());
+  derived_bytes_ -= bytes;
+  UnchargeBudget(bytes);
+}
+
+cv::Mat* CNDataFrame::SharedImageBGR() {
+  cv::Mat* bgr = bgr_mat.load(std::memory_order_acquire);
+  if (bgr != nullptr) {
+    return bgr;
+  }
+  std::lock_guard<std::mutex> lk(bgr_mutex_);
+  bgr = bgr_mat.load(std::memory_order_relaxed);
+  if (bgr != nullptr) {
+    return bgr;
   }
+  int stride_ = stride[0];
+  cv::Mat mat;
+  // the planes are read in place
   switch (fmt) {
     case CNDataFormat::CN_PIXEL_FORMAT_BGR24: {
-      bgr = cv::Mat(height, stride_, CV_8UC3, img_data).clone();
+      mat = cv::Mat(height, stride_, CV_8UC3, const_cast<void*>(data[0]->GetCpuData())).clone();
     } break;
     case CNDataFormat::CN_PIXEL_FORMAT_RGB24: {
-      cv::Mat src = cv::Mat(height, stride_, CV_8UC3, img_data);
-      cv::cvtColor(src, bgr, cv::COLOR_RGB2BGR);
-    } break;
-    case CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12: {
-      cv::Mat src = cv::Mat(height * 3 / 2, stride_, CV_8UC1, img_data);
-      cv::cvtColor(src, bgr, cv::COLOR_YUV2BGR_NV12);
+      cv::Mat src = cv::Mat(height, stride_, CV_8UC3, const_cast<void*>(data[0]->GetCpuData()));
+      cv::cvtColor(src, mat, cv::COLOR_RGB2BGR);
     } break;
+    case CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12:
     case CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV21: {
-      cv::Mat src = cv::Mat(height * 3 / 2, stride_, CV_8UC1, img_data);
-      cv::cvtColor(src, bgr, cv::COLOR_YUV2BGR_NV21);
+      mat.create(height, stride_, CV_8UC3);
+      YUV420spToBGR(static_cast<const uint8_t*>(data[0]->GetCpuData()), stride[0],
+                    static_cast<const uint8_t*>(data[1]->GetCpuData()), stride[1],
+                    CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV21 == fmt, stride_, height, mat.data,
+                    static_cast<int>(mat.step));
     } break;
     default: {
       LOG(WARNING) << "Unsupport pixel format.";
-      delete[] img_data;
       return nullptr;
     }
   }
-  delete[] img_data;
-  bgr_mat = new cv::Mat();
-  if (bgr_mat) {
-    *bgr_mat = bgr;
+  bgr = new cv::Mat(mat);
+  bgr_mat.store(bgr, std::memory_order_release);
+  ChargeBudget(mat.total() * mat.elemSize());
+  return bgr;
+}
+
+static std::atomic<size_t> derived_cache_capacity{32 << 20};
+static std::atomic<uint64_t> derived_cache_hits{0};
+static std::atomic<uint64_t> derived_cache_misses{0};
+static std::atomic<uint64_t> derived_cache_uncached{0};
+
+void SetDerivedImageCacheCapacity(size_t bytes) { derived_cache_capacity.store(bytes); }
+
+size_t GetDerivedImageCacheCapacity() { return derived_cache_capacity.load(); }
+
+DerivedImageCacheStats GetDerivedImageCacheStats() {
+  DerivedImageCacheStats stats;
+  stats.hits = derived_cache_hits.load(std::memory_order_relaxed);
+  stats.misses = derived_cache_misses.load(std::memory_order_relaxed);
+  stats.uncached = derived_cache_uncached.load(std::memory_order_relaxed);
+  return stats;
+}
+
+cv::Mat CNDataFrame::GetDerivedImage(CNDataFormat dst_fmt, int dst_w, int dst_h) {
+  if ((CN_PIXEL_FORMAT_BGR24 != dst_fmt && CN_PIXEL_FORMAT_RGB24 != dst_fmt) || dst_w <= 0 || dst_h <= 0) {
+    LOG(WARNING) << "Unsupport derived image, format " << dst_fmt << ", size " << dst_w << "x" << dst_h;
+    return cv::Mat();
+  }
+  cv::Mat* bgr = ImageBGR();
+  if (nullptr == bgr) return cv::Mat();
+  // the images derived from the copy of a branch are not shared with the other branches
+  bool shared = bgr == bgr_mat.load(std::memory_order_acquire);
+  // holds the lock while deriving, the modules asking for the same image wait for it instead of deriving again
+  std::lock_guard<std::mutex> lk(derived_mutex_);
+  for (const auto& it : derived_images_) {
+    if (shared && it.fmt == dst_fmt && it.image.cols == dst_w && it.image.rows == dst_h) {
+      derived_cache_hits.fetch_add(1, std::memory_order_relaxed);
+      return it.image;
+    }
+  }
+  // the padding of the strides is not a part of the image
+  cv::Mat src = (*bgr)(cv::Rect(0, 0, std::min(width, bgr->cols), bgr->rows));
+  cv::Mat dst;
+  if (src.cols == dst_w && src.rows == dst_h) {
+    dst = src;
+  } else {
+    cv::resize(src, dst, cv::Size(dst_w, dst_h));
+  }
+  if (CN_PIXEL_FORMAT_RGB24 == dst_fmt) {
+    cv::Mat rgb;
+    cv::cvtColor(dst, rgb, cv::COLOR_BGR2RGB);
+    dst = rgb;
+  }
+  derived_cache_misses.fetch_add(1, std::memory_order_relaxed);
+  // a view of the BGR image takes no extra memory
+  size_t bytes = dst.data == src.data ? 0 : dst.total() * dst.elemSize();
+  if (!shared || derived_bytes_ + bytes > derived_cache_capacity.load(std::memory_order_relaxed)) {
+    derived_cache_uncached.fetch_add(1, std::memory_order_relaxed);
+    return dst;
   }
-  return bgr_mat;
+  derived_bytes_ += bytes;
+  ChargeBudget(bytes);
+  derived_images_.push_back({dst_fmt, dst, bytes});
+  return dst;
 }
 #endif
 
@@ -126,7 +305,7 @@ void CNDataFrame::CopyToSyncMem() {
     /*cndecoder buffer will be used to avoid dev2dev copy*/
     for (int i = 0; i < GetPlanes(); i++) {
       size_t plane_size = GetPlaneBytes(i);
-      this->data[i].reset(new CNSyncedMemory(plane_size, ctx.dev_id, ctx.ddr_channel));
+      this->data[i] = CNSyncedMemory::Create(plane_size, ctx.dev_id, ctx.ddr_channel);
       this->data[i]->SetMluData(this->ptr[i]);
     }
     return;
@@ -138,13 +317,15 @@ void CNDataFrame::CopyToSyncMem() {
     }
     size_t bytes = GetBytes();
     bytes = ROUND_UP(bytes, 64 * 1024);
-    CALL_CNRT_BY_CONTEXT(cnrtMalloc(&mlu_data, bytes), ctx.dev_id, ctx.ddr_channel);
+    mlu_data = DevMalloc(bytes, ctx.dev_id, ctx.ddr_channel);
+    LOG_IF(FATAL, nullptr == mlu_data) << "Malloc device memory failed, size: " << bytes;
+    alloc_bytes_ = bytes;
     void* dst = mlu_data;
     for (int i = 0; i < GetPlanes(); i++) {
       size_t plane_size = GetPlaneBytes(i);
-      CALL_CNRT_BY_CONTEXT(cnrtMemcpy(dst, ptr[i], plane_size, CNRT_MEM_TRANS_DIR_DEV2DEV), ctx.dev_id,
-                           ctx.ddr_channel);
-      this->data[i].reset(new CNSyncedMemory(plane_size, ctx.dev_id, ctx.ddr_channel));
+      LOG_IF(FATAL, !DevMemcpy(dst, ptr[i], plane_size, DEV_MEMCPY_DEV2DEV, ctx.dev_id, ctx.ddr_channel))
+          << "Copy device memory failed, size: " << plane_size;
+      this->data[i] = CNSyncedMemory::Create(plane_size, ctx.dev_id, ctx.ddr_channel);
       this->data[i]->SetMluData(dst);
       dst = reinterpret_cast<void*>(reinterpret_cast<uint8_t*>(dst) + plane_size);
     }
@@ -158,11 +339,12 @@ void CNDataFrame::CopyToSyncMem() {
     if (nullptr == cpu_data) {
       LOG(FATAL) << "CopyToSyncMem: failed to alloc cpu memory";
     }
+    alloc_bytes_ = bytes;
     void* dst = cpu_data;
     for (int i = 0; i < GetPlanes(); i++) {
       size_t plane_size = GetPlaneBytes(i);
       memcpy(dst, ptr[i], plane_size);
-      this->data[i].reset(new CNSyncedMemory(plane_size));
+      this->data[i] = CNSyncedMemory::Create(plane_size);
       this->data[i]->SetCpuData(dst);
       dst = reinterpret_cast<void*>(reinterpret_cast<uint8_t*>(dst) + plane_size);
     }
@@ -171,78 +353,261 @@ void CNDataFrame::CopyToSyncMem() {
   }
 }
 
-void CNDataFrame::SetModuleMask(Module* module, Module* current) {
-  CNSpinLockGuard guard(mask_lock_);
-  auto iter = module_mask_map_.find(module->GetId());
-  if (iter != module_mask_map_.end()) {
-    iter->second |= (uint64_t)1 << current->GetId();
-  } else {
-    module_mask_map_[module->GetId()] = (uint64_t)1 << current->GetId();
+std::atomic<uint64_t>* CNDataFrame::ModuleMask(size_t module_id, bool create) {
+  if (module_id < kInlineModuleNum) return &module_mask_[module_id];
+  LOG_IF(FATAL, module_id >= GetMaxModuleNumber()) << "module id " << module_id << " out of range";
+  std::atomic<uint64_t>* ext = ext_module_mask_.load(std::memory_order_acquire);
+  if (nullptr == ext && create) {
+    std::atomic<uint64_t>* masks = new std::atomic<uint64_t>[GetMaxModuleNumber() - kInlineModuleNum];
+    for (size_t i = 0; i < GetMaxModuleNumber() - kInlineModuleNum; ++i) masks[i].store(0, std::memory_order_relaxed);
+    // branches may race to allocate, the loser frees its copy
+    if (ext_module_mask_.compare_exchange_strong(ext, masks, std::memory_order_acq_rel)) {
+      ext = masks;
+    } else {
+      delete[] masks;
+    }
   }
+  return nullptr == ext ? nullptr : &ext[module_id - kInlineModuleNum];
+}
+
+void CNDataFrame::SetModuleMask(Module* module, Module* current) {
+  ModuleMask(module->GetId(), true)->fetch_or(module->GetParentMask(current->GetId()), std::memory_order_acq_rel);
 }
 
 uint64_t CNDataFrame::GetModulesMask(Module* module) {
-  CNSpinLockGuard guard(mask_lock_);
-  auto iter = module_mask_map_.find(module->GetId());
-  if (iter != module_mask_map_.end()) {
-    return iter->second;
+  std::atomic<uint64_t>* mask = ModuleMask(module->GetId(), false);
+  return nullptr == mask ? 0 : mask->load(std::memory_order_acquire);
+}
+
+uint64_t CNDataFrame::ClearModuleMask(Module* module) {
+  std::atomic<uint64_t>* mask = ModuleMask(module->GetId(), false);
+  return nullptr == mask ? 0 : mask->exchange(0, std::memory_order_acq_rel);
+}
+
+bool CNDataFrame::ClaimModuleMask(Module* module) {
+  std::atomic<uint64_t>* mask = ModuleMask(module->GetId(), false);
+  uint64_t expected = module->GetModulesMask();
+  // a branch dropping the frame races for the mask, see Conveyor::TryPush
+  return nullptr != mask && mask->compare_exchange_strong(expected, 0, std::memory_order_acq_rel);
+}
+
+uint32_t CNDataFrame::AddEOSCount() { return eos_cnt.fetch_add(1, std::memory_order_acq_rel) + 1; }
+
+void CNDataFrame::ResetModuleMask() {
+  for (auto& it : module_mask_) it.store(0, std::memory_order_relaxed);
+  std::atomic<uint64_t>* ext = ext_module_mask_.load(std::memory_order_relaxed);
+  if (nullptr != ext) {
+    for (size_t i = 0; i < GetMaxModuleNumber() - kInlineModuleNum; ++i) ext[i].store(0, std::memory_order_relaxed);
   }
-  return 0;
+  eos_cnt.store(0, std::memory_order_relaxed);
 }
 
-void CNDataFrame::ClearModuleMask(Module* module) {
-  CNSpinLockGuard guard(mask_lock_);
-  auto iter = module_mask_map_.find(module->GetId());
-  if (iter != module_mask_map_.end()) {
-    iter->second = 0;
+namespace {
+
+/* (name, type) >>> slot, only registration and lookup by name go through it */
+class MetaRegistry {
+ public:
+  static MetaRegistry* Instance() {
+    // never destroyed, objects may be released while static objects are being destroyed
+    static MetaRegistry* registry = new MetaRegistry;
+    return registry;
   }
+
+  uint32_t Register(const std::string& name, CNMetaType type) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto it = slots_[type].find(name);
+    if (it != slots_[type].end()) return it->second;
+    uint32_t slot = slot_num_.load(std::memory_order_relaxed);
+    if (slot >= MAX_META_SLOT_NUM) {
+      LOG_IF(ERROR, !overflowed_) << "Too many metadata keys, the max number is " << MAX_META_SLOT_NUM
+                                  << ". Failed to register " << name << " and the keys after it.";
+      overflowed_ = true;
+      return INVALID_META_SLOT;
+    }
+    slots_[type][name] = slot;
+    slot_num_.store(slot + 1, std::memory_order_release);
+    return slot;
+  }
+
+  uint32_t Find(const std::string& name, CNMetaType type) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto it = slots_[type].find(name);
+    return it == slots_[type].end() ? INVALID_META_SLOT : it->second;
+  }
+
+  uint32_t GetSlotNum() const { return slot_num_.load(std::memory_order_acquire); }
+
+ private:
+  std::mutex mutex_;
+  std::unordered_map<std::string, uint32_t> slots_[CN_META_TYPE_NUM];
+  std::atomic<uint32_t> slot_num_{0};
+  bool overflowed_ = false;
+};  // class MetaRegistry
+
+}  // namespace
+
+uint32_t RegisterMetaSlot(const std::string& name, CNMetaType type) {
+  if (type < 0 || type >= CN_META_TYPE_NUM) return INVALID_META_SLOT;
+  return MetaRegistry::Instance()->Register(name, type);
 }
 
-uint64_t CNDataFrame::AddEOSMask(Module* module) {
-  CNSpinLockGuard guard(eos_lock_);
-  eos_mask |= (uint64_t)1 << module->GetId();
-  return eos_mask;
+uint32_t FindMetaSlot(const std::string& name, CNMetaType type) {
+  if (type < 0 || type >= CN_META_TYPE_NUM) return INVALID_META_SLOT;
+  return MetaRegistry::Instance()->Find(name, type);
 }
 
-bool CNInferObject::AddAttribute(const std::string& key, const CNInferAttr& value) {
-  std::lock_guard<std::mutex> lk(attribute_mutex_);
+uint32_t GetMetaSlotNum() { return MetaRegistry::Instance()->GetSlotNum(); }
+
+const CNMetaSlots::Entry* CNMetaSlots::Find(uint32_t slot) const {
+  for (const Entry& entry : entries_) {
+    if (entry.slot == slot) return &entry;
+  }
+  return nullptr;
+}
+
+const CNMetaSlots::Entry* CNMetaSlots::FindNamed(uint32_t slot, const std::string& name) const {
+  for (const Entry& entry : entries_) {
+    if (entry.slot == slot && strs_[entry.name] == name) return &entry;
+  }
+  return nullptr;
+}
+
+CNMetaSlots::Entry* CNMetaSlots::FindOrAdd(uint32_t slot, bool overwrite, bool* added) {
+  *added = false;
+  for (Entry& entry : entries_) {
+    if (entry.slot == slot) return overwrite ? &entry : nullptr;
+  }
+  if (slot >= GetMetaSlotNum()) return nullptr;
+  entries_.emplace_back(slot);
+  *added = true;
+  return &entries_.back();
+}
+
+CNMetaSlots::Entry* CNMetaSlots::AddNamedEntry(uint32_t slot, const std::string& name) {
+  if (FindNamed(slot, name)) return nullptr;
+  uint32_t name_idx = NewStr(name);
+  entries_.emplace_back(slot);
+  entries_.back().name = name_idx;
+  return &entries_.back();
+}
+
+uint32_t CNMetaSlots::NewStr(const std::string& value) {
+  if (str_num_ == strs_.size()) strs_.emplace_back();
+  strs_[str_num_] = value;
+  return static_cast<uint32_t>(str_num_++);
+}
+
+void CNMetaSlots::Clear() {
+  CNSpinLockGuard lk(lock_);
+  entries_.clear();
+  for (size_t i = 0; i < str_num_; ++i) strs_[i].clear();
+  str_num_ = 0;
+}
+
+bool CNMetaSlots::IsSet(uint32_t slot) const {
+  CNSpinLockGuard lk(lock_);
+  return nullptr != Find(slot);
+}
 
-  if (attributes_.find(key) != attributes_.end()) return false;
+#define CNS_META_WRITE(__FIELD__)                        \
+  CNSpinLockGuard lk(lock_);                             \
+  bool added;                                            \
+  Entry* entry = FindOrAdd(slot, overwrite, &added);     \
+  if (!entry) return false;                              \
+  entry->__FIELD__ = value;                              \
+  return true;
+
+#define CNS_META_READ(__FIELD__)       \
+  CNSpinLockGuard lk(lock_);           \
+  const Entry* entry = Find(slot);     \
+  if (!entry) return false;            \
+  *value = entry->__FIELD__;           \
+  return true;
 
-  attributes_.insert(std::make_pair(key, value));
+bool CNMetaSlots::Write(uint32_t slot, const CNInferAttr& value, bool overwrite) { CNS_META_WRITE(attr) }
+bool CNMetaSlots::Write(uint32_t slot, const int64_t& value, bool overwrite) { CNS_META_WRITE(i64) }
+bool CNMetaSlots::Write(uint32_t slot, const double& value, bool overwrite) { CNS_META_WRITE(f64) }
+bool CNMetaSlots::Read(uint32_t slot, CNInferAttr* value) const { CNS_META_READ(attr) }
+bool CNMetaSlots::Read(uint32_t slot, int64_t* value) const { CNS_META_READ(i64) }
+bool CNMetaSlots::Read(uint32_t slot, double* value) const { CNS_META_READ(f64) }
+
+#undef CNS_META_WRITE
+#undef CNS_META_READ
+
+bool CNMetaSlots::Write(uint32_t slot, const std::string& value, bool overwrite) {
+  CNSpinLockGuard lk(lock_);
+  bool added;
+  Entry* entry = FindOrAdd(slot, overwrite, &added);
+  if (!entry) return false;
+  if (added) {
+    entry->str = NewStr(value);
+  } else {
+    strs_[entry->str] = value;
+  }
   return true;
 }
 
-bool CNInferObject::AddAttribute(const std::pair<std::string, CNInferAttr>& attribute) {
-  std::lock_guard<std::mutex> lk(attribute_mutex_);
+bool CNMetaSlots::Read(uint32_t slot, std::string* value) const {
+  CNSpinLockGuard lk(lock_);
+  const Entry* entry = Find(slot);
+  if (!entry) return false;
+  *value = strs_[entry->str];
+  return true;
+}
 
-  if (attributes_.find(attribute.first) != attributes_.end()) return false;
+bool CNMetaSlots::AddNamed(const std::string& name, const CNInferAttr& value) {
+  CNSpinLockGuard lk(lock_);
+  Entry* entry = AddNamedEntry(NamedSlot(CN_META_TYPE_ATTR), name);
+  if (!entry) return false;
+  entry->attr = value;
+  return true;
+}
 
-  attributes_.insert(attribute);
+bool CNMetaSlots::AddNamed(const std::string& name, const std::string& value) {
+  CNSpinLockGuard lk(lock_);
+  Entry* entry = AddNamedEntry(NamedSlot(CN_META_TYPE_STRING), name);
+  if (!entry) return false;
+  entry->str = NewStr(value);
   return true;
 }
 
-CNInferAttr CNInferObject::GetAttribute(const std::string& key) {
-  std::lock_guard<std::mutex> lk(attribute_mutex_);
+bool CNMetaSlots::GetNamed(const std::string& name, CNInferAttr* value) const {
+  CNSpinLockGuard lk(lock_);
+  const Entry* entry = FindNamed(NamedSlot(CN_META_TYPE_ATTR), name);
+  if (!entry) return false;
+  *value = entry->attr;
+  return true;
+}
 
-  if (attributes_.find(key) != attributes_.end()) return attributes_[key];
+bool CNMetaSlots::GetNamed(const std::string& name, std::string* value) const {
+  CNSpinLockGuard lk(lock_);
+  const Entry* entry = FindNamed(NamedSlot(CN_META_TYPE_STRING), name);
+  if (!entry) return false;
+  *value = strs_[entry->str];
+  return true;
+}
 
-  return CNInferAttr();
+/* the attributes are added to meta by names, names made of the data never reach the slot registry */
+bool CNInferObject::AddAttribute(const std::string& key, const CNInferAttr& value) {
+  return meta.AddNamed(key, value);
 }
 
-bool CNInferObject::AddExtraAttribute(const std::string& key, const std::string& value) {
-  std::lock_guard<std::mutex> lk(attribute_mutex_);
+bool CNInferObject::AddAttribute(const std::pair<std::string, CNInferAttr>& attribute) {
+  return AddAttribute(attribute.first, attribute.second);
+}
 
-  if (extra_attributes_.find(key) != extra_attributes_.end()) return false;
+CNInferAttr CNInferObject::GetAttribute(const std::string& key) {
+  CNInferAttr attr;
+  meta.GetNamed(key, &attr);
+  return attr;
+}
 
-  extra_attributes_.insert(std::make_pair(key, value));
-  return true;
+bool CNInferObject::AddExtraAttribute(const std::string& key, const std::string& value) {
+  return meta.AddNamed(key, value);
 }
 
 bool CNInferObject::AddExtraAttribute(const std::vector<std::pair<std::string, std::string>>& attributes) {
-  std::lock_guard<std::mutex> lk(attribute_mutex_);
   bool ret = true;
-
   for (auto& attribute : attributes) {
     ret &= AddExtraAttribute(attribute.first, attribute.second);
   }
@@ -250,91 +615,334 @@ bool CNInferObject::AddExtraAttribute(const std::vector<std::pair<std::string, s
 }
 
 std::string CNInferObject::GetExtraAttribute(const std::string& key) {
-  std::lock_guard<std::mutex> lk(attribute_mutex_);
-
-  if (extra_attributes_.find(key) != extra_attributes_.end()) return extra_attributes_[key];
-
-  return "";
+  std::string value;
+  meta.GetNamed(key, &value);
+  return value;
 }
 
 void CNInferObject::AddFeature(const CNInferFeature& feature) {
-  std::lock_guard<std::mutex> lk(feature_mutex_);
+  CNSpinLockGuard lk(feature_lock_);
   features_.push_back(feature);
 }
 
 std::vector<CNInferFeature> CNInferObject::GetFeatures() {
-  std::lock_guard<std::mutex> lk(feature_mutex_);
+  CNSpinLockGuard lk(feature_lock_);
   return features_;
 }
 
-CNSpinLock CNFrameInfo::spinlock_;
-std::map<std::string, int> CNFrameInfo::stream_count_map_;
+void CNDetections::Reserve(size_t num) {
+  bboxes_.reserve(num);
+  scores_.reserve(num);
+  class_ids_.reserve(num);
+  track_ids_.reserve(num);
+  features_.reserve(num);
+}
+
+size_t CNDetections::Add(const CNInferBoundingBox& bbox, float score, int class_id, int track_id) {
+  bboxes_.push_back(bbox);
+  scores_.push_back(score);
+  class_ids_.push_back(class_id);
+  track_ids_.push_back(track_id);
+  features_.push_back(std::make_pair(0, 0));
+  return scores_.size() - 1;
+}
+
+void CNDetections::SetFeature(size_t index, const float* feature, size_t len) {
+  features_[index] = std::make_pair(static_cast<uint32_t>(feature_arena_.size()), static_cast<uint32_t>(len));
+  feature_arena_.insert(feature_arena_.end(), feature, feature + len);
+}
+
+const float* CNDetections::GetFeature(size_t index, size_t* len) const {
+  *len = features_[index].second;
+  return *len ? feature_arena_.data() + features_[index].first : nullptr;
+}
+
+void CNDetections::Clear() {
+  bboxes_.clear();
+  scores_.clear();
+  class_ids_.clear();
+  track_ids_.clear();
+  features_.clear();
+  feature_arena_.clear();
+}
+
+void CNDetections::ToObjects(std::vector<std::shared_ptr<CNInferObject>>* objs) const {
+  objs->reserve(objs->size() + Size());
+  for (size_t i = 0; i < Size(); ++i) {
+    std::shared_ptr<CNInferObject> obj = std::make_shared<CNInferObject>();
+    if (class_ids_[i] >= 0) obj->id = std::to_string(class_ids_[i]);
+    if (track_ids_[i] >= 0) obj->track_id = std::to_string(track_ids_[i]);
+    obj->score = scores_[i];
+    obj->bbox = bboxes_[i];
+    size_t len;
+    const float* feature = GetFeature(i, &len);
+    if (feature) obj->AddFeature(CNInferFeature(feature, feature + len));
+    objs->push_back(obj);
+  }
+}
+
+static int IdToInt(const std::string& id) {
+  if (id.empty()) return -1;
+  char* end = nullptr;
+  long value = strtol(id.c_str(), &end, 10);  // NOLINT
+  return *end == '\0' ? static_cast<int>(value) : -1;
+}
+
+void CNDetections::FromObjects(const std::vector<std::shared_ptr<CNInferObject>>& objs) {
+  Reserve(Size() + objs.size());
+  for (const auto& obj : objs) {
+    size_t index = Add(obj->bbox, obj->score, IdToInt(obj->id), IdToInt(obj->track_id));
+    std::vector<CNInferFeature> features = obj->GetFeatures();
+    if (!features.empty()) SetFeature(index, features[0].data(), features[0].size());
+  }
+}
+
 int CNFrameInfo::parallelism_ = 0;
 
 void SetParallelism(int parallelism) { CNFrameInfo::parallelism_ = parallelism; }
 int GetParallelism() { return CNFrameInfo::parallelism_; }
 
+namespace {
+
+/* the in-flight frames of a stream, limited by parallelism */
+class StreamCredit {
+ public:
+  bool TryAcquire() {
+    // seq_cst, a waiter failing here must see the release or be seen by it, see Release()
+    int used = used_.load(std::memory_order_seq_cst);
+    do {
+      if (used >= CNFrameInfo::parallelism_) return false;
+    } while (!used_.compare_exchange_weak(used, used + 1));
+    return true;
+  }
+
+  bool Acquire(const std::chrono::milliseconds& timeout) {
+    if (TryAcquire()) return true;
+    std::unique_lock<std::mutex> lk(mutex_);
+    ++waiters_;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool ret = cv_.wait_for(lk, timeout, [this] { return TryAcquire(); });
+    --waiters_;
+    return ret;
+  }
+
+  /*
+    takes the lock only if some thread is waiting for a credit. the fences pair with the one in Acquire(),
+    either the waiter sees the credit released or the releaser sees the waiter.
+   */
+  void Release() {
+    used_.fetch_sub(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load() > 0) {
+      std::lock_guard<std::mutex> lk(mutex_);
+      cv_.notify_one();
+    }
+  }
+
+ private:
+  std::atomic<int> used_{0};
+  std::atomic<int> waiters_{0};
+  std::mutex mutex_;
+  std::condition_variable cv_;
+};  // class StreamCredit
+
+struct StreamEntry {
+  std::string stream_id;
+  StreamCredit credit;
+};
+
+/*
+  Stream ids are never removed, the entries are stored in chunks allocated on demand so that a published
+  handle can be resolved without locking.
+*/
+class StreamIdRegistry {
+ public:
+  static constexpr uint32_t kChunkSize = 256;
+  static constexpr uint32_t kMaxChunkNum = 4096;
+
+  /* never destroyed, frames may be released while static objects are being destroyed */
+  static StreamIdRegistry* Instance() {
+    static StreamIdRegistry* registry = new StreamIdRegistry;
+    return registry;
+  }
+
+  uint32_t Intern(const std::string& stream_id) {
+    CNSpinLockGuard guard(lock_);
+    auto iter = handles_.find(stream_id);
+    if (iter != handles_.end()) return iter->second;
+    uint32_t handle = static_cast<uint32_t>(handles_.size());
+    uint32_t chunk_idx = handle / kChunkSize;
+    if (chunk_idx >= kMaxChunkNum) {
+      LOG(ERROR) << "Too many stream ids, the max number is " << kChunkSize * kMaxChunkNum;
+      return INVALID_STREAM_HANDLE;
+    }
+    StreamEntry* chunk = chunks_[chunk_idx].load(std::memory_order_relaxed);
+    if (nullptr == chunk) {
+      chunk = new StreamEntry[kChunkSize];
+    }
+    chunk[handle % kChunkSize].stream_id = stream_id;
+    // the caller publishes the handle, the chunk and the string must be visible before it
+    chunks_[chunk_idx].store(chunk, std::memory_order_release);
+    handles_[stream_id] = handle;
+    return handle;
+  }
+
+  /* returns nullptr if the handle is invalid */
+  StreamEntry* Get(uint32_t handle) const {
+    if (handle >= kChunkSize * kMaxChunkNum) return nullptr;
+    StreamEntry* chunk = chunks_[handle / kChunkSize].load(std::memory_order_acquire);
+    if (nullptr == chunk || chunk[handle % kChunkSize].stream_id.empty()) return nullptr;
+    return &chunk[handle % kChunkSize];
+  }
+
+ private:
+  StreamIdRegistry() {
+    for (auto& chunk : chunks_) chunk.store(nullptr, std::memory_order_relaxed);
+  }
+  CNSpinLock lock_;
+  std::unordered_map<std::string, uint32_t> handles_;
+  std::atomic<StreamEntry*> chunks_[kMaxChunkNum];
+};  // class StreamIdRegistry
+
+/* released frames are cleared and cached here for CNFrameInfo::Create */
+class FrameInfoPool {
+ public:
+  static constexpr size_t kMaxCachedFrames = 1024;
+
+  /* never destroyed, frames may be released while static objects are being destroyed */
+  static FrameInfoPool* Instance() {
+    static FrameInfoPool* pool = new FrameInfoPool;
+    return pool;
+  }
+
+  template <typename Creator>
+  CNFrameInfo* Get(Creator create) {
+    {
+      CNSpinLockGuard guard(lock_);
+      if (!frames_.empty()) {
+        CNFrameInfo* frame_info = frames_.back();
+        frames_.pop_back();
+        reuse_cnt_.fetch_add(1, std::memory_order_relaxed);
+        return frame_info;
+      }
+    }
+    heap_alloc_cnt_.fetch_add(1, std::memory_order_relaxed);
+    return create();
+  }
+
+  /* returns false if the pool is full and the caller should delete the frame */
+  bool Put(CNFrameInfo* frame_info) {
+    CNSpinLockGuard guard(lock_);
+    if (frames_.size() >= kMaxCachedFrames) return false;
+    frames_.push_back(frame_info);
+    return true;
+  }
+
+  uint64_t HeapAllocCount() const { return heap_alloc_cnt_.load(std::memory_order_relaxed); }
+  uint64_t ReuseCount() const { return reuse_cnt_.load(std::memory_order_relaxed); }
+
+ private:
+  FrameInfoPool() { frames_.reserve(kMaxCachedFrames); }
+  CNSpinLock lock_;
+  std::vector<CNFrameInfo*> frames_;
+  std::atomic<uint64_t> heap_alloc_cnt_{0};
+  std::atomic<uint64_t> reuse_cnt_{0};
+};  // class FrameInfoPool
+
+}  // namespace
+
+uint32_t InternStreamId(const std::string& stream_id) {
+  if (stream_id.empty()) return INVALID_STREAM_HANDLE;
+  return StreamIdRegistry::Instance()->Intern(stream_id);
+}
+
+const std::string& GetInternedStreamId(uint32_t stream_handle) {
+  static const std::string empty;
+  StreamEntry* entry = StreamIdRegistry::Instance()->Get(stream_handle);
+  return entry ? entry->stream_id : empty;
+}
+
+CNFramePoolStats GetFramePoolStats() {
+  CNFramePoolStats stats;
+  stats.frame_heap_allocs = FrameInfoPool::Instance()->HeapAllocCount();
+  stats.frame_reuses = FrameInfoPool::Instance()->ReuseCount();
+  stats.block_heap_allocs = BlockPool::HeapAllocCount();
+  stats.block_reuses = BlockPool::ReuseCount();
+  return stats;
+}
+
 std::shared_ptr<CNFrameInfo> CNFrameInfo::Create(const std::string& stream_id, bool eos) {
   if (stream_id == "") {
     LOG(ERROR) << "CNFrameInfo::Create() stream_id is empty string.";
     return nullptr;
   }
+  return Create(InternStreamId(stream_id), eos);
+}
 
-  CNFrameInfo* frameInfo = new CNFrameInfo();
-  if (!frameInfo) {
-    LOG(ERROR) << "CNFrameInfo::Create() new CNFrameInfo failed.";
+std::shared_ptr<CNFrameInfo> CNFrameInfo::Create(uint32_t stream_handle, bool eos) {
+  StreamEntry* entry = StreamIdRegistry::Instance()->Get(stream_handle);
+  if (nullptr == entry) {
+    LOG(ERROR) << "CNFrameInfo::Create() invalid stream handle " << stream_handle;
     return nullptr;
   }
-  frameInfo->frame.stream_id = stream_id;
-  std::shared_ptr<CNFrameInfo> ptr(frameInfo);
-
-  if (eos) {
-    ptr->frame.flags |= cnstream::CN_FRAME_FLAG_EOS;
-    return ptr;
+  bool has_credit = !eos && parallelism_ > 0;
+  if (has_credit && !entry->credit.TryAcquire()) {
+    return nullptr;
   }
+  return Create(stream_handle, eos, has_credit);
+}
 
-  if (parallelism_ > 0) {
-    CNSpinLockGuard guard(spinlock_);
-    auto iter = stream_count_map_.find(stream_id);
-    if (iter == stream_count_map_.end()) {
-      int count = 1;
-      stream_count_map_[stream_id] = count;
-      // LOG(INFO) << "CNFrameInfo::Create() insert stream_id: " << stream_id;
-    } else {
-      int count = stream_count_map_[stream_id];
-      if (count >= parallelism_) {
-        return nullptr;
-      }
-      stream_count_map_[stream_id] = count + 1;
-      // LOG(INFO) << "CNFrameInfo::Create() add count stream_id " << stream_id << ":" << count;
-    }
+std::shared_ptr<CNFrameInfo> CNFrameInfo::WaitAndCreate(uint32_t stream_handle,
+                                                        const std::chrono::milliseconds& timeout) {
+  StreamEntry* entry = StreamIdRegistry::Instance()->Get(stream_handle);
+  if (nullptr == entry) {
+    LOG(ERROR) << "CNFrameInfo::WaitAndCreate() invalid stream handle " << stream_handle;
+    return nullptr;
+  }
+  bool has_credit = parallelism_ > 0;
+  if (has_credit && !entry->credit.Acquire(timeout)) {
+    return nullptr;
   }
-  return ptr;
+  return Create(stream_handle, false, has_credit);
 }
 
-CNFrameInfo::~CNFrameInfo() {
-  if (frame.flags & CN_FRAME_FLAG_EOS) {
-    return;
+std::shared_ptr<CNFrameInfo> CNFrameInfo::Create(uint32_t stream_handle, bool eos, bool has_credit) {
+  CNFrameInfo* frameInfo = FrameInfoPool::Instance()->Get([] { return new CNFrameInfo(); });
+  if (!frameInfo) {
+    LOG(ERROR) << "CNFrameInfo::Create() new CNFrameInfo failed.";
+    if (has_credit) StreamIdRegistry::Instance()->Get(stream_handle)->credit.Release();
+    return nullptr;
   }
-  if (frame.ctx.dev_type == DevContext::INVALID) {
-    return;
+  // refers to the interned string, no copy
+  frameInfo->frame.stream_id = StreamIdRef(stream_handle);
+  frameInfo->frame.stream_handle = stream_handle;
+  frameInfo->has_credit_ = has_credit;
+  frameInfo->create_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  if (eos) {
+    frameInfo->frame.flags |= cnstream::CN_FRAME_FLAG_EOS;
   }
-  if (parallelism_ > 0) {
-    CNSpinLockGuard guard(spinlock_);
-    auto iter = stream_count_map_.find(frame.stream_id);
-    if (iter != stream_count_map_.end()) {
-      int count = iter->second;
-      --count;
-      if (count <= 0) {
-        stream_count_map_.erase(iter);
-        // LOG(INFO) << "CNFrameInfo::~CNFrameInfo() erase stream_id " << frame.stream_id;
-      } else {
-        iter->second = count;
-        // LOG(INFO) << "CNFrameInfo::~CNFrameInfo() update stream_id " << frame.stream_id << " : " << count;
-      }
-    } else {
-      LOG(ERROR) << "Invaid stream_id, please check\n";
-    }
+  // the reference count is pooled as well
+  return std::shared_ptr<CNFrameInfo>(frameInfo, &CNFrameInfo::Recycle, PoolAllocator<CNFrameInfo>());
+}
+
+void CNFrameInfo::Recycle(CNFrameInfo* frame_info) {
+  frame_info->ReleaseCredit();
+  // the cleared frame keeps the capacity of objs and dets
+  frame_info->frame.Reset();
+  frame_info->objs.clear();
+  frame_info->meta.Clear();
+  frame_info->dets.Clear();
+  frame_info->channel_idx = INVALID_STREAM_IDX;
+  if (!FrameInfoPool::Instance()->Put(frame_info)) delete frame_info;
+}
+
+CNFrameInfo::~CNFrameInfo() { ReleaseCredit(); }
+
+void CNFrameInfo::ReleaseCredit() {
+  if (has_credit_) {
+    StreamIdRegistry::Instance()->Get(frame.stream_handle)->credit.Release();
+    has_credit_ = false;
   }
 }
 
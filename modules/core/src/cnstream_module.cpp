@@ -25,38 +25,10 @@
 
 namespace cnstream {
 
-CNSpinLock Module::module_id_spinlock_;
-uint64_t Module::module_id_mask_ = 0;
+/* module ids are allocated by each pipeline, the pipeline itself takes id 0 */
+static const uint32_t kMaxModuleNumPerPipeline = 1024;
 
-uint32_t GetMaxModuleNumber() {
-  /*maxModuleIdNum is sizeof(module_id_mask_) * 8  (bytes->bits)*/
-  return sizeof(uint64_t) * 8;
-}
-
-size_t Module::GetId() {
-  CNSpinLockGuard guard(module_id_spinlock_);
-  if (id_ != INVALID_MODULE_ID) {
-    return id_;
-  }
-  for (size_t i = 0; i < sizeof(module_id_mask_) * 8; i++) {
-    if (!(module_id_mask_ & ((uint64_t)1 << i))) {
-      module_id_mask_ |= (uint64_t)1 << i;
-      id_ = i;
-      return i;
-    }
-  }
-  id_ = INVALID_MODULE_ID;
-  return INVALID_MODULE_ID;
-}
-
-void Module::ReturnId() {
-  CNSpinLockGuard guard(module_id_spinlock_);
-  if (id_ < 0 || id_ >= sizeof(module_id_mask_) * 8) {
-    return;
-  }
-  module_id_mask_ &= ~(1 << id_);
-  id_ = INVALID_MODULE_ID;
-}
+uint32_t GetMaxModuleNumber() { return kMaxModuleNumPerPipeline; }
 
 bool Module::PostEvent(EventType type, const std::string& msg) const {
   Event event;
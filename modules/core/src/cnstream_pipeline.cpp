@@ -31,6 +31,7 @@
 #include <map>
 #include <memory>
 #include <set>
+#include <sstream>
 #include <string>
 #include <thread>
 #include <unordered_map>
@@ -40,8 +41,12 @@
 #include "cnstream_module.hpp"
 #include "cnstream_pipeline.hpp"
 #include "cnstream_timer.hpp"
+#include "cnstream_trace.hpp"
 #include "connector.hpp"
 #include "conveyor.hpp"
+#include "executor.hpp"
+#include "memory_budget.hpp"
+#include "queue_sampler.hpp"
 #include "threadsafe_queue.hpp"
 
 namespace cnstream {
@@ -80,6 +85,53 @@ void CNModuleConfig::ParseByJSONStr(const std::string& jstr) {
     this->maxInputQueueSize = 20;
   }
 
+  // inputQueueType
+  if (end != doc.FindMember("queue_type")) {
+    if (!doc["queue_type"].IsString()) throw std::string("queue_type must be string type.");
+    std::string queue_type = doc["queue_type"].GetString();
+    if (queue_type == "mutex") {
+      this->inputQueueType = LINK_QUEUE_MUTEX;
+    } else if (queue_type == "mpmc") {
+      this->inputQueueType = LINK_QUEUE_MPMC;
+    } else if (queue_type == "spsc") {
+      this->inputQueueType = LINK_QUEUE_SPSC;
+    } else {
+      throw std::string("queue_type must be one of \"mutex\", \"mpmc\" and \"spsc\".");
+    }
+  } else {
+    this->inputQueueType = LINK_QUEUE_MUTEX;
+  }
+
+  // inputOverflowPolicy
+  if (end != doc.FindMember("overflow_policy")) {
+    if (!doc["overflow_policy"].IsString()) throw std::string("overflow_policy must be string type.");
+    std::string policy = doc["overflow_policy"].GetString();
+    if (policy == "block") {
+      this->inputOverflowPolicy = LINK_OVERFLOW_BLOCK;
+    } else if (policy == "drop_oldest") {
+      this->inputOverflowPolicy = LINK_OVERFLOW_DROP_OLDEST;
+    } else if (policy == "drop_newest") {
+      this->inputOverflowPolicy = LINK_OVERFLOW_DROP_NEWEST;
+    } else if (policy == "keep_latest_n") {
+      this->inputOverflowPolicy = LINK_OVERFLOW_KEEP_LATEST_N;
+    } else {
+      throw std::string(
+          "overflow_policy must be one of \"block\", \"drop_oldest\", \"drop_newest\" and \"keep_latest_n\".");
+    }
+  } else {
+    this->inputOverflowPolicy = LINK_OVERFLOW_BLOCK;
+  }
+
+  // inputKeepLatestNum
+  if (end != doc.FindMember("keep_latest_num")) {
+    if (!doc["keep_latest_num"].IsUint() || 0 == doc["keep_latest_num"].GetUint()) {
+      throw std::string("keep_latest_num must be positive uint type.");
+    }
+    this->inputKeepLatestNum = doc["keep_latest_num"].GetUint();
+  } else {
+    this->inputKeepLatestNum = 1;
+  }
+
   // enablePerfInfo
   if (end != doc.FindMember("show_perf_info")) {
     if (!doc["show_perf_info"].IsBool()) throw std::string("show_perf_info must be Boolean type.");
@@ -161,8 +213,17 @@ void CNModuleConfig::ParseByJSONFile(const std::string& jfname) {
   this->parameters[CNS_JSON_DIR_PARAM_NAME] = jf_dir;
 }
 
+/* the latencies of the frames processed by a module, see ModuleLatencyStats */
+struct ModuleLatency {
+  LatencyHistogram queue;
+  LatencyHistogram process;
+  LatencyHistogram from_source;
+};
+
 struct ModuleAssociatedInfo {
   std::shared_ptr<Module> instance;
+  std::shared_ptr<ModuleLatency> latency = std::make_shared<ModuleLatency>();
+  uint32_t trace_name = 0;
   uint32_t parallelism = 0;
   std::set<std::string> down_nodes;
   std::vector<std::string> input_connectors;
@@ -171,6 +232,12 @@ struct ModuleAssociatedInfo {
 
 StreamMsgObserver::~StreamMsgObserver() {}
 
+/* the frames are stamped by the steady clock, like CNFrameInfo::create_ns */
+static inline int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
 class PipelinePrivate {
  private:
   explicit PipelinePrivate(Pipeline* q_ptr) : q_ptr_(q_ptr) {
@@ -187,20 +254,90 @@ class PipelinePrivate {
   std::thread event_thread_;
   std::map<std::string, ModuleAssociatedInfo> modules_;
   std::mutex stop_mtx_;
-  uint64_t eos_mask_ = 0;
+  uint32_t eos_module_num_ = 0;
+  /* module ids are scoped to the pipeline, the pipeline itself takes id 0 */
+  std::vector<bool> module_ids_;
+  ExecutorType executor_type_ = EXECUTOR_THREAD_PER_CONVEYOR;
+  uint32_t executor_worker_num_ = 0;
+  std::shared_ptr<WorkStealingExecutor> executor_;
+  std::shared_ptr<FrameMemoryBudget> memory_budget_ = std::make_shared<FrameMemoryBudget>();
+  LatencyHistogram end_to_end_latency_;
+  uint32_t sampler_interval_ms_ = 0;
+  uint32_t sampler_summary_interval_s_ = 0;
+  std::unique_ptr<QueueSampler> queue_sampler_;
 
  private:
   std::unordered_map<std::string, CNModuleConfig> modules_config_;
   std::unordered_map<std::string, std::vector<std::string>> connections_config_;
   std::map<std::string, std::shared_ptr<Module>> modules_map_;
   DECLARE_PUBLIC(q_ptr_, Pipeline);
-  void SetEOSMask() {
-    for (const std::pair<std::string, ModuleAssociatedInfo> module_info : modules_) {
-      auto instance = module_info.second.instance;
-      eos_mask_ |= (uint64_t)1 << instance->GetId();
+  // the eos of a frame is done when every module has received it
+  void SetEOSMask() { eos_module_num_ = modules_.size(); }
+  void ClearEOSMask() { eos_module_num_ = 0; }
+
+  size_t AllocModuleId() {
+    for (size_t i = 0; i < module_ids_.size(); ++i) {
+      if (!module_ids_[i]) {
+        module_ids_[i] = true;
+        return i;
+      }
+    }
+    if (module_ids_.size() >= GetMaxModuleNumber()) return INVALID_MODULE_ID;
+    module_ids_.push_back(true);
+    return module_ids_.size() - 1;
+  }
+
+  /* processes one frame popped by node_name from link, returns false if the module failed and must stop */
+  bool ProcessData(const std::string& node_name, ModuleAssociatedInfo* module_info, Connector* link,
+                   std::shared_ptr<CNFrameInfo> data);
+
+  /* every module learns which modules are upstream of it, the copies on write of frame images follow them */
+  void SetUpstreamIds() {
+    std::vector<Module*> modules(module_ids_.size(), nullptr);
+    for (auto& it : modules_) modules[it.second.instance->GetId()] = it.second.instance.get();
+    for (Module* module : modules) {
+      if (nullptr == module) continue;
+      std::vector<bool> upstream(modules.size(), false);
+      std::vector<size_t> pending = {module->GetId()};
+      while (!pending.empty()) {
+        size_t id = pending.back();
+        pending.pop_back();
+        if (upstream[id]) continue;
+        upstream[id] = true;
+        if (nullptr == modules[id]) continue;
+        for (size_t parent : modules[id]->GetParentIds()) pending.push_back(parent);
+      }
+      module->upstream_ids_.swap(upstream);
+    }
+  }
+
+  /* the sampler of the last run is kept for the queries until the next run */
+  void StartQueueSampler() {
+    queue_sampler_.reset();
+    if (0 == sampler_interval_ms_) return;
+    std::vector<QueueSampler::Link> links;
+    std::map<std::string, size_t> link_indexes;
+    for (auto& it : links_) {
+      link_indexes[it.first] = links.size();
+      links.push_back({it.first, it.second.get()});
+    }
+    std::vector<QueueSampler::Node> nodes;
+    for (auto& it : modules_) {
+      QueueSampler::Node node;
+      node.name = it.first;
+      for (auto& id : it.second.input_connectors) node.inputs.push_back(link_indexes[id]);
+      for (auto& id : it.second.output_connectors) node.outputs.push_back(link_indexes[id]);
+      nodes.push_back(node);
     }
+    queue_sampler_.reset(new QueueSampler(q_ptr_->GetName(), links, nodes));
+    queue_sampler_->Start(sampler_interval_ms_, sampler_summary_interval_s_);
   }
-  void ClearEOSMask() { eos_mask_ = 0; }
+
+  /*
+    work-stealing executor
+   */
+  void StartExecutor();
+  void ClearPushCallbacks();
 
   /*
     stream message
@@ -246,6 +383,7 @@ class PipelinePrivate {
 
 Pipeline::Pipeline(const std::string& name) : Module(name) {
   d_ptr_ = new PipelinePrivate(this);
+  SetId(d_ptr_->AllocModuleId());
 
   event_bus_ = new EventBus();
   GetEventBus()->AddBusWatch(std::bind(&Pipeline::DefaultBusWatch, this, std::placeholders::_1, std::placeholders::_2),
@@ -254,6 +392,8 @@ Pipeline::Pipeline(const std::string& name) : Module(name) {
 
 Pipeline::~Pipeline() {
   running_ = false;
+  // modules may outlive the pipeline and be added to another one
+  for (auto& it : d_ptr_->modules_) it.second.instance->SetId(INVALID_MODULE_ID);
   delete event_bus_;
   delete d_ptr_;
 }
@@ -308,6 +448,11 @@ bool Pipeline::ProvideData(const Module* module, std::shared_ptr<CNFrameInfo> da
 
   if (d_ptr_->modules_.find(moduleName) == d_ptr_->modules_.end()) return false;
 
+  if (!d_ptr_->memory_budget_->Admit(&data->frame)) return false;
+
+  // the frames recycled keep the stamps, resized only for the first frames
+  if (data->transmit_ns_.size() < d_ptr_->module_ids_.size()) data->transmit_ns_.resize(d_ptr_->module_ids_.size());
+
   TransmitData(moduleName, data);
 
   return true;
@@ -321,7 +466,13 @@ bool Pipeline::AddModule(std::shared_ptr<Module> module) {
     return false;
   }
 
+  if (module->GetId() != INVALID_MODULE_ID) {
+    LOG(WARNING) << "Module [" << module->GetName() << "] has already been added to another pipeline";
+    return false;
+  }
+
   LOG(INFO) << "Add Module " << module->GetName() << " to pipeline";
+  module->SetId(d_ptr_->AllocModuleId());
   if (module->GetId() == INVALID_MODULE_ID) {
     LOG(ERROR) << "Failed to get module Id";
     return false;
@@ -330,6 +481,7 @@ bool Pipeline::AddModule(std::shared_ptr<Module> module) {
   ModuleAssociatedInfo associated_info;
   associated_info.instance = module;
   associated_info.parallelism = 1;
+  associated_info.trace_name = RegisterTraceName(moduleName);
   module->SetContainer(this);
   d_ptr_->modules_.insert(std::make_pair(moduleName, associated_info));
 
@@ -350,7 +502,8 @@ uint32_t Pipeline::GetModuleParallelism(std::shared_ptr<Module> module) {
 }
 
 std::string Pipeline::LinkModules(std::shared_ptr<Module> up_node, std::shared_ptr<Module> down_node,
-                                  size_t queue_capacity) {
+                                  size_t queue_capacity, LinkQueueType queue_type, LinkOverflowPolicy policy,
+                                  uint32_t keep_latest_num) {
   if (up_node == nullptr || down_node == nullptr) {
     return "";
   }
@@ -368,6 +521,10 @@ std::string Pipeline::LinkModules(std::shared_ptr<Module> up_node, std::shared_p
   ModuleAssociatedInfo& down_node_info = d_ptr_->modules_.find(down_node_name)->second;
 
   std::string link_id = up_node->GetName() + "-->" + down_node->GetName();
+  if (down_node->GetParentIds().size() >= Module::kMaxParentNum) {
+    LOG(ERROR) << "Link " << link_id << " failed, module " << down_node_name << " has too many upstream modules";
+    return "";
+  }
   auto ret = up_node_info.down_nodes.insert(down_node_name);
   if (!ret.second) {
     LOG(ERROR) << "modules have been linked already";
@@ -376,12 +533,28 @@ std::string Pipeline::LinkModules(std::shared_ptr<Module> up_node, std::shared_p
 
   LOG(INFO) << "Link Module " << link_id;
 
+  if (LINK_QUEUE_SPSC == queue_type &&
+      (up_node_info.parallelism != 1 || up_node->isSource_.load() || up_node->hasTranmit())) {
+    LOG(WARNING) << "Link " << link_id << " has more than one producer thread, use mpmc queue instead of spsc queue.";
+    queue_type = LINK_QUEUE_MPMC;
+  }
+  if (LINK_OVERFLOW_BLOCK != policy && LINK_QUEUE_MUTEX != queue_type) {
+    LOG(WARNING) << "Link " << link_id << " drops frames on overflow, use mutex queue instead of lock-free queue.";
+    queue_type = LINK_QUEUE_MUTEX;
+  }
+  if (0 == keep_latest_num) keep_latest_num = 1;
+
   // create connector
-  std::shared_ptr<Connector> con = std::make_shared<Connector>(down_node_info.parallelism, queue_capacity);
+  std::shared_ptr<Connector> con =
+      std::make_shared<Connector>(down_node_info.parallelism, queue_capacity, queue_type, policy, keep_latest_num);
   up_node_info.output_connectors.push_back(link_id);
   down_node_info.input_connectors.push_back(link_id);
   d_ptr_->links_[link_id] = con;
 
+  con->SetUpstreamId(up_node->GetId());
+  con->SetDownstreamModule(down_node.get());
+  con->SetTraceName(RegisterTraceName(link_id));
+
   down_node->SetParentId(up_node->GetId());
   return link_id;
 }
@@ -400,10 +573,97 @@ bool Pipeline::QueryLinkStatus(LinkStatus* status, const std::string& link_id) {
   for (uint32_t i = 0; i < con->GetConveyorCount(); ++i) {
     status->cache_size.emplace_back(con->GetConveyor(i)->GetBufferSize());
   }
+  status->drop_count = con->GetDropCount();
+  status->cow_copies = con->GetCowCopyCount();
+  status->queue_latency = con->GetQueueLatency()->GetStats();
+  return true;
+}
+
+bool Pipeline::QueryModuleLatency(ModuleLatencyStats* stats, const std::string& module_name) const {
+  auto it = d_ptr_->modules_.find(module_name);
+  if (it == d_ptr_->modules_.end()) {
+    LOG(ERROR) << "can not find module " << module_name;
+    return false;
+  }
+  if (!stats) {
+    LOG(ERROR) << "stats cannot be nullptr";
+    return false;
+  }
+  const ModuleLatency& latency = *it->second.latency;
+  stats->queue = latency.queue.GetStats();
+  stats->process = latency.process.GetStats();
+  stats->from_source = latency.from_source.GetStats();
+  return true;
+}
+
+LatencyStats Pipeline::GetEndToEndLatency() const { return d_ptr_->end_to_end_latency_.GetStats(); }
+
+void Pipeline::ResetLatencyStats() {
+  for (auto& it : d_ptr_->modules_) {
+    it.second.latency->queue.Reset();
+    it.second.latency->process.Reset();
+    it.second.latency->from_source.Reset();
+  }
+  for (auto& it : d_ptr_->links_) it.second->GetQueueLatency()->Reset();
+  d_ptr_->end_to_end_latency_.Reset();
+}
+
+void Pipeline::SetQueueSampler(uint32_t interval_ms, uint32_t summary_interval_s) {
+  d_ptr_->sampler_interval_ms_ = interval_ms;
+  d_ptr_->sampler_summary_interval_s_ = summary_interval_s;
+}
+
+bool Pipeline::QueryQueueTelemetry(std::vector<QueueTelemetry>* telemetry, const std::string& link_id) const {
+  if (!telemetry) {
+    LOG(ERROR) << "telemetry cannot be nullptr";
+    return false;
+  }
+  if (!d_ptr_->queue_sampler_) {
+    LOG(ERROR) << "the queue sampler is not enabled, see Pipeline::SetQueueSampler";
+    return false;
+  }
+  if (!d_ptr_->queue_sampler_->GetTelemetry(link_id, telemetry)) {
+    LOG(ERROR) << "can not find link according to link id";
+    return false;
+  }
   return true;
 }
 
+void Pipeline::ResetQueueTelemetry() {
+  if (d_ptr_->queue_sampler_) d_ptr_->queue_sampler_->Reset();
+}
+
+std::string Pipeline::GetBottleneckModule(double* percent) const {
+  if (!d_ptr_->queue_sampler_) {
+    if (percent) *percent = 0;
+    return "";
+  }
+  return d_ptr_->queue_sampler_->GetBottleneck(percent);
+}
+
 bool Pipeline::Start() {
+  // size the stream index space before the modules are opened, they size their per-stream structures with it
+  uint32_t max_stream_num = 0;
+  for (auto& it : d_ptr_->modules_) {
+    if (!it.second.instance->isSource_.load()) continue;
+    ModuleParamSet param_set = GetModuleParamSet(it.second.instance->GetName());
+    auto search = param_set.find("max_stream_num");
+    if (search == param_set.end()) continue;
+    std::stringstream ss(search->second);
+    int64_t num = 0;
+    ss >> num;
+    if (ss.fail() || !ss.eof() || num <= 0 || num > static_cast<int64_t>(INVALID_STREAM_IDX) - 1 ||
+        (max_stream_num && static_cast<int64_t>(max_stream_num) != num)) {
+      LOG(ERROR) << it.second.instance->GetName() << ": invalid max_stream_num " << search->second;
+      return false;
+    }
+    max_stream_num = num;
+  }
+  if (!SourceModule::AcquireStreamIndexSpace(max_stream_num)) {
+    LOG(ERROR) << "max_stream_num " << max_stream_num << " differs from " << GetMaxStreamNumber()
+               << ", which is used by the running pipelines or streams.";
+    return false;
+  }
   // set eos mask
   d_ptr_->SetEOSMask();
   // open modules
@@ -422,29 +682,47 @@ bool Pipeline::Start() {
   if (open_module_failed) {
     for (auto it : opened_modules) it->Close();
     d_ptr_->ClearEOSMask();
+    SourceModule::ReleaseStreamIndexSpace();
     return false;
   }
 
+  d_ptr_->SetUpstreamIds();
+
   // start data transmit
+  d_ptr_->memory_budget_->Start();
   running_.store(true);
   event_bus_->running_.store(true);
   d_ptr_->event_thread_ = std::thread(&Pipeline::EventLoop, this);
 
+  if (EXECUTOR_WORK_STEALING == d_ptr_->executor_type_) {
+    d_ptr_->StartExecutor();
+  } else if (d_ptr_->executor_) {
+    d_ptr_->ClearPushCallbacks();
+    d_ptr_->executor_.reset();
+  }
+
   for (std::pair<std::string, std::shared_ptr<Connector>> connector : d_ptr_->links_) {
     connector.second->Start();
   }
+  d_ptr_->StartQueueSampler();
 
   // create process threads
-  for (auto& it : d_ptr_->modules_) {
-    const std::string node_name = it.first;
-    ModuleAssociatedInfo& module_info = it.second;
-    uint32_t parallelism = module_info.parallelism;
-    for (uint32_t conveyor_idx = 0; conveyor_idx < parallelism; ++conveyor_idx) {
-      d_ptr_->threads_.push_back(std::thread(&Pipeline::TaskLoop, this, node_name, conveyor_idx));
+  if (EXECUTOR_WORK_STEALING != d_ptr_->executor_type_) {
+    for (auto& it : d_ptr_->modules_) {
+      const std::string node_name = it.first;
+      ModuleAssociatedInfo& module_info = it.second;
+      uint32_t parallelism = module_info.parallelism;
+      for (uint32_t conveyor_idx = 0; conveyor_idx < parallelism; ++conveyor_idx) {
+        d_ptr_->threads_.push_back(std::thread(&Pipeline::TaskLoop, this, node_name, conveyor_idx));
+      }
     }
   }
   LOG(INFO) << "Pipeline Start";
-  LOG(INFO) << "Total Module's threads :" << d_ptr_->threads_.size();
+  if (d_ptr_->executor_) {
+    LOG(INFO) << "Total Module's workers :" << d_ptr_->executor_->GetWorkerNum();
+  } else {
+    LOG(INFO) << "Total Module's threads :" << d_ptr_->threads_.size();
+  }
   return true;
 }
 
@@ -452,7 +730,9 @@ bool Pipeline::Stop() {
   std::lock_guard<std::mutex> lk(d_ptr_->stop_mtx_);
   if (!IsRunning()) return true;
 
-  // stop data transmit
+  if (d_ptr_->queue_sampler_) d_ptr_->queue_sampler_->Stop();
+  // stop data transmit, the sources waiting for the memory budget give up
+  d_ptr_->memory_budget_->Stop();
   for (std::pair<std::string, std::shared_ptr<Connector>> connector : d_ptr_->links_) {
     connector.second->Stop();
   }
@@ -462,6 +742,7 @@ bool Pipeline::Stop() {
     if (it.joinable()) it.join();
   }
   d_ptr_->threads_.clear();
+  if (d_ptr_->executor_) d_ptr_->executor_->Stop();
   if (d_ptr_->event_thread_.joinable()) {
     d_ptr_->event_thread_.join();
   }
@@ -471,12 +752,31 @@ bool Pipeline::Stop() {
   }
 
   d_ptr_->ClearEOSMask();
+  SourceModule::ReleaseStreamIndexSpace();
   LOG(INFO) << "Pipeline Stop";
   return true;
 }
 
 EventBus* Pipeline::GetEventBus() const { return event_bus_; }
 
+bool Pipeline::SetExecutor(ExecutorType type, uint32_t worker_num) {
+  if (IsRunning()) {
+    LOG(ERROR) << "The executor can not be changed while the pipeline is running.";
+    return false;
+  }
+  d_ptr_->executor_type_ = type;
+  d_ptr_->executor_worker_num_ = worker_num;
+  return true;
+}
+
+ExecutorType Pipeline::GetExecutorType() const { return d_ptr_->executor_type_; }
+
+void Pipeline::SetMemoryBudget(size_t bytes, MemoryBudgetPolicy policy) {
+  d_ptr_->memory_budget_->SetLimit(bytes, policy);
+}
+
+MemoryBudgetStatus Pipeline::GetMemoryBudgetStatus() const { return d_ptr_->memory_budget_->GetStatus(); }
+
 void Pipeline::EventLoop() {
   const std::list<std::pair<BusWatcher, Module*>>& kWatchers = event_bus_->GetBusWatchers();
   EventHandleFlag flag = EVENT_HANDLE_NULL;
@@ -516,6 +816,19 @@ void Pipeline::PrintPerformanceInformation() const {
   }
 }
 
+/* starts copying the planes to the side the module reads, the copy overlaps with the time the frame is queued */
+static void PrefetchFrame(CNDataFrame* frame, ModuleDataAccess access) {
+  if (MODULE_DATA_ACCESS_ANY == access || (frame->flags & CN_FRAME_FLAG_EOS)) return;
+  for (int i = 0; i < frame->GetPlanes(); ++i) {
+    if (!frame->data[i]) continue;
+    if (MODULE_DATA_ACCESS_CPU == access) {
+      frame->data[i]->PrefetchToCpu();
+    } else {
+      frame->data[i]->PrefetchToMlu();
+    }
+  }
+}
+
 void Pipeline::TransmitData(std::string moduleName, std::shared_ptr<CNFrameInfo> data) {
   LOG_IF(FATAL, d_ptr_->modules_.find(moduleName) == d_ptr_->modules_.end());
 
@@ -535,8 +848,7 @@ void Pipeline::TransmitData(std::string moduleName, std::shared_ptr<CNFrameInfo>
     e.message = module_info.instance->GetName() + " received eos from channel " + std::to_string(chn_idx);
     e.thread_id = std::this_thread::get_id();
     event_bus_->PostEvent(e);
-    const uint64_t eos_mask = data->frame.AddEOSMask(module_info.instance.get());
-    if (eos_mask == d_ptr_->eos_mask_) {
+    if (data->frame.AddEOSCount() == d_ptr_->eos_module_num_) {
       StreamMsg msg;
       msg.type = StreamMsgType::EOS_MSG;
       msg.chn_idx = chn_idx;
@@ -546,11 +858,30 @@ void Pipeline::TransmitData(std::string moduleName, std::shared_ptr<CNFrameInfo>
   }
 
   /*
-    set module mask
+    the frame forks into a branch for each downstream module, the branch ends if there is none
+   */
+  if (!(data->frame.flags & CN_FRAME_FLAG_EOS) && module_info.down_nodes.size() != 1) {
+    data->frame.AddBranches(static_cast<int>(module_info.down_nodes.size()) - 1);
+  }
+
+  /*
+    the frame is done by the module, the downstream modules start the queue wait from here
+   */
+  if (!(data->frame.flags & CN_FRAME_FLAG_EOS)) {
+    int64_t now = NowNs();
+    size_t module_id = module_info.instance->GetId();
+    if (module_id < data->transmit_ns_.size()) data->transmit_ns_[module_id] = now;
+    module_info.latency->from_source.Record(now - data->create_ns);
+    if (module_info.down_nodes.empty()) d_ptr_->end_to_end_latency_.Record(now - data->create_ns);
+  }
+
+  /*
+    set module mask and prefetch for downstream modules
    */
   for (auto& down_node_name : module_info.down_nodes) {
     ModuleAssociatedInfo& down_node_info = d_ptr_->modules_.find(down_node_name)->second;
     data->frame.SetModuleMask(down_node_info.instance.get(), module_info.instance.get());
+    PrefetchFrame(&data->frame, down_node_info.instance->GetDataAccess());
   }
 
   // broadcast
@@ -558,7 +889,10 @@ void Pipeline::TransmitData(std::string moduleName, std::shared_ptr<CNFrameInfo>
   for (auto& id : connector_ids) {
     std::shared_ptr<Connector>& connector = d_ptr_->links_[id];
     int conveyor_idx = chn_idx % connector->GetConveyorCount();
+    // the module waits here while the queue is full
+    int64_t push_ns = IsTraceEnabled() ? NowNs() : 0;
     connector->PushDataBufferToConveyor(conveyor_idx, data);
+    if (push_ns) TraceSpan("push", connector->GetTraceName(), push_ns, NowNs(), data->frame.frame_id);
   }
 }
 
@@ -574,9 +908,7 @@ void Pipeline::TaskLoop(std::string node_name, uint32_t conveyor_idx) {
 
   if (input_connectors.size() == 0) return;
 
-  size_t len = node_name.size() > 10 ? 10 : node_name.size();
-  std::string thread_name = "cn-" + node_name.substr(0, len) + std::to_string(conveyor_idx);
-  SetThreadName(thread_name, pthread_self());
+  SetThreadName(GetModuleThreadName(node_name, conveyor_idx), pthread_self());
 
   bool has_data = true;
   while (has_data) {
@@ -584,7 +916,10 @@ void Pipeline::TaskLoop(std::string node_name, uint32_t conveyor_idx) {
     std::shared_ptr<CNFrameInfo> data;
     // sync data
     for (std::shared_ptr<Connector> connector : input_connectors) {
+      // the thread starves here while the queue is empty
+      int64_t wait_ns = IsTraceEnabled() ? NowNs() : 0;
       data = connector->PopDataBufferFromConveyor(conveyor_idx);
+      if (wait_ns && data) TraceSpan("wait", connector->GetTraceName(), wait_ns, NowNs(), data->frame.frame_id);
       if (nullptr == data.get()) {
         /*
           nullptr will be received when connector stops.
@@ -595,48 +930,161 @@ void Pipeline::TaskLoop(std::string node_name, uint32_t conveyor_idx) {
 
       has_data = true;
 
-      if (data->frame.GetModulesMask(module_info.instance.get()) == module_info.instance->GetModulesMask()) {
-        data->frame.ClearModuleMask(module_info.instance.get());
-        int flags = data->frame.flags;
+      if (!d_ptr_->ProcessData(node_name, &module_info, connector.get(), data)) return;
+    }  // for
+  }    // while
+}
 
-        if (!module_info.instance->hasTranmit() && (CN_FRAME_FLAG_EOS & flags)) {
-          /*normal module, transmit EOS by the framework*/
-          TransmitData(node_name, data);
-          continue;
-        }
+bool PipelinePrivate::ProcessData(const std::string& node_name, ModuleAssociatedInfo* module_info, Connector* link,
+                                  std::shared_ptr<CNFrameInfo> data) {
+  int64_t pop_ns = 0;
+  if (!(data->frame.flags & CN_FRAME_FLAG_EOS)) {
+    pop_ns = NowNs();
+    size_t up_id = link->GetUpstreamId();
+    if (up_id < data->transmit_ns_.size()) {
+      int64_t wait_ns = pop_ns - data->transmit_ns_[up_id];
+      link->GetQueueLatency()->Record(wait_ns);
+      module_info->latency->queue.Record(wait_ns);
+    }
+  }
+  if (!data->frame.ClaimModuleMask(module_info->instance.get())) {
+    // waits for the other upstream modules, or the frame is dropped by one of them
+    return true;
+  }
+  int flags = data->frame.flags;
+
+  if (!module_info->instance->hasTranmit() && (CN_FRAME_FLAG_EOS & flags)) {
+    /*normal module, transmit EOS by the framework*/
+    q_ptr_->TransmitData(node_name, data);
+    return true;
+  }
+
+  // the branches from the upstream modules join here
+  size_t parent_num = module_info->instance->GetParentNum();
+  if (parent_num > 1 && !(CN_FRAME_FLAG_EOS & flags)) data->frame.AddBranches(1 - static_cast<int>(parent_num));
+
+  CNDataFrame::SetProcessContext(module_info->instance.get(), link);
+  int ret = module_info->instance->DoProcess(data);
+  CNDataFrame::SetProcessContext(nullptr, nullptr);
+  // the modules transmitting by themselves are timed until Process() returns
+  if (pop_ns) {
+    int64_t end_ns = NowNs();
+    module_info->latency->process.Record(end_ns - pop_ns);
+    TraceSpan("process", module_info->trace_name, pop_ns, end_ns, data->frame.frame_id);
+  }
+  /*process failed*/
+  if (ret < 0) {
+    Event e;
+    e.type = EventType::EVENT_ERROR;
+    e.module = module_info->instance.get();
+    e.message = module_info->instance->GetName() + " process failed, return number: " + std::to_string(ret);
+    e.thread_id = std::this_thread::get_id();
+    q_ptr_->event_bus_->PostEvent(e);
+    StreamMsg msg;
+    msg.type = StreamMsgType::ERROR_MSG;
+    msg.chn_idx = data->channel_idx;
+    msg.stream_id = data->frame.stream_id;
+    UpdateByStreamMsg(msg);
+    return false;
+  } else if (ret > 0) {
+    // data has been transmitted by the module itself
+    if (!module_info->instance->hasTranmit()) {
+      LOG(ERROR) << "Module::Process() should not return 1\n";
+      return false;
+    }
+    return true;
+  }
+  q_ptr_->TransmitData(node_name, data);
+  return true;
+}
 
-        {
-          int ret = module_info.instance->DoProcess(data);
-          /*process failed*/
-          if (ret < 0) {
-            Event e;
-            e.type = EventType::EVENT_ERROR;
-            e.module = module_info.instance.get();
-            e.message = module_info.instance->GetName() + " process failed, return number: " + std::to_string(ret);
-            e.thread_id = std::this_thread::get_id();
-            event_bus_->PostEvent(e);
-            StreamMsg msg;
-            msg.type = StreamMsgType::ERROR_MSG;
-            msg.chn_idx = data->channel_idx;
-            msg.stream_id = data->frame.stream_id;
-            d_ptr_->UpdateByStreamMsg(msg);
-            return;
-          } else if (ret > 0) {
-            // data has been transmitted by the module itself
-            if (!module_info.instance->hasTranmit()) {
-              LOG(ERROR) << "Module::Process() should not return 1\n";
-              return;
-            }
-            continue;
+void PipelinePrivate::StartExecutor() {
+  // at most this many frames are processed each time a task runs, then the worker picks the next task
+  static const int kFramesPerRun = 8;
+  std::shared_ptr<WorkStealingExecutor> executor = std::make_shared<WorkStealingExecutor>(executor_worker_num_);
+  std::map<std::string, std::vector<WorkStealingExecutor::Task*>> module_tasks;
+  for (auto& it : modules_) {
+    const std::string node_name = it.first;
+    ModuleAssociatedInfo* module_info = &it.second;
+    std::vector<std::shared_ptr<Connector>> input_connectors;
+    for (auto& link_id : module_info->input_connectors) input_connectors.push_back(links_[link_id]);
+    if (input_connectors.empty()) continue;
+    // the frames the task could not push wait on these conveyors, the task yields until they are pushed
+    std::vector<Conveyor*> outputs;
+    for (auto& link_id : module_info->output_connectors) {
+      std::shared_ptr<Connector>& connector = links_[link_id];
+      for (uint32_t i = 0; i < connector->GetConveyorCount(); ++i) outputs.push_back(connector->GetConveyor(i));
+    }
+    for (uint32_t conveyor_idx = 0; conveyor_idx < module_info->parallelism; ++conveyor_idx) {
+      std::vector<Conveyor*> conveyors;
+      std::vector<Connector*> links;
+      for (auto& connector : input_connectors) {
+        conveyors.push_back(connector->GetConveyor(conveyor_idx));
+        links.push_back(connector.get());
+      }
+      auto push_parked = [outputs]() -> bool {
+        bool drained = true;
+        for (Conveyor* conveyor : outputs) drained = conveyor->PushParked() && drained;
+        return drained;
+      };
+      auto run = [this, node_name, module_info, conveyors, links, push_parked]() -> bool {
+        for (int processed = 0; processed < kFramesPerRun && q_ptr_->IsRunning();) {
+          if (!push_parked()) break;
+          bool has_data = false;
+          for (size_t i = 0; i < conveyors.size(); ++i) {
+            std::shared_ptr<CNFrameInfo> data = conveyors[i]->TryPopDataBuffer();
+            if (nullptr == data.get()) continue;
+            has_data = true;
+            ++processed;
+            if (!ProcessData(node_name, module_info, links[i], data)) return false;
           }
+          if (!has_data) break;
         }
-        TransmitData(node_name, data);
-      } else {
-        // LOG(INFO) << std::hex << data->frame.GetModulesMask(module_info.instance.get()) << " : " <<
-        // module_info.instance->GetModulesMask();
+        return true;
+      };
+      auto check = [conveyors, outputs]() -> bool {
+        bool parked = false;
+        for (Conveyor* conveyor : outputs) {
+          if (conveyor->CanPushParked()) return true;
+          parked = parked || conveyor->HasParked();
+        }
+        if (parked) return false;
+        for (Conveyor* conveyor : conveyors) {
+          if (conveyor->GetBufferSize()) return true;
+        }
+        return false;
+      };
+      WorkStealingExecutor::Task* task = executor->AddTask(run, check);
+      module_tasks[node_name].push_back(task);
+      // the callbacks hold the executor, it is released when they are replaced
+      for (Conveyor* conveyor : conveyors) conveyor->SetPushCallback([executor, task]() { executor->Schedule(task); });
+    }
+  }
+  // a consumer freeing space resumes the producers which parked frames on the conveyor
+  for (auto& it : modules_) {
+    auto tasks = module_tasks.find(it.first);
+    if (module_tasks.end() == tasks) continue;
+    std::vector<WorkStealingExecutor::Task*> producers = tasks->second;
+    for (auto& link_id : it.second.output_connectors) {
+      std::shared_ptr<Connector>& connector = links_[link_id];
+      for (uint32_t i = 0; i < connector->GetConveyorCount(); ++i) {
+        connector->GetConveyor(i)->SetSpaceCallback([executor, producers]() {
+          for (WorkStealingExecutor::Task* task : producers) executor->Schedule(task);
+        });
       }
-    }  // for
-  }    // while
+    }
+  }
+  executor->Start();
+  executor_ = executor;
+}
+
+void PipelinePrivate::ClearPushCallbacks() {
+  for (auto& it : links_) {
+    for (uint32_t i = 0; i < it.second->GetConveyorCount(); ++i) {
+      it.second->GetConveyor(i)->SetPushCallback(nullptr);
+      it.second->GetConveyor(i)->SetSpaceCallback(nullptr);
+    }
+  }
 }
 
 /* ------config/auto-graph methods------ */
@@ -674,6 +1122,8 @@ int Pipeline::BuildPipeline(const std::vector<CNModuleConfig>& configs) {
   /*TODO,check configs*/
   ModuleCreatorWorker creator;
   std::map<std::string, int> queues_size;
+  std::map<std::string, LinkQueueType> queues_type;
+  std::map<std::string, std::pair<LinkOverflowPolicy, uint32_t>> queues_policy;
   for (auto& v : configs) {
     this->AddModuleConfig(v);
     Module* module = creator.Create(v.className, v.name);
@@ -687,12 +1137,16 @@ int Pipeline::BuildPipeline(const std::vector<CNModuleConfig>& configs) {
     d_ptr_->modules_map_[v.name] = instance;
 
     queues_size[v.name] = v.maxInputQueueSize;
+    queues_type[v.name] = v.inputQueueType;
+    queues_policy[v.name] = std::make_pair(v.inputOverflowPolicy, v.inputKeepLatestNum);
     this->AddModule(instance);
     this->SetModuleParallelism(instance, v.parallelism);
   }
   for (auto& v : d_ptr_->connections_config_) {
     for (auto& name : v.second) {
-      if (this->LinkModules(d_ptr_->modules_map_[v.first], d_ptr_->modules_map_[name], queues_size[name]).empty()) {
+      if (this->LinkModules(d_ptr_->modules_map_[v.first], d_ptr_->modules_map_[name], queues_size[name],
+                            queues_type[name], queues_policy[name].first, queues_policy[name].second)
+              .empty()) {
         LOG(ERROR) << "Link [" << v.first << "] with [" << name << "] failed.";
         return -1;
       }
@@ -701,7 +1155,7 @@ int Pipeline::BuildPipeline(const std::vector<CNModuleConfig>& configs) {
   return 0;
 }
 
-int Pipeline::BuildPipelineByJSONFile(const std::string& config_file) {
+std::vector<CNModuleConfig> ParsePipelineJSONFile(const std::string& config_file) {
   std::ifstream ifs(config_file);
   if (!ifs.is_open()) {
     throw "Open file filed: " + config_file;
@@ -758,8 +1212,11 @@ int Pipeline::BuildPipelineByJSONFile(const std::string& config_file) {
     }
     mconfs.push_back(mconf);
   }
+  return mconfs;
+}
 
-  return BuildPipeline(mconfs);
+int Pipeline::BuildPipelineByJSONFile(const std::string& config_file) {
+  return BuildPipeline(ParsePipelineJSONFile(config_file));
 }
 
 Module* Pipeline::GetModule(const std::string& moduleName) {
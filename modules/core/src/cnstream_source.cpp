@@ -21,19 +21,62 @@
 #include "cnstream_eventbus.hpp"
 #include "cnstream_pipeline.hpp"
 
-#include <bitset>
+#include <atomic>
+#include <functional>
+#include <queue>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace cnstream {
 
 static CNSpinLock stream_idx_lock;
 static std::unordered_map<std::string, uint32_t> stream_idx_map;
 
-static const uint32_t MAX_STREAM_NUM = 64;
-static std::bitset<MAX_STREAM_NUM> stream_bitset(0);
+static const uint32_t DEFAULT_MAX_STREAM_NUM = 64;
+static std::atomic<uint32_t> max_stream_num{DEFAULT_MAX_STREAM_NUM};
+/*
+  indexes below next_stream_idx have been handed out once, the returned ones wait in free_stream_idx.
+  the smallest free index is always handed out first.
+ */
+static uint32_t next_stream_idx = 0;
+static std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> free_stream_idx;
+/* the pipelines running, their modules have been sized with max_stream_num */
+static uint32_t running_pipeline_num = 0;
+
+uint32_t GetMaxStreamNumber() { return max_stream_num.load(); }
+
+static void _ResizeStreamIndexSpace(uint32_t num) {
+  max_stream_num = num;
+  next_stream_idx = 0;
+  free_stream_idx = decltype(free_stream_idx)();
+}
+
+bool SetMaxStreamNumber(uint32_t num) {
+  CNSpinLockGuard guard(stream_idx_lock);
+  if (0 == num || running_pipeline_num || !stream_idx_map.empty()) {
+    return false;
+  }
+  _ResizeStreamIndexSpace(num);
+  return true;
+}
+
+bool SourceModule::AcquireStreamIndexSpace(uint32_t num) {
+  CNSpinLockGuard guard(stream_idx_lock);
+  if (0 != num && num != max_stream_num) {
+    if (running_pipeline_num || !stream_idx_map.empty()) {
+      return false;
+    }
+    _ResizeStreamIndexSpace(num);
+  }
+  ++running_pipeline_num;
+  return true;
+}
 
-uint32_t GetMaxStreamNumber() { return MAX_STREAM_NUM; }
+void SourceModule::ReleaseStreamIndexSpace() {
+  CNSpinLockGuard guard(stream_idx_lock);
+  if (running_pipeline_num) --running_pipeline_num;
+}
 
 static uint32_t _GetStreamIndex(const std::string &stream_id) {
   CNSpinLockGuard guard(stream_idx_lock);
@@ -42,14 +85,17 @@ static uint32_t _GetStreamIndex(const std::string &stream_id) {
     return search->second;
   }
 
-  for (uint32_t i = 0; i < GetMaxStreamNumber(); i++) {
-    if (!stream_bitset[i]) {
-      stream_bitset.set(i);
-      stream_idx_map[stream_id] = i;
-      return i;
-    }
+  uint32_t stream_idx = INVALID_STREAM_IDX;
+  if (!free_stream_idx.empty()) {
+    stream_idx = free_stream_idx.top();
+    free_stream_idx.pop();
+  } else if (next_stream_idx < max_stream_num) {
+    stream_idx = next_stream_idx++;
+  } else {
+    return INVALID_STREAM_IDX;
   }
-  return INVALID_STREAM_IDX;
+  stream_idx_map[stream_id] = stream_idx;
+  return stream_idx;
 }
 
 static int _ReturnStreamIndex(const std::string &stream_id) {
@@ -59,10 +105,10 @@ static int _ReturnStreamIndex(const std::string &stream_id) {
     return -1;
   }
   uint32_t stream_idx = search->second;
-  if (stream_idx >= GetMaxStreamNumber()) {
+  if (stream_idx >= max_stream_num) {
     return -1;
   }
-  stream_bitset.reset(stream_idx);
+  free_stream_idx.push(stream_idx);
   stream_idx_map.erase(search);
   return 0;
 }
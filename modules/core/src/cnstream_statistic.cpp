@@ -18,6 +18,156 @@
  * THE SOFTWARE.
  *************************************************************************/
 
+#include <algorithm>
+#include <iostream>
+
 #include "cnstream_statistic.hpp"
 
-namespace cnstream {}  // namespace cnstream
+namespace cnstream {
+
+constexpr uint32_t StreamFpsStat::kChunkSize;
+constexpr uint32_t StreamFpsStat::kMaxChunkNum;
+
+static int64_t FpsNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+StreamFpsStat::StreamFpsStat() {
+  for (auto &chunk : chunks_) chunk.store(nullptr, std::memory_order_relaxed);
+}
+
+StreamFpsStat::~StreamFpsStat() {
+  for (auto &chunk : chunks_) delete[] chunk.load(std::memory_order_relaxed);
+}
+
+StreamFpsStat::StreamFps *StreamFpsStat::Get(uint32_t stream_handle, bool create) {
+  if (stream_handle >= kChunkSize * kMaxChunkNum) return nullptr;
+  std::atomic<StreamFps *> &chunk = chunks_[stream_handle / kChunkSize];
+  StreamFps *fps = chunk.load(std::memory_order_acquire);
+  if (nullptr == fps) {
+    if (!create) return nullptr;
+    std::lock_guard<std::mutex> lk(mutex_);
+    fps = chunk.load(std::memory_order_relaxed);
+    if (nullptr == fps) {
+      fps = new StreamFps[kChunkSize];
+      chunk.store(fps, std::memory_order_release);
+    }
+  }
+  return &fps[stream_handle % kChunkSize];
+}
+
+void StreamFpsStat::Update(const std::shared_ptr<CNFrameInfo> data) {
+  StreamFps *fps = Get(data->frame.stream_handle, true);
+  if (nullptr == fps) return;
+  int64_t now = FpsNowNs();
+  int64_t start = 0;
+  if (0 == fps->start_ns.load(std::memory_order_relaxed)) {
+    fps->start_ns.compare_exchange_strong(start, now, std::memory_order_relaxed);
+  }
+  if (!(data->frame.flags & CN_FRAME_FLAG_EOS)) {
+    fps->frame_count.fetch_add(1, std::memory_order_relaxed);
+    fps->end_ns.store(now, std::memory_order_relaxed);
+  }
+}
+
+double StreamFpsStat::StreamFps::Fps() const {
+  int64_t start = start_ns.load(std::memory_order_relaxed);
+  int64_t end = end_ns.load(std::memory_order_relaxed);
+  if (0 == start || end <= start) return 0.0;
+  return frame_count.load(std::memory_order_relaxed) * 1e9 / (end - start);
+}
+
+double StreamFpsStat::Fps(const std::string &stream_id) {
+  for (uint32_t handle = 0; handle < kChunkSize * kMaxChunkNum; handle += kChunkSize) {
+    if (nullptr == chunks_[handle / kChunkSize].load(std::memory_order_acquire)) continue;
+    for (uint32_t i = handle; i < handle + kChunkSize; ++i) {
+      if (GetInternedStreamId(i) == stream_id) return Get(i, false)->Fps();
+    }
+  }
+  return 0.0;
+}
+
+void StreamFpsStat::PrintFps(const std::string &moduleName) {
+  double total_fps = 0.0;
+  std::cout << "-----------------------";
+  std::cout << moduleName;
+  std::cout << " -- show Fps Statistics -------------------------" << std::endl;
+  for (uint32_t handle = 0; handle < kChunkSize * kMaxChunkNum; ++handle) {
+    if (0 == handle % kChunkSize && nullptr == chunks_[handle / kChunkSize].load(std::memory_order_acquire)) {
+      handle += kChunkSize - 1;
+      continue;
+    }
+    StreamFps *fps = Get(handle, false);
+    if (0 == fps->start_ns.load(std::memory_order_relaxed)) continue;
+    std::cout << GetInternedStreamId(handle);
+    std::cout << " -- fps: ";
+    std::cout << fps->Fps();
+    std::cout << ",  frame_count :";
+    std::cout << fps->frame_count.load(std::memory_order_relaxed);
+    std::cout << std::endl;
+    total_fps += fps->Fps();
+  }
+  std::cout << "Total fps:" << total_fps << std::endl;
+}
+
+constexpr int LatencyHistogram::kSubBucketBits;
+constexpr int LatencyHistogram::kSubBucketNum;
+constexpr int LatencyHistogram::kBucketNum;
+
+/* the values below kSubBucketNum have a bucket each, the others share kSubBucketNum buckets per power of 2 */
+int LatencyHistogram::BucketIndex(uint64_t value) {
+  if (value < static_cast<uint64_t>(kSubBucketNum)) return static_cast<int>(value);
+  int shift = 63 - __builtin_clzll(value) - kSubBucketBits;
+  return (shift + 1) * kSubBucketNum + static_cast<int>((value >> shift) & (kSubBucketNum - 1));
+}
+
+uint64_t LatencyHistogram::BucketValue(int idx) {
+  if (idx < kSubBucketNum) return idx;
+  int shift = idx / kSubBucketNum - 1;
+  uint64_t sub = idx % kSubBucketNum + kSubBucketNum;
+  return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(int64_t ns) {
+  uint64_t value = ns > 0 ? static_cast<uint64_t>(ns) : 0;
+  counts_[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(value, std::memory_order_relaxed);
+  uint64_t max = max_.load(std::memory_order_relaxed);
+  while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+  }
+}
+
+LatencyStats LatencyHistogram::GetStats() const {
+  LatencyStats stats;
+  uint64_t counts[kBucketNum];
+  uint64_t count = 0;
+  for (int i = 0; i < kBucketNum; ++i) {
+    counts[i] = counts_[i].load(std::memory_order_relaxed);
+    count += counts[i];
+  }
+  if (0 == count) return stats;
+  stats.count = count;
+  stats.mean_us = sum_.load(std::memory_order_relaxed) / 1e3 / count;
+  stats.max_us = max_.load(std::memory_order_relaxed) / 1e3;
+  double* percentiles[] = {&stats.p50_us, &stats.p90_us, &stats.p99_us};
+  const double ratios[] = {0.5, 0.9, 0.99};
+  uint64_t seen = 0;
+  int pi = 0;
+  for (int i = 0; i < kBucketNum && pi < 3; ++i) {
+    seen += counts[i];
+    while (pi < 3 && seen >= ratios[pi] * count) {
+      *percentiles[pi] = std::min(BucketValue(i) / 1e3, stats.max_us);
+      ++pi;
+    }
+  }
+  return stats;
+}
+
+void LatencyHistogram::Reset() {
+  for (auto& count : counts_) count.store(0, std::memory_order_relaxed);
+  sum_.store(0, std::memory_order_relaxed);
+  max_.store(0, std::memory_order_relaxed);
+}
+
+}  // namespace cnstream
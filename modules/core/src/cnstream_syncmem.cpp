@@ -27,22 +27,73 @@ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
-#include <cnrt.h>
 #include <glog/logging.h>
 
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
 #include "cnstream_common.hpp"
+#include "cnstream_devmem.hpp"
 #include "cnstream_syncmem.hpp"
+#include "host_memory_pool.hpp"
+#include "pool_allocator.hpp"
 
 namespace cnstream {
 
+static MemoryPool* DefaultHostMemoryPool() {
+  // never destroyed, frames may be released while static objects are being destroyed
+  static MemoryPool* pool = new SizeClassMemoryPool();
+  return pool;
+}
+
+static std::atomic<MemoryPool*> host_memory_pool{nullptr};
+
+void SetHostMemoryPool(MemoryPool* pool) { host_memory_pool.store(pool); }
+
+MemoryPool* GetHostMemoryPool() {
+  MemoryPool* pool = host_memory_pool.load();
+  return pool ? pool : DefaultHostMemoryPool();
+}
+
+MemoryPool* CreateHostMemoryPool(const HostMemoryPoolOptions& options) { return new SizeClassMemoryPool(options); }
+
+/* put before each buffer, so that CNStreamFreeHost gives it back to the pool allocated it */
+struct HostBufferHeader {
+  MemoryPool* pool;
+  size_t size;
+};
+static constexpr size_t kHostBufferHeaderSize = 64;  // keeps the alignment of the pool
+static_assert(sizeof(HostBufferHeader) <= kHostBufferHeaderSize, "HostBufferHeader is too large");
+
 void CNStreamMallocHost(void** ptr, size_t size) {
-  void* __ptr = malloc(size);
+  MemoryPool* pool = GetHostMemoryPool();
+  void* __ptr = pool->Alloc(size + kHostBufferHeaderSize);
   LOG_IF(FATAL, nullptr == __ptr) << "Malloc memory on CPU failed, malloc size:" << size;
-  *ptr = __ptr;
+  HostBufferHeader* header = static_cast<HostBufferHeader*>(__ptr);
+  header->pool = pool;
+  header->size = size + kHostBufferHeaderSize;
+  *ptr = static_cast<uint8_t*>(__ptr) + kHostBufferHeaderSize;
+}
+
+void CNStreamFreeHost(void* ptr) {
+  if (nullptr == ptr) return;
+  HostBufferHeader* header = reinterpret_cast<HostBufferHeader*>(static_cast<uint8_t*>(ptr) - kHostBufferHeaderSize);
+  header->pool->Free(header, header->size);
 }
 
 CNSyncedMemory::CNSyncedMemory() {}
 
+std::shared_ptr<CNSyncedMemory> CNSyncedMemory::Create(size_t size) {
+  return std::allocate_shared<CNSyncedMemory>(PoolAllocator<CNSyncedMemory>(), size);
+}
+
+std::shared_ptr<CNSyncedMemory> CNSyncedMemory::Create(size_t size, int mlu_dev_id, int mlu_ddr_chn) {
+  return std::allocate_shared<CNSyncedMemory>(PoolAllocator<CNSyncedMemory>(), size, mlu_dev_id, mlu_ddr_chn);
+}
+
 CNSyncedMemory::CNSyncedMemory(size_t size) : size_(size) {}
 
 CNSyncedMemory::CNSyncedMemory(size_t size, int mlu_dev_id, int mlu_ddr_chn)
@@ -50,16 +101,103 @@ CNSyncedMemory::CNSyncedMemory(size_t size, int mlu_dev_id, int mlu_ddr_chn)
 
 CNSyncedMemory::~CNSyncedMemory() {
   if (0 == size_) return;
+  WaitPrefetch();
   if (cpu_ptr_ && own_cpu_data_) {
-    free(cpu_ptr_);
+    CNStreamFreeHost(cpu_ptr_);
   }
   if (mlu_ptr_ && own_mlu_data_) {
-    CNS_CNRT_CHECK(cnrtFree(mlu_ptr_));
+    DevFree(mlu_ptr_, dev_id_, ddr_chn_);
+  }
+}
+
+/* a queue of prefetches and the notifiers marking them, a notifier is reused once its prefetch is waited for */
+class PrefetchQueue {
+ public:
+  PrefetchQueue(int dev_id, int ddr_chn) : queue_(dev_id, ddr_chn) {}
+  DevQueue* GetQueue() { return &queue_; }
+  DevNotifier* AcquireNotifier() {
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      if (!notifiers_.empty()) {
+        DevNotifier* notifier = notifiers_.back();
+        notifiers_.pop_back();
+        return notifier;
+      }
+    }
+    return new DevNotifier;
+  }
+  void ReleaseNotifier(DevNotifier* notifier) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    notifiers_.push_back(notifier);
+  }
+
+ private:
+  DevQueue queue_;
+  std::mutex mutex_;
+  std::vector<DevNotifier*> notifiers_;
+};  // class PrefetchQueue
+
+/* prefetches on one device and DDR channel share one queue and are copied one after another, like DMA */
+static PrefetchQueue* GetPrefetchQueue(int dev_id, int ddr_chn) {
+  static std::mutex mutex;
+  // never destroyed, frames may be released while static objects are being destroyed
+  static auto queues = new std::map<std::pair<int, int>, PrefetchQueue*>;
+  std::lock_guard<std::mutex> lk(mutex);
+  PrefetchQueue*& queue = (*queues)[std::make_pair(dev_id, ddr_chn)];
+  if (!queue) queue = new PrefetchQueue(dev_id, ddr_chn);
+  return queue;
+}
+
+void CNSyncedMemory::Prefetch(void* dst, const void* src, DevMemcpyDir dir) {
+  // the host buffers are pageable, copied synchronously if the device can not copy them asynchronously
+  if (!DevAsyncCopyPageable()) {
+    if (DevMemcpy(dst, src, size_, dir, dev_id_, ddr_chn_)) head_ = SYNCED;
+    return;
+  }
+  // on failure the data is copied synchronously when it is accessed
+  PrefetchQueue* queue = GetPrefetchQueue(dev_id_, ddr_chn_);
+  if (!queue->GetQueue()->MemcpyAsync(dst, src, size_, dir)) return;
+  prefetch_ = queue->AcquireNotifier();
+  prefetch_->Place(queue->GetQueue());
+  prefetch_queue_ = queue;
+  head_ = SYNCED;
+}
+
+void CNSyncedMemory::WaitPrefetch() {
+  if (!prefetch_) return;
+  prefetch_->Wait();
+  prefetch_queue_->ReleaseNotifier(prefetch_);
+  prefetch_ = nullptr;
+  prefetch_queue_ = nullptr;
+}
+
+void CNSyncedMemory::PrefetchToCpu() {
+  if (0 == size_) return;
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (HEAD_AT_MLU != head_) return;
+  if (NULL == cpu_ptr_) {
+    CNStreamMallocHost(&cpu_ptr_, size_);
+    own_cpu_data_ = true;
+  }
+  Prefetch(cpu_ptr_, mlu_ptr_, DEV_MEMCPY_DEV2HOST);
+}
+
+void CNSyncedMemory::PrefetchToMlu() {
+  if (0 == size_) return;
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (HEAD_AT_CPU != head_) return;
+  if (NULL == mlu_ptr_) {
+    mlu_ptr_ = DevMalloc(size_, dev_id_, ddr_chn_);
+    LOG_IF(FATAL, nullptr == mlu_ptr_) << "Malloc device memory failed, size: " << size_;
+    own_mlu_data_ = true;
   }
+  Prefetch(mlu_ptr_, cpu_ptr_, DEV_MEMCPY_HOST2DEV);
 }
 
 inline void CNSyncedMemory::ToCpu() {
   if (0 == size_) return;
+  std::lock_guard<std::mutex> lk(mutex_);
+  WaitPrefetch();
   switch (head_) {
     case UNINITIALIZED:
       CNStreamMallocHost(&cpu_ptr_, size_);
@@ -72,7 +210,8 @@ inline void CNSyncedMemory::ToCpu() {
         CNStreamMallocHost(&cpu_ptr_, size_);
         own_cpu_data_ = true;
       }
-      CALL_CNRT_BY_CONTEXT(cnrtMemcpy(cpu_ptr_, mlu_ptr_, size_, CNRT_MEM_TRANS_DIR_DEV2HOST), dev_id_, ddr_chn_);
+      LOG_IF(FATAL, !DevMemcpy(cpu_ptr_, mlu_ptr_, size_, DEV_MEMCPY_DEV2HOST, dev_id_, ddr_chn_))
+          << "Copy device memory to host failed, size: " << size_;
       head_ = SYNCED;
       break;
     case HEAD_AT_CPU:
@@ -83,18 +222,23 @@ inline void CNSyncedMemory::ToCpu() {
 
 inline void CNSyncedMemory::ToMlu() {
   if (0 == size_) return;
+  std::lock_guard<std::mutex> lk(mutex_);
+  WaitPrefetch();
   switch (head_) {
     case UNINITIALIZED:
-      CALL_CNRT_BY_CONTEXT(cnrtMalloc(&mlu_ptr_, size_), dev_id_, ddr_chn_);
+      mlu_ptr_ = DevMalloc(size_, dev_id_, ddr_chn_);
+      LOG_IF(FATAL, nullptr == mlu_ptr_) << "Malloc device memory failed, size: " << size_;
       head_ = HEAD_AT_MLU;
       own_mlu_data_ = true;
       break;
     case HEAD_AT_CPU:
       if (NULL == mlu_ptr_) {
-        CALL_CNRT_BY_CONTEXT(cnrtMalloc(&mlu_ptr_, size_), dev_id_, ddr_chn_);
+        mlu_ptr_ = DevMalloc(size_, dev_id_, ddr_chn_);
+        LOG_IF(FATAL, nullptr == mlu_ptr_) << "Malloc device memory failed, size: " << size_;
         own_mlu_data_ = true;
       }
-      CALL_CNRT_BY_CONTEXT(cnrtMemcpy(mlu_ptr_, cpu_ptr_, size_, CNRT_MEM_TRANS_DIR_HOST2DEV), dev_id_, ddr_chn_);
+      LOG_IF(FATAL, !DevMemcpy(mlu_ptr_, cpu_ptr_, size_, DEV_MEMCPY_HOST2DEV, dev_id_, ddr_chn_))
+          << "Copy host memory to device failed, size: " << size_;
       head_ = SYNCED;
       break;
     case HEAD_AT_MLU:
@@ -111,6 +255,8 @@ const void* CNSyncedMemory::GetCpuData() {
 void CNSyncedMemory::SetCpuData(void* data) {
   if (0 == size_) return;
   LOG_IF(FATAL, NULL == data) << "data is NULL.";
+  std::lock_guard<std::mutex> lk(mutex_);
+  WaitPrefetch();
   if (own_cpu_data_) {
     CNStreamFreeHost(cpu_ptr_);
   }
@@ -127,8 +273,10 @@ const void* CNSyncedMemory::GetMluData() {
 void CNSyncedMemory::SetMluData(void* data) {
   if (0 == size_) return;
   LOG_IF(FATAL, nullptr == data) << "data is NULL.";
+  std::lock_guard<std::mutex> lk(mutex_);
+  WaitPrefetch();
   if (own_mlu_data_) {
-    CALL_CNRT_BY_CONTEXT(cnrtFree(mlu_ptr_), dev_id_, ddr_chn_);
+    DevFree(mlu_ptr_, dev_id_, ddr_chn_);
   }
   mlu_ptr_ = data;
   head_ = HEAD_AT_MLU;
@@ -139,8 +287,7 @@ void CNSyncedMemory::SetMluDevContext(int dev_id, int ddr_chn) {
   /*
     check device
    */
-  cnrtDev_t dev;
-  LOG_IF(FATAL, CNRT_RET_SUCCESS != cnrtGetDeviceHandle(&dev, dev_id)) << "Can not find device by id: " << dev_id;
+  LOG_IF(FATAL, !DevCheck(dev_id)) << "Can not find device by id: " << dev_id;
   LOG_IF(FATAL, ddr_chn < 0 || ddr_chn >= 4) << "Invalid ddr channel [0,4) :" << ddr_chn;
 
   dev_id_ = dev_id;
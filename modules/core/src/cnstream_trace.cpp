@@ -0,0 +1,288 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "cnstream_common.hpp"
+#include "cnstream_trace.hpp"
+
+namespace cnstream {
+
+static inline int64_t TraceNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+struct TraceEvent {
+  int64_t begin_ns;
+  int64_t end_ns;
+  int64_t arg;
+  const char* category;
+  uint32_t name;
+};
+
+/*
+  The spans of a thread. Only the owner thread writes, it publishes a span by head_. The dumping thread reads
+  the spans concurrently and drops the ones which may have been overwritten meanwhile.
+ */
+struct TraceRing {
+  std::vector<TraceEvent> events;
+  std::atomic<uint64_t> head{0};
+  std::atomic<bool> in_use{false};
+  /* when the owner thread exited, no span of the ring ended later */
+  std::atomic<int64_t> retired_ns{0};
+  int tid = 0;
+  std::string thread_name;
+};
+
+class TraceRegistry {
+ public:
+  static TraceRegistry* Instance() {
+    // never deleted, the threads may record spans while the process exits
+    static TraceRegistry* instance = new TraceRegistry();
+    return instance;
+  }
+
+  uint32_t RegisterName(const std::string& name) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto it = name_ids_.find(name);
+    if (it != name_ids_.end()) return it->second;
+    uint32_t id = static_cast<uint32_t>(names_.size());
+    names_.push_back(name);
+    name_ids_[name] = id;
+    return id;
+  }
+
+  /*
+    the rings of the exited threads are reused once their spans are too old to be dumped by default, their
+    spans are dropped then. a fresh ring is allocated otherwise.
+   */
+  TraceRing* AcquireRing() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    TraceRing* ring = nullptr;
+    const int64_t retired_before_ns = TraceNowNs() - kRetiredRingKeepNs;
+    for (auto& it : rings_) {
+      if (!it->in_use.load() && it->retired_ns.load() < retired_before_ns) {
+        ring = it.get();
+        break;
+      }
+    }
+    if (!ring) {
+      rings_.emplace_back(new TraceRing);
+      ring = rings_.back().get();
+    }
+    if (ring->events.size() != buffer_size_) {
+      ring->events.clear();
+      ring->events.resize(buffer_size_);
+    }
+    ring->head.store(0);
+    ring->tid = static_cast<int>(syscall(SYS_gettid));
+    char name[16] = {0};
+    pthread_getname_np(pthread_self(), name, sizeof(name));
+    ring->thread_name = name;
+    ring->in_use.store(true);
+    return ring;
+  }
+
+  void SetBufferSize(size_t events) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    buffer_size_ = events > 0 ? events : 1;
+  }
+
+  bool Dump(const std::string& path, double last_seconds);
+
+  std::atomic<bool> enabled{false};
+
+ private:
+  static constexpr int64_t kRetiredRingKeepNs = 60 * 1000000000LL;
+  TraceRegistry() {}
+  std::mutex mutex_;
+  std::vector<std::string> names_;
+  std::unordered_map<std::string, uint32_t> name_ids_;
+  std::vector<std::unique_ptr<TraceRing>> rings_;
+  size_t buffer_size_ = 65536;
+};  // class TraceRegistry
+
+/* gives the ring back when the thread exits */
+struct TraceRingHolder {
+  TraceRing* ring = nullptr;
+  ~TraceRingHolder() {
+    if (!ring) return;
+    ring->retired_ns.store(TraceNowNs());
+    ring->in_use.store(false);
+  }
+};
+
+static thread_local TraceRingHolder trace_ring_holder;
+
+void SetTraceEnabled(bool enable) { TraceRegistry::Instance()->enabled.store(enable); }
+
+bool IsTraceEnabled() { return TraceRegistry::Instance()->enabled.load(std::memory_order_relaxed); }
+
+void SetTraceBufferSize(size_t events) { TraceRegistry::Instance()->SetBufferSize(events); }
+
+uint32_t RegisterTraceName(const std::string& name) { return TraceRegistry::Instance()->RegisterName(name); }
+
+void TraceSpan(const char* category, uint32_t name, int64_t begin_ns, int64_t end_ns, int64_t arg) {
+  if (!IsTraceEnabled()) return;
+  TraceRing* ring = trace_ring_holder.ring;
+  if (!ring) ring = trace_ring_holder.ring = TraceRegistry::Instance()->AcquireRing();
+  uint64_t head = ring->head.load(std::memory_order_relaxed);
+  TraceEvent& event = ring->events[head % ring->events.size()];
+  event.begin_ns = begin_ns;
+  event.end_ns = end_ns;
+  event.arg = arg;
+  event.category = category;
+  event.name = name;
+  ring->head.store(head + 1, std::memory_order_release);
+}
+
+TraceScope::TraceScope(const char* category, uint32_t name, int64_t arg) : category_(category), name_(name), arg_(arg) {
+  if (IsTraceEnabled()) begin_ns_ = TraceNowNs();
+}
+
+TraceScope::~TraceScope() {
+  if (begin_ns_) TraceSpan(category_, name_, begin_ns_, TraceNowNs(), arg_);
+}
+
+static std::string JsonEscape(const std::string& str) {
+  std::string escaped;
+  for (char c : str) {
+    if ('"' == c || '\\' == c) {
+      escaped += '\\';
+      escaped += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      escaped += buf;
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+bool TraceRegistry::Dump(const std::string& path, double last_seconds) {
+  std::ofstream ofs(path);
+  if (!ofs.is_open()) {
+    LOG(ERROR) << "[Trace] open " << path << " failed";
+    return false;
+  }
+  const int64_t since_ns = TraceNowNs() - static_cast<int64_t>(last_seconds * 1e9);
+  const int pid = getpid();
+  std::lock_guard<std::mutex> lk(mutex_);
+  ofs << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  std::vector<TraceEvent> events;
+  char buf[64];
+  for (auto& ring : rings_) {
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+    if (0 == head) continue;
+    const uint64_t capacity = ring->events.size();
+    uint64_t begin = head > capacity ? head - capacity : 0;
+    events.assign(head - begin, TraceEvent());
+    for (uint64_t i = begin; i < head; ++i) events[i - begin] = ring->events[i % capacity];
+    // the spans written meanwhile overwrite the oldest ones, and the one being written is torn
+    uint64_t new_head = ring->head.load(std::memory_order_acquire);
+    uint64_t valid = new_head + 1 > capacity ? new_head + 1 - capacity : 0;
+    ofs << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << ring->tid
+        << ",\"args\":{\"name\":\"" << JsonEscape(ring->thread_name) << "\"}}";
+    first = false;
+    for (uint64_t i = std::max(begin, valid); i < head; ++i) {
+      const TraceEvent& event = events[i - begin];
+      if (event.end_ns < since_ns || event.name >= names_.size()) continue;
+      snprintf(buf, sizeof(buf), "%.3f,\"dur\":%.3f", event.begin_ns / 1e3, (event.end_ns - event.begin_ns) / 1e3);
+      ofs << ",\n{\"name\":\"" << JsonEscape(names_[event.name]) << "\",\"cat\":\"" << event.category
+          << "\",\"ph\":\"X\",\"ts\":" << buf << ",\"pid\":" << pid << ",\"tid\":" << ring->tid;
+      if (event.arg >= 0) ofs << ",\"args\":{\"arg\":" << event.arg << "}";
+      ofs << "}";
+    }
+  }
+  ofs << "\n]}\n";
+  return ofs.good();
+}
+
+bool DumpTrace(const std::string& path, double last_seconds) {
+  return TraceRegistry::Instance()->Dump(path, last_seconds);
+}
+
+/*
+  SIGUSR2 wakes up the dumping thread, the file is not written in the signal handler
+ */
+static sem_t trace_dump_sem;
+static std::mutex trace_dump_mutex;
+static std::string trace_dump_path;
+static double trace_dump_seconds = 10;
+
+static void TraceDumpSignalHandler(int) { sem_post(&trace_dump_sem); }
+
+bool SetTraceDumpSignal(const std::string& path, double last_seconds) {
+  std::lock_guard<std::mutex> lk(trace_dump_mutex);
+  trace_dump_path = path;
+  trace_dump_seconds = last_seconds;
+  static bool thread_started = false;
+  if (!thread_started) {
+    if (0 != sem_init(&trace_dump_sem, 0, 0)) return false;
+    std::thread([] {
+      SetThreadName("cn-TraceDump");
+      while (true) {
+        if (0 != sem_wait(&trace_dump_sem)) {
+          if (EINTR == errno) continue;
+          return;
+        }
+        std::string path;
+        double seconds;
+        {
+          std::lock_guard<std::mutex> lk(trace_dump_mutex);
+          path = trace_dump_path;
+          seconds = trace_dump_seconds;
+        }
+        if (DumpTrace(path, seconds)) LOG(INFO) << "[Trace] dumped to " << path;
+      }
+    }).detach();
+    thread_started = true;
+  }
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = TraceDumpSignalHandler;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART;
+  return 0 == sigaction(SIGUSR2, &action, nullptr);
+}
+
+}  // namespace cnstream
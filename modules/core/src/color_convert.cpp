@@ -0,0 +1,277 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "color_convert.hpp"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CNS_COLOR_CONVERT_X86
+#include <immintrin.h>
+#endif
+
+namespace cnstream {
+
+namespace {
+
+/* BT.601 limited range in 20-bit fixed point, the same as OpenCV */
+constexpr int kShift = 20;
+constexpr int kHalf = 1 << (kShift - 1);
+constexpr int kCY = 1220542;
+constexpr int kCUB = 2116026;
+constexpr int kCUG = -409993;
+constexpr int kCVG = -852492;
+constexpr int kCVR = 1673527;
+
+inline uint8_t Clamp(int v) { return static_cast<uint8_t>(std::min(std::max(v, 0), 255)); }
+
+/*
+  Converts pixels [begin, width) of a row pair sharing one chroma row, y1 and dst1 are nullptr for the last row
+  of an image with odd height.
+*/
+typedef void (*RowPairFunc)(const uint8_t* y0, const uint8_t* y1, const uint8_t* uv, bool nv21, int width,
+                            uint8_t* dst0, uint8_t* dst1);
+
+void RowPairScalar(const uint8_t* y0, const uint8_t* y1, const uint8_t* uv, bool nv21, int begin, int width,
+                   uint8_t* dst0, uint8_t* dst1) {
+  for (int x = begin; x < width; ++x) {
+    int u = static_cast<int>(uv[(x & ~1) + (nv21 ? 1 : 0)]) - 128;
+    int v = static_cast<int>(uv[(x & ~1) + (nv21 ? 0 : 1)]) - 128;
+    int ruv = kHalf + kCVR * v;
+    int guv = kHalf + kCVG * v + kCUG * u;
+    int buv = kHalf + kCUB * u;
+    int yy = std::max(0, static_cast<int>(y0[x]) - 16) * kCY;
+    dst0[3 * x] = Clamp((yy + buv) >> kShift);
+    dst0[3 * x + 1] = Clamp((yy + guv) >> kShift);
+    dst0[3 * x + 2] = Clamp((yy + ruv) >> kShift);
+    if (nullptr == y1) continue;
+    yy = std::max(0, static_cast<int>(y1[x]) - 16) * kCY;
+    dst1[3 * x] = Clamp((yy + buv) >> kShift);
+    dst1[3 * x + 1] = Clamp((yy + guv) >> kShift);
+    dst1[3 * x + 2] = Clamp((yy + ruv) >> kShift);
+  }
+}
+
+void RowPairScalar(const uint8_t* y0, const uint8_t* y1, const uint8_t* uv, bool nv21, int width, uint8_t* dst0,
+                   uint8_t* dst1) {
+  RowPairScalar(y0, y1, uv, nv21, 0, width, dst0, dst1);
+}
+
+#ifdef CNS_COLOR_CONVERT_X86
+
+/* interleaves 16 B, G and R values into 48 bytes of BGR24 */
+__attribute__((target("sse4.1"))) inline void StoreBGR(__m128i b, __m128i g, __m128i r, uint8_t* dst) {
+  const __m128i b0 = _mm_setr_epi8(0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5);
+  const __m128i g0 = _mm_setr_epi8(-1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1);
+  const __m128i r0 = _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1);
+  const __m128i b1 = _mm_setr_epi8(-1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1);
+  const __m128i g1 = _mm_setr_epi8(5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10);
+  const __m128i r1 = _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1);
+  const __m128i b2 = _mm_setr_epi8(-1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1);
+  const __m128i g2 = _mm_setr_epi8(-1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1);
+  const __m128i r2 = _mm_setr_epi8(10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15);
+  __m128i out0 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(b, b0), _mm_shuffle_epi8(g, g0)), _mm_shuffle_epi8(r, r0));
+  __m128i out1 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(b, b1), _mm_shuffle_epi8(g, g1)), _mm_shuffle_epi8(r, r1));
+  __m128i out2 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(b, b2), _mm_shuffle_epi8(g, g2)), _mm_shuffle_epi8(r, r2));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), out0);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), out1);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 32), out2);
+}
+
+/* splits 8 interleaved chroma pairs into U and V minus 128, 16-bit lanes */
+__attribute__((target("sse4.1"))) inline void LoadChroma(const uint8_t* uv, bool nv21, __m128i* u, __m128i* v) {
+  __m128i uvv = _mm_loadu_si128(reinterpret_cast<const __m128i*>(uv));
+  __m128i lo = _mm_sub_epi16(_mm_and_si128(uvv, _mm_set1_epi16(0xff)), _mm_set1_epi16(128));
+  __m128i hi = _mm_sub_epi16(_mm_srli_epi16(uvv, 8), _mm_set1_epi16(128));
+  *u = nv21 ? hi : lo;
+  *v = nv21 ? lo : hi;
+}
+
+/* the chroma terms of 16 pixels, 4 pixels per vector */
+struct ChromaSSE {
+  __m128i r[4], g[4], b[4];
+};
+
+__attribute__((target("sse4.1"))) inline void ChromaTermsSSE(__m128i u16, __m128i v16, ChromaSSE* c) {
+  const __m128i half = _mm_set1_epi32(kHalf);
+  for (int i = 0; i < 2; ++i) {
+    __m128i u = _mm_cvtepi16_epi32(i ? _mm_srli_si128(u16, 8) : u16);
+    __m128i v = _mm_cvtepi16_epi32(i ? _mm_srli_si128(v16, 8) : v16);
+    __m128i ruv = _mm_add_epi32(half, _mm_mullo_epi32(v, _mm_set1_epi32(kCVR)));
+    __m128i guv = _mm_add_epi32(_mm_add_epi32(half, _mm_mullo_epi32(v, _mm_set1_epi32(kCVG))),
+                                _mm_mullo_epi32(u, _mm_set1_epi32(kCUG)));
+    __m128i buv = _mm_add_epi32(half, _mm_mullo_epi32(u, _mm_set1_epi32(kCUB)));
+    // each chroma pair covers 2 pixels
+    c->r[2 * i] = _mm_unpacklo_epi32(ruv, ruv);
+    c->r[2 * i + 1] = _mm_unpackhi_epi32(ruv, ruv);
+    c->g[2 * i] = _mm_unpacklo_epi32(guv, guv);
+    c->g[2 * i + 1] = _mm_unpackhi_epi32(guv, guv);
+    c->b[2 * i] = _mm_unpacklo_epi32(buv, buv);
+    c->b[2 * i + 1] = _mm_unpackhi_epi32(buv, buv);
+  }
+}
+
+__attribute__((target("sse4.1"))) inline __m128i LumaSSE(__m128i y8) {
+  __m128i yy = _mm_max_epi32(_mm_sub_epi32(_mm_cvtepu8_epi32(y8), _mm_set1_epi32(16)), _mm_setzero_si128());
+  return _mm_mullo_epi32(yy, _mm_set1_epi32(kCY));
+}
+
+__attribute__((target("sse4.1"))) inline __m128i PackChannel(const __m128i* y, const __m128i* c) {
+  __m128i v0 = _mm_srai_epi32(_mm_add_epi32(y[0], c[0]), kShift);
+  __m128i v1 = _mm_srai_epi32(_mm_add_epi32(y[1], c[1]), kShift);
+  __m128i v2 = _mm_srai_epi32(_mm_add_epi32(y[2], c[2]), kShift);
+  __m128i v3 = _mm_srai_epi32(_mm_add_epi32(y[3], c[3]), kShift);
+  return _mm_packus_epi16(_mm_packs_epi32(v0, v1), _mm_packs_epi32(v2, v3));
+}
+
+__attribute__((target("sse4.1"))) inline void Row16SSE(const uint8_t* src, const ChromaSSE& c, uint8_t* dst) {
+  __m128i y8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+  __m128i y[4];
+  y[0] = LumaSSE(y8);
+  y[1] = LumaSSE(_mm_srli_si128(y8, 4));
+  y[2] = LumaSSE(_mm_srli_si128(y8, 8));
+  y[3] = LumaSSE(_mm_srli_si128(y8, 12));
+  StoreBGR(PackChannel(y, c.b), PackChannel(y, c.g), PackChannel(y, c.r), dst);
+}
+
+__attribute__((target("sse4.1"))) void RowPairSSE41(const uint8_t* y0, const uint8_t* y1, const uint8_t* uv,
+                                                    bool nv21, int width, uint8_t* dst0, uint8_t* dst1) {
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    __m128i u, v;
+    LoadChroma(uv + x, nv21, &u, &v);
+    ChromaSSE c;
+    ChromaTermsSSE(u, v, &c);
+    Row16SSE(y0 + x, c, dst0 + 3 * x);
+    if (y1) Row16SSE(y1 + x, c, dst1 + 3 * x);
+  }
+  RowPairScalar(y0, y1, uv, nv21, x, width, dst0, dst1);
+}
+
+/* the chroma terms of 16 pixels, 8 pixels per vector */
+struct ChromaAVX2 {
+  __m256i r[2], g[2], b[2];
+};
+
+__attribute__((target("avx2"))) inline void ChromaTermsAVX2(__m128i u16, __m128i v16, ChromaAVX2* c) {
+  const __m256i half = _mm256_set1_epi32(kHalf);
+  const __m256i dup = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+  __m256i u = _mm256_cvtepi16_epi32(u16);
+  __m256i v = _mm256_cvtepi16_epi32(v16);
+  __m256i ruv = _mm256_add_epi32(half, _mm256_mullo_epi32(v, _mm256_set1_epi32(kCVR)));
+  __m256i guv = _mm256_add_epi32(_mm256_add_epi32(half, _mm256_mullo_epi32(v, _mm256_set1_epi32(kCVG))),
+                                 _mm256_mullo_epi32(u, _mm256_set1_epi32(kCUG)));
+  __m256i buv = _mm256_add_epi32(half, _mm256_mullo_epi32(u, _mm256_set1_epi32(kCUB)));
+  // each chroma pair covers 2 pixels
+  c->r[0] = _mm256_permutevar8x32_epi32(ruv, dup);
+  c->g[0] = _mm256_permutevar8x32_epi32(guv, dup);
+  c->b[0] = _mm256_permutevar8x32_epi32(buv, dup);
+  const __m256i dup_hi = _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7);
+  c->r[1] = _mm256_permutevar8x32_epi32(ruv, dup_hi);
+  c->g[1] = _mm256_permutevar8x32_epi32(guv, dup_hi);
+  c->b[1] = _mm256_permutevar8x32_epi32(buv, dup_hi);
+}
+
+__attribute__((target("avx2"))) inline __m128i PackChannelAVX2(__m256i y0, __m256i y1, const __m256i* c) {
+  __m256i v0 = _mm256_srai_epi32(_mm256_add_epi32(y0, c[0]), kShift);
+  __m256i v1 = _mm256_srai_epi32(_mm256_add_epi32(y1, c[1]), kShift);
+  // packs works in 128-bit lanes, restore the pixel order
+  __m256i v16 = _mm256_permute4x64_epi64(_mm256_packs_epi32(v0, v1), 0xd8);
+  return _mm_packus_epi16(_mm256_castsi256_si128(v16), _mm256_extracti128_si256(v16, 1));
+}
+
+__attribute__((target("avx2"))) inline void Row16AVX2(const uint8_t* src, const ChromaAVX2& c, uint8_t* dst) {
+  __m128i y8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+  const __m256i cy = _mm256_set1_epi32(kCY);
+  const __m256i y16 = _mm256_set1_epi32(16);
+  __m256i y0 = _mm256_max_epi32(_mm256_sub_epi32(_mm256_cvtepu8_epi32(y8), y16), _mm256_setzero_si256());
+  __m256i y1 = _mm256_max_epi32(_mm256_sub_epi32(_mm256_cvtepu8_epi32(_mm_srli_si128(y8, 8)), y16),
+                                _mm256_setzero_si256());
+  y0 = _mm256_mullo_epi32(y0, cy);
+  y1 = _mm256_mullo_epi32(y1, cy);
+  StoreBGR(PackChannelAVX2(y0, y1, c.b), PackChannelAVX2(y0, y1, c.g), PackChannelAVX2(y0, y1, c.r), dst);
+}
+
+__attribute__((target("avx2"))) void RowPairAVX2(const uint8_t* y0, const uint8_t* y1, const uint8_t* uv, bool nv21,
+                                                 int width, uint8_t* dst0, uint8_t* dst1) {
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    __m128i u, v;
+    LoadChroma(uv + x, nv21, &u, &v);
+    ChromaAVX2 c;
+    ChromaTermsAVX2(u, v, &c);
+    Row16AVX2(y0 + x, c, dst0 + 3 * x);
+    if (y1) Row16AVX2(y1 + x, c, dst1 + 3 * x);
+  }
+  RowPairScalar(y0, y1, uv, nv21, x, width, dst0, dst1);
+}
+
+#endif  // CNS_COLOR_CONVERT_X86
+
+RowPairFunc GetRowPairFunc(ColorConvertKernel kernel) {
+  if (COLOR_CONVERT_AUTO == kernel) {
+    if (ColorConvertKernelSupported(COLOR_CONVERT_AVX2)) return GetRowPairFunc(COLOR_CONVERT_AVX2);
+    if (ColorConvertKernelSupported(COLOR_CONVERT_SSE41)) return GetRowPairFunc(COLOR_CONVERT_SSE41);
+    return RowPairScalar;
+  }
+  if (!ColorConvertKernelSupported(kernel)) return RowPairScalar;
+  switch (kernel) {
+#ifdef CNS_COLOR_CONVERT_X86
+    case COLOR_CONVERT_SSE41:
+      return RowPairSSE41;
+    case COLOR_CONVERT_AVX2:
+      return RowPairAVX2;
+#endif
+    default:
+      return RowPairScalar;
+  }
+}
+
+}  // namespace
+
+bool ColorConvertKernelSupported(ColorConvertKernel kernel) {
+  switch (kernel) {
+    case COLOR_CONVERT_AUTO:
+    case COLOR_CONVERT_SCALAR:
+      return true;
+#ifdef CNS_COLOR_CONVERT_X86
+    case COLOR_CONVERT_SSE41:
+      return __builtin_cpu_supports("sse4.1");
+    case COLOR_CONVERT_AVX2:
+      return __builtin_cpu_supports("avx2");
+#endif
+    default:
+      return false;
+  }
+}
+
+void YUV420spToBGR(const uint8_t* y, int y_stride, const uint8_t* uv, int uv_stride, bool nv21, int width,
+                   int height, uint8_t* bgr, int bgr_stride, ColorConvertKernel kernel) {
+  RowPairFunc row_pair = GetRowPairFunc(kernel);
+  for (int row = 0; row < height; row += 2) {
+    const uint8_t* y0 = y + static_cast<size_t>(row) * y_stride;
+    uint8_t* dst0 = bgr + static_cast<size_t>(row) * bgr_stride;
+    bool has_next = row + 1 < height;
+    row_pair(y0, has_next ? y0 + y_stride : nullptr, uv + static_cast<size_t>(row / 2) * uv_stride, nv21, width,
+             dst0, has_next ? dst0 + bgr_stride : nullptr);
+  }
+}
+
+}  // namespace cnstream
@@ -0,0 +1,61 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_CORE_INCLUDE_COLOR_CONVERT_HPP_
+#define MODULES_CORE_INCLUDE_COLOR_CONVERT_HPP_
+
+#include <cstdint>
+
+namespace cnstream {
+
+/**
+ * The kernels used by YUV420spToBGR, the fastest one supported by the CPU is chosen by default.
+ */
+enum ColorConvertKernel {
+  COLOR_CONVERT_AUTO = 0,
+  COLOR_CONVERT_SCALAR,
+  COLOR_CONVERT_SSE41,
+  COLOR_CONVERT_AVX2
+};
+
+/* returns false if the CPU does not support the kernel */
+bool ColorConvertKernelSupported(ColorConvertKernel kernel);
+
+/**
+ * Converts a NV12 or NV21 image to BGR24, BT.601 limited range, the results are the same as cv::cvtColor
+ * with COLOR_YUV2BGR_NV12 / COLOR_YUV2BGR_NV21. The planes are read in place, they do not need to be contiguous.
+ *
+ * @param y The Y plane.
+ * @param y_stride The bytes of a Y row.
+ * @param uv The interleaved UV (NV12) or VU (NV21) plane.
+ * @param uv_stride The bytes of a UV row.
+ * @param nv21 True if the chroma plane is VU.
+ * @param width The width of the image.
+ * @param height The height of the image.
+ * @param bgr The output image.
+ * @param bgr_stride The bytes of a BGR row.
+ * @param kernel The kernel to use, it falls back to the scalar kernel if the CPU does not support it.
+ */
+void YUV420spToBGR(const uint8_t* y, int y_stride, const uint8_t* uv, int uv_stride, bool nv21, int width,
+                   int height, uint8_t* bgr, int bgr_stride, ColorConvertKernel kernel = COLOR_CONVERT_AUTO);
+
+}  // namespace cnstream
+
+#endif  // MODULES_CORE_INCLUDE_COLOR_CONVERT_HPP_
@@ -21,6 +21,8 @@
 #include "connector.hpp"
 
 #include <atomic>
+#include <map>
+#include <string>
 #include <vector>
 #include "conveyor.hpp"
 
@@ -35,15 +37,21 @@ class ConnectorPrivate {
   DECLARE_PUBLIC(q_ptr_, Connector);
   std::vector<Conveyor*> vec_conveyor_;
   size_t conveyor_capacity_ = 20;
+  LinkQueueType queue_type_ = LINK_QUEUE_MUTEX;
+  LinkOverflowPolicy policy_ = LINK_OVERFLOW_BLOCK;
   std::atomic<bool> stop_{false};
   DISABLE_COPY_AND_ASSIGN(ConnectorPrivate);
 };  // class ConnectorPrivate
 
-Connector::Connector(const size_t conveyor_count, size_t conveyor_capacity) : d_ptr_(new ConnectorPrivate(this)) {
+Connector::Connector(const size_t conveyor_count, size_t conveyor_capacity, LinkQueueType queue_type,
+                     LinkOverflowPolicy policy, uint32_t keep_latest_num)
+    : d_ptr_(new ConnectorPrivate(this)) {
   d_ptr_->conveyor_capacity_ = conveyor_capacity;
+  d_ptr_->queue_type_ = LINK_OVERFLOW_BLOCK == policy ? queue_type : LINK_QUEUE_MUTEX;
+  d_ptr_->policy_ = policy;
   d_ptr_->vec_conveyor_.reserve(conveyor_count);
   for (size_t i = 0; i < conveyor_count; ++i) {
-    d_ptr_->vec_conveyor_.push_back(new Conveyor(this, conveyor_capacity));
+    d_ptr_->vec_conveyor_.push_back(new Conveyor(this, conveyor_capacity, policy, queue_type, keep_latest_num));
   }
 }
 
@@ -55,6 +63,18 @@ Conveyor* Connector::GetConveyor(int conveyor_idx) const { return d_ptr_->GetCon
 
 size_t Connector::GetConveyorCapacity() const { return d_ptr_->conveyor_capacity_; }
 
+LinkQueueType Connector::GetQueueType() const { return d_ptr_->queue_type_; }
+
+LinkOverflowPolicy Connector::GetOverflowPolicy() const { return d_ptr_->policy_; }
+
+std::map<std::string, uint64_t> Connector::GetDropCount() const {
+  std::map<std::string, uint64_t> drop_cnt;
+  for (Conveyor* it : d_ptr_->vec_conveyor_) {
+    for (auto& cnt : it->GetDropCount()) drop_cnt[cnt.first] += cnt.second;
+  }
+  return drop_cnt;
+}
+
 CNFrameInfoPtr Connector::PopDataBufferFromConveyor(int conveyor_idx) {
   return GetConveyor(conveyor_idx)->PopDataBuffer();
 }
@@ -65,9 +85,19 @@ void Connector::PushDataBufferToConveyor(int conveyor_idx, CNFrameInfoPtr data)
 
 bool Connector::IsStopped() { return d_ptr_->stop_.load(); }
 
-void Connector::Start() { d_ptr_->stop_.store(false); }
+void Connector::Start() {
+  d_ptr_->stop_.store(false);
+  for (Conveyor* it : d_ptr_->vec_conveyor_) {
+    it->Start();
+  }
+}
 
-void Connector::Stop() { d_ptr_->stop_.store(true); }
+void Connector::Stop() {
+  d_ptr_->stop_.store(true);
+  for (Conveyor* it : d_ptr_->vec_conveyor_) {
+    it->Stop();
+  }
+}
 
 ConnectorPrivate::ConnectorPrivate(Connector* q) : q_ptr_(q) {}
 
@@ -21,9 +21,13 @@
 #ifndef MODULES_CORE_INCLUDE_CONNECTOR_HPP_
 #define MODULES_CORE_INCLUDE_CONNECTOR_HPP_
 
+#include <atomic>
+#include <map>
 #include <memory>
+#include <string>
 
 #include "cnstream_frame.hpp"
+#include "cnstream_statistic.hpp"
 
 namespace cnstream {
 
@@ -61,13 +65,36 @@ class Connector {
    * @param
    *   [conveyor_count]: the conveyor num of this connector.
    *   [conveyor_capacity]: the maximum buffer number of a conveyor.
+   *   [queue_type]: the data queue backend of the conveyors.
+   *   [policy]: what a conveyor does with new data when it is full.
+   *   [keep_latest_num]: frames kept for each stream, used by LINK_OVERFLOW_KEEP_LATEST_N.
    ***************************************************************************/
-  explicit Connector(const size_t conveyor_count, size_t conveyor_capacity = 20);
+  explicit Connector(const size_t conveyor_count, size_t conveyor_capacity = 20,
+                     LinkQueueType queue_type = LINK_QUEUE_MUTEX, LinkOverflowPolicy policy = LINK_OVERFLOW_BLOCK,
+                     uint32_t keep_latest_num = 1);
   ~Connector();
 
   const size_t GetConveyorCount() const;
   Conveyor* GetConveyor(int conveyor_idx) const;
   size_t GetConveyorCapacity() const;
+  LinkQueueType GetQueueType() const;
+  LinkOverflowPolicy GetOverflowPolicy() const;
+  /* the number of dropped frames of all conveyors, keyed by stream id */
+  std::map<std::string, uint64_t> GetDropCount() const;
+  /* the frame images copied on write by the downstream module, see CNDataFrame::MutableImageBGR */
+  void AddCowCopy() { cow_copies_.fetch_add(1, std::memory_order_relaxed); }
+  uint64_t GetCowCopyCount() const { return cow_copies_.load(std::memory_order_relaxed); }
+  /* the id of the upstream module, frames start waiting in the queue when it transmits them */
+  void SetUpstreamId(size_t id) { up_module_id_ = id; }
+  size_t GetUpstreamId() const { return up_module_id_; }
+  /* the module popping the frames, owned by the pipeline */
+  void SetDownstreamModule(Module* module) { down_module_ = module; }
+  Module* GetDownstreamModule() const { return down_module_; }
+  /* the time frames wait in the queue, from the transmit of the upstream module to the pop of the downstream one */
+  LatencyHistogram* GetQueueLatency() { return &queue_latency_; }
+  /* the name of the wait spans of the link, see RegisterTraceName */
+  void SetTraceName(uint32_t name) { trace_name_ = name; }
+  uint32_t GetTraceName() const { return trace_name_; }
 
   CNFrameInfoPtr PopDataBufferFromConveyor(int conveyor_idx);
   void PushDataBufferToConveyor(int conveyor_idx, CNFrameInfoPtr data);
@@ -78,6 +105,11 @@ class Connector {
   void EmptyDataQueue();
 
  private:
+  std::atomic<uint64_t> cow_copies_{0};
+  size_t up_module_id_ = INVALID_MODULE_ID;
+  Module* down_module_ = nullptr;
+  LatencyHistogram queue_latency_;
+  uint32_t trace_name_ = 0;
   DECLARE_PRIVATE(d_ptr_, Connector);
   DISABLE_COPY_AND_ASSIGN(Connector);
 };  // class Connector
@@ -22,54 +22,215 @@
 
 #include <chrono>
 #include <memory>
-#include <thread>
+#include <utility>
 #include <vector>
 
 #include "connector.hpp"
+#include "executor.hpp"
+#include "lockfree_queue.hpp"
 
 namespace cnstream {
 
-Conveyor::Conveyor(Connector* container, size_t max_size, bool enable_drop)
-    : container_(container), max_size_(max_size), enable_drop_(enable_drop) {
+Conveyor::Conveyor(Connector* container, size_t max_size, LinkOverflowPolicy policy, LinkQueueType queue_type,
+                   uint32_t keep_latest_num)
+    : container_(container), max_size_(max_size), policy_(policy), keep_latest_num_(keep_latest_num) {
   LOG_IF(FATAL, nullptr == container) << "container should not be nullptr.";
+  if (LINK_OVERFLOW_BLOCK != policy_) {
+    // dropping picks frames from the middle of the queue, only the mutex queue supports it
+    drop_q_ = new BoundedThreadSafeQueue<CNFrameInfoPtr>(max_size);
+    dataq_ = drop_q_;
+    select_dropped_ = std::bind(&Conveyor::SelectDropped, this, std::placeholders::_1, std::placeholders::_2);
+    return;
+  }
+  switch (queue_type) {
+    case LINK_QUEUE_MPMC:
+      dataq_ = new BlockingRingQueue<MpmcRingBuffer<CNFrameInfoPtr>>(max_size);
+      break;
+    case LINK_QUEUE_SPSC:
+      dataq_ = new BlockingRingQueue<SpscRingBuffer<CNFrameInfoPtr>>(max_size);
+      break;
+    case LINK_QUEUE_MUTEX:
+    default:
+      dataq_ = new BoundedThreadSafeQueue<CNFrameInfoPtr>(max_size);
+      break;
+  }
+}
+
+Conveyor::~Conveyor() { delete dataq_; }
+
+uint32_t Conveyor::GetBufferSize() { return dataq_->Size(); }
+
+std::map<std::string, uint64_t> Conveyor::GetDropCount() {
+  std::map<std::string, uint64_t> drop_cnt;
+  std::lock_guard<std::mutex> lk(drop_mtx_);
+  for (const auto& it : drop_cnt_) drop_cnt[GetInternedStreamId(it.first)] = it.second;
+  return drop_cnt;
+}
+
+static inline bool IsEos(const CNFrameInfoPtr& data) { return data->frame.flags & CN_FRAME_FLAG_EOS; }
+
+int Conveyor::SelectDropped(const std::deque<CNFrameInfoPtr>& queue, const CNFrameInfoPtr& data) const {
+  typedef BoundedThreadSafeQueue<CNFrameInfoPtr> Queue;
+  if (LINK_OVERFLOW_KEEP_LATEST_N == policy_) {
+    if (IsEos(data)) return Queue::kDropNone;
+    int oldest = Queue::kDropNone;
+    uint32_t cnt = 0;
+    for (size_t i = 0; i < queue.size(); ++i) {
+      if (queue[i]->channel_idx != data->channel_idx || IsEos(queue[i])) continue;
+      if (Queue::kDropNone == oldest) oldest = static_cast<int>(i);
+      ++cnt;
+    }
+    return cnt >= keep_latest_num_ ? oldest : Queue::kDropNone;
+  }
+  if (queue.size() < max_size_) return Queue::kDropNone;
+  if (LINK_OVERFLOW_DROP_OLDEST == policy_) {
+    for (size_t i = 0; i < queue.size(); ++i) {
+      if (!IsEos(queue[i])) return static_cast<int>(i);
+    }
+  }
+  // eos frames wait for free space
+  return IsEos(data) ? Queue::kDropNone : Queue::kDropNewValue;
 }
 
-uint32_t Conveyor::GetBufferSize() { return dataq_.Size(); }
+bool Conveyor::TryPush(CNFrameInfoPtr& data, const std::chrono::microseconds rel_time) {
+  if (nullptr == drop_q_) return dataq_->WaitAndTryPush(data, rel_time);
+  CNFrameInfoPtr dropped;
+  if (!drop_q_->WaitAndPushOrDrop(data, select_dropped_, &dropped, rel_time)) return false;
+  if (dropped) {
+    /*
+      the branch of the dropped frame ends, a join downstream never processes the frame.
+      if the join has processed it through another branch, the join has ended this branch already.
+     */
+    Module* down_module = container_->GetDownstreamModule();
+    if (nullptr == down_module || 0 != dropped->frame.ClearModuleMask(down_module)) dropped->frame.AddBranches(-1);
+    std::lock_guard<std::mutex> lk(drop_mtx_);
+    drop_cnt_[dropped->frame.stream_handle]++;
+  }
+  return true;
+}
 
 void Conveyor::PushDataBuffer(CNFrameInfoPtr data) {
-  while (!container_->IsStopped() && dataq_.Size() >= max_size_) {
-    if (enable_drop_) {
-      CNFrameInfoPtr drop;
-      dataq_.TryPop(drop);
-      break;
-    } else {
-      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  bool by_worker = nullptr != WorkStealingExecutor::Current();
+  // the frames of one stream never overtake the ones parked before them
+  if (by_worker && HasParked() && !container_->IsStopped()) {
+    Park(std::move(data));
+    return;
+  }
+  // the drop policies make room unless the frame is an eos frame or the keep-latest-n policy keeps the queue full
+  bool pushed = TryPush(data, std::chrono::microseconds(0));
+  if (!pushed && !container_->IsStopped()) {
+    blocked_pushes_.fetch_add(1, std::memory_order_relaxed);
+    if (by_worker) {
+      Park(std::move(data));
+      return;
+    }
+    pushed = BlockedPush(data);
+  }
+  if (pushed && push_callback_) push_callback_();
+}
+
+bool Conveyor::BlockedPush(CNFrameInfoPtr& data) {
+  auto start = std::chrono::steady_clock::now();
+  bool pushed = false;
+  if (nullptr == drop_q_) {
+    pushed = dataq_->WaitAndPush(std::move(data));
+  } else {
+    while (!(pushed = TryPush(data, std::chrono::milliseconds(100))) && !container_->IsStopped()) {
     }
   }
-  if (container_->IsStopped()) return;
-  dataq_.Push(data);
+  blocked_ns_.fetch_add(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count(),
+      std::memory_order_relaxed);
+  return pushed;
+}
+
+void Conveyor::Park(CNFrameInfoPtr data) {
+  /*
+    Blocked workers could take the whole pool while the consumer of this conveyor
+    waits for a worker, so the frame waits here instead of the worker.
+   */
+  {
+    std::lock_guard<std::mutex> lk(parked_mtx_);
+    parked_.emplace_back(std::chrono::steady_clock::now(), std::move(data));
+    parked_num_.fetch_add(1);
+  }
+}
+
+bool Conveyor::PushParked() {
+  if (!HasParked()) return true;
+  bool pushed = false, drained = false;
+  {
+    // frames of one stream leave in the order they were parked
+    std::lock_guard<std::mutex> lk(parked_mtx_);
+    while (!parked_.empty()) {
+      if (container_->IsStopped()) {
+        parked_.clear();
+      } else if (TryPush(parked_.front().second, std::chrono::microseconds(0))) {
+        auto waited = std::chrono::steady_clock::now() - parked_.front().first;
+        blocked_ns_.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(waited).count(),
+                              std::memory_order_relaxed);
+        parked_.pop_front();
+        pushed = true;
+      } else {
+        break;
+      }
+    }
+    drained = parked_.empty();
+    parked_num_.store(parked_.size());
+  }
+  if (pushed && push_callback_) push_callback_();
+  // the other producers yielded while the frames were parked, the pop that made room may not have seen them
+  if (pushed && drained && space_callback_) space_callback_();
+  return drained;
+}
+
+void Conveyor::OnPopped() {
+  // pairs with the fence of WorkStealingExecutor::RunTask, either the producer sees the space or we see the frames
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (HasParked() && space_callback_) space_callback_();
 }
 
 CNFrameInfoPtr Conveyor::PopDataBuffer() {
   CNFrameInfoPtr data;
-  while (!container_->IsStopped()) {
-    if (dataq_.WaitAndTryPop(data, std::chrono::milliseconds(20))) {
-      break;
-    }
+  if (!dataq_->WaitAndPop(data)) {
+    return nullptr;
   }
-  if (container_->IsStopped()) {
+  OnPopped();
+  return data;
+}
+
+CNFrameInfoPtr Conveyor::TryPopDataBuffer() {
+  CNFrameInfoPtr data;
+  if (!dataq_->TryPop(data)) {
     return nullptr;
   }
+  OnPopped();
   return data;
 }
 
+void Conveyor::Stop() { dataq_->Stop(); }
+
+void Conveyor::Start() {
+  {
+    std::lock_guard<std::mutex> lk(parked_mtx_);
+    parked_.clear();
+    parked_num_.store(0);
+  }
+  blocked_pushes_.store(0);
+  blocked_ns_.store(0);
+  dataq_->Start();
+}
+
 std::vector<CNFrameInfoPtr> Conveyor::PopAllDataBuffer() {
   std::vector<CNFrameInfoPtr> vec_data;
   CNFrameInfoPtr data;
-  while (!dataq_.Empty()) {
-    dataq_.TryPop(data);
+  while (dataq_->TryPop(data)) {
     vec_data.push_back(data);
   }
+  std::lock_guard<std::mutex> lk(parked_mtx_);
+  for (auto& it : parked_) vec_data.push_back(std::move(it.second));
+  parked_.clear();
+  parked_num_.store(0);
   return vec_data;
 }
 
@@ -21,7 +21,15 @@
 #ifndef MODULES_CORE_INCLUDE_CONVEYOR_HPP_
 #define MODULES_CORE_INCLUDE_CONVEYOR_HPP_
 
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "cnstream_frame.hpp"
@@ -49,27 +57,82 @@ class Connector;
  * until it is not.
  * Or if the queue is full, the module could not push buffer, unless
  * the other module pop a buffer from it.
+ * Both sides are woken up by condition signalling as soon as the queue state
+ * changes or the connector stops, there is no polling.
+ * Workers of the work-stealing executor do not block on a full queue, they park
+ * the frame on the conveyor and their task yields until the consumer frees space.
  ****************************************************************************/
 class Conveyor {
  public:
   friend class Connector;
-  // ~Conveyor();
+  ~Conveyor();
   void PushDataBuffer(CNFrameInfoPtr data);
   CNFrameInfoPtr PopDataBuffer();
+  /* never blocks, returns nullptr if there is no data */
+  CNFrameInfoPtr TryPopDataBuffer();
   std::vector<CNFrameInfoPtr> PopAllDataBuffer();
   uint32_t GetBufferSize();
+  /* the number of frames dropped by the overflow policy, keyed by stream id */
+  std::map<std::string, uint64_t> GetDropCount();
+  /* called after each successful push, used to schedule the consumer. Set it only when the pipeline is stopped. */
+  void SetPushCallback(std::function<void()> callback) { push_callback_ = std::move(callback); }
+  /*
+   * called when a consumer frees space while frames are parked, used to resume the producers.
+   * Set it only when the pipeline is stopped.
+   */
+  void SetSpaceCallback(std::function<void()> callback) { space_callback_ = std::move(callback); }
+  /* whether frames pushed by workers of the work-stealing executor wait out of the queue for free space */
+  bool HasParked() const { return parked_num_.load() > 0; }
+  /* whether some of the parked frames fit in the queue now */
+  bool CanPushParked() { return HasParked() && GetBufferSize() < max_size_; }
+  /* moves the parked frames into the queue while there is free space, returns false if some are left */
+  bool PushParked();
+  /* the pushes which found the queue full and the time they waited, cleared when the conveyor starts */
+  uint64_t GetBlockedPushes() const { return blocked_pushes_.load(std::memory_order_relaxed); }
+  uint64_t GetBlockedNs() const { return blocked_ns_.load(std::memory_order_relaxed); }
 
  private:
 #ifdef TEST
  public:
 #endif
-  Conveyor(Connector* container, size_t max_size, bool enable_drop = false);
+  Conveyor(Connector* container, size_t max_size, LinkOverflowPolicy policy = LINK_OVERFLOW_BLOCK,
+           LinkQueueType queue_type = LINK_QUEUE_MUTEX, uint32_t keep_latest_num = 1);
+  /* wakes up all blocked producers and consumers */
+  void Stop();
+  void Start();
+  /* tells the producers that there is free space for the parked frames */
+  void OnPopped();
+  /*
+   * a worker of the work-stealing executor never blocks on a full queue, the frame is parked and the
+   * producer task pushes it with PushParked() once the consumer frees space
+   */
+  void Park(CNFrameInfoPtr data);
+  /* pushes on the full queue, the time is counted as blocked */
+  bool BlockedPush(CNFrameInfoPtr& data);
+  /* pushes with the overflow policy, waits at most rel_time for free space */
+  bool TryPush(CNFrameInfoPtr& data, const std::chrono::microseconds rel_time);
+  /* returns the position of the frame to drop, see BoundedThreadSafeQueue::WaitAndPushOrDrop */
+  int SelectDropped(const std::deque<CNFrameInfoPtr>& queue, const CNFrameInfoPtr& data) const;
 
  private:
   Connector* container_;
   size_t max_size_;
-  bool enable_drop_;
-  ThreadSafeQueue<CNFrameInfoPtr> dataq_;
+  LinkOverflowPolicy policy_;
+  uint32_t keep_latest_num_;
+  BoundedQueue<CNFrameInfoPtr>* dataq_ = nullptr;
+  /* the same queue as dataq_ when frames may be dropped */
+  BoundedThreadSafeQueue<CNFrameInfoPtr>* drop_q_ = nullptr;
+  std::function<int(const std::deque<CNFrameInfoPtr>&, const CNFrameInfoPtr&)> select_dropped_;
+  std::mutex drop_mtx_;
+  std::map<uint32_t /*stream_handle*/, uint64_t> drop_cnt_;
+  std::function<void()> push_callback_;
+  std::function<void()> space_callback_;
+  std::mutex parked_mtx_;
+  /* frames parked by workers and the time they were parked at */
+  std::deque<std::pair<std::chrono::steady_clock::time_point, CNFrameInfoPtr>> parked_;
+  std::atomic<uint32_t> parked_num_{0};
+  std::atomic<uint64_t> blocked_pushes_{0};
+  std::atomic<uint64_t> blocked_ns_{0};
   DISABLE_COPY_AND_ASSIGN(Conveyor);
 };  // class Conveyor
 
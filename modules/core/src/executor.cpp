@@ -0,0 +1,169 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "executor.hpp"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cnstream {
+
+class WorkStealingExecutor::Task {
+ public:
+  Task(TaskFunc f, TaskCheck c) : func(std::move(f)), check(std::move(c)) {}
+  TaskFunc func;
+  TaskCheck check;
+  /* true while the task is queued or running, a dead task keeps it forever */
+  std::atomic<bool> scheduled{false};
+};  // class WorkStealingExecutor::Task
+
+namespace {
+thread_local WorkStealingExecutor* tls_executor = nullptr;
+thread_local int tls_worker_idx = -1;
+}  // namespace
+
+WorkStealingExecutor::WorkStealingExecutor(uint32_t worker_num) : worker_num_(worker_num) {
+  if (0 == worker_num_) worker_num_ = std::thread::hardware_concurrency();
+  if (0 == worker_num_) worker_num_ = 1;
+}
+
+WorkStealingExecutor::~WorkStealingExecutor() {
+  Stop();
+  for (Task* it : all_tasks_) delete it;
+  all_tasks_.clear();
+}
+
+WorkStealingExecutor* WorkStealingExecutor::Current() { return tls_executor; }
+
+WorkStealingExecutor::Task* WorkStealingExecutor::AddTask(TaskFunc func, TaskCheck check) {
+  LOG_IF(FATAL, running_.load()) << "Tasks should be added before the executor starts.";
+  Task* task = new Task(std::move(func), std::move(check));
+  all_tasks_.push_back(task);
+  return task;
+}
+
+void WorkStealingExecutor::Start(const std::string& thread_name_prefix) {
+  if (running_.exchange(true)) return;
+  for (uint32_t i = 0; i < worker_num_; ++i) workers_.push_back(new Worker);
+  for (uint32_t i = 0; i < worker_num_; ++i) {
+    workers_[i]->thread =
+        std::thread(&WorkStealingExecutor::WorkerLoop, this, i, thread_name_prefix + std::to_string(i));
+  }
+}
+
+void WorkStealingExecutor::Stop() {
+  if (!running_.exchange(false)) return;
+  {
+    std::lock_guard<std::mutex> lk(sleep_mtx_);
+    sleep_cond_.notify_all();
+  }
+  for (Worker* it : workers_) {
+    if (it->thread.joinable()) it->thread.join();
+    delete it;
+  }
+  workers_.clear();
+  shared_tasks_.clear();
+  pending_.store(0);
+  for (Task* it : all_tasks_) it->scheduled.store(false);
+}
+
+void WorkStealingExecutor::Schedule(Task* task) {
+  // pairs with the fence in RunTask, either we see the task idle or it sees our data
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (task->scheduled.exchange(true)) return;
+  Enqueue(task);
+}
+
+void WorkStealingExecutor::Enqueue(Task* task) {
+  if (this == tls_executor) {
+    Worker* worker = workers_[tls_worker_idx];
+    std::lock_guard<std::mutex> lk(worker->mtx);
+    worker->tasks.push_back(task);
+  } else {
+    std::lock_guard<std::mutex> lk(shared_mtx_);
+    shared_tasks_.push_back(task);
+  }
+  pending_.fetch_add(1);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (sleepers_.load() > 0) {
+    std::lock_guard<std::mutex> lk(sleep_mtx_);
+    sleep_cond_.notify_one();
+  }
+}
+
+WorkStealingExecutor::Task* WorkStealingExecutor::TakeTask(int worker_idx) {
+  Task* task = nullptr;
+  {
+    Worker* worker = workers_[worker_idx];
+    std::lock_guard<std::mutex> lk(worker->mtx);
+    if (!worker->tasks.empty()) {
+      task = worker->tasks.front();
+      worker->tasks.pop_front();
+    }
+  }
+  if (!task) {
+    std::lock_guard<std::mutex> lk(shared_mtx_);
+    if (!shared_tasks_.empty()) {
+      task = shared_tasks_.front();
+      shared_tasks_.pop_front();
+    }
+  }
+  // steal from the back, the owner takes from the front
+  for (uint32_t i = 1; !task && i < worker_num_; ++i) {
+    Worker* victim = workers_[(worker_idx + i) % worker_num_];
+    std::lock_guard<std::mutex> lk(victim->mtx);
+    if (!victim->tasks.empty()) {
+      task = victim->tasks.back();
+      victim->tasks.pop_back();
+    }
+  }
+  if (task) pending_.fetch_sub(1);
+  return task;
+}
+
+void WorkStealingExecutor::RunTask(Task* task) {
+  if (!task->func()) return;
+  task->scheduled.store(false);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (task->check()) Schedule(task);
+}
+
+void WorkStealingExecutor::WorkerLoop(uint32_t worker_idx, std::string thread_name) {
+  tls_executor = this;
+  tls_worker_idx = worker_idx;
+  SetThreadName(thread_name, pthread_self());
+  while (running_.load()) {
+    Task* task = TakeTask(worker_idx);
+    if (task) {
+      RunTask(task);
+      continue;
+    }
+    std::unique_lock<std::mutex> lk(sleep_mtx_);
+    sleepers_.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    sleep_cond_.wait(lk, [this] { return !running_.load() || pending_.load() > 0; });
+    sleepers_.fetch_sub(1);
+  }
+  tls_executor = nullptr;
+  tls_worker_idx = -1;
+}
+
+}  // namespace cnstream
@@ -0,0 +1,118 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_CORE_INCLUDE_EXECUTOR_HPP_
+#define MODULES_CORE_INCLUDE_EXECUTOR_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cnstream_common.hpp"
+
+namespace cnstream {
+
+/****************************************************************************
+ * @brief A fixed pool of worker threads shared by all modules of a pipeline.
+ *
+ * A task stands for one (module, conveyor) pair. It is scheduled when data is
+ * pushed into one of its input conveyors and is never queued or run twice at the
+ * same time, so the frames of one conveyor, and so of one channel, keep their order.
+ *
+ * Each worker owns a task deque. Tasks scheduled by a worker go to its own deque,
+ * tasks scheduled by other threads (source modules for example) go to a shared
+ * deque. An idle worker takes tasks from its own deque first, then from the shared
+ * deque, and at last steals from the other workers.
+ *
+ * A task must never block its worker on another task, as every worker could end up
+ * waiting for a task that has no worker left to run it. A task that can not go on
+ * returns, and is scheduled again once it can.
+ ****************************************************************************/
+class WorkStealingExecutor {
+ public:
+  class Task;
+  /*
+   * Runs a bounded amount of work, returns false if the task must never run again.
+   */
+  using TaskFunc = std::function<bool()>;
+  /*
+   * Returns whether there is still data for the task.
+   */
+  using TaskCheck = std::function<bool()>;
+
+  /*
+   * @param worker_num Number of worker threads, 0 means the number of cpu cores.
+   */
+  explicit WorkStealingExecutor(uint32_t worker_num = 0);
+  ~WorkStealingExecutor();
+
+  /*
+   * Adds a task before Start().
+   */
+  Task* AddTask(TaskFunc func, TaskCheck check);
+
+  void Start(const std::string& thread_name_prefix = "cn-worker");
+  void Stop();
+
+  /*
+   * Queues the task unless it is already queued or running. Can be called from any thread.
+   */
+  void Schedule(Task* task);
+
+  uint32_t GetWorkerNum() const { return worker_num_; }
+
+  /*
+   * @return Returns the executor the calling thread works for, nullptr if it is not a worker.
+   */
+  static WorkStealingExecutor* Current();
+
+ private:
+  struct Worker {
+    std::mutex mtx;
+    std::deque<Task*> tasks;
+    std::thread thread;
+  };
+
+  void WorkerLoop(uint32_t worker_idx, std::string thread_name);
+  Task* TakeTask(int worker_idx);
+  void RunTask(Task* task);
+  void Enqueue(Task* task);
+
+  uint32_t worker_num_ = 0;
+  std::vector<Task*> all_tasks_;
+  std::vector<Worker*> workers_;
+  std::mutex shared_mtx_;
+  std::deque<Task*> shared_tasks_;
+  std::atomic<int> pending_{0};
+  std::atomic<int> sleepers_{0};
+  std::atomic<bool> running_{false};
+  std::mutex sleep_mtx_;
+  std::condition_variable sleep_cond_;
+  DISABLE_COPY_AND_ASSIGN(WorkStealingExecutor);
+};  // class WorkStealingExecutor
+
+}  // namespace cnstream
+
+#endif  // MODULES_CORE_INCLUDE_EXECUTOR_HPP_
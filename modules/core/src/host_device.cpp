@@ -0,0 +1,278 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnstream_devmem.hpp"
+
+#ifdef CNS_HOST_DEVICE
+
+#include <glog/logging.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace cnstream {
+
+/*
+  The host-emulated device. Device memory is host memory registered in an allocation table, so that copies from
+  or to memory not allocated by DevMalloc fail like they do on a real device.
+ */
+class EmulatedDevice {
+ public:
+  static EmulatedDevice* Instance() {
+    // never destroyed, frames may free device memory while static objects are being destroyed
+    static EmulatedDevice* device = new EmulatedDevice;
+    return device;
+  }
+
+  void* Malloc(size_t size) {
+    void* ptr = nullptr;
+    if (0 != posix_memalign(&ptr, kAlignment, size ? size : 1)) return nullptr;
+    std::lock_guard<std::mutex> lk(alloc_mutex_);
+    allocs_[reinterpret_cast<uintptr_t>(ptr)] = size;
+    return ptr;
+  }
+
+  void Free(void* ptr) {
+    {
+      std::lock_guard<std::mutex> lk(alloc_mutex_);
+      auto it = allocs_.find(reinterpret_cast<uintptr_t>(ptr));
+      LOG_IF(FATAL, it == allocs_.end()) << "Free device memory not allocated by DevMalloc: " << ptr;
+      allocs_.erase(it);
+    }
+    free(ptr);
+  }
+
+  /* checks that [ptr, ptr + size) is inside one device buffer */
+  bool IsDevMemory(const void* ptr, size_t size) {
+    uintptr_t begin = reinterpret_cast<uintptr_t>(ptr);
+    std::lock_guard<std::mutex> lk(alloc_mutex_);
+    auto it = allocs_.upper_bound(begin);
+    if (it == allocs_.begin()) return false;
+    --it;
+    return begin + size <= it->first + it->second;
+  }
+
+  bool Memcpy(void* dst, const void* src, size_t size, DevMemcpyDir dir) {
+    bool dst_on_dev = DEV_MEMCPY_DEV2HOST != dir;
+    bool src_on_dev = DEV_MEMCPY_HOST2DEV != dir;
+    if ((dst_on_dev && !IsDevMemory(dst, size)) || (src_on_dev && !IsDevMemory(src, size))) {
+      LOG(ERROR) << "Memcpy failed, dst: " << dst << " src: " << src << " size: " << size << " direction: " << dir
+                 << ", device side memory is not allocated by DevMalloc";
+      return false;
+    }
+    Link& link = links_[dir];
+    std::chrono::steady_clock::time_point done;
+    {
+      std::lock_guard<std::mutex> lk(link_mutex_);
+      auto now = std::chrono::steady_clock::now();
+      if (link.busy_until < now) link.busy_until = now;
+      if (link.bandwidth > 0) {
+        link.busy_until += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(size / link.bandwidth));
+      }
+      done = link.busy_until;
+    }
+    memcpy(dst, src, size);
+    std::this_thread::sleep_until(done);
+    return true;
+  }
+
+  void SetBandwidth(const EmulatedDevBandwidth& bandwidth) {
+    std::lock_guard<std::mutex> lk(link_mutex_);
+    links_[DEV_MEMCPY_HOST2DEV].bandwidth = bandwidth.host2dev;
+    links_[DEV_MEMCPY_DEV2HOST].bandwidth = bandwidth.dev2host;
+    links_[DEV_MEMCPY_DEV2DEV].bandwidth = bandwidth.dev2dev;
+  }
+
+  EmulatedDevBandwidth GetBandwidth() {
+    std::lock_guard<std::mutex> lk(link_mutex_);
+    EmulatedDevBandwidth bandwidth;
+    bandwidth.host2dev = links_[DEV_MEMCPY_HOST2DEV].bandwidth;
+    bandwidth.dev2host = links_[DEV_MEMCPY_DEV2HOST].bandwidth;
+    bandwidth.dev2dev = links_[DEV_MEMCPY_DEV2DEV].bandwidth;
+    return bandwidth;
+  }
+
+ private:
+  EmulatedDevice() { SetBandwidth(EmulatedDevBandwidth()); }
+
+  static constexpr size_t kAlignment = 64;
+  struct Link {
+    double bandwidth = 0;
+    std::chrono::steady_clock::time_point busy_until;
+  };
+  std::mutex alloc_mutex_;
+  std::map<uintptr_t, size_t> allocs_;
+  std::mutex link_mutex_;
+  Link links_[3];
+};  // class EmulatedDevice
+
+const char* GetDevMemBackend() { return "host"; }
+
+bool DevCheck(int dev_id) { return dev_id >= 0; }
+
+void* DevMalloc(size_t size, int dev_id, int ddr_chn) { return EmulatedDevice::Instance()->Malloc(size); }
+
+void DevFree(void* ptr, int dev_id, int ddr_chn) {
+  if (ptr) EmulatedDevice::Instance()->Free(ptr);
+}
+
+bool DevMemcpy(void* dst, const void* src, size_t size, DevMemcpyDir dir, int dev_id, int ddr_chn) {
+  return EmulatedDevice::Instance()->Memcpy(dst, src, size, dir);
+}
+
+bool DevAsyncCopyPageable() { return true; }
+
+void SetEmulatedDevBandwidth(const EmulatedDevBandwidth& bandwidth) {
+  EmulatedDevice::Instance()->SetBandwidth(bandwidth);
+}
+
+EmulatedDevBandwidth GetEmulatedDevBandwidth() { return EmulatedDevice::Instance()->GetBandwidth(); }
+
+/* each queue runs its tasks on its own thread, in order */
+class DevQueuePrivate {
+ public:
+  DevQueuePrivate() : worker([this] { Loop(); }) {}
+  ~DevQueuePrivate() {
+    {
+      std::lock_guard<std::mutex> lk(mutex);
+      running = false;
+    }
+    task_cond.notify_one();
+    worker.join();
+  }
+
+  void Push(std::function<bool()> task) {
+    {
+      std::lock_guard<std::mutex> lk(mutex);
+      tasks.push_back(std::move(task));
+      ++pending;
+    }
+    task_cond.notify_one();
+  }
+
+  bool Sync() {
+    std::unique_lock<std::mutex> lk(mutex);
+    done_cond.wait(lk, [this] { return 0 == pending; });
+    bool ret = !failed;
+    failed = false;
+    return ret;
+  }
+
+  std::mutex mutex;
+  std::condition_variable task_cond, done_cond;
+  std::deque<std::function<bool()>> tasks;
+  size_t pending = 0;
+  bool failed = false;
+  bool running = true;
+  std::thread worker;
+
+ private:
+  void Loop() {
+    std::unique_lock<std::mutex> lk(mutex);
+    while (true) {
+      task_cond.wait(lk, [this] { return !tasks.empty() || !running; });
+      if (tasks.empty()) return;
+      auto task = std::move(tasks.front());
+      tasks.pop_front();
+      lk.unlock();
+      bool ret = task();
+      lk.lock();
+      if (!ret) failed = true;
+      if (0 == --pending) done_cond.notify_all();
+    }
+  }
+};  // class DevQueuePrivate
+
+DevQueue::DevQueue(int dev_id, int ddr_chn) { d_ptr_ = new DevQueuePrivate; }
+
+DevQueue::~DevQueue() {
+  d_ptr_->Sync();
+  delete d_ptr_;
+}
+
+bool DevQueue::MemcpyAsync(void* dst, const void* src, size_t size, DevMemcpyDir dir) {
+  d_ptr_->Push([=] { return EmulatedDevice::Instance()->Memcpy(dst, src, size, dir); });
+  return true;
+}
+
+bool DevQueue::Sync() { return d_ptr_->Sync(); }
+
+class DevNotifierPrivate {
+ public:
+  std::mutex mutex;
+  std::condition_variable cond;
+  bool placed = false;
+  bool reached = false;
+  std::chrono::steady_clock::time_point time;
+};  // class DevNotifierPrivate
+
+DevNotifier::DevNotifier() { d_ptr_ = new DevNotifierPrivate; }
+
+DevNotifier::~DevNotifier() {
+  Wait();
+  delete d_ptr_;
+}
+
+bool DevNotifier::Place(DevQueue* queue) {
+  DevNotifierPrivate* notifier = d_ptr_;
+  {
+    std::lock_guard<std::mutex> lk(notifier->mutex);
+    notifier->placed = true;
+    notifier->reached = false;
+  }
+  queue->d_ptr_->Push([notifier] {
+    std::lock_guard<std::mutex> lk(notifier->mutex);
+    notifier->time = std::chrono::steady_clock::now();
+    notifier->reached = true;
+    notifier->cond.notify_all();
+    return true;
+  });
+  return true;
+}
+
+bool DevNotifier::Wait() {
+  std::unique_lock<std::mutex> lk(d_ptr_->mutex);
+  if (!d_ptr_->placed) return true;
+  d_ptr_->cond.wait(lk, [this] { return d_ptr_->reached; });
+  return true;
+}
+
+float DevNotifier::Duration(DevNotifier* start, DevNotifier* end) {
+  std::chrono::steady_clock::time_point times[2];
+  DevNotifier* notifiers[2] = {start, end};
+  for (int i = 0; i < 2; ++i) {
+    std::lock_guard<std::mutex> lk(notifiers[i]->d_ptr_->mutex);
+    if (!notifiers[i]->d_ptr_->reached) return -1;
+    times[i] = notifiers[i]->d_ptr_->time;
+  }
+  return std::chrono::duration<float, std::milli>(times[1] - times[0]).count();
+}
+
+}  // namespace cnstream
+
+#endif  // CNS_HOST_DEVICE
@@ -0,0 +1,214 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "host_memory_pool.hpp"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <thread>
+
+namespace cnstream {
+
+constexpr size_t SizeClassMemoryPool::kMinClassSize;
+constexpr size_t SizeClassMemoryPool::kMaxClassSize;
+constexpr size_t SizeClassMemoryPool::kHugePageSize;
+
+static HostMemoryPoolOptions MakeOptions(size_t max_cached_bytes) {
+  HostMemoryPoolOptions options;
+  options.max_cached_bytes = max_cached_bytes;
+  return options;
+}
+
+SizeClassMemoryPool::SizeClassMemoryPool(size_t max_cached_bytes)
+    : SizeClassMemoryPool(MakeOptions(max_cached_bytes)) {}
+
+SizeClassMemoryPool::SizeClassMemoryPool(const HostMemoryPoolOptions& options) : options_(options) {}
+
+SizeClassMemoryPool::~SizeClassMemoryPool() {
+  for (auto& shard : shards_) {
+    for (int idx = 0; idx < kClassNum; ++idx) {
+      FreeBuffer* head = shard.heads[idx];
+      while (head) {
+        FreeBuffer* next = head->next;
+        SystemFree(head, ClassIndexToSize(idx));
+        head = next;
+      }
+    }
+  }
+}
+
+/* mempolicy modes and flags of mbind and get_mempolicy, see numaif.h */
+static constexpr int kMpolPreferred = 1;
+static constexpr int kMpolFNode = 1 << 0;
+static constexpr int kMpolFAddr = 1 << 1;
+
+int SizeClassMemoryPool::NumaNode(const void* ptr) {
+  int node = 0;
+  if (nullptr == ptr) {
+    unsigned cpu = 0, cpu_node = 0;
+    if (0 == syscall(SYS_getcpu, &cpu, &cpu_node, nullptr)) node = static_cast<int>(cpu_node);
+  } else if (0 != syscall(SYS_get_mempolicy, &node, nullptr, 0, ptr, kMpolFNode | kMpolFAddr)) {
+    node = 0;
+  }
+  return node;
+}
+
+bool SizeClassMemoryPool::IsMapped(size_t bytes) const {
+  return bytes >= kHugePageSize && (HOST_HUGE_PAGE_NONE != options_.huge_page || options_.numa_local);
+}
+
+static size_t RoundUpToHugePage(size_t bytes) {
+  return (bytes + SizeClassMemoryPool::kHugePageSize - 1) & ~(SizeClassMemoryPool::kHugePageSize - 1);
+}
+
+void* SizeClassMemoryPool::SystemAlloc(size_t bytes, int node) {
+  if (!IsMapped(bytes)) return malloc(bytes);
+  size_t len = RoundUpToHugePage(bytes);
+  void* ptr = MAP_FAILED;
+  if (HOST_HUGE_PAGE_EXPLICIT == options_.huge_page) {
+    ptr = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  }
+  if (MAP_FAILED == ptr && HOST_HUGE_PAGE_NONE != options_.huge_page) {
+    // transparent huge pages back the 2MB aligned ranges only, the unaligned head and tail are unmapped
+    uint8_t* raw = static_cast<uint8_t*>(
+        mmap(nullptr, len + kHugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (MAP_FAILED == raw) return nullptr;
+    uint8_t* aligned = reinterpret_cast<uint8_t*>(RoundUpToHugePage(reinterpret_cast<uintptr_t>(raw)));
+    if (aligned != raw) munmap(raw, aligned - raw);
+    if (aligned + len != raw + len + kHugePageSize) munmap(aligned + len, raw + kHugePageSize - aligned);
+    madvise(aligned, len, MADV_HUGEPAGE);
+    ptr = aligned;
+  } else if (MAP_FAILED == ptr) {
+    ptr = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  }
+  if (MAP_FAILED == ptr) return nullptr;
+  if (options_.numa_local) {
+    // before the pages are touched, so that they are allocated on the node
+    unsigned long nodemask = 1UL << node;  // NOLINT
+    syscall(SYS_mbind, ptr, len, kMpolPreferred, &nodemask, sizeof(nodemask) * 8, 0);
+  }
+  return ptr;
+}
+
+void SizeClassMemoryPool::SystemFree(void* ptr, size_t bytes) {
+  if (IsMapped(bytes)) {
+    munmap(ptr, RoundUpToHugePage(bytes));
+  } else {
+    free(ptr);
+  }
+}
+
+/*
+  Class k * 4 + j - 1 holds the sizes in (2^k + (j - 1) * 2^(k - 2), 2^k + j * 2^(k - 2)], shifted so that
+  class 3 is kMinClassSize.
+*/
+int SizeClassMemoryPool::ClassIndex(size_t size) {
+  if (size > kMaxClassSize) return -1;
+  if (size < kMinClassSize) size = kMinClassSize;
+  int k = 63 - __builtin_clzll(static_cast<uint64_t>(size - 1));
+  size_t step = static_cast<size_t>(1) << (k - 2);
+  int j = static_cast<int>((size - (static_cast<size_t>(1) << k) + step - 1) / step);
+  return (k - 11) * 4 + j - 1;
+}
+
+size_t SizeClassMemoryPool::ClassIndexToSize(int idx) {
+  int k = idx / 4 + 11;
+  int j = idx % 4 + 1;
+  return (static_cast<size_t>(1) << k) + j * (static_cast<size_t>(1) << (k - 2));
+}
+
+size_t SizeClassMemoryPool::ClassSize(size_t size) {
+  int idx = ClassIndex(size);
+  return idx < 0 ? size : ClassIndexToSize(idx);
+}
+
+int SizeClassMemoryPool::ShardIndex() {
+  static thread_local int shard_idx = -1;
+  if (shard_idx < 0) {
+    shard_idx = static_cast<int>(std::hash<std::thread::id>()(std::this_thread::get_id()) % kShardNum);
+  }
+  return shard_idx;
+}
+
+void* SizeClassMemoryPool::Alloc(size_t size) {
+  int idx = ClassIndex(size);
+  size_t bytes = idx < 0 ? size : ClassIndexToSize(idx);
+  bool numa_local = options_.numa_local && IsMapped(bytes);
+  int node = numa_local ? NumaNode() : 0;
+  if (idx >= 0) {
+    int first = ShardIndex();
+    for (int i = 0; i < kShardNum; ++i) {
+      Shard& shard = shards_[(first + i) % kShardNum];
+      std::lock_guard<std::mutex> lk(shard.mutex);
+      FreeBuffer** prev = &shard.heads[idx];
+      // the buffers bound to the other nodes are skipped
+      while (*prev && numa_local && (*prev)->node != node) prev = &(*prev)->next;
+      FreeBuffer* buffer = *prev;
+      if (buffer) {
+        *prev = buffer->next;
+        bytes_cached_.fetch_sub(bytes);
+        bytes_in_use_.fetch_add(bytes);
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        return buffer;
+      }
+    }
+  }
+  void* ptr = SystemAlloc(bytes, node);
+  if (nullptr == ptr) return nullptr;
+  bytes_in_use_.fetch_add(bytes);
+  misses_.fetch_add(1, std::memory_order_relaxed);
+  return ptr;
+}
+
+void SizeClassMemoryPool::Free(void* ptr, size_t size) {
+  if (nullptr == ptr) return;
+  int idx = ClassIndex(size);
+  size_t bytes = idx < 0 ? size : ClassIndexToSize(idx);
+  bytes_in_use_.fetch_sub(bytes);
+  if (idx >= 0 && bytes_cached_.fetch_add(bytes) + bytes <= options_.max_cached_bytes) {
+    // the node the buffer is bound to, read before the buffer is overwritten
+    int node = options_.numa_local && IsMapped(bytes) ? NumaNode(ptr) : 0;
+    Shard& shard = shards_[ShardIndex()];
+    std::lock_guard<std::mutex> lk(shard.mutex);
+    FreeBuffer* buffer = static_cast<FreeBuffer*>(ptr);
+    buffer->next = shard.heads[idx];
+    buffer->node = node;
+    shard.heads[idx] = buffer;
+    return;
+  }
+  if (idx >= 0) bytes_cached_.fetch_sub(bytes);
+  SystemFree(ptr, bytes);
+}
+
+MemoryPoolStats SizeClassMemoryPool::GetStats() {
+  MemoryPoolStats stats;
+  stats.hits = hits_.load(std::memory_order_relaxed);
+  stats.misses = misses_.load(std::memory_order_relaxed);
+  stats.bytes_in_use = bytes_in_use_.load();
+  stats.bytes_cached = bytes_cached_.load();
+  return stats;
+}
+
+}  // namespace cnstream
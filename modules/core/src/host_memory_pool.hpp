@@ -0,0 +1,97 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_CORE_INCLUDE_HOST_MEMORY_POOL_HPP_
+#define MODULES_CORE_INCLUDE_HOST_MEMORY_POOL_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+
+#include "cnstream_common.hpp"
+#include "cnstream_syncmem.hpp"
+
+namespace cnstream {
+
+/**
+ * @brief The default host memory pool, caches the freed buffers by size classes.
+ *
+ * The size classes are 4 steps between powers of 2, so a buffer wastes less than 25%. The cached buffers are
+ * spread over shards picked by thread, a thread takes buffers from its own shard first and then from the others,
+ * so the buffers freed by the last module are found by the decoder thread.
+ *
+ * The buffers of kHugePageSize or larger are mapped from huge pages and bound to the NUMA node of the allocating
+ * thread by the options, see HostMemoryPoolOptions. The smaller ones are always allocated by malloc.
+ */
+class SizeClassMemoryPool : public MemoryPool {
+ public:
+  static constexpr size_t kMinClassSize = 4096;
+  /* larger buffers are not cached */
+  static constexpr size_t kMaxClassSize = 256 << 20;
+  static constexpr size_t kHugePageSize = 2 << 20;
+
+  /**
+   * @param max_cached_bytes The max bytes of the cached buffers, the buffers freed beyond it go back to the system.
+   */
+  explicit SizeClassMemoryPool(size_t max_cached_bytes = 512 << 20);
+  explicit SizeClassMemoryPool(const HostMemoryPoolOptions& options);
+  ~SizeClassMemoryPool();
+
+  void* Alloc(size_t size) override;
+  void Free(void* ptr, size_t size) override;
+  MemoryPoolStats GetStats() override;
+
+  /* the bytes allocated for size, size itself if it is not cached */
+  static size_t ClassSize(size_t size);
+
+ private:
+  DISABLE_COPY_AND_ASSIGN(SizeClassMemoryPool);
+  static constexpr int kClassNum = 68;
+  static constexpr int kShardNum = 8;
+  /* returns -1 if size is too large to be cached */
+  static int ClassIndex(size_t size);
+  static size_t ClassIndexToSize(int idx);
+  static int ShardIndex();
+  /* the NUMA node of the calling thread, or of the page at ptr if it is not nullptr. 0 if it is unknown */
+  static int NumaNode(const void* ptr = nullptr);
+  /* whether the buffers of the size are mapped instead of allocated by malloc */
+  bool IsMapped(size_t bytes) const;
+  void* SystemAlloc(size_t bytes, int node);
+  void SystemFree(void* ptr, size_t bytes);
+
+  struct FreeBuffer {
+    FreeBuffer* next;
+    int node;
+  };
+  struct Shard {
+    std::mutex mutex;
+    FreeBuffer* heads[kClassNum] = {nullptr};
+  };
+  Shard shards_[kShardNum];
+  const HostMemoryPoolOptions options_;
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+  std::atomic<uint64_t> bytes_in_use_{0};
+  std::atomic<uint64_t> bytes_cached_{0};
+};  // class SizeClassMemoryPool
+
+}  // namespace cnstream
+
+#endif  // MODULES_CORE_INCLUDE_HOST_MEMORY_POOL_HPP_
@@ -0,0 +1,285 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_CORE_INCLUDE_LOCKFREE_QUEUE_HPP_
+#define MODULES_CORE_INCLUDE_LOCKFREE_QUEUE_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+
+#include "threadsafe_queue.hpp"
+
+namespace cnstream {
+
+/**
+ * @brief Bounded multi-producer multi-consumer ring buffer (D. Vyukov's algorithm).
+ *
+ * All cells are allocated once in the constructor, TryPush and TryPop never allocate and never lock.
+ * Each cell carries a turn counter, 2 * round when it is free and 2 * round + 1 when it is filled,
+ * so the capacity does not have to be a power of two and may be as small as one.
+ */
+template <typename T>
+class MpmcRingBuffer {
+ public:
+  using value_type = T;
+
+  explicit MpmcRingBuffer(size_t capacity) : capacity_(capacity ? capacity : 1) {
+    cells_ = new Cell[capacity_];
+    for (size_t i = 0; i < capacity_; ++i) cells_[i].turn.store(0, std::memory_order_relaxed);
+  }
+  ~MpmcRingBuffer() { delete[] cells_; }
+  MpmcRingBuffer(const MpmcRingBuffer& other) = delete;
+  MpmcRingBuffer& operator=(const MpmcRingBuffer& other) = delete;
+
+  /* value is moved into the buffer only on success */
+  bool TryPush(T& value) {
+    Cell* cell;
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      cell = &cells_[pos % capacity_];
+      size_t turn = 2 * (pos / capacity_);
+      intptr_t diff = static_cast<intptr_t>(cell->turn.load(std::memory_order_acquire)) - static_cast<intptr_t>(turn);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+      } else if (diff < 0) {
+        return false;  // full
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->data = std::move(value);
+    cell->turn.store(2 * (pos / capacity_) + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool TryPop(T& value) {
+    Cell* cell;
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      cell = &cells_[pos % capacity_];
+      size_t turn = 2 * (pos / capacity_) + 1;
+      intptr_t diff = static_cast<intptr_t>(cell->turn.load(std::memory_order_acquire)) - static_cast<intptr_t>(turn);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+      } else if (diff < 0) {
+        return false;  // empty
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    value = std::move(cell->data);
+    cell->turn.store(2 * (pos / capacity_) + 2, std::memory_order_release);
+    return true;
+  }
+
+  /* approximate when producers or consumers are running concurrently */
+  size_t Size() const {
+    size_t tail = enqueue_pos_.load(std::memory_order_relaxed);
+    size_t head = dequeue_pos_.load(std::memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+  }
+
+  size_t Capacity() const { return capacity_; }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> turn;
+    T data;
+  };
+  static const size_t kCacheLine = 64;
+
+  const size_t capacity_;
+  Cell* cells_ = nullptr;
+  char pad0_[kCacheLine];
+  std::atomic<size_t> enqueue_pos_{0};
+  char pad1_[kCacheLine];
+  std::atomic<size_t> dequeue_pos_{0};
+  char pad2_[kCacheLine];
+};
+
+/**
+ * @brief Bounded single-producer single-consumer ring buffer.
+ *
+ * Only one thread may push and only one thread may pop at the same time.
+ */
+template <typename T>
+class SpscRingBuffer {
+ public:
+  using value_type = T;
+
+  explicit SpscRingBuffer(size_t capacity) : capacity_(capacity ? capacity : 1) { slots_ = new T[capacity_]; }
+  ~SpscRingBuffer() { delete[] slots_; }
+  SpscRingBuffer(const SpscRingBuffer& other) = delete;
+  SpscRingBuffer& operator=(const SpscRingBuffer& other) = delete;
+
+  /* value is moved into the buffer only on success */
+  bool TryPush(T& value) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_cache_ >= capacity_) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      if (tail - head_cache_ >= capacity_) return false;
+    }
+    slots_[tail % capacity_] = std::move(value);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool TryPop(T& value) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_cache_) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+      if (head == tail_cache_) return false;
+    }
+    value = std::move(slots_[head % capacity_]);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t Size() const {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t head = head_.load(std::memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+  }
+
+  size_t Capacity() const { return capacity_; }
+
+ private:
+  static const size_t kCacheLine = 64;
+
+  const size_t capacity_;
+  T* slots_ = nullptr;
+  char pad0_[kCacheLine];
+  /* written by the producer */
+  std::atomic<size_t> tail_{0};
+  size_t head_cache_ = 0;
+  char pad1_[kCacheLine];
+  /* written by the consumer */
+  std::atomic<size_t> head_{0};
+  size_t tail_cache_ = 0;
+  char pad2_[kCacheLine];
+};
+
+/**
+ * @brief Adds blocking semantics on top of a lock-free ring buffer.
+ *
+ * The fast path only touches the ring buffer. The mutex and the condition variables are used
+ * only when a thread really has to wait, and a signal is sent only when someone is waiting.
+ */
+template <typename Ring>
+class BlockingRingQueue : public BoundedQueue<typename Ring::value_type> {
+ public:
+  using T = typename Ring::value_type;
+
+  explicit BlockingRingQueue(size_t capacity) : ring_(capacity) {}
+  BlockingRingQueue(const BlockingRingQueue& other) = delete;
+  BlockingRingQueue& operator=(const BlockingRingQueue& other) = delete;
+
+  bool WaitAndPush(T new_value) override {
+    if (stopped_.load(std::memory_order_acquire)) return false;
+    if (!ring_.TryPush(new_value)) {
+      bool pushed = false;
+      std::unique_lock<std::mutex> lk(wait_m_);
+      push_waiters_.fetch_add(1);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      notfull_cond_.wait(lk, [&] { return stopped_.load() || (pushed = ring_.TryPush(new_value)); });
+      push_waiters_.fetch_sub(1);
+      if (!pushed) return false;
+    }
+    Signal(pop_waiters_, notempty_cond_);
+    return true;
+  }
+
+  bool WaitAndTryPush(T& value, const std::chrono::microseconds rel_time) override {
+    if (stopped_.load(std::memory_order_acquire)) return false;
+    if (!ring_.TryPush(value)) {
+      bool pushed = false;
+      std::unique_lock<std::mutex> lk(wait_m_);
+      push_waiters_.fetch_add(1);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      notfull_cond_.wait_for(lk, rel_time, [&] { return stopped_.load() || (pushed = ring_.TryPush(value)); });
+      push_waiters_.fetch_sub(1);
+      if (!pushed) return false;
+    }
+    Signal(pop_waiters_, notempty_cond_);
+    return true;
+  }
+
+  bool WaitAndPop(T& value) override {
+    if (stopped_.load(std::memory_order_acquire)) return false;
+    if (!ring_.TryPop(value)) {
+      bool popped = false;
+      std::unique_lock<std::mutex> lk(wait_m_);
+      pop_waiters_.fetch_add(1);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      notempty_cond_.wait(lk, [&] { return stopped_.load() || (popped = ring_.TryPop(value)); });
+      pop_waiters_.fetch_sub(1);
+      if (!popped) return false;
+    }
+    Signal(push_waiters_, notfull_cond_);
+    return true;
+  }
+
+  bool TryPop(T& value) override {
+    if (!ring_.TryPop(value)) return false;
+    Signal(push_waiters_, notfull_cond_);
+    return true;
+  }
+
+  void Stop() override {
+    stopped_.store(true);
+    std::lock_guard<std::mutex> lk(wait_m_);
+    notempty_cond_.notify_all();
+    notfull_cond_.notify_all();
+  }
+
+  void Start() override { stopped_.store(false); }
+
+  bool Empty() override { return ring_.Size() == 0; }
+
+  uint32_t Size() override { return ring_.Size(); }
+
+  size_t Capacity() const override { return ring_.Capacity(); }
+
+ private:
+  void Signal(const std::atomic<int>& waiters, std::condition_variable& cond) {
+    // pairs with the fence on the waiting side, either the waiter sees our update or we see the waiter
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters.load(std::memory_order_relaxed) > 0) {
+      std::lock_guard<std::mutex> lk(wait_m_);
+      cond.notify_all();
+    }
+  }
+
+  Ring ring_;
+  std::atomic<bool> stopped_{false};
+  std::atomic<int> push_waiters_{0};
+  std::atomic<int> pop_waiters_{0};
+  std::mutex wait_m_;
+  std::condition_variable notempty_cond_;
+  std::condition_variable notfull_cond_;
+};
+
+}  // namespace cnstream
+
+#endif  // MODULES_CORE_INCLUDE_LOCKFREE_QUEUE_HPP_
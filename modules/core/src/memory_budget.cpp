@@ -0,0 +1,95 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "memory_budget.hpp"
+
+#include <algorithm>
+
+#include "cnstream_frame.hpp"
+
+namespace cnstream {
+
+void FrameMemoryBudget::SetLimit(size_t bytes, MemoryBudgetPolicy policy) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  limit_ = bytes;
+  policy_ = policy;
+  cond_.notify_all();
+}
+
+size_t FrameMemoryBudget::GetLimit() const {
+  std::lock_guard<std::mutex> lk(mutex_);
+  return limit_;
+}
+
+bool FrameMemoryBudget::Admit(CNDataFrame* frame) {
+  size_t bytes = std::max(frame->alloc_bytes_, frame->GetBytes());
+  if (0 == bytes || frame->budget_) return true;
+  std::unique_lock<std::mutex> lk(mutex_);
+  bool throttled = false;
+  while (0 != limit_ && 0 != in_flight_ && in_flight_ + bytes > limit_) {
+    if (MEMORY_BUDGET_DROP == policy_ || stopped_) {
+      ++dropped_;
+      return false;
+    }
+    if (!throttled) ++throttled_, throttled = true;
+    cond_.wait(lk);
+  }
+  in_flight_ += bytes;
+  peak_ = std::max(peak_, in_flight_);
+  frame->budget_ = shared_from_this();
+  frame->budget_bytes_.store(bytes, std::memory_order_relaxed);
+  return true;
+}
+
+void FrameMemoryBudget::Charge(size_t bytes) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  in_flight_ += bytes;
+  peak_ = std::max(peak_, in_flight_);
+}
+
+void FrameMemoryBudget::Release(size_t bytes) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  in_flight_ -= bytes;
+  cond_.notify_all();
+}
+
+void FrameMemoryBudget::Stop() {
+  std::lock_guard<std::mutex> lk(mutex_);
+  stopped_ = true;
+  cond_.notify_all();
+}
+
+void FrameMemoryBudget::Start() {
+  std::lock_guard<std::mutex> lk(mutex_);
+  stopped_ = false;
+}
+
+MemoryBudgetStatus FrameMemoryBudget::GetStatus() const {
+  std::lock_guard<std::mutex> lk(mutex_);
+  MemoryBudgetStatus status;
+  status.budget_bytes = limit_;
+  status.in_flight_bytes = in_flight_;
+  status.peak_bytes = peak_;
+  status.throttled_frames = throttled_;
+  status.dropped_frames = dropped_;
+  return status;
+}
+
+}  // namespace cnstream
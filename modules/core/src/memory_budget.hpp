@@ -0,0 +1,79 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_CORE_INCLUDE_MEMORY_BUDGET_HPP_
+#define MODULES_CORE_INCLUDE_MEMORY_BUDGET_HPP_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "cnstream_common.hpp"
+
+namespace cnstream {
+
+struct CNDataFrame;
+
+/**
+ * @brief The bytes of the frame buffers in flight in a pipeline.
+ *
+ * A frame is charged when it enters the pipeline, the buffers allocated by CNDataFrame::CopyToSyncMem or
+ * the bytes of its planes if it references a buffer of its own, e.g. a decoder buffer. The images the frame
+ * allocates afterwards, its BGR image, the copies of the branches and the derived images, are charged as
+ * they are allocated, they are never refused but delay or drop the next frames. The charges are given back
+ * when the frame releases its buffers. Frames without images, e.g. eos frames, are not charged.
+ */
+class FrameMemoryBudget : public std::enable_shared_from_this<FrameMemoryBudget> {
+ public:
+  /* 0 means unlimited */
+  void SetLimit(size_t bytes, MemoryBudgetPolicy policy);
+  size_t GetLimit() const;
+  /*
+    charges the frame, waits or refuses it by the policy when the budget is used up.
+    a frame is always admitted when nothing is in flight, so frames larger than the budget still flow.
+    returns false if the frame is dropped or the budget is stopped while waiting.
+    a frame already charged is admitted again without being charged.
+   */
+  bool Admit(CNDataFrame* frame);
+  /* charges an admitted frame more, never waits */
+  void Charge(size_t bytes);
+  void Release(size_t bytes);
+  /* wakes up and refuses the waiting sources until Start is called */
+  void Stop();
+  void Start();
+  MemoryBudgetStatus GetStatus() const;
+
+ private:
+  mutable std::mutex mutex_;
+  std::condition_variable cond_;
+  size_t limit_ = 0;
+  MemoryBudgetPolicy policy_ = MEMORY_BUDGET_BLOCK;
+  size_t in_flight_ = 0;
+  size_t peak_ = 0;
+  uint64_t throttled_ = 0;
+  uint64_t dropped_ = 0;
+  bool stopped_ = false;
+};  // class FrameMemoryBudget
+
+}  // namespace cnstream
+
+#endif  // MODULES_CORE_INCLUDE_MEMORY_BUDGET_HPP_
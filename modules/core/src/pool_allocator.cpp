@@ -0,0 +1,101 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "pool_allocator.hpp"
+
+#include <atomic>
+#include <new>
+
+#include "cnstream_common.hpp"
+
+namespace cnstream {
+
+namespace {
+
+constexpr size_t kSizeClassStep = 16;
+constexpr size_t kSizeClassNum = BlockPool::kMaxBlockSize / kSizeClassStep;
+
+struct FreeBlock {
+  FreeBlock* next;
+};
+
+struct SizeClass {
+  CNSpinLock lock;
+  FreeBlock* head = nullptr;
+  size_t cached = 0;
+};
+
+/* never destroyed, frames may be released while static objects are being destroyed */
+SizeClass* GetSizeClasses() {
+  static SizeClass* classes = new SizeClass[kSizeClassNum];
+  return classes;
+}
+
+std::atomic<uint64_t> heap_alloc_cnt{0};
+std::atomic<uint64_t> reuse_cnt{0};
+
+inline size_t SizeClassIdx(size_t size) { return (size + kSizeClassStep - 1) / kSizeClassStep - 1; }
+
+}  // namespace
+
+void* BlockPool::Alloc(size_t size) {
+  if (0 == size) size = 1;
+  if (size > kMaxBlockSize) {
+    heap_alloc_cnt.fetch_add(1, std::memory_order_relaxed);
+    return ::operator new(size);
+  }
+  SizeClass& sc = GetSizeClasses()[SizeClassIdx(size)];
+  {
+    CNSpinLockGuard guard(sc.lock);
+    FreeBlock* block = sc.head;
+    if (nullptr != block) {
+      sc.head = block->next;
+      --sc.cached;
+      reuse_cnt.fetch_add(1, std::memory_order_relaxed);
+      return block;
+    }
+  }
+  heap_alloc_cnt.fetch_add(1, std::memory_order_relaxed);
+  // blocks of a size class are interchangeable, so allocate the full class size
+  return ::operator new((SizeClassIdx(size) + 1) * kSizeClassStep);
+}
+
+void BlockPool::Free(void* p, size_t size) {
+  if (nullptr == p) return;
+  if (0 == size) size = 1;
+  if (size <= kMaxBlockSize) {
+    SizeClass& sc = GetSizeClasses()[SizeClassIdx(size)];
+    CNSpinLockGuard guard(sc.lock);
+    if (sc.cached < kMaxCachedBlocks) {
+      FreeBlock* block = static_cast<FreeBlock*>(p);
+      block->next = sc.head;
+      sc.head = block;
+      ++sc.cached;
+      return;
+    }
+  }
+  ::operator delete(p);
+}
+
+uint64_t BlockPool::HeapAllocCount() { return heap_alloc_cnt.load(std::memory_order_relaxed); }
+
+uint64_t BlockPool::ReuseCount() { return reuse_cnt.load(std::memory_order_relaxed); }
+
+}  // namespace cnstream
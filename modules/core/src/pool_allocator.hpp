@@ -0,0 +1,82 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_CORE_INCLUDE_POOL_ALLOCATOR_HPP_
+#define MODULES_CORE_INCLUDE_POOL_ALLOCATOR_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cnstream {
+
+/**
+ * @brief Free lists of small fixed size blocks.
+ *
+ * Released blocks are cached for reuse instead of going back to the heap, so the objects
+ * created for every frame stop allocating once a pipeline reaches steady state.
+ * Blocks larger than kMaxBlockSize are not pooled.
+ */
+class BlockPool {
+ public:
+  static constexpr size_t kMaxBlockSize = 512;
+  /* the most blocks cached in each size class, the rest go back to the heap */
+  static constexpr size_t kMaxCachedBlocks = 4096;
+
+  static void* Alloc(size_t size);
+  static void Free(void* p, size_t size);
+
+  /* blocks allocated from the heap */
+  static uint64_t HeapAllocCount();
+  /* blocks taken from the free lists */
+  static uint64_t ReuseCount();
+};  // class BlockPool
+
+/**
+ * @brief STL allocator on top of BlockPool, used for shared_ptr control blocks and std::allocate_shared.
+ */
+template <typename T>
+class PoolAllocator {
+ public:
+  typedef T value_type;
+  template <typename U>
+  struct rebind {
+    typedef PoolAllocator<U> other;
+  };
+
+  PoolAllocator() {}
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U>&) {}  // NOLINT
+
+  T* allocate(size_t n) { return static_cast<T*>(BlockPool::Alloc(n * sizeof(T))); }
+  void deallocate(T* p, size_t n) { BlockPool::Free(p, n * sizeof(T)); }
+
+  template <typename U>
+  bool operator==(const PoolAllocator<U>&) const {
+    return true;
+  }
+  template <typename U>
+  bool operator!=(const PoolAllocator<U>&) const {
+    return false;
+  }
+};  // class PoolAllocator
+
+}  // namespace cnstream
+
+#endif  // MODULES_CORE_INCLUDE_POOL_ALLOCATOR_HPP_
@@ -0,0 +1,189 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "queue_sampler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "connector.hpp"
+#include "conveyor.hpp"
+
+namespace cnstream {
+
+QueueSampler::QueueSampler(const std::string& pipeline_name, const std::vector<Link>& links,
+                           const std::vector<Node>& nodes)
+    : pipeline_name_(pipeline_name), links_(links), nodes_(nodes) {
+  for (auto& link : links_) {
+    std::vector<ConveyorSamples> conveyors(link.connector->GetConveyorCount());
+    for (auto& conveyor : conveyors) conveyor.depth_counts.assign(link.connector->GetConveyorCapacity() + 1, 0);
+    samples_.push_back(std::move(conveyors));
+  }
+  bottleneck_counts_.assign(nodes_.size(), 0);
+}
+
+QueueSampler::~QueueSampler() { Stop(); }
+
+void QueueSampler::Start(uint32_t interval_ms, uint32_t summary_interval_s) {
+  Stop();
+  stopped_ = false;
+  thread_ = std::thread(&QueueSampler::Loop, this, interval_ms, summary_interval_s);
+}
+
+void QueueSampler::Stop() {
+  {
+    std::lock_guard<std::mutex> lk(stop_mutex_);
+    stopped_ = true;
+  }
+  stop_cond_.notify_all();
+  if (thread_.joinable()) thread_.join();
+}
+
+void QueueSampler::Loop(uint32_t interval_ms, uint32_t summary_interval_s) {
+  SetThreadName("cn-QueueSampler");
+  auto next_summary = std::chrono::steady_clock::now() + std::chrono::seconds(summary_interval_s);
+  std::unique_lock<std::mutex> lk(stop_mutex_);
+  while (!stop_cond_.wait_for(lk, std::chrono::milliseconds(interval_ms), [this] { return stopped_; })) {
+    Sample();
+    if (summary_interval_s && std::chrono::steady_clock::now() >= next_summary) {
+      next_summary += std::chrono::seconds(summary_interval_s);
+      LogSummary();
+    }
+  }
+}
+
+void QueueSampler::Sample() {
+  // the sizes are read before the lock, the queries do not wait for them
+  std::vector<std::vector<uint32_t>> depths(links_.size());
+  for (size_t i = 0; i < links_.size(); ++i) {
+    Connector* connector = links_[i].connector;
+    for (uint32_t c = 0; c < connector->GetConveyorCount(); ++c) {
+      depths[i].push_back(connector->GetConveyor(c)->GetBufferSize());
+    }
+  }
+  std::lock_guard<std::mutex> lk(mutex_);
+  ++sample_num_;
+  std::vector<bool> full(links_.size(), false), empty(links_.size(), true);
+  for (size_t i = 0; i < links_.size(); ++i) {
+    for (size_t c = 0; c < depths[i].size(); ++c) {
+      ConveyorSamples& conveyor = samples_[i][c];
+      uint32_t capacity = conveyor.depth_counts.size() - 1;
+      uint32_t depth = std::min(depths[i][c], capacity);
+      ++conveyor.depth_counts[depth];
+      if (depth == capacity) {
+        ++conveyor.full;
+        full[i] = true;
+      }
+      if (depth) empty[i] = false;
+    }
+  }
+  for (size_t n = 0; n < nodes_.size(); ++n) {
+    const Node& node = nodes_[n];
+    bool input_full = std::any_of(node.inputs.begin(), node.inputs.end(), [&](size_t i) { return full[i]; });
+    bool output_empty = std::all_of(node.outputs.begin(), node.outputs.end(), [&](size_t i) { return empty[i]; });
+    if (input_full && output_empty) ++bottleneck_counts_[n];
+  }
+}
+
+bool QueueSampler::GetTelemetry(const std::string& link_id, std::vector<QueueTelemetry>* telemetry) const {
+  auto link = std::find_if(links_.begin(), links_.end(), [&](const Link& it) { return it.id == link_id; });
+  if (link == links_.end()) return false;
+  const std::vector<ConveyorSamples>& conveyors = samples_[link - links_.begin()];
+  telemetry->clear();
+  std::lock_guard<std::mutex> lk(mutex_);
+  for (size_t c = 0; c < conveyors.size(); ++c) {
+    const ConveyorSamples& conveyor = conveyors[c];
+    QueueTelemetry result;
+    result.capacity = conveyor.depth_counts.size() - 1;
+    result.samples = sample_num_;
+    Conveyor* source = link->connector->GetConveyor(c);
+    result.blocked_pushes = source->GetBlockedPushes() - conveyor.blocked_pushes_base;
+    result.blocked_ms = (source->GetBlockedNs() - conveyor.blocked_ns_base) / 1e6;
+    if (sample_num_) {
+      uint64_t sum = 0, seen = 0;
+      uint32_t* percentiles[] = {&result.p50_depth, &result.p90_depth, &result.p99_depth};
+      const double ratios[] = {0.5, 0.9, 0.99};
+      int pi = 0;
+      for (uint32_t depth = 0; depth < conveyor.depth_counts.size(); ++depth) {
+        uint64_t count = conveyor.depth_counts[depth];
+        if (!count) continue;
+        sum += count * depth;
+        seen += count;
+        result.max_depth = depth;
+        while (pi < 3 && seen >= ratios[pi] * sample_num_) *percentiles[pi++] = depth;
+      }
+      result.mean_depth = static_cast<double>(sum) / sample_num_;
+      result.at_capacity_percent = 100.0 * conveyor.full / sample_num_;
+    }
+    telemetry->push_back(result);
+  }
+  return true;
+}
+
+void QueueSampler::Reset() {
+  std::lock_guard<std::mutex> lk(mutex_);
+  sample_num_ = 0;
+  std::fill(bottleneck_counts_.begin(), bottleneck_counts_.end(), 0);
+  for (size_t i = 0; i < links_.size(); ++i) {
+    for (size_t c = 0; c < samples_[i].size(); ++c) {
+      ConveyorSamples& conveyor = samples_[i][c];
+      std::fill(conveyor.depth_counts.begin(), conveyor.depth_counts.end(), 0);
+      conveyor.full = 0;
+      Conveyor* source = links_[i].connector->GetConveyor(c);
+      conveyor.blocked_pushes_base = source->GetBlockedPushes();
+      conveyor.blocked_ns_base = source->GetBlockedNs();
+    }
+  }
+}
+
+std::string QueueSampler::GetBottleneck(double* percent) const {
+  std::lock_guard<std::mutex> lk(mutex_);
+  auto it = std::max_element(bottleneck_counts_.begin(), bottleneck_counts_.end());
+  if (it == bottleneck_counts_.end() || 0 == *it) {
+    if (percent) *percent = 0;
+    return "";
+  }
+  if (percent) *percent = 100.0 * *it / sample_num_;
+  return nodes_[it - bottleneck_counts_.begin()].name;
+}
+
+void QueueSampler::LogSummary() const {
+  std::ostringstream os;
+  os << "[" << pipeline_name_ << "] queue telemetry:";
+  std::vector<QueueTelemetry> telemetry;
+  for (auto& link : links_) {
+    GetTelemetry(link.id, &telemetry);
+    for (size_t c = 0; c < telemetry.size(); ++c) {
+      const QueueTelemetry& it = telemetry[c];
+      os << "\n  " << link.id << " conveyor " << c << ": depth mean " << it.mean_depth << " p99 " << it.p99_depth
+         << " max " << it.max_depth << "/" << it.capacity << ", full " << it.at_capacity_percent << "%, blocked "
+         << it.blocked_pushes << " pushes " << it.blocked_ms << " ms";
+    }
+  }
+  double percent = 0;
+  std::string bottleneck = GetBottleneck(&percent);
+  if (!bottleneck.empty()) os << "\n  bottleneck: " << bottleneck << " (" << percent << "% of the samples)";
+  LOG(INFO) << os.str();
+}
+
+}  // namespace cnstream
@@ -0,0 +1,97 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_CORE_INCLUDE_QUEUE_SAMPLER_HPP_
+#define MODULES_CORE_INCLUDE_QUEUE_SAMPLER_HPP_
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cnstream_common.hpp"
+#include "cnstream_pipeline.hpp"
+
+namespace cnstream {
+
+class Connector;
+
+/**
+ * @brief Samples the depth of the conveyors of a pipeline in a background thread.
+ *
+ * A module is the bottleneck in a sample if one of its input conveyors is full while all its output conveyors
+ * are empty, i.e. the upstream modules wait for it and the downstream modules starve.
+ */
+class QueueSampler {
+ public:
+  struct Link {
+    std::string id;
+    Connector* connector;
+  };
+  struct Node {
+    std::string name;
+    /* indexes of the links */
+    std::vector<size_t> inputs;
+    std::vector<size_t> outputs;
+  };
+
+  QueueSampler(const std::string& pipeline_name, const std::vector<Link>& links, const std::vector<Node>& nodes);
+  ~QueueSampler();
+
+  void Start(uint32_t interval_ms, uint32_t summary_interval_s);
+  void Stop();
+  /* takes one sample, called by the sampling thread */
+  void Sample();
+  bool GetTelemetry(const std::string& link_id, std::vector<QueueTelemetry>* telemetry) const;
+  /* drops the samples and the backpressure so far, the sampling goes on */
+  void Reset();
+  std::string GetBottleneck(double* percent) const;
+  void LogSummary() const;
+
+ private:
+  DISABLE_COPY_AND_ASSIGN(QueueSampler);
+  struct ConveyorSamples {
+    /* the number of samples of each depth, the depths beyond the capacity are counted as the capacity */
+    std::vector<uint64_t> depth_counts;
+    uint64_t full = 0;
+    /* the backpressure counters of the conveyor when the samples were reset */
+    uint64_t blocked_pushes_base = 0;
+    uint64_t blocked_ns_base = 0;
+  };
+  void Loop(uint32_t interval_ms, uint32_t summary_interval_s);
+
+  const std::string pipeline_name_;
+  std::vector<Link> links_;
+  std::vector<Node> nodes_;
+  mutable std::mutex mutex_;
+  std::vector<std::vector<ConveyorSamples>> samples_;
+  std::vector<uint64_t> bottleneck_counts_;
+  uint64_t sample_num_ = 0;
+  std::mutex stop_mutex_;
+  std::condition_variable stop_cond_;
+  bool stopped_ = true;
+  std::thread thread_;
+};  // class QueueSampler
+
+}  // namespace cnstream
+
+#endif  // MODULES_CORE_INCLUDE_QUEUE_SAMPLER_HPP_
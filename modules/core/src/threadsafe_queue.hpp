@@ -21,9 +21,13 @@
 #ifndef MODULES_CORE_INCLUDE_THREADSAFE_QUEUE_HPP_
 #define MODULES_CORE_INCLUDE_THREADSAFE_QUEUE_HPP_
 
+#include <chrono>
 #include <condition_variable>
+#include <deque>
+#include <functional>
 #include <mutex>
 #include <queue>
+#include <utility>
 
 namespace cnstream {
 
@@ -97,6 +101,178 @@ void ThreadSafeQueue<T>::Push(T new_value) {
   notempty_cond_.notify_one();
 }
 
+/**
+ * @brief Interface of the bounded blocking queues used by conveyors.
+ *
+ * Producers block in WaitAndPush until space frees up, consumers block in WaitAndPop
+ * until data arrives. Stop() wakes all waiters, after which both calls return false
+ * immediately until Start() is called again.
+ */
+template <typename T>
+class BoundedQueue {
+ public:
+  virtual ~BoundedQueue() {}
+
+  /* Blocks until there is free space. Returns false if the queue is stopped. */
+  virtual bool WaitAndPush(T new_value) = 0;
+
+  /*
+   * Waits at most rel_time for free space. value is moved into the queue only on success.
+   * Returns false on timeout or if the queue is stopped.
+   */
+  virtual bool WaitAndTryPush(T& value, const std::chrono::microseconds rel_time) = 0;
+
+  /* Blocks until data is available. Returns false if the queue is stopped. */
+  virtual bool WaitAndPop(T& value) = 0;
+
+  virtual bool TryPop(T& value) = 0;
+
+  virtual void Stop() = 0;
+  virtual void Start() = 0;
+  virtual bool Empty() = 0;
+  virtual uint32_t Size() = 0;
+  virtual size_t Capacity() const = 0;
+};
+
+/**
+ * @brief Bounded blocking queue with not-full / not-empty signalling, guarded by one mutex.
+ */
+template <typename T>
+class BoundedThreadSafeQueue : public BoundedQueue<T> {
+ public:
+  explicit BoundedThreadSafeQueue(size_t capacity) : capacity_(capacity) {}
+  BoundedThreadSafeQueue(const BoundedThreadSafeQueue& other) = delete;
+  BoundedThreadSafeQueue& operator=(const BoundedThreadSafeQueue& other) = delete;
+
+  bool WaitAndPush(T new_value) override;
+
+  bool WaitAndTryPush(T& value, const std::chrono::microseconds rel_time) override;
+
+  static constexpr int kDropNone = -1;
+  static constexpr int kDropNewValue = -2;
+  /*
+   * Pushes with a drop policy. select(queue, value) is called under the lock and returns the position of
+   * the element to drop before value is pushed, kDropNewValue to drop value itself, or kDropNone to push
+   * value once there is free space. The dropped element is moved to dropped.
+   * Waits at most rel_time for free space, value is moved only on success.
+   * Returns false on timeout or if the queue is stopped.
+   */
+  bool WaitAndPushOrDrop(T& value, const std::function<int(const std::deque<T>&, const T&)>& select, T* dropped,
+                         const std::chrono::microseconds rel_time);
+
+  bool WaitAndPop(T& value) override;
+
+  bool TryPop(T& value) override;
+
+  void Stop() override {
+    {
+      std::lock_guard<std::mutex> lk(data_m_);
+      stopped_ = true;
+    }
+    notempty_cond_.notify_all();
+    notfull_cond_.notify_all();
+  }
+
+  void Start() override {
+    std::lock_guard<std::mutex> lk(data_m_);
+    stopped_ = false;
+  }
+
+  bool Empty() override {
+    std::lock_guard<std::mutex> lk(data_m_);
+    return q_.empty();
+  }
+
+  uint32_t Size() override {
+    std::lock_guard<std::mutex> lk(data_m_);
+    return q_.size();
+  }
+
+  size_t Capacity() const override { return capacity_; }
+
+ private:
+  const size_t capacity_;
+  bool stopped_ = false;
+  std::mutex data_m_;
+  std::deque<T> q_;
+  std::condition_variable notempty_cond_;
+  std::condition_variable notfull_cond_;
+};
+
+template <typename T>
+bool BoundedThreadSafeQueue<T>::WaitAndPush(T new_value) {
+  std::unique_lock<std::mutex> lk(data_m_);
+  notfull_cond_.wait(lk, [&] { return stopped_ || q_.size() < capacity_; });
+  if (stopped_) return false;
+  q_.push_back(std::move(new_value));
+  lk.unlock();
+  notempty_cond_.notify_one();
+  return true;
+}
+
+template <typename T>
+bool BoundedThreadSafeQueue<T>::WaitAndTryPush(T& value, const std::chrono::microseconds rel_time) {
+  std::unique_lock<std::mutex> lk(data_m_);
+  if (!notfull_cond_.wait_for(lk, rel_time, [&] { return stopped_ || q_.size() < capacity_; })) return false;
+  if (stopped_) return false;
+  q_.push_back(std::move(value));
+  lk.unlock();
+  notempty_cond_.notify_one();
+  return true;
+}
+
+template <typename T>
+bool BoundedThreadSafeQueue<T>::WaitAndPushOrDrop(T& value,
+                                                  const std::function<int(const std::deque<T>&, const T&)>& select,
+                                                  T* dropped, const std::chrono::microseconds rel_time) {
+  const auto deadline = std::chrono::steady_clock::now() + rel_time;
+  std::unique_lock<std::mutex> lk(data_m_);
+  while (!stopped_) {
+    int pos = select(q_, value);
+    if (kDropNewValue == pos) {
+      *dropped = std::move(value);
+      return true;
+    }
+    if (pos >= 0 || q_.size() < capacity_) {
+      if (pos >= 0) {
+        *dropped = std::move(q_[pos]);
+        q_.erase(q_.begin() + pos);
+      }
+      q_.push_back(std::move(value));
+      lk.unlock();
+      notempty_cond_.notify_one();
+      return true;
+    }
+    if (std::cv_status::timeout == notfull_cond_.wait_until(lk, deadline)) return false;
+  }
+  return false;
+}
+
+template <typename T>
+bool BoundedThreadSafeQueue<T>::WaitAndPop(T& value) {
+  std::unique_lock<std::mutex> lk(data_m_);
+  notempty_cond_.wait(lk, [&] { return stopped_ || !q_.empty(); });
+  if (stopped_) return false;
+  value = std::move(q_.front());
+  q_.pop_front();
+  lk.unlock();
+  notfull_cond_.notify_one();
+  return true;
+}
+
+template <typename T>
+bool BoundedThreadSafeQueue<T>::TryPop(T& value) {
+  std::unique_lock<std::mutex> lk(data_m_);
+  if (q_.empty()) {
+    return false;
+  }
+  value = std::move(q_.front());
+  q_.pop_front();
+  lk.unlock();
+  notfull_cond_.notify_one();
+  return true;
+}
+
 }  // namespace cnstream
 
 #endif  // MODULES_CORE_INCLUDE_THREADSAFE_QUEUE_HPP_
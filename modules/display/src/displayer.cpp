@@ -28,6 +28,7 @@ namespace cnstream {
 
 Displayer::Displayer(const std::string &name) : Module(name) {
   player_ = new SDLVideoPlayer;
+  SetDataAccess(MODULE_DATA_ACCESS_CPU);
   param_register_.SetModuleDesc("Displayer is a module for displaying the vedio.");
   param_register_.Register("window-width", "Width for displayer window.");
   param_register_.Register("window-height", "Height for displayer window.");
@@ -83,7 +84,9 @@ void Displayer::Close() {
 int Displayer::Process(CNFrameInfoPtr data) {
   if (show_) {
     UpdateData ud;
-    ud.img = *data->frame.ImageBGR();
+    // the scaled image is derived once per frame and may be shared with other modules
+    ud.img = data->frame.GetDerivedImage(CN_PIXEL_FORMAT_BGR24, player_->chn_w(), player_->chn_h());
+    if (ud.img.empty()) return 0;
     ud.chn_idx = data->channel_idx;
     player_->FeedData(ud);
   }
@@ -177,7 +177,8 @@ bool SDLVideoPlayer::FeedData(const UpdateData& data) {
   std::queue<UpdateData>& q = data_queues_[data.chn_idx].first;
   cv::Size show_size(chn_w_, chn_h_);
   auto t = data;
-  cv::resize(t.img, t.img, show_size);
+  // the image may be shared with other modules, resize to a new one
+  if (t.img.size() != show_size) cv::resize(t.img, t.img, show_size);
   std::lock_guard<std::mutex> lk(*pmtx);
   if (q.size() > 10) q.pop();
   q.push(t);
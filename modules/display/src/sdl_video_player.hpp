@@ -48,6 +48,9 @@ class SDLVideoPlayer {  // BGR
   inline int window_w() const { return window_w_; }
   inline void set_window_h(int h) { window_h_ = h; }
   inline int window_h() const { return window_h_; }
+  /* the size of a channel on the window, valid after Init() */
+  inline int chn_w() const { return chn_w_; }
+  inline int chn_h() const { return chn_h_; }
   inline bool running() const { return running_; }
   inline SDL_Window *window() const { return window_; }
   inline SDL_Renderer *renderer() const { return renderer_; }
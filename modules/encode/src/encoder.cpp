@@ -29,6 +29,7 @@ namespace cnstream {
 Encoder::Encoder(const std::string &name) : Module(name) {
   param_register_.SetModuleDesc("Encoder is a module for encode the video or image.");
   param_register_.Register("dump_dir", "Output path.");
+  SetDataAccess(MODULE_DATA_ACCESS_CPU);
 }
 
 EncoderContext *Encoder::GetEncoderContext(CNFrameInfoPtr data) {
@@ -112,6 +112,7 @@ class FpsStats : public Module, public ModuleCreator<FpsStats> {
     }
   };
   StreamFps* stream_fps_ = nullptr;
+  uint32_t stream_num_ = 0;
 };  // class FpsStats
 
 }  // namespace cnstream
@@ -29,7 +29,8 @@
 namespace cnstream {
 
 FpsStats::FpsStats(const std::string& name) : Module(name) {
-  stream_fps_ = new StreamFps[GetMaxStreamNumber()];
+  stream_num_ = GetMaxStreamNumber();
+  stream_fps_ = new StreamFps[stream_num_];
   param_register_.SetModuleDesc("FpsStats is a module for show fps stats.");
 }
 
@@ -38,13 +39,21 @@ FpsStats::~FpsStats() {
   delete[] stream_fps_;
 }
 
-bool FpsStats::Open(ModuleParamSet paramSet) { return true; }
+bool FpsStats::Open(ModuleParamSet paramSet) {
+  // the stream number may be configured after the module is created
+  if (stream_num_ != GetMaxStreamNumber()) {
+    delete[] stream_fps_;
+    stream_num_ = GetMaxStreamNumber();
+    stream_fps_ = new StreamFps[stream_num_];
+  }
+  return true;
+}
 
 void FpsStats::Close() {}
 
 int FpsStats::Process(std::shared_ptr<CNFrameInfo> data) {
   uint32_t stream_idx = data->channel_idx;
-  if (stream_idx < GetMaxStreamNumber()) {
+  if (stream_idx < stream_num_) {
     std::unique_lock<std::mutex> lock(stream_fps_[stream_idx].mutex_);
     stream_fps_[stream_idx].update(data);
   } else {
@@ -57,7 +66,7 @@ int FpsStats::Process(std::shared_ptr<CNFrameInfo> data) {
 void FpsStats::ShowStatistics() {
   std::cout << "------------------------FpsStats::ShowStatistics------------------------" << std::endl;
   auto total_fps = 0.0f;
-  for (uint32_t i = 0; i < GetMaxStreamNumber(); i++) {
+  for (uint32_t i = 0; i < stream_num_; i++) {
     std::unique_lock<std::mutex> lock(stream_fps_[i].mutex_);
     if (stream_fps_[i].stream_id_.empty()) {
       continue;
@@ -24,6 +24,8 @@
 #include <glog/logging.h>
 #include <memory>
 #include <vector>
+#include "cnstream_devmem.hpp"
+#include "cnstream_trace.hpp"
 #include "infer_engine.hpp"
 #include "infer_resource.hpp"
 #include "infer_task.hpp"
@@ -44,11 +46,22 @@ std::vector<std::shared_ptr<InferTask>> H2DBatchingDoneStage::BatchingDone(const
     QueuingTicket mir_ticket = mlu_input_res_ticket;
     IOResValue cpu_value = this->cpu_input_res_->WaitResourceByTicket(&cir_ticket);
     IOResValue mlu_value = this->mlu_input_res_->WaitResourceByTicket(&mir_ticket);
+    CNS_TRACE_SCOPE("infer", "h2d");
+#ifdef CNS_HOST_DEVICE
+    // no layout transform on the host-emulated device
+    for (size_t input_idx = 0; input_idx < cpu_value.datas.size(); ++input_idx) {
+      size_t bytes = cpu_value.datas[input_idx].batch_offset * this->batchsize_;
+      if (!DevMemcpy(mlu_value.ptrs[input_idx], cpu_value.ptrs[input_idx], bytes, DEV_MEMCPY_HOST2DEV)) {
+        throw CnstreamError("memcpy h2d failed.");
+      }
+    }
+#elif CNS_MLU100
     edk::MluMemoryOp mem_op;
     mem_op.SetLoader(this->model_);
-#ifdef CNS_MLU100
     mem_op.MemcpyInputH2D(mlu_value.ptrs, cpu_value.ptrs, this->batchsize_);
 #elif CNS_MLU270
+    edk::MluMemoryOp mem_op;
+    mem_op.SetLoader(this->model_);
     mem_op.MemcpyInputH2D(mlu_value.ptrs, cpu_value.ptrs, 1);
 #endif
     this->cpu_input_res_->DeallingDone();
@@ -69,6 +82,7 @@ std::vector<std::shared_ptr<InferTask>> ResizeConvertBatchingDoneStage::Batching
     QueuingTicket mir_tickett = mlu_input_res_ticket;
     std::shared_ptr<RCOpValue> rcop_value = this->rcop_res_->WaitResourceByTicket(&rcopr_ticket);
     IOResValue mlu_value = this->mlu_input_res_->WaitResourceByTicket(&mir_tickett);
+    CNS_TRACE_SCOPE("infer", "resize_convert");
     CHECK_EQ(mlu_value.datas.size(), 1) << "Internal error, maybe model input num not 1";
     // batched frame is less than batchsize, feed some fake data to resize convert operator.
     for (size_t bidx = finfos.size(); bidx < batchsize_; ++bidx) {
@@ -111,6 +125,7 @@ std::vector<std::shared_ptr<InferTask>> InferBatchingDoneStage::BatchingDone(con
     QueuingTicket mor_ticket = mlu_output_res_ticket;
     IOResValue mlu_input_value = this->mlu_input_res_->WaitResourceByTicket(&mir_ticket);
     IOResValue mlu_output_value = this->mlu_output_res_->WaitResourceByTicket(&mor_ticket);
+    CNS_TRACE_SCOPE("infer", "infer");
     this->easyinfer_->Run(mlu_input_value.ptrs, mlu_output_value.ptrs);
     this->mlu_input_res_->DeallingDone();
     this->mlu_output_res_->DeallingDone();
@@ -130,11 +145,22 @@ std::vector<std::shared_ptr<InferTask>> D2HBatchingDoneStage::BatchingDone(const
     QueuingTicket cor_ticket = cpu_output_res_ticket;
     IOResValue mlu_output_value = this->mlu_output_res_->WaitResourceByTicket(&mor_ticket);
     IOResValue cpu_output_value = this->cpu_output_res_->WaitResourceByTicket(&cor_ticket);
+    CNS_TRACE_SCOPE("infer", "d2h");
+#ifdef CNS_HOST_DEVICE
+    for (size_t output_idx = 0; output_idx < cpu_output_value.datas.size(); ++output_idx) {
+      size_t bytes = cpu_output_value.datas[output_idx].batch_offset * this->batchsize_;
+      if (!DevMemcpy(cpu_output_value.ptrs[output_idx], mlu_output_value.ptrs[output_idx], bytes,
+                     DEV_MEMCPY_DEV2HOST)) {
+        throw CnstreamError("memcpy d2h failed.");
+      }
+    }
+#elif CNS_MLU100
     edk::MluMemoryOp mem_op;
     mem_op.SetLoader(this->model_);
-#ifdef CNS_MLU100
     mem_op.MemcpyOutputD2H(cpu_output_value.ptrs, mlu_output_value.ptrs, this->batchsize_);
 #elif CNS_MLU270
+    edk::MluMemoryOp mem_op;
+    mem_op.SetLoader(this->model_);
     mem_op.MemcpyOutputD2H(cpu_output_value.ptrs, mlu_output_value.ptrs, 1);
 #endif
     this->mlu_output_res_->DeallingDone();
@@ -158,6 +184,7 @@ std::vector<std::shared_ptr<InferTask>> PostprocessingBatchingDoneStage::Batchin
     InferTaskSptr task = std::make_shared<InferTask>([cpu_output_res_ticket, this, finfo, bidx]() -> int {
       QueuingTicket cor_ticket = cpu_output_res_ticket;
       IOResValue cpu_output_value = this->cpu_output_res_->WaitResourceByTicket(&cor_ticket);
+      CNS_TRACE_SCOPE_ARG("infer", "postproc", finfo.first->frame.frame_id);
       std::vector<float*> net_outputs;
       for (size_t output_idx = 0; output_idx < cpu_output_value.datas.size(); ++output_idx) {
         net_outputs.push_back(reinterpret_cast<float*>(cpu_output_value.datas[output_idx].Offset(bidx)));
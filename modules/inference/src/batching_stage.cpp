@@ -19,12 +19,13 @@
  *************************************************************************/
 
 #include "batching_stage.hpp"
-#include <cnrt.h>
 #include <easyinfer/model_loader.h>
 #include <glog/logging.h>
 #include <memory>
 #include <vector>
+#include "cnstream_devmem.hpp"
 #include "cnstream_frame.hpp"
+#include "cnstream_trace.hpp"
 #include "infer_resource.hpp"
 #include "infer_task.hpp"
 #include "preproc.hpp"
@@ -45,6 +46,7 @@ std::shared_ptr<InferTask> IOBatchingStage::Batching(std::shared_ptr<CNFrameInfo
   std::shared_ptr<InferTask> task = std::make_shared<InferTask>([this, ticket, finfo, bidx]() -> int {
     QueuingTicket t = ticket;
     IOResValue value = this->output_res_->WaitResourceByTicket(&t);
+    CNS_TRACE_SCOPE_ARG("infer", "preproc", finfo->frame.frame_id);
     this->ProcessOneFrame(finfo, bidx, value);
     this->output_res_->DeallingDone();
     return 0;
@@ -82,14 +84,14 @@ void YUVSplitBatchingStage::ProcessOneFrame(std::shared_ptr<CNFrameInfo> finfo,
   // copy y plane
   void* dst_y = value.datas[0].Offset(batch_idx);
   void* src_y = finfo->frame.data[0]->GetMutableMluData();
-  cnrtRet_t ret = cnrtMemcpy(dst_y, src_y, finfo->frame.GetPlaneBytes(0), CNRT_MEM_TRANS_DIR_DEV2DEV);
-  CHECK_EQ(ret, CNRT_RET_SUCCESS) << "memcpy d2d failed. dst, src, size:" << dst_y << ", " << src_y << ", "
-                                  << finfo->frame.GetPlaneBytes(0);
+  bool ret = DevMemcpy(dst_y, src_y, finfo->frame.GetPlaneBytes(0), DEV_MEMCPY_DEV2DEV);
+  CHECK(ret) << "memcpy d2d failed. dst, src, size:" << dst_y << ", " << src_y << ", "
+             << finfo->frame.GetPlaneBytes(0);
   void* dst_uv = value.datas[1].Offset(batch_idx);
   void* src_uv = finfo->frame.data[1]->GetMutableMluData();
-  ret = cnrtMemcpy(dst_uv, src_uv, finfo->frame.GetPlaneBytes(1), CNRT_MEM_TRANS_DIR_DEV2DEV);
-  CHECK_EQ(ret, CNRT_RET_SUCCESS) << "memcpy d2d failed. dst, src, size:" << dst_uv << ", " << src_uv << ", "
-                                  << finfo->frame.GetPlaneBytes(1);
+  ret = DevMemcpy(dst_uv, src_uv, finfo->frame.GetPlaneBytes(1), DEV_MEMCPY_DEV2DEV);
+  CHECK(ret) << "memcpy d2d failed. dst, src, size:" << dst_uv << ", " << src_uv << ", "
+             << finfo->frame.GetPlaneBytes(1);
 }
 
 YUVPackedBatchingStage::YUVPackedBatchingStage(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize,
@@ -104,14 +106,14 @@ void YUVPackedBatchingStage::ProcessOneFrame(std::shared_ptr<CNFrameInfo> finfo,
   // copy y plane
   void* dst_y = value.datas[0].Offset(batch_idx);
   void* src_y = finfo->frame.data[0]->GetMutableMluData();
-  cnrtRet_t ret = cnrtMemcpy(dst_y, src_y, finfo->frame.GetPlaneBytes(0), CNRT_MEM_TRANS_DIR_DEV2DEV);
-  CHECK_EQ(ret, CNRT_RET_SUCCESS) << "memcpy d2d failed. dst, src, size:" << dst_y << ", " << src_y << ", "
-                                  << finfo->frame.GetPlaneBytes(0);
+  bool ret = DevMemcpy(dst_y, src_y, finfo->frame.GetPlaneBytes(0), DEV_MEMCPY_DEV2DEV);
+  CHECK(ret) << "memcpy d2d failed. dst, src, size:" << dst_y << ", " << src_y << ", "
+             << finfo->frame.GetPlaneBytes(0);
   void* dst_uv = reinterpret_cast<void*>(reinterpret_cast<char*>(dst_y) + value.datas[0].shape.hw() / 3 * 2);
   void* src_uv = finfo->frame.data[1]->GetMutableMluData();
-  ret = cnrtMemcpy(dst_uv, src_uv, finfo->frame.GetPlaneBytes(1), CNRT_MEM_TRANS_DIR_DEV2DEV);
-  CHECK_EQ(ret, CNRT_RET_SUCCESS) << "memcpy d2d failed. dst, src, size, y offset:" << dst_uv << ", " << src_uv << ", "
-                                  << finfo->frame.GetPlaneBytes(1) << ", " << value.datas[0].shape.hw() / 3 * 2;
+  ret = DevMemcpy(dst_uv, src_uv, finfo->frame.GetPlaneBytes(1), DEV_MEMCPY_DEV2DEV);
+  CHECK(ret) << "memcpy d2d failed. dst, src, size, y offset:" << dst_uv << ", " << src_uv << ", "
+             << finfo->frame.GetPlaneBytes(1) << ", " << value.datas[0].shape.hw() / 3 * 2;
 }
 
 ResizeConvertBatchingStage::ResizeConvertBatchingStage(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize,
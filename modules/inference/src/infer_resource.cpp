@@ -23,6 +23,7 @@
 #include <glog/logging.h>
 #include <memory>
 #include <string>
+#include "cnstream_devmem.hpp"
 #include "cnstream_error.hpp"
 #include "inferencer.hpp"
 
@@ -108,7 +109,14 @@ IOResValue MluInputResource::Allocate(std::shared_ptr<edk::ModelLoader> model, u
   mem_op.SetLoader(model);
   IOResValue value;
   value.datas.resize(input_num);
-#ifdef CNS_MLU100
+#ifdef CNS_HOST_DEVICE
+  value.ptrs = new void*[input_num];
+  for (int input_idx = 0; input_idx < input_num; ++input_idx) {
+    size_t bytes = EmulatedDevBatchBytes(model->InputShapes()[input_idx], model->GetInputDataBatchAlignSize(input_idx));
+    value.ptrs[input_idx] = DevMalloc(bytes * batchsize);
+    if (!value.ptrs[input_idx]) throw IOResourceError("Malloc mlu input failed, size: " + std::to_string(bytes));
+  }
+#elif CNS_MLU100
   value.ptrs = mem_op.AllocMluInput(batchsize);
 #elif CNS_MLU270
   value.ptrs = mem_op.AllocMluInput(1);
@@ -116,7 +124,12 @@ IOResValue MluInputResource::Allocate(std::shared_ptr<edk::ModelLoader> model, u
   for (int input_idx = 0; input_idx < input_num; ++input_idx) {
     value.datas[input_idx].ptr = value.ptrs[input_idx];
     value.datas[input_idx].shape = model->InputShapes()[input_idx];
+#ifdef CNS_HOST_DEVICE
+    // same stride as the cpu input, so h2d and d2h copy the whole batch at once
+    value.datas[input_idx].batch_offset = static_cast<size_t>(value.datas[input_idx].shape.hwc()) * sizeof(float);
+#else
     value.datas[input_idx].batch_offset = model->GetInputDataBatchAlignSize(input_idx);
+#endif
     value.datas[input_idx].batchsize = batchsize;
   }
   return value;
@@ -125,9 +138,16 @@ IOResValue MluInputResource::Allocate(std::shared_ptr<edk::ModelLoader> model, u
 void MluInputResource::Deallocate(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize,
                                   const IOResValue& value) {
   int input_num = model->InputNum();
+#ifdef CNS_HOST_DEVICE
+  if (value.ptrs) {
+    for (int input_idx = 0; input_idx < input_num; ++input_idx) DevFree(value.ptrs[input_idx]);
+    delete[] value.ptrs;
+  }
+#else
   edk::MluMemoryOp mem_op;
   mem_op.SetLoader(model);
   if (value.ptrs) mem_op.FreeArrayMlu(value.ptrs, input_num);
+#endif
 }
 
 MluOutputResource::MluOutputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize)
@@ -141,7 +161,15 @@ IOResValue MluOutputResource::Allocate(std::shared_ptr<edk::ModelLoader> model,
   mem_op.SetLoader(model);
   IOResValue value;
   value.datas.resize(output_num);
-#ifdef CNS_MLU100
+#ifdef CNS_HOST_DEVICE
+  value.ptrs = new void*[output_num];
+  for (int output_idx = 0; output_idx < output_num; ++output_idx) {
+    size_t bytes =
+        EmulatedDevBatchBytes(model->OutputShapes()[output_idx], model->GetOutputDataBatchAlignSize(output_idx));
+    value.ptrs[output_idx] = DevMalloc(bytes * batchsize);
+    if (!value.ptrs[output_idx]) throw IOResourceError("Malloc mlu output failed, size: " + std::to_string(bytes));
+  }
+#elif CNS_MLU100
   value.ptrs = mem_op.AllocMluOutput(batchsize);
 #elif CNS_MLU270
   value.ptrs = mem_op.AllocMluOutput(1);
@@ -149,7 +177,12 @@ IOResValue MluOutputResource::Allocate(std::shared_ptr<edk::ModelLoader> model,
   for (int output_idx = 0; output_idx < output_num; ++output_idx) {
     value.datas[output_idx].ptr = value.ptrs[output_idx];
     value.datas[output_idx].shape = model->OutputShapes()[output_idx];
+#ifdef CNS_HOST_DEVICE
+    // same stride as the cpu output, so h2d and d2h copy the whole batch at once
+    value.datas[output_idx].batch_offset = static_cast<size_t>(value.datas[output_idx].shape.hwc()) * sizeof(float);
+#else
     value.datas[output_idx].batch_offset = model->GetOutputDataBatchAlignSize(output_idx);
+#endif
     value.datas[output_idx].batchsize = batchsize;
   }
   return value;
@@ -157,10 +190,17 @@ IOResValue MluOutputResource::Allocate(std::shared_ptr<edk::ModelLoader> model,
 
 void MluOutputResource::Deallocate(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize,
                                    const IOResValue& value) {
+#ifdef CNS_HOST_DEVICE
+  if (value.ptrs) {
+    for (size_t output_idx = 0; output_idx < value.datas.size(); ++output_idx) DevFree(value.ptrs[output_idx]);
+    delete[] value.ptrs;
+  }
+#else
   int input_num = model->InputNum();
   edk::MluMemoryOp mem_op;
   mem_op.SetLoader(model);
   if (value.ptrs) mem_op.FreeArrayMlu(value.ptrs, input_num);
+#endif
 }
 
 RCOpResource::RCOpResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize)
@@ -25,6 +25,7 @@
 #include <easyinfer/mlu_memory_op.h>
 #include <easyinfer/model_loader.h>
 
+#include <algorithm>
 #include <memory>
 #include <vector>
 
@@ -66,6 +67,17 @@ struct IOResValue {
   std::vector<OneData> datas;
 };  // struct IOResValue
 
+#ifdef CNS_HOST_DEVICE
+/*
+  The host-emulated device keeps model inputs and outputs in the cpu layout: items are batch_offset =
+  hwc * sizeof(float) apart on both sides. The buffer still reserves the larger of the cpu size and the mlu size
+  per item, so a writer that uses the mlu layout stays in bounds.
+ */
+inline size_t EmulatedDevBatchBytes(const edk::Shape& shape, int64_t mlu_batch_align_size) {
+  return std::max(static_cast<size_t>(shape.hwc() * sizeof(float)), static_cast<size_t>(mlu_batch_align_size));
+}
+#endif
+
 CNSTREAM_REGISTER_EXCEPTION(IOResource);
 class IOResource : public InferResource<IOResValue> {
  public:
@@ -159,6 +159,7 @@ bool Inferencer::Open(ModuleParamSet paramSet) {
     }
     LOG(INFO) << "[Inferencer] With CPU preproc set";
   }
+  SetDataAccess(d_ptr_->pre_proc_ ? MODULE_DATA_ACCESS_CPU : MODULE_DATA_ACCESS_MLU);
 
   d_ptr_->device_id_ = 0;
   if (paramSet.find("device_id") != paramSet.end()) {
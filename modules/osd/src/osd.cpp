@@ -189,6 +189,7 @@ Osd::Osd(const std::string& name) : Module(name) {
   param_register_.SetModuleDesc("Osd is a module for draw objects on image,output is bgr24 images.");
   param_register_.Register("label_path", "The label path.");
   param_register_.Register("chinese_label_flag", "Whether use chinese label.");
+  SetDataAccess(MODULE_DATA_ACCESS_CPU);
 }
 
 Osd::~Osd() { Close(); }
@@ -243,6 +244,7 @@ bool Osd::Open(cnstream::ModuleParamSet paramSet) {
   // and the unordered map will not be rehashed after, so, it will not cause thread safe issue, when multi threads write
   // the unordered map at the same time without locks
   osd_ctxs_.rehash(GetMaxStreamNumber());
+  classification_key_ = RegisterMetaKey<CNInferAttr>("classification");
   return true;
 }
 
@@ -260,6 +262,20 @@ void Osd::Close() {
 #define CLIP(x) x < 0 ? 0 : (x > 1 ? 1 : x)
 static thread_local auto font_ = static_cast<std::shared_ptr<CnFont>>(new CnFont("/usr/include/wqy-zenhei.ttc"));
 
+static DetectObject ToDetectObject(int label, float score, const CNInferBoundingBox& bbox, int track_id) {
+  DetectObject obj;
+  obj.label = label;
+  obj.score = score;
+  obj.x = CLIP(bbox.x);
+  obj.y = CLIP(bbox.y);
+  obj.width = CLIP(bbox.w);
+  obj.height = CLIP(bbox.h);
+  obj.width = (obj.x + obj.width > 1) ? (1 - obj.x) : obj.width;
+  obj.height = (obj.y + obj.height > 1) ? (1 - obj.y) : obj.height;
+  obj.track_id = track_id;
+  return obj;
+}
+
 int Osd::Process(std::shared_ptr<CNFrameInfo> data) {
   OsdContext* ctx = GetOsdContext(data);
   if (ctx == nullptr) {
@@ -271,24 +287,26 @@ int Osd::Process(std::shared_ptr<CNFrameInfo> data) {
     ctx->processer_ = new CnOsd(1, 1, labels_);
   }
 
+  const CNDetections& dets = data->dets;
   std::vector<DetectObject> objs;
+  objs.reserve(data->objs.size() + dets.Size() + 1);
+  CNInferAttr classification;
+  if (data->meta.Get(classification_key_, &classification)) {
+    objs.push_back(ToDetectObject(classification.value, classification.score, CNInferBoundingBox{0, 0, 0, 0}, -1));
+  }
   for (const auto& it : data->objs) {
-    DetectObject obj;
-    obj.label = it->id.empty() ? -1 : std::stoi(it->id);
-    obj.score = it->score;
-    obj.x = CLIP(it->bbox.x);
-    obj.y = CLIP(it->bbox.y);
-    obj.width = CLIP(it->bbox.w);
-    obj.height = CLIP(it->bbox.h);
-    obj.width = (obj.x + obj.width > 1) ? (1 - obj.x) : obj.width;
-    obj.height = (obj.y + obj.height > 1) ? (1 - obj.y) : obj.height;
-    obj.track_id = it->track_id.empty() ? -1 : std::stoi(it->track_id);
-    objs.push_back(obj);
+    objs.push_back(ToDetectObject(it->id.empty() ? -1 : std::stoi(it->id), it->score, it->bbox,
+                                  it->track_id.empty() ? -1 : std::stoi(it->track_id)));
+  }
+  for (size_t i = 0; i < dets.Size(); ++i) {
+    objs.push_back(ToDetectObject(dets.ClassIds()[i], dets.Scores()[i], dets.BBoxes()[i], dets.TrackIds()[i]));
   }
+  // drawn on a copy if another branch of the pipeline still reads the frame
+  cv::Mat* image = data->frame.MutableImageBGR();
   if (!chinese_label_flag_) {
-    ctx->processer_->DrawLabel(*data->frame.ImageBGR(), objs);
+    ctx->processer_->DrawLabel(*image, objs);
   } else {
-    ctx->processer_->DrawLabel(*data->frame.ImageBGR(), objs, font_.get());
+    ctx->processer_->DrawLabel(*image, objs, font_.get());
   }
   return 0;
 }
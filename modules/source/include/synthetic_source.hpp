@@ -0,0 +1,144 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_SYNTHETIC_SOURCE_HPP_
+#define MODULES_SYNTHETIC_SOURCE_HPP_
+/**
+ *  \file synthetic_source.hpp
+ *
+ *  This file contains a declaration of class SyntheticSource and struct SyntheticSourceParam
+ */
+
+#include <memory>
+#include <string>
+
+#include "cnstream_frame.hpp"
+#include "cnstream_pipeline.hpp"
+#include "cnstream_source.hpp"
+
+namespace cnstream {
+
+/**
+ * @brief a structure for private usage
+ */
+struct SyntheticSourceParam {
+  int width = 1920;                                ///< frame width
+  int height = 1080;                               ///< frame height
+  CNDataFormat fmt = CN_PIXEL_FORMAT_YUV420_NV12;  ///< NV12, NV21 or BGR24
+  uint64_t frame_num = 0;                          ///< frames of each stream before EOS, 0 for endless
+  uint32_t object_num = 0;                         ///< fake detections added to each frame
+  uint32_t buffer_num = 8;                         ///< images pre-allocated for each stream
+};
+
+/**
+ * @brief Source module generating frames on CPU, without any demuxer or decoder.
+ *
+ * The images of each stream are allocated and filled once when the stream is added, the frames sent
+ * reference them without copying. A stream waits when all of its images are held by the frames in the
+ * pipeline. It drives the pipeline overhead benchmarks and stress tests, where decoding would hide the
+ * cost of the pipeline.
+ */
+class SyntheticSource : public SourceModule, public ModuleCreator<SyntheticSource> {
+ public:
+  /**
+   * @brief Construct SyntheticSource object with a given moduleName
+   * @param
+   * 	moduleName[in]:defined module name
+   */
+  explicit SyntheticSource(const std::string &moduleName);
+  /**
+   * @brief Deconstruct SyntheticSource object
+   *
+   */
+  ~SyntheticSource();
+
+  /**
+   * @brief Called by pipeline when pipeline start.
+   * @param
+   *   paramSet[in]:  prameterSet set by user, supported paramSet as below,
+   *      "width": optional, frame width, 1920 by default
+   *      "height": optional, frame height, 1080 by default
+   *      "pixel_format": optional, "nv12", "nv21" or "bgr", "nv12" by default
+   *      "frame_num": optional, frames of each stream before EOS, 0 (endless) by default
+   *      "object_num": optional, fake detections added to each frame, 0 by default
+   *      "buffer_num": optional, images pre-allocated for each stream, 8 by default
+   * @return
+   *    true if paramSet are supported and valid, othersize false
+   */
+  bool Open(ModuleParamSet paramSet) override;
+  /**
+   * @brief Called by pipeline when pipeline stop.
+   */
+  void Close() override;
+
+  /**
+   * @brief Check ParamSet for a module.
+   *
+   * @param paramSet Parameters for this module.
+   *
+   * @return Returns true if this API run successfully. Otherwise, returns false.
+   */
+  bool CheckParamSet(ModuleParamSet paramSet) override;
+
+ public:
+  /**
+   * @brief Add streams named "<prefix><index>", should be called after pipeline starts.
+   * @param
+   *   stream_num[in]: number of streams to add.
+   *   framerate[in]: frames per second of each stream, 0 for as fast as the pipeline takes them.
+   *   loop[in]: whether to go on after "frame_num" frames instead of sending EOS.
+   *   prefix[in]: prefix of the stream ids.
+   * @return
+   *    0: success,
+   *   -1: error occurs, the streams added before the error are kept
+   */
+  int AddStreams(uint32_t stream_num, int framerate, bool loop = false, const std::string &prefix = "synthetic_");
+
+  /**
+   * @brief Create the handler of one stream, called by AddVideoSource.
+   * @param
+   *   stream_id[in]: unique stream identifier.
+   *   filename[in]: ignored, there is no input.
+   *   framerate[in]: frames per second, 0 for as fast as the pipeline takes them.
+   *   loop[in]: whether to go on after "frame_num" frames instead of sending EOS.
+   * @return
+   *    source handler instance
+   */
+  std::shared_ptr<cnstream::SourceHandler> CreateSource(const std::string &stream_id, const std::string &filename,
+                                                        int framerate, bool loop = false);
+
+ public:
+  /**
+   * @brief Get module parameters, should be called after Open() invoked.
+   */
+  SyntheticSourceParam GetSourceParam() const { return param_; }
+
+  /**
+   * @brief Whether the module is added to a pipeline which is running.
+   */
+  bool IsPipelineRunning() const { return container_ && container_->IsRunning(); }
+
+ private:
+  SyntheticSourceParam param_;
+};  // class SyntheticSource
+
+}  // namespace cnstream
+
+#endif  // MODULES_SYNTHETIC_SOURCE_HPP_
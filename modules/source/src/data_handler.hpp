@@ -48,7 +48,7 @@ class DataHandler : public SourceHandler {
   void SendFlowEos() {
     if (eos_sent_) return;
     if (send_flow_eos_.load()) {
-      auto data = CNFrameInfo::Create(stream_id_, true);
+      auto data = CNFrameInfo::Create(stream_handle_, true);
       if (!data) {
         throw std::string("SendFlowEos: Create CNFrameInfo failed while received eos. stream id is ") + stream_id_;
       }
@@ -59,6 +59,8 @@ class DataHandler : public SourceHandler {
     }
   }
   bool GetDemuxEos() const { return demux_eos_.load() ? true : false; }
+  /* false once Close() is called, the decoders waiting for a frame give up */
+  bool IsRunning() const { return running_.load() ? true : false; }
   bool ReuseCNDecBuf() const { return param_.reuse_cndec_buf; }
   size_t Output_w() { return param_.output_w; }
   size_t Output_h() { return param_.output_h; }
@@ -18,13 +18,15 @@
  * THE SOFTWARE.
  *************************************************************************/
 #include "ffmpeg_decoder.hpp"
-#include <cnrt.h>
 #include <glog/logging.h>
 #include <future>
 #include <memory>
 #include <sstream>
 #include <thread>
 #include <utility>
+#include "cnstream_devmem.hpp"
+#include "cnstream_trace.hpp"
+
 namespace cnstream {
 
 #ifdef __GNUC__
@@ -149,6 +151,7 @@ bool FFmpegMluDecoder::Process(AVPacket *pkt, bool eos) {
     } else {
       packet.length = 0;
     }
+    CNS_TRACE_SCOPE("decoder", "decode");
     if (instance_->SendData(packet, eos)) {
       return true;
     } else {
@@ -162,16 +165,15 @@ bool FFmpegMluDecoder::Process(AVPacket *pkt, bool eos) {
 }
 
 int FFmpegMluDecoder::ProcessFrame(const edk::CnFrame &frame, bool *reused) {
+  CNS_TRACE_SCOPE("decoder", "output");
   *reused = false;
 
-  // FIXME, remove infinite-loop
-  std::shared_ptr<CNFrameInfo> data;
-  while (1) {
-    data = CNFrameInfo::Create(stream_id_);
-    if (data.get() != nullptr) break;
-    if (stream_id_.empty()) return -1;
-    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  std::shared_ptr<CNFrameInfo> data = CNFrameInfo::WaitAndCreate(stream_handle_, std::chrono::milliseconds(100));
+  // waits for an in-flight credit of the stream, gives up when the stream is closed
+  while (nullptr == data && INVALID_STREAM_HANDLE != stream_handle_ && handler_.IsRunning()) {
+    data = CNFrameInfo::WaitAndCreate(stream_handle_, std::chrono::milliseconds(100));
   }
+  if (nullptr == data) return -1;
   data->channel_idx = stream_idx_;
   data->frame.frame_id = frame_id_++;
   data->frame.timestamp = frame.pts;
@@ -307,7 +309,11 @@ bool FFmpegCpuDecoder::Process(AVPacket *pkt, bool eos) {
     return false;
   }
   int got_frame = 0;
-  int ret = avcodec_decode_video2(instance_, av_frame_, &got_frame, pkt);
+  int ret;
+  {
+    CNS_TRACE_SCOPE("decoder", "decode");
+    ret = avcodec_decode_video2(instance_, av_frame_, &got_frame, pkt);
+  }
   if (ret < 0) {
     LOG(ERROR) << "avcodec_decode_video2 failed";
     return false;
@@ -322,17 +328,14 @@ bool FFmpegCpuDecoder::ProcessFrame(AVFrame *frame) {
   if (frame_count_++ % interval_ != 0) {
     return true;  // discard frames
   }
+  CNS_TRACE_SCOPE("decoder", "output");
 
-  // FIXME, remove infinite-loop
-  std::shared_ptr<CNFrameInfo> data;
-  while (1) {
-    data = CNFrameInfo::Create(stream_id_);
-    if (data != nullptr) {
-      break;
-    }
-    if (stream_id_.empty()) return false;
-    std::this_thread::sleep_for(std::chrono::microseconds(5));
+  std::shared_ptr<CNFrameInfo> data = CNFrameInfo::WaitAndCreate(stream_handle_, std::chrono::milliseconds(100));
+  // waits for an in-flight credit of the stream, gives up when the stream is closed
+  while (nullptr == data && INVALID_STREAM_HANDLE != stream_handle_ && handler_.IsRunning()) {
+    data = CNFrameInfo::WaitAndCreate(stream_handle_, std::chrono::milliseconds(100));
   }
+  if (nullptr == data) return false;
   data->channel_idx = stream_idx_;
 
   if (instance_->pix_fmt != AV_PIX_FMT_YUV420P && instance_->pix_fmt != AV_PIX_FMT_YUVJ420P) {
@@ -367,18 +370,21 @@ bool FFmpegCpuDecoder::ProcessFrame(AVFrame *frame) {
       *vu++ = *v++;
       *vu++ = *u++;
     }
-    CALL_CNRT_BY_CONTEXT(cnrtMalloc(&data->frame.mlu_data, y_size_ * 3 / 2), dev_ctx_.dev_id, dev_ctx_.ddr_channel);
+    data->frame.mlu_data = DevMalloc(y_size_ * 3 / 2, dev_ctx_.dev_id, dev_ctx_.ddr_channel);
     if (nullptr == data->frame.mlu_data) {
       LOG(ERROR) << "FFmpegCpuDecoder: Failed to alloc mlu memory";
       return false;
     }
-    CALL_CNRT_BY_CONTEXT(cnrtMemcpy(data->frame.mlu_data, nv21_data_, y_size_ * 3 / 2, CNRT_MEM_TRANS_DIR_HOST2DEV),
-                         dev_ctx_.dev_id, dev_ctx_.ddr_channel);
+    if (!DevMemcpy(data->frame.mlu_data, nv21_data_, y_size_ * 3 / 2, DEV_MEMCPY_HOST2DEV, dev_ctx_.dev_id,
+                   dev_ctx_.ddr_channel)) {
+      LOG(ERROR) << "FFmpegCpuDecoder: Failed to copy frame to mlu";
+      return false;
+    }
 
     auto t = reinterpret_cast<uint8_t *>(data->frame.mlu_data);
     for (int i = 0; i < data->frame.GetPlanes(); ++i) {
       size_t plane_size = data->frame.GetPlaneBytes(i);
-      data->frame.data[i].reset(new CNSyncedMemory(plane_size, dev_ctx_.dev_id, dev_ctx_.ddr_channel));
+      data->frame.data[i] = CNSyncedMemory::Create(plane_size, dev_ctx_.dev_id, dev_ctx_.ddr_channel);
       data->frame.data[i]->SetMluData(t);
       t += plane_size;
     }
@@ -399,7 +405,7 @@ bool FFmpegCpuDecoder::ProcessFrame(AVFrame *frame) {
     auto t = reinterpret_cast<uint8_t *>(data->frame.cpu_data);
     for (int i = 0; i < data->frame.GetPlanes(); ++i) {
       size_t plane_size = data->frame.GetPlaneBytes(i);
-      data->frame.data[i].reset(new CNSyncedMemory(plane_size));
+      data->frame.data[i] = CNSyncedMemory::Create(plane_size);
       data->frame.data[i]->SetCpuData(t);
       t += plane_size;
     }
@@ -50,6 +50,7 @@ class FFmpegDecoder {
  public:
   explicit FFmpegDecoder(DataHandler &handler) : handler_(handler) {
     stream_id_ = handler_.GetStreamId();
+    stream_handle_ = handler_.GetStreamHandle();
     stream_idx_ = handler_.GetStreamIndex();
     dev_ctx_ = handler_.GetDevContext();
   }
@@ -65,6 +66,7 @@ class FFmpegDecoder {
 
  protected:
   std::string stream_id_;
+  uint32_t stream_handle_;
   DataHandler &handler_;
 
   uint32_t stream_idx_;
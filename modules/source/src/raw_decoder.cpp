@@ -25,6 +25,9 @@
 #include <sstream>
 #include <thread>
 #include <utility>
+
+#include "cnstream_trace.hpp"
+
 namespace cnstream {
 
 #ifdef __GNUC__
@@ -141,6 +144,7 @@ bool RawMluDecoder::Process(RawPacket *pkt, bool eos) {
     } else {
       packet.length = 0;
     }
+    CNS_TRACE_SCOPE("decoder", "decode");
     if (instance_->SendData(packet, eos)) {
       return true;
     }
@@ -153,18 +157,15 @@ bool RawMluDecoder::Process(RawPacket *pkt, bool eos) {
 }
 
 int RawMluDecoder::ProcessFrame(const edk::CnFrame &frame, bool *reused) {
+  CNS_TRACE_SCOPE("decoder", "output");
   *reused = false;
 
-  // FIXME, remove infinite-loop
-  std::shared_ptr<CNFrameInfo> data;
-  while (1) {
-    data = CNFrameInfo::Create(stream_id_);
-    if (data.get() != nullptr) {
-      break;
-    }
-    if (stream_id_.empty()) return -1;
-    std::this_thread::sleep_for(std::chrono::microseconds(5));
+  std::shared_ptr<CNFrameInfo> data = CNFrameInfo::WaitAndCreate(stream_handle_, std::chrono::milliseconds(100));
+  // waits for an in-flight credit of the stream, gives up when the stream is closed
+  while (nullptr == data && INVALID_STREAM_HANDLE != stream_handle_ && handler_.IsRunning()) {
+    data = CNFrameInfo::WaitAndCreate(stream_handle_, std::chrono::milliseconds(100));
   }
+  if (nullptr == data) return -1;
   data->channel_idx = stream_idx_;
   data->frame.frame_id = frame_id_++;
   data->frame.timestamp = frame.pts;
@@ -54,6 +54,7 @@ class RawDecoder {
  public:
   explicit RawDecoder(DataHandler &handler) : handler_(handler) {
     stream_id_ = handler_.GetStreamId();
+    stream_handle_ = handler_.GetStreamHandle();
     stream_idx_ = handler_.GetStreamIndex();
     dev_ctx_ = handler_.GetDevContext();
   }
@@ -69,6 +70,7 @@ class RawDecoder {
 
  protected:
   std::string stream_id_;
+  uint32_t stream_handle_;
   DataHandler &handler_;
 
   uint32_t stream_idx_;
@@ -0,0 +1,315 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+#include "synthetic_source.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fr_controller.hpp"
+#include "glog/logging.h"
+
+namespace cnstream {
+
+namespace {
+
+/* the images of one stream, kept alive by the frames referencing them */
+class ImagePool {
+ public:
+  explicit ImagePool(const SyntheticSourceParam &param) {
+    size_t pixels = static_cast<size_t>(param.width) * param.height;
+    if (CN_PIXEL_FORMAT_BGR24 == param.fmt) {
+      plane_bytes_ = {pixels * 3};
+    } else {
+      plane_bytes_ = {pixels, pixels / 2};
+    }
+    size_t row_bytes = plane_bytes_[0] / param.height;
+    for (uint32_t idx = 0; idx < param.buffer_num; ++idx) {
+      void *image = nullptr;
+      CNStreamMallocHost(&image, plane_bytes_[0] + (plane_bytes_.size() > 1 ? plane_bytes_[1] : 0));
+      LOG_IF(FATAL, nullptr == image) << "SyntheticSource: failed to alloc cpu memory";
+      /* horizontal stripes, shifted for each image so that the frames differ */
+      uint8_t *p = reinterpret_cast<uint8_t *>(image);
+      for (int y = 0; y < param.height; ++y, p += row_bytes) memset(p, (y + idx * 32) & 0xff, row_bytes);
+      if (plane_bytes_.size() > 1) memset(p, 128, plane_bytes_[1]);
+      images_.push_back(image);
+      free_.push_back(idx);
+    }
+  }
+  ~ImagePool() {
+    for (auto image : images_) CNStreamFreeHost(image);
+  }
+
+  /* returns the index of a free image, -1 if none is released within timeout */
+  int Acquire(const std::chrono::milliseconds &timeout) {
+    std::unique_lock<std::mutex> lk(mutex_);
+    if (!cond_.wait_for(lk, timeout, [this] { return !free_.empty(); })) return -1;
+    int idx = free_.back();
+    free_.pop_back();
+    return idx;
+  }
+  void Release(int idx) {
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      free_.push_back(idx);
+    }
+    cond_.notify_one();
+  }
+  void *Image(int idx) const { return images_[idx]; }
+  const std::vector<size_t> &PlaneBytes() const { return plane_bytes_; }
+
+ private:
+  std::vector<void *> images_;
+  std::vector<size_t> plane_bytes_;
+  std::vector<int> free_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  DISABLE_COPY_AND_ASSIGN(ImagePool);
+};
+
+/* gives the image back to the pool when the frame is recycled */
+class ImageDeallocator : public IDataDeallocator {
+ public:
+  ImageDeallocator(const std::shared_ptr<ImagePool> &pool, int idx) : pool_(pool), idx_(idx) {}
+  ~ImageDeallocator() { pool_->Release(idx_); }
+
+ private:
+  std::shared_ptr<ImagePool> pool_;
+  int idx_;
+};
+
+class SyntheticHandler : public SourceHandler {
+ public:
+  explicit SyntheticHandler(SyntheticSource *module, const std::string &stream_id, int frame_rate, bool loop)
+      : SourceHandler(module, stream_id, frame_rate, loop) {}
+  ~SyntheticHandler() { Close(); }
+
+  bool Open() override {
+    if (stream_index_ == INVALID_STREAM_IDX) {
+      LOG(ERROR) << "invalid chn_idx(stream_idx)";
+      return false;
+    }
+    param_ = dynamic_cast<SyntheticSource *>(module_)->GetSourceParam();
+    pool_ = std::make_shared<ImagePool>(param_);
+    running_.store(true);
+    thread_ = std::thread(&SyntheticHandler::Loop, this);
+    return true;
+  }
+  void Close() override {
+    running_.store(false);
+    if (thread_.joinable()) thread_.join();
+  }
+
+ private:
+  void Loop() {
+    /* named like the module threads, with the stream index */
+    SetThreadName(GetModuleThreadName(module_->GetName(), stream_index_));
+    FrController controller(frame_rate_);
+    if (frame_rate_ > 0) controller.Start();
+    while (running_.load()) {
+      if (!loop_ && param_.frame_num && frame_id_ >= param_.frame_num) break;
+      /* a frame dropped by the memory budget is skipped, the stream ends only when it or the pipeline stops */
+      if (!SendFrame() && !dynamic_cast<SyntheticSource *>(module_)->IsPipelineRunning()) break;
+      if (frame_rate_ > 0) controller.Control();
+    }
+    SendEos();
+  }
+
+  bool SendFrame() {
+    std::shared_ptr<CNFrameInfo> data;
+    while (nullptr == data) {
+      if (!running_.load()) return false;
+      data = CNFrameInfo::WaitAndCreate(stream_handle_, std::chrono::milliseconds(100));
+    }
+    int idx = -1;
+    while (idx < 0) {
+      if (!running_.load()) return false;
+      idx = pool_->Acquire(std::chrono::milliseconds(100));
+    }
+    data->channel_idx = stream_index_;
+    CNDataFrame &frame = data->frame;
+    frame.ctx.dev_type = DevContext::CPU;
+    frame.ctx.dev_id = -1;
+    frame.fmt = param_.fmt;
+    frame.width = param_.width;
+    frame.height = param_.height;
+    frame.stride[0] = frame.stride[1] = param_.width;
+    /* no copy, the frame references the image until it is recycled */
+    frame.deAllocator_ = std::make_shared<ImageDeallocator>(pool_, idx);
+    uint8_t *t = reinterpret_cast<uint8_t *>(pool_->Image(idx));
+    for (int i = 0; i < frame.GetPlanes(); ++i) {
+      size_t plane_size = pool_->PlaneBytes()[i];
+      frame.ptr[i] = t;
+      frame.data[i] = CNSyncedMemory::Create(plane_size);
+      frame.data[i]->SetCpuData(t);
+      t += plane_size;
+    }
+    /* a grid of boxes drifting to the right */
+    data->dets.Reserve(param_.object_num);
+    for (uint32_t i = 0; i < param_.object_num; ++i) {
+      CNInferBoundingBox bbox;
+      bbox.x = 0.02f + 0.12f * (i % 8) + 0.002f * (frame_id_ % 10);
+      bbox.y = 0.02f + 0.12f * (i / 8 % 8);
+      bbox.w = 0.1f;
+      bbox.h = 0.1f;
+      data->dets.Add(bbox, 0.9f, i);
+    }
+    frame.frame_id = frame_id_;
+    frame.timestamp = frame_id_++;
+    return SendData(data);
+  }
+
+  void SendEos() {
+    auto data = CNFrameInfo::Create(stream_handle_, true);
+    if (!data) {
+      LOG(ERROR) << "SyntheticSource: failed to create the EOS frame of stream " << stream_id_;
+      return;
+    }
+    data->channel_idx = stream_index_;
+    SendData(data);
+  }
+
+  SyntheticSourceParam param_;
+  std::shared_ptr<ImagePool> pool_;
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+  uint64_t frame_id_ = 0;
+};
+
+bool ParseUint(ModuleParamSet &paramSet, const std::string &key, uint64_t *value) {  // NOLINT
+  if (paramSet.find(key) == paramSet.end()) return true;
+  std::stringstream ss(paramSet[key]);
+  int64_t v = -1;
+  ss >> v;
+  if (ss.fail() || !ss.eof() || v < 0) {
+    LOG(ERROR) << "[SyntheticSource] [" << key << "] " << paramSet[key] << " is not a valid number";
+    return false;
+  }
+  *value = v;
+  return true;
+}
+
+}  // namespace
+
+SyntheticSource::SyntheticSource(const std::string &name) : SourceModule(name) {
+  param_register_.SetModuleDesc("SyntheticSource is a module generating frames on CPU, for benchmarks.");
+  param_register_.Register("width", "Frame width, 1920 by default.");
+  param_register_.Register("height", "Frame height, 1080 by default.");
+  param_register_.Register("pixel_format", "Pixel format, must be nv12, nv21 or bgr. nv12 by default.");
+  param_register_.Register("frame_num", "Frames of each stream before EOS, 0 (endless) by default.");
+  param_register_.Register("object_num", "Fake detections added to each frame, 0 by default.");
+  param_register_.Register("buffer_num", "Images pre-allocated for each stream, 8 by default.");
+}
+
+SyntheticSource::~SyntheticSource() {}
+
+bool SyntheticSource::Open(ModuleParamSet paramSet) {
+  SyntheticSourceParam param;
+  if (paramSet.find("pixel_format") != paramSet.end()) {
+    std::string pixel_format = paramSet["pixel_format"];
+    if (pixel_format == "nv12") {
+      param.fmt = CN_PIXEL_FORMAT_YUV420_NV12;
+    } else if (pixel_format == "nv21") {
+      param.fmt = CN_PIXEL_FORMAT_YUV420_NV21;
+    } else if (pixel_format == "bgr") {
+      param.fmt = CN_PIXEL_FORMAT_BGR24;
+    } else {
+      LOG(ERROR) << "pixel_format " << pixel_format << " not supported";
+      return false;
+    }
+  }
+  uint64_t width = param.width, height = param.height, object_num = 0, buffer_num = param.buffer_num;
+  if (!ParseUint(paramSet, "width", &width) || !ParseUint(paramSet, "height", &height) ||
+      !ParseUint(paramSet, "frame_num", &param.frame_num) || !ParseUint(paramSet, "object_num", &object_num) ||
+      !ParseUint(paramSet, "buffer_num", &buffer_num)) {
+    return false;
+  }
+  if (0 == width || 0 == height || width > 8192 || height > 8192) {
+    LOG(ERROR) << "width, height : invalid";
+    return false;
+  }
+  if (param.fmt != CN_PIXEL_FORMAT_BGR24 && (width % 2 || height % 2)) {
+    LOG(ERROR) << "width, height : must be even for YUV420";
+    return false;
+  }
+  if (0 == buffer_num) {
+    LOG(ERROR) << "buffer_num : invalid";
+    return false;
+  }
+  param.width = width;
+  param.height = height;
+  param.object_num = object_num;
+  param.buffer_num = buffer_num;
+  param_ = param;
+  return true;
+}
+
+void SyntheticSource::Close() { RemoveSources(); }
+
+int SyntheticSource::AddStreams(uint32_t stream_num, int framerate, bool loop, const std::string &prefix) {
+  for (uint32_t i = 0; i < stream_num; ++i) {
+    if (AddVideoSource(prefix + std::to_string(i), "synthetic", framerate, loop) != 0) return -1;
+  }
+  return 0;
+}
+
+std::shared_ptr<SourceHandler> SyntheticSource::CreateSource(const std::string &stream_id,
+                                                             const std::string &filename, int framerate, bool loop) {
+  (void)filename;
+  if (stream_id.empty()) {
+    LOG(ERROR) << "invalid stream_id";
+    return nullptr;
+  }
+  return std::make_shared<SyntheticHandler>(this, stream_id, framerate, loop);
+}
+
+bool SyntheticSource::CheckParamSet(ModuleParamSet paramSet) {
+  for (auto &it : paramSet) {
+    if (!param_register_.IsRegisted(it.first)) {
+      LOG(WARNING) << "[SyntheticSource] Unknown param: " << it.first;
+    }
+  }
+
+  if (paramSet.find("pixel_format") != paramSet.end()) {
+    std::string pixel_format = paramSet["pixel_format"];
+    if (pixel_format != "nv12" && pixel_format != "nv21" && pixel_format != "bgr") {
+      LOG(ERROR) << "[SyntheticSource] [pixel_format] " << pixel_format << " not supported";
+      return false;
+    }
+  }
+
+  ParametersChecker checker;
+  std::string err_msg;
+  if (!checker.IsNum({"width", "height", "buffer_num"}, paramSet, err_msg, true) ||
+      !checker.IsNum({"frame_num", "object_num"}, paramSet, err_msg)) {
+    LOG(ERROR) << "[SyntheticSource] " << err_msg;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace cnstream
@@ -114,7 +114,8 @@ class Tracker : public Module, public ModuleCreator<Tracker> {
 
  private:
   inline TrackerContext *GetTrackerContext(CNFrameInfoPtr data);
-  std::unordered_map<std::string, TrackerContext *> tracker_ctxs_;
+  // stream handle >>> context, a handle is never given to another stream id
+  std::unordered_map<uint32_t, TrackerContext *> tracker_ctxs_;
   std::mutex tracker_mutex_;
   std::string model_path_ = "";
   std::string func_name_ = "";
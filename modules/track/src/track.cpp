@@ -55,12 +55,12 @@ Tracker::~Tracker() { Close(); }
 inline TrackerContext *Tracker::GetTrackerContext(CNFrameInfoPtr data) {
   std::unique_lock<std::mutex> lock(tracker_mutex_);
   TrackerContext *ctx = nullptr;
-  auto it = tracker_ctxs_.find(data->frame.stream_id);
+  auto it = tracker_ctxs_.find(data->frame.stream_handle);
   if (it != tracker_ctxs_.end()) {
     ctx = it->second;
   } else {
     ctx = new TrackerContext;
-    tracker_ctxs_[data->frame.stream_id] = ctx;
+    tracker_ctxs_[data->frame.stream_handle] = ctx;
     if (!ctx->processer_) {
       if ("KCF" == track_name_) {
         assert(nullptr != pKCFloader_);
@@ -115,6 +115,8 @@ bool Tracker::Open(cnstream::ModuleParamSet paramSet) {
     track_name_ = "FeatureMatch";
   }
 
+  // one bucket for each stream at a time, so the map is seldom rehashed while frames are processed
+  tracker_ctxs_.rehash(GetMaxStreamNumber());
   return true;
 }
 
@@ -126,6 +128,57 @@ void Tracker::Close() {
   tracker_ctxs_.clear();
 }
 
+/* the detections are read from CNFrameInfo::dets if the postprocessor writes the compact ones */
+static void GetDetectObjects(const CNFrameInfo &data, std::vector<edk::DetectObject> *in) {
+  const CNDetections &dets = data.dets;
+  in->reserve(dets.Empty() ? data.objs.size() : dets.Size());
+  for (size_t i = 0; i < dets.Size(); i++) {
+    edk::DetectObject obj;
+    obj.label = dets.ClassIds()[i];
+    obj.score = dets.Scores()[i];
+    obj.bbox.x = dets.BBoxes()[i].x;
+    obj.bbox.y = dets.BBoxes()[i].y;
+    obj.bbox.width = dets.BBoxes()[i].w;
+    obj.bbox.height = dets.BBoxes()[i].h;
+    in->push_back(obj);
+  }
+  if (!dets.Empty()) return;
+  for (size_t i = 0; i < data.objs.size(); i++) {
+    edk::DetectObject obj;
+    obj.label = std::stoi(data.objs[i]->id);
+    obj.score = data.objs[i]->score;
+    obj.bbox.x = data.objs[i]->bbox.x;
+    obj.bbox.y = data.objs[i]->bbox.y;
+    obj.bbox.width = data.objs[i]->bbox.w;
+    obj.bbox.height = data.objs[i]->bbox.h;
+    in->push_back(obj);
+  }
+}
+
+/* the results are written back to where the detections were read from */
+static void SetDetectObjects(const std::vector<edk::DetectObject> &out, CNFrameInfo *data) {
+  if (!data->dets.Empty()) {
+    data->dets.Clear();
+    for (size_t i = 0; i < out.size(); i++) {
+      CNInferBoundingBox bbox = {out[i].bbox.x, out[i].bbox.y, out[i].bbox.width, out[i].bbox.height};
+      data->dets.Add(bbox, out[i].score, out[i].label, out[i].track_id);
+    }
+    return;
+  }
+  data->objs.clear();
+  for (size_t i = 0; i < out.size(); i++) {
+    std::shared_ptr<CNInferObject> obj = std::make_shared<CNInferObject>();
+    obj->id = std::to_string(out[i].label);
+    obj->track_id = std::to_string(out[i].track_id);
+    obj->score = out[i].score;
+    obj->bbox.x = out[i].bbox.x;
+    obj->bbox.y = out[i].bbox.y;
+    obj->bbox.w = out[i].bbox.width;
+    obj->bbox.h = out[i].bbox.height;
+    data->objs.push_back(obj);
+  }
+}
+
 int Tracker::Process(std::shared_ptr<CNFrameInfo> data) {
   TrackerContext *ctx = GetTrackerContext(data);
   if (nullptr == ctx || nullptr == ctx->processer_) {
@@ -135,16 +188,7 @@ int Tracker::Process(std::shared_ptr<CNFrameInfo> data) {
 
   if (track_name_ == "FeatureMatch") {
     std::vector<edk::DetectObject> in, out;
-    for (size_t i = 0; i < data->objs.size(); i++) {
-      edk::DetectObject obj;
-      obj.label = std::stoi(data->objs[i]->id);
-      obj.score = data->objs[i]->score;
-      obj.bbox.x = data->objs[i]->bbox.x;
-      obj.bbox.y = data->objs[i]->bbox.y;
-      obj.bbox.width = data->objs[i]->bbox.w;
-      obj.bbox.height = data->objs[i]->bbox.h;
-      in.push_back(obj);
-    }
+    GetDetectObjects(*data, &in);
 
 #ifdef HAVE_OPENCV
     cv::Mat img = *data->frame.ImageBGR();
@@ -165,30 +209,10 @@ int Tracker::Process(std::shared_ptr<CNFrameInfo> data) {
 #error OpenCV required
 #endif
 
-    data->objs.clear();
-    for (size_t i = 0; i < out.size(); i++) {
-      std::shared_ptr<CNInferObject> obj = std::make_shared<CNInferObject>();
-      obj->id = std::to_string(out[i].label);
-      obj->track_id = std::to_string(out[i].track_id);
-      obj->score = out[i].score;
-      obj->bbox.x = out[i].bbox.x;
-      obj->bbox.y = out[i].bbox.y;
-      obj->bbox.w = out[i].bbox.width;
-      obj->bbox.h = out[i].bbox.height;
-      data->objs.push_back(obj);
-    }
+    SetDetectObjects(out, data.get());
   } else if (track_name_ == "KCF") {
     std::vector<edk::DetectObject> in, out;
-    for (size_t i = 0; i < data->objs.size(); i++) {
-      edk::DetectObject obj;
-      obj.label = std::stoi(data->objs[i]->id);
-      obj.score = data->objs[i]->score;
-      obj.bbox.x = data->objs[i]->bbox.x;
-      obj.bbox.y = data->objs[i]->bbox.y;
-      obj.bbox.width = data->objs[i]->bbox.w;
-      obj.bbox.height = data->objs[i]->bbox.h;
-      in.push_back(obj);
-    }
+    GetDetectObjects(*data, &in);
 
     edk::TrackFrame tframe;
     tframe.data = data->frame.data[0]->GetMutableMluData();
@@ -201,18 +225,7 @@ int Tracker::Process(std::shared_ptr<CNFrameInfo> data) {
 
     ctx->processer_->UpdateFrame(tframe, in, &out);
 
-    data->objs.clear();
-    for (size_t i = 0; i < out.size(); i++) {
-      std::shared_ptr<CNInferObject> obj = std::make_shared<CNInferObject>();
-      obj->id = std::to_string(out[i].label);
-      obj->track_id = std::to_string(out[i].track_id);
-      obj->score = out[i].score;
-      obj->bbox.x = out[i].bbox.x;
-      obj->bbox.y = out[i].bbox.y;
-      obj->bbox.w = out[i].bbox.width;
-      obj->bbox.h = out[i].bbox.height;
-      data->objs.push_back(obj);
-    }
+    SetDetectObjects(out, data.get());
   }
 
   return 0;
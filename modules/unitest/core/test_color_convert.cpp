@@ -0,0 +1,102 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#ifdef HAVE_OPENCV
+#include "opencv2/opencv.hpp"
+#endif
+
+#include "color_convert.hpp"
+
+namespace cnstream {
+
+struct TestImage {
+  int width, height, stride;
+  std::vector<uint8_t> y, uv;
+  TestImage(int w, int h, int s, uint32_t seed) : width(w), height(h), stride(s) {
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> dist(0, 255);
+    y.resize(static_cast<size_t>(stride) * height);
+    uv.resize(static_cast<size_t>(stride) * ((height + 1) / 2));
+    for (auto& v : y) v = static_cast<uint8_t>(dist(gen));
+    for (auto& v : uv) v = static_cast<uint8_t>(dist(gen));
+  }
+  std::vector<uint8_t> Convert(bool nv21, ColorConvertKernel kernel) const {
+    std::vector<uint8_t> bgr(static_cast<size_t>(width) * 3 * height);
+    YUV420spToBGR(y.data(), stride, uv.data(), stride, nv21, width, height, bgr.data(), width * 3, kernel);
+    return bgr;
+  }
+};
+
+static const ColorConvertKernel kSimdKernels[] = {COLOR_CONVERT_SSE41, COLOR_CONVERT_AVX2};
+
+TEST(CoreColorConvert, KnownColors) {
+  // black, white and a saturated blue in BT.601 limited range
+  const uint8_t yuv[][3] = {{16, 128, 128}, {235, 128, 128}, {41, 240, 110}};
+  const uint8_t bgr[][3] = {{0, 0, 0}, {255, 255, 255}, {255, 0, 0}};
+  for (int i = 0; i < 3; ++i) {
+    uint8_t y[4], uv[2] = {yuv[i][1], yuv[i][2]};
+    memset(y, yuv[i][0], sizeof(y));
+    uint8_t out[12];
+    YUV420spToBGR(y, 2, uv, 2, false, 2, 2, out, 6, COLOR_CONVERT_SCALAR);
+    for (int p = 0; p < 4; ++p) {
+      for (int c = 0; c < 3; ++c) EXPECT_NEAR(out[3 * p + c], bgr[i][c], 1) << "color " << i;
+    }
+  }
+}
+
+TEST(CoreColorConvert, SimdMatchesScalar) {
+  // odd sizes leave scalar tails in rows and columns
+  const int sizes[][3] = {{16, 2, 16}, {64, 48, 80}, {37, 21, 40}, {1920, 9, 1920}, {130, 7, 136}};
+  for (auto& size : sizes) {
+    TestImage image(size[0], size[1], size[2], size[0] * 31 + size[1]);
+    for (bool nv21 : {false, true}) {
+      std::vector<uint8_t> expected = image.Convert(nv21, COLOR_CONVERT_SCALAR);
+      for (ColorConvertKernel kernel : kSimdKernels) {
+        if (!ColorConvertKernelSupported(kernel)) continue;
+        EXPECT_EQ(image.Convert(nv21, kernel), expected) << "kernel " << kernel << ", " << size[0] << "x" << size[1];
+      }
+      EXPECT_EQ(image.Convert(nv21, COLOR_CONVERT_AUTO), expected);
+    }
+  }
+}
+
+#ifdef HAVE_OPENCV
+TEST(CoreColorConvert, MatchesOpenCV) {
+  TestImage image(640, 360, 640, 7);
+  for (bool nv21 : {false, true}) {
+    std::vector<uint8_t> yuv(image.y);
+    yuv.insert(yuv.end(), image.uv.begin(), image.uv.end());
+    cv::Mat src(image.height * 3 / 2, image.stride, CV_8UC1, yuv.data()), expected;
+    cv::cvtColor(src, expected, nv21 ? cv::COLOR_YUV2BGR_NV21 : cv::COLOR_YUV2BGR_NV12);
+    std::vector<uint8_t> bgr = image.Convert(nv21, COLOR_CONVERT_AUTO);
+    cv::Mat actual(image.height, image.width, CV_8UC3, bgr.data());
+    double max_diff = cv::norm(actual, expected, cv::NORM_INF);
+    EXPECT_LE(max_diff, 1);
+  }
+}
+#endif
+
+}  // namespace cnstream
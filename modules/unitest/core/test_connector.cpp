@@ -26,6 +26,7 @@
 #include "cnstream_frame.hpp"
 #include "connector.hpp"
 #include "conveyor.hpp"
+#include "queue_sampler.hpp"
 
 namespace cnstream {
 
@@ -57,6 +58,17 @@ TEST(CoreConnector, PushPopDataBuffer) {
   EXPECT_EQ(data.get(), out_data.get());
 }
 
+TEST(CoreConnector, LockFreeQueueType) {
+  for (LinkQueueType type : {LINK_QUEUE_MPMC, LINK_QUEUE_SPSC}) {
+    Connector connector(2, 4, type);
+    EXPECT_EQ(type, connector.GetQueueType());
+    CNFrameInfoPtr data = CNFrameInfo::Create(std::to_string(0));
+    connector.PushDataBufferToConveyor(1, data);
+    CNFrameInfoPtr out_data = connector.PopDataBufferFromConveyor(1);
+    EXPECT_EQ(data.get(), out_data.get());
+  }
+}
+
 TEST(CoreConnector, StartStop) {
   size_t conveyor_count = 10;
   Connector connector(conveyor_count);
@@ -66,4 +78,50 @@ TEST(CoreConnector, StartStop) {
   EXPECT_TRUE(connector.IsStopped());
 }
 
+/*
+  a --> b --> c, b is the bottleneck when the queue a-->b is full and the queue b-->c is empty
+ */
+TEST(CoreConnector, QueueSampler) {
+  Connector input(1, 2), output(1, 2);
+  input.Start();
+  output.Start();
+  std::vector<QueueSampler::Link> links = {{"a-->b", &input}, {"b-->c", &output}};
+  std::vector<QueueSampler::Node> nodes(3);
+  nodes[0].name = "a";
+  nodes[0].outputs = {0};
+  nodes[1].name = "b";
+  nodes[1].inputs = {0};
+  nodes[1].outputs = {1};
+  nodes[2].name = "c";
+  nodes[2].inputs = {1};
+  QueueSampler sampler("pipeline", links, nodes);
+  EXPECT_EQ("", sampler.GetBottleneck(nullptr));
+  sampler.Sample();
+  input.PushDataBufferToConveyor(0, CNFrameInfo::Create("0"));
+  sampler.Sample();
+  input.PushDataBufferToConveyor(0, CNFrameInfo::Create("0"));
+  sampler.Sample();
+  sampler.Sample();
+  // c is full, but b's output is not empty
+  output.PushDataBufferToConveyor(0, CNFrameInfo::Create("0"));
+  output.PushDataBufferToConveyor(0, CNFrameInfo::Create("0"));
+  sampler.Sample();
+
+  std::vector<QueueTelemetry> telemetry;
+  EXPECT_FALSE(sampler.GetTelemetry("no_such_link", &telemetry));
+  ASSERT_TRUE(sampler.GetTelemetry("a-->b", &telemetry));
+  ASSERT_EQ(1u, telemetry.size());
+  EXPECT_EQ(2u, telemetry[0].capacity);
+  EXPECT_EQ(5u, telemetry[0].samples);
+  // depths 0, 1, 2, 2, 2
+  EXPECT_DOUBLE_EQ(7.0 / 5, telemetry[0].mean_depth);
+  EXPECT_EQ(2u, telemetry[0].p50_depth);
+  EXPECT_EQ(2u, telemetry[0].max_depth);
+  EXPECT_DOUBLE_EQ(60, telemetry[0].at_capacity_percent);
+  double percent = 0;
+  EXPECT_EQ("b", sampler.GetBottleneck(&percent));
+  EXPECT_DOUBLE_EQ(40, percent);
+  sampler.LogSummary();
+}
+
 }  // namespace cnstream
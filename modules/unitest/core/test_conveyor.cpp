@@ -21,11 +21,13 @@
 #include <chrono>
 #include <ctime>
 #include <memory>
+#include <string>
 #include <thread>
 #include <vector>
 
 #include "gtest/gtest.h"
 
+#include "cnstream_module.hpp"
 #include "connector.hpp"
 #include "conveyor.hpp"
 
@@ -141,7 +143,7 @@ TEST(CoreConveyor, PushPopDataBuffer) {
 TEST(CoreConveyor, PushDataFull) {
   Connector* connect = new Connector(1);
   size_t max_size = 10;
-  Conveyor* conveyor = new Conveyor(connect, max_size, true);
+  Conveyor* conveyor = new Conveyor(connect, max_size, LINK_OVERFLOW_DROP_OLDEST);
   // When data queue is full, conveyor will drop one data from the front.
   for (uint32_t i = 0; i < max_size + 1; i++) {
     std::shared_ptr<CNFrameInfo> sdata = CNFrameInfo::Create(std::to_string(0));
@@ -151,10 +153,132 @@ TEST(CoreConveyor, PushDataFull) {
   delete conveyor;
 }
 
+static CNFrameInfoPtr CreateFrame(uint32_t chn_idx, int64_t frame_id, bool eos = false) {
+  auto data = CNFrameInfo::Create(std::to_string(chn_idx), eos);
+  data->channel_idx = chn_idx;
+  data->frame.frame_id = frame_id;
+  return data;
+}
+
+/* pops everything and returns the frame ids, eos frames are -1 */
+static std::vector<int64_t> PopFrameIds(Conveyor* conveyor) {
+  std::vector<int64_t> ids;
+  for (auto& data : conveyor->PopAllDataBuffer()) {
+    ids.push_back(data->frame.flags & CN_FRAME_FLAG_EOS ? -1 : data->frame.frame_id);
+  }
+  return ids;
+}
+
+TEST(CoreConveyor, OverflowPolicy) {
+  Connector* connect = new Connector(1);
+  Conveyor drop_oldest(connect, 3, LINK_OVERFLOW_DROP_OLDEST);
+  drop_oldest.PushDataBuffer(CreateFrame(0, 0, true));
+  for (int64_t i = 1; i <= 4; ++i) drop_oldest.PushDataBuffer(CreateFrame(0, i));
+  // the eos frame is never dropped
+  EXPECT_EQ(PopFrameIds(&drop_oldest), std::vector<int64_t>({-1, 3, 4}));
+  EXPECT_EQ(drop_oldest.GetDropCount()["0"], 2u);
+
+  Conveyor drop_newest(connect, 3, LINK_OVERFLOW_DROP_NEWEST);
+  for (int64_t i = 0; i < 5; ++i) drop_newest.PushDataBuffer(CreateFrame(1, i));
+  EXPECT_EQ(PopFrameIds(&drop_newest), std::vector<int64_t>({0, 1, 2}));
+  EXPECT_EQ(drop_newest.GetDropCount()["1"], 2u);
+
+  Conveyor keep_latest(connect, 10, LINK_OVERFLOW_KEEP_LATEST_N, LINK_QUEUE_MUTEX, 2);
+  for (int64_t i = 0; i < 4; ++i) {
+    keep_latest.PushDataBuffer(CreateFrame(0, i));
+    keep_latest.PushDataBuffer(CreateFrame(1, 10 + i));
+  }
+  keep_latest.PushDataBuffer(CreateFrame(1, 14, true));
+  EXPECT_EQ(PopFrameIds(&keep_latest), std::vector<int64_t>({2, 12, 3, 13, -1}));
+  auto drop_cnt = keep_latest.GetDropCount();
+  EXPECT_EQ(drop_cnt["0"], 2u);
+  EXPECT_EQ(drop_cnt["1"], 2u);
+  delete connect;
+}
+
+class BranchTestModule : public Module {
+ public:
+  explicit BranchTestModule(const std::string& name) : Module(name) {}
+  bool Open(ModuleParamSet paramSet) override { return true; }
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> data) override { return 0; }
+};  // class BranchTestModule
+
+TEST(CoreConveyor, DroppedFrameEndsBranch) {
+  BranchTestModule left("left"), right("right"), join("join");
+  left.SetId(1);
+  right.SetId(2);
+  join.SetId(3);
+  join.SetParentId(left.GetId());
+  join.SetParentId(right.GetId());
+  Connector* connect = new Connector(1, 1, LINK_QUEUE_MUTEX, LINK_OVERFLOW_DROP_OLDEST);
+  connect->SetDownstreamModule(&join);
+  Conveyor* conveyor = connect->GetConveyor(0);
+  // the frames fork into the left and right branches, the conveyor links left to join
+  auto fork = [&](int64_t frame_id) {
+    auto data = CreateFrame(0, frame_id);
+    data->frame.AddBranches(1);
+    data->frame.SetModuleMask(&join, &left);
+    return data;
+  };
+
+  auto dropped = fork(0);
+  conveyor->PushDataBuffer(dropped);
+  auto joined = fork(1);
+  conveyor->PushDataBuffer(joined);
+  EXPECT_EQ(1, dropped->frame.GetBranchNum());
+  // the join never processes the dropped frame
+  dropped->frame.SetModuleMask(&join, &right);
+  EXPECT_FALSE(dropped->frame.ClaimModuleMask(&join));
+
+  // the join has processed the frame through the right branch and ended the left one
+  joined->frame.SetModuleMask(&join, &right);
+  EXPECT_TRUE(joined->frame.ClaimModuleMask(&join));
+  joined->frame.AddBranches(-1);
+  conveyor->PushDataBuffer(fork(2));
+  EXPECT_EQ(1, joined->frame.GetBranchNum());
+  EXPECT_EQ(connect->GetDropCount()["0"], 2u);
+  delete connect;
+}
+
+TEST(CoreConveyor, EosWaitsForFreeSpace) {
+  Connector* connect = new Connector(1, 1, LINK_QUEUE_MUTEX, LINK_OVERFLOW_DROP_NEWEST);
+  Conveyor* conveyor = connect->GetConveyor(0);
+  conveyor->PushDataBuffer(CreateFrame(0, 0));
+  std::thread producer([&] { conveyor->PushDataBuffer(CreateFrame(0, 1, true)); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(conveyor->PopDataBuffer()->frame.frame_id, 0);
+  producer.join();
+  EXPECT_TRUE(conveyor->PopDataBuffer()->frame.flags & CN_FRAME_FLAG_EOS);
+  EXPECT_TRUE(connect->GetDropCount().empty());
+  delete connect;
+}
+
+TEST(CoreConveyor, StopWakesBlockedConveyor) {
+  Connector* connect = new Connector(2, 1);
+  Conveyor* full_conveyor = connect->GetConveyor(0);
+  Conveyor* empty_conveyor = connect->GetConveyor(1);
+  full_conveyor->PushDataBuffer(CNFrameInfo::Create(std::to_string(0)));
+
+  std::thread producer([&] { full_conveyor->PushDataBuffer(CNFrameInfo::Create(std::to_string(0))); });
+  std::thread consumer([&] { EXPECT_EQ(empty_conveyor->PopDataBuffer(), nullptr); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  connect->Stop();
+  producer.join();
+  consumer.join();
+  EXPECT_EQ(full_conveyor->GetBufferSize(), (uint32_t)1);
+
+  connect->Start();
+  auto sdata = CNFrameInfo::Create(std::to_string(0));
+  empty_conveyor->PushDataBuffer(sdata);
+  EXPECT_EQ(empty_conveyor->PopDataBuffer(), sdata);
+  delete connect;
+}
+
 TEST(CoreConveyor, PopAllData) {
   Connector* connect = new Connector(1);
   size_t max_size = 10;
-  Conveyor* conveyor = new Conveyor(connect, max_size, true);
+  Conveyor* conveyor = new Conveyor(connect, max_size, LINK_OVERFLOW_DROP_OLDEST);
   std::vector<std::shared_ptr<CNFrameInfo>> sdata_vec;
   std::vector<std::shared_ptr<CNFrameInfo>> rdata_vec;
   // When data queue is full, conveyor will drop one data from the front.
@@ -174,4 +298,25 @@ TEST(CoreConveyor, PopAllData) {
   delete conveyor;
 }
 
+TEST(CoreConveyor, BlockedPushes) {
+  for (LinkQueueType queue_type : {LINK_QUEUE_MUTEX, LINK_QUEUE_MPMC}) {
+    Connector connector(1);
+    Conveyor conveyor(&connector, 2, LINK_OVERFLOW_BLOCK, queue_type);
+    conveyor.PushDataBuffer(CNFrameInfo::Create("0"));
+    conveyor.PushDataBuffer(CNFrameInfo::Create("0"));
+    EXPECT_EQ(0u, conveyor.GetBlockedPushes());
+    std::thread producer([&] { conveyor.PushDataBuffer(CNFrameInfo::Create("0")); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_NE(nullptr, conveyor.PopDataBuffer());
+    producer.join();
+    EXPECT_EQ(1u, conveyor.GetBlockedPushes());
+    EXPECT_GE(conveyor.GetBlockedNs(), 15000000u);
+    EXPECT_EQ(2u, conveyor.GetBufferSize());
+    // cleared by start
+    conveyor.Start();
+    EXPECT_EQ(0u, conveyor.GetBlockedPushes());
+    EXPECT_EQ(0u, conveyor.GetBlockedNs());
+  }
+}
+
 }  // namespace cnstream
@@ -0,0 +1,154 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "cnstream_devmem.hpp"
+#include "cnstream_frame.hpp"
+#include "cnstream_syncmem.hpp"
+
+namespace cnstream {
+
+TEST(CoreDevMem, MemcpyRoundTrip) {
+  const size_t size = 1 << 20;
+  std::vector<uint8_t> src(size), dst(size, 0);
+  for (size_t i = 0; i < size; ++i) src[i] = i * 7;
+  void* dev_a = DevMalloc(size, 0, 0);
+  void* dev_b = DevMalloc(size, 0, 0);
+  ASSERT_NE(dev_a, nullptr);
+  ASSERT_NE(dev_b, nullptr);
+  EXPECT_TRUE(DevMemcpy(dev_a, src.data(), size, DEV_MEMCPY_HOST2DEV, 0, 0));
+  EXPECT_TRUE(DevMemcpy(dev_b, dev_a, size, DEV_MEMCPY_DEV2DEV, 0, 0));
+  EXPECT_TRUE(DevMemcpy(dst.data(), dev_b, size, DEV_MEMCPY_DEV2HOST, 0, 0));
+  EXPECT_EQ(src, dst);
+  DevFree(dev_a, 0, 0);
+  DevFree(dev_b, 0, 0);
+}
+
+TEST(CoreDevMem, QueueAndNotifier) {
+  const size_t size = 1 << 20;
+  const int kCopyNum = 8;
+  std::vector<uint8_t> src(size, 3), dst(size * kCopyNum, 0);
+  void* dev = DevMalloc(size * kCopyNum);
+  ASSERT_NE(dev, nullptr);
+  DevQueue queue;
+  DevNotifier start, end;
+  ASSERT_TRUE(start.Place(&queue));
+  for (int i = 0; i < kCopyNum; ++i) {
+    ASSERT_TRUE(queue.MemcpyAsync(static_cast<uint8_t*>(dev) + i * size, src.data(), size, DEV_MEMCPY_HOST2DEV));
+  }
+  ASSERT_TRUE(queue.MemcpyAsync(dst.data(), dev, size * kCopyNum, DEV_MEMCPY_DEV2HOST));
+  ASSERT_TRUE(end.Place(&queue));
+  EXPECT_TRUE(end.Wait());
+  EXPECT_GE(DevNotifier::Duration(&start, &end), 0);
+  EXPECT_TRUE(queue.Sync());
+  EXPECT_EQ(std::vector<uint8_t>(size * kCopyNum, 3), dst);
+  DevFree(dev);
+}
+
+#ifdef CNS_HOST_DEVICE
+TEST(CoreDevMem, EmulatedDevRejectsHostMemory) {
+  std::vector<uint8_t> host(1024), other(1024);
+  void* dev = DevMalloc(1024);
+  ASSERT_NE(dev, nullptr);
+  EXPECT_FALSE(DevMemcpy(host.data(), other.data(), 1024, DEV_MEMCPY_HOST2DEV));
+  EXPECT_FALSE(DevMemcpy(host.data(), other.data(), 1024, DEV_MEMCPY_DEV2HOST));
+  // out of the device buffer
+  EXPECT_FALSE(DevMemcpy(static_cast<uint8_t*>(dev) + 512, host.data(), 1024, DEV_MEMCPY_HOST2DEV));
+  EXPECT_TRUE(DevMemcpy(static_cast<uint8_t*>(dev) + 512, host.data(), 512, DEV_MEMCPY_HOST2DEV));
+
+  DevQueue queue;
+  EXPECT_TRUE(queue.MemcpyAsync(host.data(), other.data(), 1024, DEV_MEMCPY_DEV2DEV));
+  EXPECT_FALSE(queue.Sync());
+  EXPECT_TRUE(queue.Sync());
+  DevFree(dev);
+}
+
+TEST(CoreDevMem, EmulatedDevBandwidth) {
+  EmulatedDevBandwidth origin = GetEmulatedDevBandwidth();
+  EmulatedDevBandwidth bandwidth;
+  bandwidth.host2dev = 1e9;
+  SetEmulatedDevBandwidth(bandwidth);
+  const size_t size = 10 << 20;
+  std::vector<uint8_t> host(size);
+  void* dev = DevMalloc(size);
+  ASSERT_NE(dev, nullptr);
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 5; ++i) ASSERT_TRUE(DevMemcpy(dev, host.data(), size, DEV_MEMCPY_HOST2DEV));
+  double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  // 50MB at 1GB/s
+  EXPECT_GE(ms, 50 * 1.048576 * 0.95);
+  SetEmulatedDevBandwidth(origin);
+  DevFree(dev);
+}
+
+TEST(CoreDevMem, EmulatedDevSyncedMemory) {
+  const size_t size = 4096;
+  CNSyncedMemory memory(size, 0, 1);
+  memset(memory.GetMutableCpuData(), 0x5a, size);
+  EXPECT_EQ(CNSyncedMemory::HEAD_AT_CPU, memory.GetHead());
+  const void* mlu = memory.GetMluData();
+  EXPECT_EQ(CNSyncedMemory::SYNCED, memory.GetHead());
+  std::vector<uint8_t> host(size);
+  ASSERT_TRUE(DevMemcpy(host.data(), mlu, size, DEV_MEMCPY_DEV2HOST));
+  EXPECT_EQ(std::vector<uint8_t>(size, 0x5a), host);
+
+  void* dev = DevMalloc(size);
+  ASSERT_NE(dev, nullptr);
+  memset(host.data(), 0xa5, size);
+  ASSERT_TRUE(DevMemcpy(dev, host.data(), size, DEV_MEMCPY_HOST2DEV));
+  memory.SetMluData(dev);
+  EXPECT_EQ(CNSyncedMemory::HEAD_AT_MLU, memory.GetHead());
+  EXPECT_EQ(0xa5, static_cast<const uint8_t*>(memory.GetCpuData())[size - 1]);
+  EXPECT_EQ(CNSyncedMemory::SYNCED, memory.GetHead());
+  DevFree(dev);
+}
+
+TEST(CoreDevMem, EmulatedDevFrameCopyToSyncMem) {
+  const int width = 64, height = 32;
+  void* decoded = DevMalloc(width * height * 3 / 2);
+  ASSERT_NE(decoded, nullptr);
+  std::vector<uint8_t> image(width * height * 3 / 2, 16);
+  ASSERT_TRUE(DevMemcpy(decoded, image.data(), image.size(), DEV_MEMCPY_HOST2DEV));
+  CNDataFrame frame;
+  frame.ctx.dev_type = DevContext::MLU;
+  frame.ctx.dev_id = 0;
+  frame.ctx.ddr_channel = 0;
+  frame.fmt = CN_PIXEL_FORMAT_YUV420_NV12;
+  frame.width = width;
+  frame.height = height;
+  frame.stride[0] = frame.stride[1] = width;
+  frame.ptr[0] = decoded;
+  frame.ptr[1] = static_cast<uint8_t*>(decoded) + width * height;
+  frame.CopyToSyncMem();
+  DevFree(decoded);
+  const uint8_t* y = static_cast<const uint8_t*>(frame.data[0]->GetCpuData());
+  const uint8_t* uv = static_cast<const uint8_t*>(frame.data[1]->GetCpuData());
+  EXPECT_EQ(16, y[0]);
+  EXPECT_EQ(16, uv[width * height / 2 - 1]);
+}
+#endif
+
+}  // namespace cnstream
@@ -0,0 +1,133 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "executor.hpp"
+
+namespace cnstream {
+
+static bool WaitFor(const std::atomic<int>& value, int expected) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (value.load() != expected && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return value.load() == expected;
+}
+
+TEST(CoreExecutor, WorkerNum) {
+  WorkStealingExecutor executor(3);
+  EXPECT_EQ(3u, executor.GetWorkerNum());
+  WorkStealingExecutor default_executor;
+  EXPECT_LT(0u, default_executor.GetWorkerNum());
+  EXPECT_EQ(nullptr, WorkStealingExecutor::Current());
+}
+
+TEST(CoreExecutor, TaskNeverRunsConcurrently) {
+  WorkStealingExecutor executor(4);
+  std::atomic<int> pending{0};
+  std::atomic<int> running{0};
+  std::atomic<int> processed{0};
+  std::atomic<bool> overlapped{false};
+  std::atomic<bool> on_worker{true};
+  auto task = executor.AddTask(
+      [&]() -> bool {
+        if (running.fetch_add(1) != 0) overlapped = true;
+        if (WorkStealingExecutor::Current() != &executor) on_worker = false;
+        while (pending.load() > 0) {
+          pending--;
+          processed++;
+        }
+        running--;
+        return true;
+      },
+      [&]() -> bool { return pending.load() > 0; });
+  executor.Start();
+  const int kProducers = 4, kCount = 10000;
+  std::vector<std::thread> producers;
+  for (int i = 0; i < kProducers; ++i) {
+    producers.emplace_back([&]() {
+      for (int n = 0; n < kCount; ++n) {
+        pending++;
+        executor.Schedule(task);
+      }
+    });
+  }
+  for (auto& it : producers) it.join();
+  EXPECT_TRUE(WaitFor(processed, kProducers * kCount));
+  executor.Stop();
+  EXPECT_FALSE(overlapped.load());
+  EXPECT_TRUE(on_worker.load());
+}
+
+TEST(CoreExecutor, IdleWorkersSteal) {
+  WorkStealingExecutor executor(4);
+  const int kChildren = 3;
+  std::atomic<int> children_done{0};
+  std::vector<WorkStealingExecutor::Task*> children;
+  for (int i = 0; i < kChildren; ++i) {
+    children.push_back(executor.AddTask(
+        [&]() -> bool {
+          children_done++;
+          return true;
+        },
+        []() -> bool { return false; }));
+  }
+  std::atomic<bool> all_stolen{false};
+  auto parent = executor.AddTask(
+      [&]() -> bool {
+        // scheduled by a worker, the children are queued on this worker, which then stays busy
+        for (auto child : children) executor.Schedule(child);
+        all_stolen = WaitFor(children_done, kChildren);
+        return true;
+      },
+      []() -> bool { return false; });
+  executor.Start();
+  executor.Schedule(parent);
+  EXPECT_TRUE(WaitFor(children_done, kChildren));
+  executor.Stop();
+  EXPECT_TRUE(all_stolen.load());
+}
+
+TEST(CoreExecutor, DeadTaskIsNotScheduled) {
+  WorkStealingExecutor executor(2);
+  std::atomic<int> runs{0};
+  auto task = executor.AddTask(
+      [&]() -> bool {
+        runs++;
+        return false;
+      },
+      []() -> bool { return true; });
+  executor.Start();
+  executor.Schedule(task);
+  EXPECT_TRUE(WaitFor(runs, 1));
+  for (int i = 0; i < 10; ++i) executor.Schedule(task);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  executor.Stop();
+  EXPECT_EQ(1, runs.load());
+}
+
+}  // namespace cnstream
@@ -18,9 +18,11 @@
  * THE SOFTWARE.
  *************************************************************************/
 
+#include <chrono>
 #include <ctime>
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "gtest/gtest.h"
@@ -29,6 +31,7 @@
 #endif
 
 #include "cnstream_frame.hpp"
+#include "cnstream_module.hpp"
 
 namespace cnstream {
 
@@ -100,6 +103,92 @@ TEST(CoreFrame, ConvertImageToBGRFailed) {
   free(frame.ptr[0]);
   free(frame.ptr[1]);
 }
+
+TEST(CoreFrame, ConvertImageToBGRConcurrently) {
+  CNDataFrame frame;
+  InitFrame(&frame, 1);
+  frame.fmt = CN_PIXEL_FORMAT_YUV420_NV12;
+  frame.CopyToSyncMem();
+
+  // the modules share the image converted once
+  const int kThreadNum = 8;
+  std::vector<cv::Mat*> images(kThreadNum, nullptr);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreadNum; ++i) {
+    threads.emplace_back([&, i] { images[i] = frame.ImageBGR(); });
+  }
+  for (auto& thread : threads) thread.join();
+  ASSERT_NE(images[0], nullptr);
+  for (int i = 1; i < kThreadNum; ++i) EXPECT_EQ(images[i], images[0]);
+  EXPECT_EQ(images[0]->rows, frame.height);
+  EXPECT_EQ(images[0]->cols, frame.stride[0]);
+  free(frame.ptr[0]);
+  free(frame.ptr[1]);
+}
+
+TEST(CoreFrame, DerivedImageCache) {
+  CNDataFrame frame;
+  InitFrame(&frame, 1);
+  frame.fmt = CN_PIXEL_FORMAT_YUV420_NV12;
+  frame.CopyToSyncMem();
+  size_t capacity = GetDerivedImageCacheCapacity();
+  SetDerivedImageCacheCapacity(640 * 360 * 3);
+
+  DerivedImageCacheStats before = GetDerivedImageCacheStats();
+  const int kThreadNum = 8;
+  std::vector<cv::Mat> images(kThreadNum);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreadNum; ++i) {
+    threads.emplace_back([&, i] { images[i] = frame.GetDerivedImage(CN_PIXEL_FORMAT_BGR24, 640, 360); });
+  }
+  for (auto& thread : threads) thread.join();
+  DerivedImageCacheStats after = GetDerivedImageCacheStats();
+  // derived once and shared
+  EXPECT_EQ(after.misses - before.misses, 1u);
+  EXPECT_EQ(after.hits - before.hits, (uint64_t)(kThreadNum - 1));
+  for (auto& image : images) {
+    EXPECT_EQ(image.data, images[0].data);
+    EXPECT_EQ(image.cols, 640);
+    EXPECT_EQ(image.rows, 360);
+  }
+
+  // the cache is full, derived but not cached
+  cv::Mat small = frame.GetDerivedImage(CN_PIXEL_FORMAT_BGR24, 320, 180);
+  EXPECT_EQ(small.cols, 320);
+  EXPECT_NE(frame.GetDerivedImage(CN_PIXEL_FORMAT_BGR24, 320, 180).data, small.data);
+  EXPECT_EQ(GetDerivedImageCacheStats().uncached - after.uncached, 2u);
+  // the full size BGR image is a view of ImageBGR()
+  EXPECT_EQ(frame.GetDerivedImage(CN_PIXEL_FORMAT_BGR24, frame.width, frame.height).data, frame.ImageBGR()->data);
+  EXPECT_TRUE(frame.GetDerivedImage(CN_PIXEL_FORMAT_YUV420_NV12, 640, 360).empty());
+
+  SetDerivedImageCacheCapacity(capacity);
+  free(frame.ptr[0]);
+  free(frame.ptr[1]);
+}
+
+TEST(CoreFrame, MutableImageClearsDerivedImages) {
+  CNDataFrame frame;
+  InitFrame(&frame, 1);
+  frame.fmt = CN_PIXEL_FORMAT_YUV420_NV12;
+  frame.CopyToSyncMem();
+  cv::Mat small = frame.GetDerivedImage(CN_PIXEL_FORMAT_BGR24, 640, 360);
+  cv::Mat view = frame.GetDerivedImage(CN_PIXEL_FORMAT_BGR24, frame.width, frame.height);
+  EXPECT_EQ(frame.GetDerivedImage(CN_PIXEL_FORMAT_BGR24, 640, 360).data, small.data);
+
+  // written in place, the resized image is derived again and the view is kept
+  cv::Mat* image = frame.MutableImageBGR();
+  ASSERT_NE(image, nullptr);
+  EXPECT_EQ(image, frame.ImageBGR());
+  DerivedImageCacheStats before = GetDerivedImageCacheStats();
+  EXPECT_NE(frame.GetDerivedImage(CN_PIXEL_FORMAT_BGR24, 640, 360).data, small.data);
+  EXPECT_EQ(frame.GetDerivedImage(CN_PIXEL_FORMAT_BGR24, frame.width, frame.height).data, view.data);
+  DerivedImageCacheStats after = GetDerivedImageCacheStats();
+  EXPECT_EQ(after.misses - before.misses, 1u);
+  EXPECT_EQ(after.hits - before.hits, 1u);
+
+  free(frame.ptr[0]);
+  free(frame.ptr[1]);
+}
 #endif
 
 TEST(CoreFrameDeathTest, CopyToSyncMemFailed) {
@@ -209,6 +298,123 @@ TEST(CoreFrame, InferObjAddAndGetfeature) {
   EXPECT_EQ(features[1], infer_feature);
 }
 
+TEST(CoreFrame, InferObjAddExtraAttributes) {
+  CNInferObject infer_obj;
+  std::vector<std::pair<std::string, std::string>> attributes = {{"key0", "value0"}, {"key1", "value1"}};
+  EXPECT_TRUE(infer_obj.AddExtraAttribute(attributes));
+  EXPECT_EQ(infer_obj.GetExtraAttribute("key0"), "value0");
+  EXPECT_EQ(infer_obj.GetExtraAttribute("key1"), "value1");
+  // some of them exist
+  attributes.push_back(std::make_pair("key2", "value2"));
+  EXPECT_FALSE(infer_obj.AddExtraAttribute(attributes));
+  EXPECT_EQ(infer_obj.GetExtraAttribute("key2"), "value2");
+}
+
+TEST(CoreFrame, RegisterMetaKey) {
+  auto key = RegisterMetaKey<int64_t>("meta_test_key");
+  EXPECT_TRUE(key.IsValid());
+  EXPECT_LT(key.slot, GetMetaSlotNum());
+  EXPECT_EQ(RegisterMetaKey<int64_t>("meta_test_key").slot, key.slot);
+  EXPECT_EQ(FindMetaKey<int64_t>("meta_test_key").slot, key.slot);
+  // the type is part of the key
+  EXPECT_FALSE(FindMetaKey<double>("meta_test_key").IsValid());
+  EXPECT_NE(RegisterMetaKey<double>("meta_test_key").slot, key.slot);
+  EXPECT_FALSE(FindMetaKey<std::string>("meta_test_wrong_key").IsValid());
+}
+
+TEST(CoreFrame, MetaSlots) {
+  auto count_key = RegisterMetaKey<int64_t>("meta_test_count");
+  auto ratio_key = RegisterMetaKey<double>("meta_test_ratio");
+  auto label_key = RegisterMetaKey<std::string>("meta_test_label");
+  CNMetaSlots meta;
+  int64_t count = -1;
+  EXPECT_FALSE(meta.Has(count_key));
+  EXPECT_FALSE(meta.Get(count_key, &count));
+  EXPECT_EQ(count, -1);
+  EXPECT_TRUE(meta.Add(count_key, int64_t(1)));
+  EXPECT_FALSE(meta.Add(count_key, int64_t(2)));
+  EXPECT_TRUE(meta.Get(count_key, &count));
+  EXPECT_EQ(count, 1);
+  EXPECT_TRUE(meta.Set(count_key, int64_t(3)));
+  EXPECT_TRUE(meta.Get(count_key, &count));
+  EXPECT_EQ(count, 3);
+  EXPECT_FALSE(meta.Has(ratio_key));
+  EXPECT_TRUE(meta.Set(ratio_key, 0.5));
+  double ratio = 0;
+  EXPECT_TRUE(meta.Get(ratio_key, &ratio));
+  EXPECT_EQ(ratio, 0.5);
+  EXPECT_TRUE(meta.Set(label_key, std::string("car")));
+  std::string label;
+  EXPECT_TRUE(meta.Get(label_key, &label));
+  EXPECT_EQ(label, "car");
+  // invalid keys
+  CNMetaKey<int64_t> invalid_key;
+  EXPECT_FALSE(meta.Set(invalid_key, int64_t(1)));
+  EXPECT_FALSE(meta.Has(invalid_key));
+  meta.Clear();
+  EXPECT_FALSE(meta.Has(count_key));
+  EXPECT_FALSE(meta.Has(ratio_key));
+  EXPECT_FALSE(meta.Get(label_key, &label));
+  EXPECT_TRUE(meta.Add(count_key, int64_t(4)));
+}
+
+TEST(CoreFrame, MetaSlotsAndAttributes) {
+  CNInferObject infer_obj;
+  CNInferAttr value;
+  value.id = 1;
+  value.value = 2;
+  value.score = 0.8;
+  // the string API does not register keys, so the names made of the data are not limited
+  const uint32_t slot_num = GetMetaSlotNum();
+  for (uint32_t i = 0; i < MAX_META_SLOT_NUM + 1; ++i) {
+    EXPECT_TRUE(infer_obj.AddAttribute("meta_test_color_" + std::to_string(i), value));
+  }
+  EXPECT_TRUE(infer_obj.AddExtraAttribute("meta_test_plate", "A12345"));
+  EXPECT_EQ(slot_num, GetMetaSlotNum());
+  EXPECT_FALSE(FindMetaKey<CNInferAttr>("meta_test_color_0").IsValid());
+  CNInferAttr attr = infer_obj.GetAttribute("meta_test_color_" + std::to_string(MAX_META_SLOT_NUM));
+  EXPECT_EQ(attr.id, value.id);
+  EXPECT_EQ(attr.value, value.value);
+  EXPECT_EQ(attr.score, value.score);
+
+  // the slots and the extended attributes are kept apart
+  auto plate_key = RegisterMetaKey<std::string>("meta_test_plate");
+  EXPECT_TRUE(infer_obj.meta.Set(plate_key, std::string("B12345")));
+  EXPECT_EQ(infer_obj.GetExtraAttribute("meta_test_plate"), "A12345");
+  EXPECT_FALSE(infer_obj.AddExtraAttribute("meta_test_plate", "C12345"));
+
+  // cleared with the slots
+  infer_obj.meta.Clear();
+  EXPECT_EQ(infer_obj.GetExtraAttribute("meta_test_plate"), "");
+  EXPECT_EQ(infer_obj.GetAttribute("meta_test_color_0").id, -1);
+  EXPECT_TRUE(infer_obj.AddExtraAttribute("meta_test_plate", "C12345"));
+  EXPECT_EQ(infer_obj.GetExtraAttribute("meta_test_plate"), "C12345");
+}
+
+TEST(CoreFrame, MetaSlotsConcurrently) {
+  std::vector<CNMetaKey<int64_t>> keys;
+  for (int i = 0; i < 16; ++i) {
+    keys.push_back(RegisterMetaKey<int64_t>("meta_test_concurrent_" + std::to_string(i)));
+  }
+  CNInferObject infer_obj;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t]() {
+      for (int i = t; i < 16; i += 4) {
+        EXPECT_TRUE(infer_obj.meta.Add(keys[i], int64_t(i)));
+        infer_obj.AddExtraAttribute("meta_test_concurrent_str_" + std::to_string(i), std::to_string(i));
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  for (int i = 0; i < 16; ++i) {
+    int64_t value = -1;
+    EXPECT_TRUE(infer_obj.meta.Get(keys[i], &value));
+    EXPECT_EQ(value, i);
+    EXPECT_EQ(infer_obj.GetExtraAttribute("meta_test_concurrent_str_" + std::to_string(i)), std::to_string(i));
+  }
+}
+
 TEST(CoreFrame, SetAndGetParallelism) {
   int paral = 32;
   SetParallelism(paral);
@@ -247,4 +453,240 @@ TEST(CoreFrame, CreateFrameInfoMultiParal) {
   SetParallelism(0);
 }
 
+TEST(CoreFrame, WaitAndCreateBlocksUntilRelease) {
+  SetParallelism(2);
+  uint32_t handle = InternStreamId("credit_stream");
+  auto first = CNFrameInfo::Create(handle);
+  auto second = CNFrameInfo::WaitAndCreate(handle, std::chrono::milliseconds(10));
+  ASSERT_NE(first, nullptr);
+  ASSERT_NE(second, nullptr);
+  EXPECT_EQ(CNFrameInfo::Create(handle), nullptr);
+  EXPECT_EQ(CNFrameInfo::WaitAndCreate(handle, std::chrono::milliseconds(10)), nullptr);
+  // eos frames are not limited
+  EXPECT_NE(CNFrameInfo::Create(handle, true), nullptr);
+
+  std::shared_ptr<CNFrameInfo> third;
+  double wait_ms = 0, cpu_ms = 0;
+  std::thread waiter([&] {
+    timespec cpu_start, cpu_end;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_start);
+    auto start = std::chrono::steady_clock::now();
+    third = CNFrameInfo::WaitAndCreate(handle, std::chrono::seconds(5));
+    wait_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_end);
+    cpu_ms = (cpu_end.tv_sec - cpu_start.tv_sec) * 1e3 + (cpu_end.tv_nsec - cpu_start.tv_nsec) / 1e6;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  first.reset();
+  waiter.join();
+  ASSERT_NE(third, nullptr);
+  EXPECT_GE(wait_ms, 90);
+  // the waiting thread sleeps instead of polling
+  EXPECT_LT(cpu_ms, 10);
+  SetParallelism(0);
+}
+
+TEST(CoreFrame, InternStreamId) {
+  uint32_t handle = InternStreamId("intern_stream_0");
+  EXPECT_NE(handle, INVALID_STREAM_HANDLE);
+  EXPECT_EQ(InternStreamId("intern_stream_0"), handle);
+  EXPECT_NE(InternStreamId("intern_stream_1"), handle);
+  EXPECT_EQ(GetInternedStreamId(handle), "intern_stream_0");
+  EXPECT_EQ(InternStreamId(""), INVALID_STREAM_HANDLE);
+  EXPECT_TRUE(GetInternedStreamId(INVALID_STREAM_HANDLE).empty());
+
+  auto data = CNFrameInfo::Create("intern_stream_0");
+  ASSERT_NE(data, nullptr);
+  EXPECT_EQ(data->frame.stream_handle, handle);
+  data = CNFrameInfo::Create(handle, true);
+  ASSERT_NE(data, nullptr);
+  EXPECT_EQ(data->frame.stream_id, "intern_stream_0");
+  EXPECT_EQ(data->frame.stream_handle, handle);
+  // the frame refers to the interned string
+  EXPECT_EQ(data->frame.stream_id.c_str(), GetInternedStreamId(handle).c_str());
+  std::string stream_id = data->frame.stream_id;
+  EXPECT_EQ(stream_id, data->frame.stream_id);
+  EXPECT_EQ(CNFrameInfo::Create(INVALID_STREAM_HANDLE), nullptr);
+}
+
+TEST(CoreFrame, InternStreamIdMultiThreads) {
+  const int kThreadNum = 4, kStreamNum = 300;
+  std::vector<std::vector<uint32_t>> handles(kThreadNum);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreadNum; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < kStreamNum; ++i) handles[t].push_back(InternStreamId("mt_stream_" + std::to_string(i)));
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  for (int i = 0; i < kStreamNum; ++i) {
+    for (int t = 1; t < kThreadNum; ++t) EXPECT_EQ(handles[t][i], handles[0][i]);
+    EXPECT_EQ(GetInternedStreamId(handles[0][i]), "mt_stream_" + std::to_string(i));
+  }
+}
+
+static void FillFramePool(CNFrameInfo* data) {
+  static uint8_t pixels[64 * 48 * 3 / 2];
+  data->channel_idx = 0;
+  data->frame.ctx.dev_type = DevContext::CPU;
+  data->frame.fmt = CN_PIXEL_FORMAT_YUV420_NV12;
+  data->frame.width = 64;
+  data->frame.height = 48;
+  data->frame.stride[0] = data->frame.stride[1] = 64;
+  data->frame.ptr[0] = pixels;
+  data->frame.ptr[1] = pixels + 64 * 48;
+  data->frame.CopyToSyncMem();
+  data->objs.push_back(std::make_shared<CNInferObject>());
+}
+
+TEST(CoreFrame, FramePoolSteadyState) {
+  const int kInFlight = 4;
+  auto run = [&](int cycles) {
+    for (int c = 0; c < cycles; ++c) {
+      std::vector<std::shared_ptr<CNFrameInfo>> frames;
+      for (int i = 0; i < kInFlight; ++i) {
+        frames.push_back(CNFrameInfo::Create("0"));
+        ASSERT_NE(frames.back(), nullptr);
+        FillFramePool(frames.back().get());
+      }
+    }
+  };
+  run(2);  // warm up the pools
+  CNFramePoolStats before = GetFramePoolStats();
+  run(100);
+  CNFramePoolStats after = GetFramePoolStats();
+  EXPECT_EQ(after.frame_heap_allocs, before.frame_heap_allocs);
+  EXPECT_EQ(after.block_heap_allocs, before.block_heap_allocs);
+  EXPECT_EQ(after.frame_reuses - before.frame_reuses, (uint64_t)(100 * kInFlight));
+  EXPECT_GE(after.block_reuses - before.block_reuses, (uint64_t)(100 * kInFlight * 2));
+}
+
+TEST(CoreFrame, RecycledFrameIsCleared) {
+  CNFrameInfo* raw = nullptr;
+  {
+    auto data = CNFrameInfo::Create("0");
+    ASSERT_NE(data, nullptr);
+    FillFramePool(data.get());
+    data->frame.flags = 1 << 1;
+    data->frame.frame_id = 10;
+    data->meta.Set(RegisterMetaKey<int64_t>("meta_test_recycle"), int64_t(1));
+    raw = data.get();
+  }
+  auto data = CNFrameInfo::Create("1");
+  ASSERT_NE(data, nullptr);
+  // the pool hands out the latest released frame first
+  EXPECT_EQ(data.get(), raw);
+  EXPECT_EQ(data->frame.stream_id, "1");
+  EXPECT_EQ(data->frame.flags, (size_t)0);
+  EXPECT_EQ(data->frame.frame_id, 0);
+  EXPECT_EQ(data->frame.fmt, CN_INVALID);
+  EXPECT_EQ(data->frame.ctx.dev_type, DevContext::INVALID);
+  EXPECT_EQ(data->channel_idx, INVALID_STREAM_IDX);
+  EXPECT_TRUE(data->objs.empty());
+  EXPECT_FALSE(data->meta.Has(FindMetaKey<int64_t>("meta_test_recycle")));
+  for (int i = 0; i < CN_MAX_PLANES; ++i) {
+    EXPECT_EQ(data->frame.data[i], nullptr);
+    EXPECT_EQ(data->frame.ptr[i], nullptr);
+  }
+  EXPECT_EQ(data->frame.cpu_data, nullptr);
+}
+
+class MaskTestModule : public Module {
+ public:
+  explicit MaskTestModule(const std::string& name) : Module(name) {}
+  bool Open(ModuleParamSet paramSet) override { return true; }
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> data) override { return 0; }
+};  // class MaskTestModule
+
+TEST(CoreFrame, ModuleMask) {
+  MaskTestModule left("left"), right("right"), join("join");
+  // ids beyond the inline masks go to the masks allocated on demand
+  for (size_t join_id : {(size_t)3, (size_t)GetMaxModuleNumber() - 1}) {
+    left.SetId(1);
+    right.SetId(2);
+    join.SetId(join_id);
+    join.SetParentId(left.GetId());
+    join.SetParentId(right.GetId());
+    auto data = CNFrameInfo::Create("0");
+    EXPECT_EQ(data->frame.GetModulesMask(&join), (uint64_t)0);
+    data->frame.SetModuleMask(&join, &left);
+    EXPECT_NE(data->frame.GetModulesMask(&join), join.GetModulesMask());
+    data->frame.SetModuleMask(&join, &right);
+    EXPECT_EQ(data->frame.GetModulesMask(&join), join.GetModulesMask());
+    data->frame.ClearModuleMask(&join);
+    EXPECT_EQ(data->frame.GetModulesMask(&join), (uint64_t)0);
+    data->frame.SetModuleMask(&join, &right);
+    data->frame.ResetModuleMask();
+    EXPECT_EQ(data->frame.GetModulesMask(&join), (uint64_t)0);
+
+    EXPECT_EQ(data->frame.AddEOSCount(), 1u);
+    EXPECT_EQ(data->frame.AddEOSCount(), 2u);
+    data->frame.ResetModuleMask();
+    EXPECT_EQ(data->frame.AddEOSCount(), 1u);
+  }
+}
+
+TEST(CoreFrame, Detections) {
+  CNDetections dets;
+  EXPECT_TRUE(dets.Empty());
+  CNInferBoundingBox bbox = {0.1, 0.2, 0.3, 0.4};
+  EXPECT_EQ(dets.Add(bbox, 0.9, 2), 0u);
+  EXPECT_EQ(dets.Add(bbox, 0.8, -1, 7), 1u);
+  EXPECT_EQ(dets.Size(), 2u);
+  EXPECT_EQ(dets.TrackIds()[0], -1);
+  dets.SetTrackId(0, 3);
+  EXPECT_EQ(dets.TrackIds()[0], 3);
+  float feature[] = {0.1, 0.2, 0.3};
+  dets.SetFeature(1, feature, 3);
+  size_t len;
+  EXPECT_EQ(dets.GetFeature(0, &len), nullptr);
+  EXPECT_EQ(len, 0u);
+  const float* got = dets.GetFeature(1, &len);
+  ASSERT_EQ(len, 3u);
+  EXPECT_EQ(got[2], feature[2]);
+
+  std::vector<std::shared_ptr<CNInferObject>> objs;
+  dets.ToObjects(&objs);
+  ASSERT_EQ(objs.size(), 2u);
+  EXPECT_EQ(objs[0]->id, "2");
+  EXPECT_EQ(objs[0]->track_id, "3");
+  EXPECT_FLOAT_EQ(objs[0]->score, 0.9);
+  EXPECT_FLOAT_EQ(objs[0]->bbox.w, 0.3);
+  EXPECT_TRUE(objs[0]->GetFeatures().empty());
+  EXPECT_EQ(objs[1]->id, "");
+  EXPECT_EQ(objs[1]->track_id, "7");
+  ASSERT_EQ(objs[1]->GetFeatures().size(), 1u);
+  EXPECT_EQ(objs[1]->GetFeatures()[0], CNInferFeature(feature, feature + 3));
+
+  objs[1]->id = "car";
+  CNDetections converted;
+  converted.FromObjects(objs);
+  ASSERT_EQ(converted.Size(), 2u);
+  EXPECT_EQ(converted.ClassIds()[0], 2);
+  EXPECT_EQ(converted.ClassIds()[1], -1);
+  EXPECT_EQ(converted.TrackIds()[1], 7);
+  EXPECT_NE(converted.GetFeature(1, &len), nullptr);
+  EXPECT_EQ(len, 3u);
+
+  dets.Clear();
+  EXPECT_TRUE(dets.Empty());
+  EXPECT_EQ(dets.Add(bbox, 0.7, 1), 0u);
+  EXPECT_EQ(dets.GetFeature(0, &len), nullptr);
+}
+
+TEST(CoreFrame, RecycledFrameKeepsDetections) {
+  CNFrameInfo* raw = nullptr;
+  {
+    auto data = CNFrameInfo::Create("0");
+    ASSERT_NE(data, nullptr);
+    data->dets.Add({0, 0, 1, 1}, 1, 0);
+    raw = data.get();
+  }
+  auto data = CNFrameInfo::Create("0");
+  ASSERT_NE(data, nullptr);
+  EXPECT_EQ(data.get(), raw);
+  EXPECT_TRUE(data->dets.Empty());
+}
+
 }  // namespace cnstream
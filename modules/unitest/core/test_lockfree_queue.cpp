@@ -0,0 +1,155 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "lockfree_queue.hpp"
+#include "threadsafe_queue.hpp"
+
+namespace cnstream {
+
+static const int kLockFreeTestCapacity = 20;
+
+/* pushes `count` values per producer and checks every value is popped exactly once */
+static void CheckNoLossNoDup(BoundedQueue<int>* queue, int producer_num, int count) {
+  std::vector<std::atomic<int>> seen(producer_num * count);
+  for (auto& it : seen) it.store(0);
+  std::vector<std::thread> producers;
+  for (int p = 0; p < producer_num; ++p) {
+    producers.emplace_back([queue, p, count]() {
+      for (int i = 0; i < count; ++i) EXPECT_TRUE(queue->WaitAndPush(p * count + i));
+    });
+  }
+  int value = -1;
+  for (int i = 0; i < producer_num * count; ++i) {
+    ASSERT_TRUE(queue->WaitAndPop(value));
+    ASSERT_GE(value, 0);
+    ASSERT_LT(value, producer_num * count);
+    seen[value]++;
+  }
+  for (auto& it : producers) it.join();
+  EXPECT_TRUE(queue->Empty());
+  for (auto& it : seen) EXPECT_EQ(1, it.load());
+}
+
+TEST(CoreLockFreeQueue, MpmcRingBuffer) {
+  MpmcRingBuffer<int> ring(3);
+  EXPECT_EQ(3u, ring.Capacity());
+  int value = 0;
+  EXPECT_FALSE(ring.TryPop(value));
+  for (int i = 0; i < 3; ++i) EXPECT_TRUE(ring.TryPush(i));
+  int extra = 3;
+  EXPECT_FALSE(ring.TryPush(extra));
+  EXPECT_EQ(3u, ring.Size());
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_TRUE(ring.TryPop(value));
+    EXPECT_EQ(i, value);
+  }
+  EXPECT_FALSE(ring.TryPop(value));
+  EXPECT_EQ(0u, ring.Size());
+}
+
+TEST(CoreLockFreeQueue, SpscRingBuffer) {
+  SpscRingBuffer<int> ring(3);
+  EXPECT_EQ(3u, ring.Capacity());
+  int value = 0;
+  EXPECT_FALSE(ring.TryPop(value));
+  for (int round = 0; round < 5; ++round) {
+    for (int i = 0; i < 3; ++i) EXPECT_TRUE(ring.TryPush(i));
+    int extra = 3;
+    EXPECT_FALSE(ring.TryPush(extra));
+    for (int i = 0; i < 3; ++i) {
+      EXPECT_TRUE(ring.TryPop(value));
+      EXPECT_EQ(i, value);
+    }
+    EXPECT_FALSE(ring.TryPop(value));
+  }
+}
+
+TEST(CoreLockFreeQueue, MoveOnlyOnSuccess) {
+  MpmcRingBuffer<std::shared_ptr<int>> ring(1);
+  std::shared_ptr<int> first = std::make_shared<int>(1);
+  std::shared_ptr<int> second = std::make_shared<int>(2);
+  EXPECT_TRUE(ring.TryPush(first));
+  EXPECT_FALSE(ring.TryPush(second));
+  // a failed push must leave the value with the caller
+  ASSERT_NE(nullptr, second);
+  EXPECT_EQ(2, *second);
+}
+
+TEST(CoreLockFreeQueue, MpmcMultiProducer) {
+  BlockingRingQueue<MpmcRingBuffer<int>> queue(kLockFreeTestCapacity);
+  CheckNoLossNoDup(&queue, 4, 10000);
+}
+
+TEST(CoreLockFreeQueue, SpscSingleProducer) {
+  BlockingRingQueue<SpscRingBuffer<int>> queue(kLockFreeTestCapacity);
+  CheckNoLossNoDup(&queue, 1, 40000);
+}
+
+TEST(CoreLockFreeQueue, BlockingPush) {
+  BlockingRingQueue<MpmcRingBuffer<int>> queue(2);
+  EXPECT_TRUE(queue.WaitAndPush(0));
+  EXPECT_TRUE(queue.WaitAndPush(1));
+  std::atomic<bool> pushed{false};
+  std::thread producer([&]() {
+    EXPECT_TRUE(queue.WaitAndPush(2));
+    pushed = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_FALSE(pushed.load());
+  int value = -1;
+  EXPECT_TRUE(queue.WaitAndPop(value));
+  producer.join();
+  EXPECT_TRUE(pushed.load());
+  EXPECT_EQ(0, value);
+
+  EXPECT_EQ(2u, queue.Size());
+  EXPECT_TRUE(queue.TryPop(value));
+  EXPECT_EQ(1, value);
+  EXPECT_TRUE(queue.TryPop(value));
+  EXPECT_EQ(2, value);
+}
+
+TEST(CoreLockFreeQueue, StopWakesWaiters) {
+  BlockingRingQueue<MpmcRingBuffer<int>> queue(1);
+  std::thread consumer([&]() {
+    int value;
+    EXPECT_FALSE(queue.WaitAndPop(value));
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  queue.Stop();
+  consumer.join();
+  queue.Start();
+  EXPECT_TRUE(queue.WaitAndPush(1));
+  std::thread producer([&]() { EXPECT_FALSE(queue.WaitAndPush(2)); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  queue.Stop();
+  producer.join();
+}
+
+}  // namespace cnstream
@@ -72,15 +72,20 @@ TEST(CoreModule, ModuleMask) {
 
   ModuleParamSet params;
   ASSERT_TRUE(module.Open(params));
-  EXPECT_EQ(module.GetId(), (uint32_t)0);
+  // ids are allocated by the pipeline
+  EXPECT_EQ(module.GetId(), INVALID_MODULE_ID);
   for (uint32_t i = 0; i < mask_len; ++i) {
     module.SetParentId(rand_r(&seed) % mask_len);
   }
   std::vector<size_t> p_ids = module.GetParentIds();
   for (auto &id : p_ids) {
-    mask |= (uint64_t)1 << id;
+    // upstream nodes are unique and each one owns a bit
+    EXPECT_EQ(module.GetParentMask(id) & mask, (uint64_t)0);
+    mask |= module.GetParentMask(id);
   }
   EXPECT_EQ(module.GetModulesMask(), mask);
+  EXPECT_EQ(mask, ((uint64_t)1 << p_ids.size()) - 1);
+  EXPECT_EQ(module.GetParentMask(mask_len), (uint64_t)0);
   module.Close();
 }
 
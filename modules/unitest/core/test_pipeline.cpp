@@ -19,9 +19,12 @@
  *************************************************************************/
 
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <chrono>
 #include <condition_variable>
 #include <ctime>
+#include <fstream>
+#include <map>
 #include <future>
 #include <memory>
 #include <mutex>
@@ -29,9 +32,12 @@
 #include <set>
 #include <string>
 #include <utility>
+#include <thread>
 #include <vector>
+#include "cnstream_devmem.hpp"
 #include "cnstream_frame.hpp"
 #include "cnstream_pipeline.hpp"
+#include "cnstream_trace.hpp"
 #include "test_base.hpp"
 
 namespace cnstream {
@@ -424,6 +430,7 @@ TEST(CorePipeline, ParseByJSONStrDefault) {
   EXPECT_EQ(m_cfg.className, "test");
   EXPECT_EQ(m_cfg.parallelism, 1);
   EXPECT_EQ(m_cfg.maxInputQueueSize, 20);
+  EXPECT_EQ(m_cfg.inputQueueType, LINK_QUEUE_MUTEX);
   EXPECT_EQ(m_cfg.next.size(), (unsigned int)0);
   EXPECT_EQ(m_cfg.parameters.size(), (unsigned int)0);
 }
@@ -472,6 +479,38 @@ TEST(CorePipeline, ParseByJSONStrMaxInputQueueError) {
   EXPECT_ANY_THROW(m_cfg.ParseByJSONStr(json_str));
 }
 
+TEST(CorePipeline, ParseByJSONStrQueueType) {
+  CNModuleConfig m_cfg;
+  m_cfg.ParseByJSONStr("{\"class_name\":\"test\",\"queue_type\":\"mpmc\"}");
+  EXPECT_EQ(m_cfg.inputQueueType, LINK_QUEUE_MPMC);
+  m_cfg.ParseByJSONStr("{\"class_name\":\"test\",\"queue_type\":\"spsc\"}");
+  EXPECT_EQ(m_cfg.inputQueueType, LINK_QUEUE_SPSC);
+  m_cfg.ParseByJSONStr("{\"class_name\":\"test\",\"queue_type\":\"mutex\"}");
+  EXPECT_EQ(m_cfg.inputQueueType, LINK_QUEUE_MUTEX);
+  // queue type must be one of the known backends
+  EXPECT_ANY_THROW(m_cfg.ParseByJSONStr("{\"class_name\":\"test\",\"queue_type\":\"lockfree\"}"));
+  EXPECT_ANY_THROW(m_cfg.ParseByJSONStr("{\"class_name\":\"test\",\"queue_type\":1}"));
+}
+
+TEST(CorePipeline, ParseByJSONStrOverflowPolicy) {
+  CNModuleConfig m_cfg;
+  m_cfg.ParseByJSONStr("{\"class_name\":\"test\"}");
+  EXPECT_EQ(m_cfg.inputOverflowPolicy, LINK_OVERFLOW_BLOCK);
+  EXPECT_EQ(m_cfg.inputKeepLatestNum, 1u);
+  m_cfg.ParseByJSONStr("{\"class_name\":\"test\",\"overflow_policy\":\"drop_oldest\"}");
+  EXPECT_EQ(m_cfg.inputOverflowPolicy, LINK_OVERFLOW_DROP_OLDEST);
+  m_cfg.ParseByJSONStr("{\"class_name\":\"test\",\"overflow_policy\":\"drop_newest\"}");
+  EXPECT_EQ(m_cfg.inputOverflowPolicy, LINK_OVERFLOW_DROP_NEWEST);
+  m_cfg.ParseByJSONStr("{\"class_name\":\"test\",\"overflow_policy\":\"keep_latest_n\",\"keep_latest_num\":3}");
+  EXPECT_EQ(m_cfg.inputOverflowPolicy, LINK_OVERFLOW_KEEP_LATEST_N);
+  EXPECT_EQ(m_cfg.inputKeepLatestNum, 3u);
+  m_cfg.ParseByJSONStr("{\"class_name\":\"test\",\"overflow_policy\":\"block\"}");
+  EXPECT_EQ(m_cfg.inputOverflowPolicy, LINK_OVERFLOW_BLOCK);
+  EXPECT_ANY_THROW(m_cfg.ParseByJSONStr("{\"class_name\":\"test\",\"overflow_policy\":\"drop\"}"));
+  EXPECT_ANY_THROW(m_cfg.ParseByJSONStr("{\"class_name\":\"test\",\"overflow_policy\":0}"));
+  EXPECT_ANY_THROW(m_cfg.ParseByJSONStr("{\"class_name\":\"test\",\"keep_latest_num\":0}"));
+}
+
 TEST(CorePipeline, ParseByJSONStrNextModuleError) {
   CNModuleConfig m_cfg;
   // next module must be array
@@ -607,6 +646,40 @@ TEST(CorePipeline, AddModuleExcessPipelineCapacity) {
   EXPECT_EQ(module->GetId(), (size_t)-1);
 }
 
+TEST(CorePipeline, ModuleIdsArePipelineScoped) {
+  auto module = std::make_shared<TestModule>("test_module");
+  EXPECT_EQ(module->GetId(), INVALID_MODULE_ID);
+  {
+    Pipeline pipeline1("test pipeline1");
+    Pipeline pipeline2("test pipeline2");
+    auto other = std::make_shared<TestModule>("other_module");
+    EXPECT_TRUE(pipeline1.AddModule(module));
+    EXPECT_TRUE(pipeline2.AddModule(other));
+    // both pipelines number their modules from 1
+    EXPECT_EQ(module->GetId(), (size_t)1);
+    EXPECT_EQ(other->GetId(), (size_t)1);
+    // a module belongs to one pipeline
+    EXPECT_FALSE(pipeline2.AddModule(module));
+  }
+  // the id is returned when the pipeline is destroyed
+  EXPECT_EQ(module->GetId(), INVALID_MODULE_ID);
+  Pipeline pipeline3("test pipeline3");
+  EXPECT_TRUE(pipeline3.AddModule(module));
+  EXPECT_EQ(module->GetId(), (size_t)1);
+}
+
+TEST(CorePipeline, LinkTooManyUpstreamModules) {
+  Pipeline pipeline("test pipeline");
+  auto join = std::make_shared<TestModule>("join");
+  EXPECT_TRUE(pipeline.AddModule(join));
+  for (size_t i = 0; i <= Module::kMaxParentNum; ++i) {
+    auto up = std::make_shared<TestModule>("up" + std::to_string(i));
+    EXPECT_TRUE(pipeline.AddModule(up));
+    EXPECT_EQ(pipeline.LinkModules(up, join).empty(), i == Module::kMaxParentNum);
+  }
+  EXPECT_EQ(join->GetModulesMask(), ~(uint64_t)0);
+}
+
 TEST(CorePipeline, SetAndGetModuleParallelism) {
   Pipeline pipeline("test pipeline");
   auto module = std::make_shared<TestModule>("test_module");
@@ -1114,6 +1187,26 @@ TEST(CorePipeline, BuildPipelineByJSONFileFailed) {
   EXPECT_ANY_THROW(pipeline.BuildPipelineByJSONFile(name_error_file_path));
 }
 
+TEST(CorePipeline, ParsePipelineJSONFile) {
+  std::string file_path = GetExePath() + "../../modules/unitest/core/data/pipeline.json";
+  std::vector<CNModuleConfig> configs = ParsePipelineJSONFile(file_path);
+  std::map<std::string, CNModuleConfig> config_map;
+  for (auto& config : configs) config_map[config.name] = config;
+  ASSERT_EQ(configs.size(), config_map.size());
+  ASSERT_EQ(1u, config_map.count("source"));
+  EXPECT_EQ("cnstream::DataSource", config_map["source"].className);
+  EXPECT_EQ(std::vector<std::string>{"detector"}, config_map["source"].next);
+  ASSERT_EQ(1u, config_map.count("detector"));
+  EXPECT_EQ(4, config_map["detector"].parallelism);
+  EXPECT_EQ(20, config_map["detector"].maxInputQueueSize);
+  EXPECT_EQ("subnet0", config_map["detector"].parameters["func_name"]);
+  EXPECT_EQ(1u, config_map["detector"].parameters.count(CNS_JSON_DIR_PARAM_NAME));
+
+  EXPECT_ANY_THROW(ParsePipelineJSONFile(""));
+  EXPECT_ANY_THROW(ParsePipelineJSONFile(GetExePath() + "../../modules/unitest/core/data/parse_error.json"));
+  EXPECT_ANY_THROW(ParsePipelineJSONFile(GetExePath() + "../../modules/unitest/core/data/name_error.json"));
+}
+
 TEST(CorePipeline, GetModule) {
   Pipeline pipeline("test pipeline");
   std::vector<CNModuleConfig> m_cfgs = GetCfg();
@@ -1148,4 +1241,852 @@ TEST(CorePipeline, StreamMsgObserver) {
   pipeline.NotifyStreamMsg(msg);
 }
 
+class OrderChecker : public Module {
+ public:
+  OrderChecker(const std::string& name, uint32_t chn_num, uint32_t expected)
+      : Module(name), last_frame_id_(chn_num, -1), expected_(expected) {}
+  bool Open(ModuleParamSet paramSet) override { return true; }
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> data) override {
+    std::lock_guard<std::mutex> lk(mtx_);
+    int64_t& last = last_frame_id_[data->channel_idx];
+    if (data->frame.frame_id != last + 1) disordered_ = true;
+    last = data->frame.frame_id;
+    if (++count_ == expected_) done_.set_value();
+    return 0;
+  }
+  std::future<void> GetDoneFuture() { return done_.get_future(); }
+  bool Disordered() const { return disordered_; }
+
+ private:
+  std::mutex mtx_;
+  std::vector<int64_t> last_frame_id_;
+  uint32_t expected_ = 0;
+  uint32_t count_ = 0;
+  bool disordered_ = false;
+  std::promise<void> done_;
+};  // class OrderChecker
+
+/*
+            /--> branch1(p3) --\
+  source --|                    |--> join(p2) --> checker(p2)
+            \--> branch2(p2) --/
+ */
+TEST(CorePipeline, WorkStealingExecutorKeepsChannelOrder) {
+  const uint32_t kChnNum = 8, kFrameNum = 300;
+  Pipeline pipeline("executor pipeline");
+  EXPECT_EQ(EXECUTOR_THREAD_PER_CONVEYOR, pipeline.GetExecutorType());
+  EXPECT_TRUE(pipeline.SetExecutor(EXECUTOR_WORK_STEALING, 3));
+  EXPECT_EQ(EXECUTOR_WORK_STEALING, pipeline.GetExecutorType());
+  auto source = std::make_shared<TestModule>("ws_source");
+  auto branch1 = std::make_shared<TestModule>("ws_branch1");
+  auto branch2 = std::make_shared<TestModule>("ws_branch2");
+  auto join = std::make_shared<TestModule>("ws_join");
+  auto checker = std::make_shared<OrderChecker>("ws_checker", kChnNum, kChnNum * kFrameNum);
+  for (auto module : std::vector<std::shared_ptr<Module>>{source, branch1, branch2, join, checker}) {
+    EXPECT_TRUE(pipeline.AddModule(module));
+  }
+  pipeline.SetModuleParallelism(branch1, 3);
+  pipeline.SetModuleParallelism(branch2, 2);
+  pipeline.SetModuleParallelism(join, 2);
+  pipeline.SetModuleParallelism(checker, 2);
+  // short queues keep the workers under backpressure
+  EXPECT_NE(pipeline.LinkModules(source, branch1, 2), "");
+  EXPECT_NE(pipeline.LinkModules(source, branch2, 2, LINK_QUEUE_MPMC), "");
+  EXPECT_NE(pipeline.LinkModules(branch1, join, 2), "");
+  EXPECT_NE(pipeline.LinkModules(branch2, join, 2, LINK_QUEUE_MPMC), "");
+  EXPECT_NE(pipeline.LinkModules(join, checker, 2), "");
+  auto done = checker->GetDoneFuture();
+  EXPECT_TRUE(pipeline.Start());
+  EXPECT_FALSE(pipeline.SetExecutor(EXECUTOR_THREAD_PER_CONVEYOR));
+  for (uint32_t i = 0; i < kFrameNum; ++i) {
+    for (uint32_t chn = 0; chn < kChnNum; ++chn) {
+      auto data = CNFrameInfo::Create(std::to_string(chn));
+      data->channel_idx = chn;
+      data->frame.frame_id = i;
+      EXPECT_TRUE(pipeline.ProvideData(source.get(), data));
+    }
+  }
+  EXPECT_EQ(std::future_status::ready, done.wait_for(std::chrono::seconds(60)));
+  EXPECT_TRUE(pipeline.Stop());
+  EXPECT_FALSE(checker->Disordered());
+}
+
+/*************************************************************************************************
+                                        benchmark
+**************************************************************************************************/
+static int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+class LatencyProbe : public Module {
+ public:
+  LatencyProbe(const std::string& name, uint32_t expected) : Module(name), expected_(expected) {}
+  bool Open(ModuleParamSet paramSet) override { return true; }
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> data) override {
+    // called by as many threads as the parallelism
+    total_ns_ += NowNs() - data->frame.timestamp;
+    if (count_.fetch_add(1) + 1 == expected_) done_.set_value();
+    return 0;
+  }
+  std::future<void> GetDoneFuture() { return done_.get_future(); }
+  double AvgLatencyMs() const { return count_ ? total_ns_ / 1e6 / count_ : 0; }
+
+ private:
+  uint32_t expected_ = 0;
+  std::atomic<uint32_t> count_{0};
+  std::atomic<int64_t> total_ns_{0};
+  std::promise<void> done_;
+};  // class LatencyProbe
+
+class EosPromise : public StreamMsgObserver {
+ public:
+  void Update(const StreamMsg& msg) override {
+    if (EOS_MSG == msg.type) done_.set_value();
+  }
+  std::future<void> GetDoneFuture() { return done_.get_future(); }
+
+ private:
+  std::promise<void> done_;
+};  // class EosPromise
+
+/*
+                                       /--> left  --\
+  source ---> hop1 ... hop96 ---> fork |             |--> probe
+                                       \--> right --/
+  the join happens at a module id beyond 64, two such pipelines live in the process at the same time.
+ */
+TEST(CorePipeline, MoreThan64Modules) {
+  const int kHops = 96;
+  const uint32_t kFrameNum = 100;
+  std::vector<std::shared_ptr<Pipeline>> pipelines;
+  std::vector<std::future<void>> frames_done, eos_done;
+  std::vector<std::shared_ptr<Module>> sources;
+  EosPromise observers[2];
+  for (int p = 0; p < 2; ++p) {
+    auto pipeline = std::make_shared<Pipeline>("large pipeline" + std::to_string(p));
+    auto source = std::make_shared<TestModule>("large_source");
+    auto left = std::make_shared<TestModule>("large_left");
+    auto right = std::make_shared<TestModule>("large_right");
+    auto probe = std::make_shared<LatencyProbe>("large_probe", kFrameNum);
+    std::vector<std::shared_ptr<Module>> chain = {source};
+    for (int i = 0; i <= kHops; ++i) chain.push_back(std::make_shared<TestModule>("large_hop" + std::to_string(i)));
+    for (auto& module : chain) EXPECT_TRUE(pipeline->AddModule(module));
+    for (auto module : std::vector<std::shared_ptr<Module>>{left, right, probe}) {
+      EXPECT_TRUE(pipeline->AddModule(module));
+    }
+    EXPECT_GT(probe->GetId(), (size_t)64);
+    for (size_t i = 0; i + 1 < chain.size(); ++i) EXPECT_NE(pipeline->LinkModules(chain[i], chain[i + 1]), "");
+    EXPECT_NE(pipeline->LinkModules(chain.back(), left), "");
+    EXPECT_NE(pipeline->LinkModules(chain.back(), right), "");
+    EXPECT_NE(pipeline->LinkModules(left, probe), "");
+    EXPECT_NE(pipeline->LinkModules(right, probe), "");
+    pipeline->SetStreamMsgObserver(&observers[p]);
+    frames_done.push_back(probe->GetDoneFuture());
+    eos_done.push_back(observers[p].GetDoneFuture());
+    ASSERT_TRUE(pipeline->Start());
+    pipelines.push_back(pipeline);
+    sources.push_back(source);
+  }
+  for (int p = 0; p < 2; ++p) {
+    for (uint32_t i = 0; i <= kFrameNum; ++i) {
+      auto data = CNFrameInfo::Create("0", i == kFrameNum);
+      data->channel_idx = 0;
+      data->frame.timestamp = NowNs();
+      EXPECT_TRUE(pipelines[p]->ProvideData(sources[p].get(), data));
+    }
+  }
+  for (int p = 0; p < 2; ++p) {
+    EXPECT_EQ(std::future_status::ready, frames_done[p].wait_for(std::chrono::seconds(30)));
+    EXPECT_EQ(std::future_status::ready, eos_done[p].wait_for(std::chrono::seconds(30)));
+    EXPECT_TRUE(pipelines[p]->Stop());
+  }
+}
+
+/*
+  source ---> hop1 ---> hop2 ---> hop3 ---> hop4 ---> probe
+  returns the average added delay per hop in milliseconds.
+ */
+static double MeasureChainPerHopLatency(size_t queue_capacity, uint32_t frame_cnt, std::chrono::microseconds interval) {
+  const int kHops = 5;
+  Pipeline pipeline("latency pipeline");
+  auto source = std::make_shared<TestModule>("bench_source");
+  auto probe = std::make_shared<LatencyProbe>("bench_probe", frame_cnt);
+  std::vector<std::shared_ptr<Module>> chain = {source};
+  for (int i = 1; i < kHops; ++i) chain.push_back(std::make_shared<TestModule>("bench_hop" + std::to_string(i)));
+  chain.push_back(probe);
+  for (auto& module : chain) EXPECT_TRUE(pipeline.AddModule(module));
+  for (size_t i = 0; i + 1 < chain.size(); ++i) {
+    EXPECT_NE(pipeline.LinkModules(chain[i], chain[i + 1], queue_capacity), "");
+  }
+  auto done = probe->GetDoneFuture();
+  EXPECT_TRUE(pipeline.Start());
+  for (uint32_t i = 0; i < frame_cnt; ++i) {
+    auto data = CNFrameInfo::Create("0");
+    data->channel_idx = 0;
+    data->frame.frame_id = i;
+    data->frame.timestamp = NowNs();
+    EXPECT_TRUE(pipeline.ProvideData(source.get(), data));
+    if (interval.count()) std::this_thread::sleep_for(interval);
+  }
+  EXPECT_EQ(std::future_status::ready, done.wait_for(std::chrono::seconds(60)));
+  EXPECT_TRUE(pipeline.Stop());
+  return probe->AvgLatencyMs() / kHops;
+}
+
+class BusyModule : public Module {
+ public:
+  BusyModule(const std::string& name, std::chrono::microseconds cost) : Module(name), cost_(cost) {}
+  bool Open(ModuleParamSet paramSet) override { return true; }
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> data) override {
+    auto end = std::chrono::steady_clock::now() + cost_;
+    while (std::chrono::steady_clock::now() < end) {
+    }
+    ++processed;
+    return 0;
+  }
+  std::atomic<uint32_t> processed{0};
+
+ private:
+  std::chrono::microseconds cost_;
+};  // class BusyModule
+
+/*
+  source ---> busy sink, the sink is 10 times slower than the source.
+  a drop-oldest link sheds the load instead of blocking the source, and the eos frame still arrives.
+ */
+TEST(CorePipeline, OverflowPolicyShedsLoad) {
+  const uint32_t kFrameNum = 300;
+  Pipeline pipeline("overload pipeline");
+  EosPromise observer;
+  pipeline.SetStreamMsgObserver(&observer);
+  auto source = std::make_shared<TestModule>("overload_source");
+  auto sink = std::make_shared<BusyModule>("overload_sink", std::chrono::microseconds(500));
+  EXPECT_TRUE(pipeline.AddModule(source));
+  EXPECT_TRUE(pipeline.AddModule(sink));
+  std::string link_id = pipeline.LinkModules(source, sink, 4, LINK_QUEUE_MPMC, LINK_OVERFLOW_DROP_OLDEST);
+  EXPECT_NE(link_id, "");
+  auto eos_done = observer.GetDoneFuture();
+  ASSERT_TRUE(pipeline.Start());
+  for (uint32_t i = 0; i <= kFrameNum; ++i) {
+    auto data = CNFrameInfo::Create("0", i == kFrameNum);
+    data->channel_idx = 0;
+    data->frame.timestamp = NowNs();
+    EXPECT_TRUE(pipeline.ProvideData(source.get(), data));
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+  EXPECT_EQ(std::future_status::ready, eos_done.wait_for(std::chrono::seconds(30)));
+  LinkStatus status;
+  EXPECT_TRUE(pipeline.QueryLinkStatus(&status, link_id));
+  EXPECT_GT(status.drop_count["0"], 0u);
+  EXPECT_TRUE(pipeline.Stop());
+}
+
+/*
+  source ---> hop1 ... hopN ---> slow sink, with the work-stealing executor.
+  every queue fills up behind the sink, the workers must never all end up waiting on them.
+ */
+static void RunSaturatedChain(uint32_t worker_num, int module_num, size_t queue_capacity) {
+  const uint32_t kFrameNum = 200;
+  Pipeline pipeline("saturated pipeline");
+  EXPECT_TRUE(pipeline.SetExecutor(EXECUTOR_WORK_STEALING, worker_num));
+  EosPromise observer;
+  pipeline.SetStreamMsgObserver(&observer);
+  auto source = std::make_shared<TestModule>("saturated_source");
+  auto sink = std::make_shared<BusyModule>("saturated_sink", std::chrono::microseconds(1000));
+  std::vector<std::shared_ptr<Module>> chain = {source};
+  for (int i = 2; i < module_num; ++i) {
+    chain.push_back(std::make_shared<TestModule>("saturated_hop" + std::to_string(i)));
+  }
+  chain.push_back(sink);
+  for (auto& module : chain) EXPECT_TRUE(pipeline.AddModule(module));
+  for (size_t i = 0; i + 1 < chain.size(); ++i) {
+    EXPECT_NE(pipeline.LinkModules(chain[i], chain[i + 1], queue_capacity), "");
+  }
+  auto eos_done = observer.GetDoneFuture();
+  ASSERT_TRUE(pipeline.Start());
+  for (uint32_t i = 0; i <= kFrameNum; ++i) {
+    auto data = CNFrameInfo::Create("0", i == kFrameNum);
+    data->channel_idx = 0;
+    data->frame.frame_id = i;
+    EXPECT_TRUE(pipeline.ProvideData(source.get(), data));
+  }
+  EXPECT_EQ(std::future_status::ready, eos_done.wait_for(std::chrono::seconds(60)));
+  EXPECT_EQ(kFrameNum, sink->processed.load());
+  EXPECT_TRUE(pipeline.Stop());
+}
+
+TEST(CorePipeline, WorkStealingExecutorSaturated) {
+  RunSaturatedChain(2, 6, 2);
+  RunSaturatedChain(4, 16, 20);
+  RunSaturatedChain(1, 4, 1);
+}
+
+/*
+            /--> left  --\
+  source --|             |--> join
+            \--> right --/
+  drives TransmitData by hand and returns the average cost of one frame through the diamond in nanoseconds.
+ */
+static double MeasureDiamondTransmitNs(uint32_t frame_cnt) {
+  const uint32_t kBatch = 1000;
+  int64_t total_ns = 0;
+  for (uint32_t done = 0; done < frame_cnt; done += kBatch) {
+    // a new pipeline for each batch, so the conveyors never fill up
+    Pipeline pipeline("diamond pipeline");
+    auto source = std::make_shared<TestModule>("diamond_source");
+    auto left = std::make_shared<TestModule>("diamond_left");
+    auto right = std::make_shared<TestModule>("diamond_right");
+    auto join = std::make_shared<TestModule>("diamond_join");
+    for (auto module : std::vector<std::shared_ptr<Module>>{source, left, right, join}) pipeline.AddModule(module);
+    pipeline.LinkModules(source, left, kBatch);
+    pipeline.LinkModules(source, right, kBatch);
+    pipeline.LinkModules(left, join, kBatch);
+    pipeline.LinkModules(right, join, kBatch);
+    std::vector<std::shared_ptr<CNFrameInfo>> frames;
+    for (uint32_t i = 0; i < kBatch; ++i) frames.push_back(CNFrameInfo::Create("0"));
+    uint32_t joined = 0;
+    int64_t start = NowNs();
+    for (auto& data : frames) {
+      pipeline.TransmitData("diamond_source", data);
+      pipeline.TransmitData("diamond_left", data);
+      pipeline.TransmitData("diamond_right", data);
+      if (data->frame.GetModulesMask(join.get()) == join->GetModulesMask()) {
+        data->frame.ClearModuleMask(join.get());
+        ++joined;
+      }
+    }
+    total_ns += NowNs() - start;
+    EXPECT_EQ(kBatch, joined);
+  }
+  return static_cast<double>(total_ns) / frame_cnt;
+}
+
+TEST(CorePipeline, DiamondTransmit) { MeasureDiamondTransmitNs(1000); }
+
+TEST(CorePipeline, ChainBackpressure) {
+  // unpaced source with short queues, every frame goes through although the producers are blocked most of the time
+  MeasureChainPerHopLatency(2, 500, std::chrono::microseconds(0));
+}
+
+class CpuReader : public Module {
+ public:
+  explicit CpuReader(const std::string& name) : Module(name) { SetDataAccess(MODULE_DATA_ACCESS_CPU); }
+  bool Open(ModuleParamSet paramSet) override { return true; }
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> data) override {
+    if (!(data->frame.flags & CN_FRAME_FLAG_EOS)) {
+      // the planes were prefetched before the frame was queued
+      if (CNSyncedMemory::SYNCED == data->frame.data[0]->GetHead()) ++prefetched;
+      if (0x7f == static_cast<const uint8_t*>(data->frame.data[0]->GetCpuData())[0]) ++checked;
+    }
+    return 0;
+  }
+  std::atomic<int> prefetched{0}, checked{0};
+};  // class CpuReader
+
+TEST(CorePipeline, PrefetchForDataAccess) {
+  const int kFrameNum = 10, kWidth = 64, kHeight = 32;
+  Pipeline pipeline("prefetch pipeline");
+  EosPromise observer;
+  pipeline.SetStreamMsgObserver(&observer);
+  auto source = std::make_shared<TestModule>("prefetch_source");
+  auto reader = std::make_shared<CpuReader>("prefetch_reader");
+  EXPECT_EQ(MODULE_DATA_ACCESS_ANY, source->GetDataAccess());
+  EXPECT_EQ(MODULE_DATA_ACCESS_CPU, reader->GetDataAccess());
+  EXPECT_TRUE(pipeline.AddModule(source));
+  EXPECT_TRUE(pipeline.AddModule(reader));
+  EXPECT_NE(pipeline.LinkModules(source, reader), "");
+  auto eos_done = observer.GetDoneFuture();
+  ASSERT_TRUE(pipeline.Start());
+  std::vector<uint8_t> image(kWidth * kHeight * 3 / 2, 0x7f);
+  for (int i = 0; i <= kFrameNum; ++i) {
+    auto data = CNFrameInfo::Create("0", i == kFrameNum);
+    data->channel_idx = 0;
+    if (i < kFrameNum) {
+      // decoded on MLU
+      data->frame.ctx.dev_type = DevContext::MLU;
+      data->frame.fmt = CN_PIXEL_FORMAT_YUV420_NV12;
+      data->frame.width = kWidth;
+      data->frame.height = kHeight;
+      data->frame.stride[0] = data->frame.stride[1] = kWidth;
+      data->frame.mlu_data = DevMalloc(image.size(), 0, 0);
+      ASSERT_TRUE(DevMemcpy(data->frame.mlu_data, image.data(), image.size(), DEV_MEMCPY_HOST2DEV, 0, 0));
+      uint8_t* plane = static_cast<uint8_t*>(data->frame.mlu_data);
+      for (int p = 0; p < data->frame.GetPlanes(); ++p) {
+        data->frame.data[p] = CNSyncedMemory::Create(data->frame.GetPlaneBytes(p), 0, 0);
+        data->frame.data[p]->SetMluData(plane);
+        plane += data->frame.GetPlaneBytes(p);
+      }
+    }
+    EXPECT_TRUE(pipeline.ProvideData(source.get(), data));
+  }
+  EXPECT_EQ(std::future_status::ready, eos_done.wait_for(std::chrono::seconds(10)));
+  EXPECT_TRUE(pipeline.Stop());
+  EXPECT_EQ(kFrameNum, reader->prefetched.load());
+  EXPECT_EQ(kFrameNum, reader->checked.load());
+}
+
+class SlowSink : public Module {
+ public:
+  explicit SlowSink(const std::string& name) : Module(name) {}
+  bool Open(ModuleParamSet paramSet) override { return true; }
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> data) override {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    return 0;
+  }
+};  // class SlowSink
+
+TEST(CorePipeline, MemoryBudget) {
+  const int kFrameNum = 30, kWidth = 256, kHeight = 256;
+  // CopyToSyncMem rounds the buffer up to 64KB
+  const size_t kFrameBytes = 128 * 1024;
+  const size_t kBudget = 4 * kFrameBytes;
+  std::vector<uint8_t> image(kWidth * kHeight * 3 / 2, 0x7f);
+  for (MemoryBudgetPolicy policy : {MEMORY_BUDGET_BLOCK, MEMORY_BUDGET_DROP}) {
+    Pipeline pipeline("budget pipeline");
+    EosPromise observer;
+    pipeline.SetStreamMsgObserver(&observer);
+    auto source = std::make_shared<TestModule>("budget_source");
+    auto sink = std::make_shared<SlowSink>("budget_sink");
+    EXPECT_TRUE(pipeline.AddModule(source));
+    EXPECT_TRUE(pipeline.AddModule(sink));
+    // the queue alone could hold all the frames
+    EXPECT_NE(pipeline.LinkModules(source, sink, kFrameNum), "");
+    pipeline.SetMemoryBudget(kBudget, policy);
+    EXPECT_EQ(kBudget, pipeline.GetMemoryBudgetStatus().budget_bytes);
+    auto eos_done = observer.GetDoneFuture();
+    ASSERT_TRUE(pipeline.Start());
+    int admitted = 0;
+    for (int i = 0; i <= kFrameNum; ++i) {
+      auto data = CNFrameInfo::Create("0", i == kFrameNum);
+      data->channel_idx = 0;
+      if (i < kFrameNum) {
+        data->frame.ctx.dev_type = DevContext::CPU;
+        data->frame.fmt = CN_PIXEL_FORMAT_YUV420_NV12;
+        data->frame.width = kWidth;
+        data->frame.height = kHeight;
+        data->frame.stride[0] = data->frame.stride[1] = kWidth;
+        data->frame.ptr[0] = image.data();
+        data->frame.ptr[1] = image.data() + kWidth * kHeight;
+        data->frame.CopyToSyncMem();
+        if (pipeline.ProvideData(source.get(), data)) ++admitted;
+      } else {
+        EXPECT_TRUE(pipeline.ProvideData(source.get(), data));
+      }
+    }
+    EXPECT_EQ(std::future_status::ready, eos_done.wait_for(std::chrono::seconds(10)));
+    EXPECT_TRUE(pipeline.Stop());
+    MemoryBudgetStatus status = pipeline.GetMemoryBudgetStatus();
+    EXPECT_LE(status.peak_bytes, kBudget);
+    EXPECT_GE(status.peak_bytes, kFrameBytes);
+    EXPECT_EQ(0u, status.in_flight_bytes);
+    if (MEMORY_BUDGET_BLOCK == policy) {
+      EXPECT_EQ(kFrameNum, admitted);
+      EXPECT_GT(status.throttled_frames, 0u);
+      EXPECT_EQ(0u, status.dropped_frames);
+    } else {
+      EXPECT_LT(admitted, kFrameNum);
+      EXPECT_EQ(static_cast<uint64_t>(kFrameNum - admitted), status.dropped_frames);
+      EXPECT_EQ(0u, status.throttled_frames);
+    }
+  }
+}
+
+class BudgetProbe : public Module {
+ public:
+  BudgetProbe(const std::string& name, Pipeline* pipeline) : Module(name), pipeline_(pipeline) {}
+  bool Open(ModuleParamSet paramSet) override { return true; }
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> data) override {
+    admitted_bytes = pipeline_->GetMemoryBudgetStatus().in_flight_bytes;
+#ifdef HAVE_OPENCV
+    data->frame.ImageBGR();
+    bgr_bytes = pipeline_->GetMemoryBudgetStatus().in_flight_bytes;
+#endif
+    return 0;
+  }
+  size_t admitted_bytes = 0;
+  size_t bgr_bytes = 0;
+
+ private:
+  Pipeline* pipeline_;
+};  // class BudgetProbe
+
+TEST(CorePipeline, MemoryBudgetChargesFrameImages) {
+  const int kWidth = 256, kHeight = 256;
+  std::vector<uint8_t> image(kWidth * kHeight * 3 / 2, 0x7f);
+  Pipeline pipeline("budget pipeline");
+  EosPromise observer;
+  pipeline.SetStreamMsgObserver(&observer);
+  auto source = std::make_shared<TestModule>("budget_source");
+  auto probe = std::make_shared<BudgetProbe>("budget_probe", &pipeline);
+  EXPECT_TRUE(pipeline.AddModule(source));
+  EXPECT_TRUE(pipeline.AddModule(probe));
+  EXPECT_NE(pipeline.LinkModules(source, probe), "");
+  pipeline.SetMemoryBudget(64 * 1024 * 1024);
+  auto eos_done = observer.GetDoneFuture();
+  ASSERT_TRUE(pipeline.Start());
+  // references a buffer of its own like the decoded frames, charged the bytes of its planes
+  auto data = CNFrameInfo::Create("0");
+  data->channel_idx = 0;
+  data->frame.ctx.dev_type = DevContext::CPU;
+  data->frame.fmt = CN_PIXEL_FORMAT_YUV420_NV12;
+  data->frame.width = kWidth;
+  data->frame.height = kHeight;
+  data->frame.stride[0] = data->frame.stride[1] = kWidth;
+  for (int p = 0; p < data->frame.GetPlanes(); ++p) {
+    data->frame.data[p] = CNSyncedMemory::Create(data->frame.GetPlaneBytes(p));
+    data->frame.data[p]->SetCpuData(image.data() + (p ? kWidth * kHeight : 0));
+  }
+  const size_t frame_bytes = data->frame.GetBytes();
+  EXPECT_TRUE(pipeline.ProvideData(source.get(), data));
+  data.reset();
+  EXPECT_TRUE(pipeline.ProvideData(source.get(), CNFrameInfo::Create("0", true)));
+  EXPECT_EQ(std::future_status::ready, eos_done.wait_for(std::chrono::seconds(10)));
+  EXPECT_TRUE(pipeline.Stop());
+  EXPECT_EQ(frame_bytes, probe->admitted_bytes);
+#ifdef HAVE_OPENCV
+  EXPECT_EQ(frame_bytes + kWidth * kHeight * 3, probe->bgr_bytes);
+#endif
+  EXPECT_EQ(0u, pipeline.GetMemoryBudgetStatus().in_flight_bytes);
+}
+
+class BranchProbe : public Module {
+ public:
+  explicit BranchProbe(const std::string& name) : Module(name) {}
+  bool Open(ModuleParamSet paramSet) override { return true; }
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> data) override {
+    std::lock_guard<std::mutex> lk(mutex_);
+    branch_nums.insert(data->frame.GetBranchNum());
+    return 0;
+  }
+  std::set<int> branch_nums;
+
+ private:
+  std::mutex mutex_;
+};  // class BranchProbe
+
+/*
+           /--> left  --\
+  source --              --> join
+           \--> right --/
+ */
+TEST(CorePipeline, FrameBranches) {
+  Pipeline pipeline("branch pipeline");
+  EosPromise observer;
+  pipeline.SetStreamMsgObserver(&observer);
+  auto source = std::make_shared<TestModule>("branch_source");
+  auto left = std::make_shared<BranchProbe>("branch_left");
+  auto right = std::make_shared<BranchProbe>("branch_right");
+  auto join = std::make_shared<BranchProbe>("branch_join");
+  for (auto module : std::vector<std::shared_ptr<Module>>{source, left, right, join}) {
+    EXPECT_TRUE(pipeline.AddModule(module));
+  }
+  EXPECT_NE(pipeline.LinkModules(source, left), "");
+  EXPECT_NE(pipeline.LinkModules(source, right), "");
+  EXPECT_NE(pipeline.LinkModules(left, join), "");
+  EXPECT_NE(pipeline.LinkModules(right, join), "");
+  auto eos_done = observer.GetDoneFuture();
+  ASSERT_TRUE(pipeline.Start());
+  EXPECT_TRUE(join->IsUpstream(source->GetId()));
+  EXPECT_TRUE(join->IsUpstream(join->GetId()));
+  EXPECT_FALSE(left->IsUpstream(right->GetId()));
+  std::vector<std::shared_ptr<CNFrameInfo>> frames;
+  for (int i = 0; i <= 10; ++i) {
+    auto data = CNFrameInfo::Create("0", i == 10);
+    data->channel_idx = 0;
+    frames.push_back(data);
+    EXPECT_TRUE(pipeline.ProvideData(source.get(), data));
+  }
+  EXPECT_EQ(std::future_status::ready, eos_done.wait_for(std::chrono::seconds(10)));
+  EXPECT_TRUE(pipeline.Stop());
+  // the branch of the other side may have ended already
+  for (int num : left->branch_nums) EXPECT_TRUE(1 == num || 2 == num);
+  for (int num : right->branch_nums) EXPECT_TRUE(1 == num || 2 == num);
+  EXPECT_EQ(std::set<int>{1}, join->branch_nums);
+  // all the branches ended
+  for (int i = 0; i < 10; ++i) EXPECT_EQ(0, frames[i]->frame.GetBranchNum());
+}
+
+#ifdef HAVE_OPENCV
+class ImageProbe : public Module {
+ public:
+  enum Role { PAINTER, CHECKER, READER };
+  ImageProbe(const std::string& name, Role role, ImageProbe* painter = nullptr)
+      : Module(name), role_(role), painter_(painter) {}
+  bool Open(ModuleParamSet paramSet) override { return true; }
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> data) override {
+    if (PAINTER == role_) {
+      cv::Mat* image = data->frame.MutableImageBGR();
+      std::fill(image->data, image->data + image->rows * image->step, 0xff);
+      std::lock_guard<std::mutex> lk(mutex_);
+      ++painted_;
+      cond_.notify_all();
+      return 0;
+    }
+    if (READER == role_) {
+      // holds the frame until the other branch has painted it
+      std::unique_lock<std::mutex> lk(painter_->mutex_);
+      auto painted = [&]() { return painter_->painted_ > data->frame.frame_id; };
+      painter_->cond_.wait_for(lk, std::chrono::seconds(5), painted);
+    }
+    if (data->frame.ImageBGR()->data[0] == (CHECKER == role_ ? 0xff : 0)) ++passed;
+    // the image read out of any module is the shared one
+    cv::Mat* image = data->frame.ImageBGR();
+    CNDataFrame::SetProcessContext(nullptr, nullptr);
+    if (data->frame.ImageBGR() == image) ++shared;
+    return 0;
+  }
+  std::atomic<int> passed{0}, shared{0};
+
+ private:
+  Role role_;
+  ImageProbe* painter_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  int64_t painted_ = 0;
+};  // class ImageProbe
+
+static void RunImageProbes(Pipeline* pipeline, Module* source, int frame_num) {
+  const int kWidth = 16, kHeight = 8;
+  EosPromise observer;
+  pipeline->SetStreamMsgObserver(&observer);
+  auto eos_done = observer.GetDoneFuture();
+  ASSERT_TRUE(pipeline->Start());
+  std::vector<uint8_t> image(kWidth * kHeight * 3, 0);
+  for (int i = 0; i <= frame_num; ++i) {
+    auto data = CNFrameInfo::Create("0", i == frame_num);
+    data->channel_idx = 0;
+    if (i < frame_num) {
+      data->frame.frame_id = i;
+      data->frame.ctx.dev_type = DevContext::CPU;
+      data->frame.fmt = CN_PIXEL_FORMAT_BGR24;
+      data->frame.width = kWidth;
+      data->frame.height = kHeight;
+      data->frame.stride[0] = kWidth;
+      data->frame.ptr[0] = image.data();
+      data->frame.CopyToSyncMem();
+    }
+    EXPECT_TRUE(pipeline->ProvideData(source, data));
+  }
+  EXPECT_EQ(std::future_status::ready, eos_done.wait_for(std::chrono::seconds(10)));
+  EXPECT_TRUE(pipeline->Stop());
+  pipeline->SetStreamMsgObserver(nullptr);
+}
+
+/*
+           /--> painter --> checker
+  source --
+           \--> reader
+ */
+TEST(CorePipeline, CopyOnWriteImage) {
+  const int kFrameNum = 10;
+  {
+    Pipeline pipeline("cow pipeline");
+    auto source = std::make_shared<TestModule>("cow_source");
+    auto painter = std::make_shared<ImageProbe>("cow_painter", ImageProbe::PAINTER);
+    auto checker = std::make_shared<ImageProbe>("cow_checker", ImageProbe::CHECKER);
+    auto reader = std::make_shared<ImageProbe>("cow_reader", ImageProbe::READER, painter.get());
+    for (auto module : std::vector<std::shared_ptr<Module>>{source, painter, checker, reader}) {
+      EXPECT_TRUE(pipeline.AddModule(module));
+    }
+    std::string painter_link = pipeline.LinkModules(source, painter);
+    EXPECT_NE(pipeline.LinkModules(painter, checker), "");
+    std::string reader_link = pipeline.LinkModules(source, reader);
+    RunImageProbes(&pipeline, source.get(), kFrameNum);
+    // the reader never sees the paint, the checker downstream of the painter always does
+    EXPECT_EQ(kFrameNum, reader->passed.load());
+    EXPECT_EQ(kFrameNum, reader->shared.load());
+    EXPECT_EQ(kFrameNum, checker->passed.load());
+    EXPECT_EQ(0, checker->shared.load());
+    LinkStatus status;
+    EXPECT_TRUE(pipeline.QueryLinkStatus(&status, painter_link));
+    EXPECT_EQ(static_cast<uint64_t>(kFrameNum), status.cow_copies);
+    LinkStatus reader_status;
+    EXPECT_TRUE(pipeline.QueryLinkStatus(&reader_status, reader_link));
+    EXPECT_EQ(0u, reader_status.cow_copies);
+  }
+  {
+    // no other branch, painted in place
+    Pipeline pipeline("inplace pipeline");
+    auto source = std::make_shared<TestModule>("inplace_source");
+    auto painter = std::make_shared<ImageProbe>("inplace_painter", ImageProbe::PAINTER);
+    auto checker = std::make_shared<ImageProbe>("inplace_checker", ImageProbe::CHECKER);
+    for (auto module : std::vector<std::shared_ptr<Module>>{source, painter, checker}) {
+      EXPECT_TRUE(pipeline.AddModule(module));
+    }
+    std::string painter_link = pipeline.LinkModules(source, painter);
+    EXPECT_NE(pipeline.LinkModules(painter, checker), "");
+    RunImageProbes(&pipeline, source.get(), kFrameNum);
+    EXPECT_EQ(kFrameNum, checker->passed.load());
+    EXPECT_EQ(kFrameNum, checker->shared.load());
+    LinkStatus status;
+    EXPECT_TRUE(pipeline.QueryLinkStatus(&status, painter_link));
+    EXPECT_EQ(0u, status.cow_copies);
+  }
+}
+#endif
+
+TEST(CorePipeline, LatencyStats) {
+  const int kFrameNum = 20;
+  Pipeline pipeline("latency pipeline");
+  EosPromise observer;
+  pipeline.SetStreamMsgObserver(&observer);
+  auto source = std::make_shared<TestModule>("latency_source");
+  auto sink = std::make_shared<SlowSink>("latency_sink");
+  EXPECT_TRUE(pipeline.AddModule(source));
+  EXPECT_TRUE(pipeline.AddModule(sink));
+  std::string link_id = pipeline.LinkModules(source, sink, kFrameNum);
+  EXPECT_NE(link_id, "");
+  auto eos_done = observer.GetDoneFuture();
+  ASSERT_TRUE(pipeline.Start());
+  for (int i = 0; i <= kFrameNum; ++i) {
+    auto data = CNFrameInfo::Create("0", i == kFrameNum);
+    data->channel_idx = 0;
+    EXPECT_TRUE(pipeline.ProvideData(source.get(), data));
+  }
+  EXPECT_EQ(std::future_status::ready, eos_done.wait_for(std::chrono::seconds(10)));
+  EXPECT_TRUE(pipeline.Stop());
+
+  ModuleLatencyStats stats;
+  EXPECT_FALSE(pipeline.QueryModuleLatency(&stats, "no_such_module"));
+  ASSERT_TRUE(pipeline.QueryModuleLatency(&stats, sink->GetName()));
+  EXPECT_EQ(static_cast<uint64_t>(kFrameNum), stats.queue.count);
+  EXPECT_EQ(static_cast<uint64_t>(kFrameNum), stats.process.count);
+  EXPECT_EQ(static_cast<uint64_t>(kFrameNum), stats.from_source.count);
+  // the sink sleeps 2ms for each frame, the frames provided at once wait in the queue
+  EXPECT_GE(stats.process.p50_us, 1900);
+  EXPECT_GE(stats.queue.max_us, 10 * 1900);
+  EXPECT_LE(stats.queue.p50_us, stats.queue.p99_us);
+  EXPECT_LE(stats.queue.p99_us, stats.queue.max_us);
+  EXPECT_GE(stats.from_source.max_us, stats.queue.max_us);
+  LinkStatus status;
+  EXPECT_TRUE(pipeline.QueryLinkStatus(&status, link_id));
+  EXPECT_EQ(static_cast<uint64_t>(kFrameNum), status.queue_latency.count);
+  EXPECT_DOUBLE_EQ(stats.queue.max_us, status.queue_latency.max_us);
+  // the source has no input queue
+  ModuleLatencyStats source_stats;
+  ASSERT_TRUE(pipeline.QueryModuleLatency(&source_stats, source->GetName()));
+  EXPECT_EQ(0u, source_stats.queue.count);
+  EXPECT_EQ(static_cast<uint64_t>(kFrameNum), source_stats.from_source.count);
+  LatencyStats end_to_end = pipeline.GetEndToEndLatency();
+  EXPECT_EQ(static_cast<uint64_t>(kFrameNum), end_to_end.count);
+  EXPECT_DOUBLE_EQ(stats.from_source.max_us, end_to_end.max_us);
+
+  pipeline.ResetLatencyStats();
+  ASSERT_TRUE(pipeline.QueryModuleLatency(&stats, sink->GetName()));
+  EXPECT_EQ(0u, stats.queue.count + stats.process.count + stats.from_source.count);
+  EXPECT_TRUE(pipeline.QueryLinkStatus(&status, link_id));
+  EXPECT_EQ(0u, status.queue_latency.count);
+  EXPECT_EQ(0u, pipeline.GetEndToEndLatency().count);
+}
+
+TEST(CorePipeline, Trace) {
+  const int kFrameNum = 10;
+  Pipeline pipeline("trace pipeline");
+  EosPromise observer;
+  pipeline.SetStreamMsgObserver(&observer);
+  auto source = std::make_shared<TestModule>("trace_source");
+  auto sink = std::make_shared<SlowSink>("trace_sink");
+  EXPECT_TRUE(pipeline.AddModule(source));
+  EXPECT_TRUE(pipeline.AddModule(sink));
+  std::string link_id = pipeline.LinkModules(source, sink, kFrameNum);
+  EXPECT_NE(link_id, "");
+  auto eos_done = observer.GetDoneFuture();
+  SetTraceEnabled(true);
+  ASSERT_TRUE(pipeline.Start());
+  for (int i = 0; i <= kFrameNum; ++i) {
+    auto data = CNFrameInfo::Create("0", i == kFrameNum);
+    data->channel_idx = 0;
+    data->frame.frame_id = i;
+    EXPECT_TRUE(pipeline.ProvideData(source.get(), data));
+  }
+  EXPECT_EQ(std::future_status::ready, eos_done.wait_for(std::chrono::seconds(10)));
+  SetTraceEnabled(false);
+  const std::string path = "pipeline_trace.json";
+  EXPECT_TRUE(DumpTrace(path));
+  EXPECT_TRUE(pipeline.Stop());
+
+  std::ifstream ifs(path);
+  std::string json((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+  auto count = [&json](const std::string& pattern) {
+    int n = 0;
+    for (size_t pos = json.find(pattern); pos != std::string::npos; pos = json.find(pattern, pos + 1)) ++n;
+    return n;
+  };
+  // the EOS frame is not processed by the sink, but pushed and popped like the others
+  EXPECT_EQ(kFrameNum, count("\"name\":\"trace_sink\",\"cat\":\"process\""));
+  EXPECT_EQ(kFrameNum + 1, count("\"name\":\"" + link_id + "\",\"cat\":\"push\""));
+  // the sink waits for each frame, or pops it right away
+  EXPECT_EQ(kFrameNum + 1, count("\"name\":\"" + link_id + "\",\"cat\":\"wait\""));
+  EXPECT_EQ(1, count("\"args\":{\"name\":\"cn-trace_sink0\"}"));
+  remove(path.c_str());
+}
+
+TEST(CorePipeline, QueueSampler) {
+  const int kFrameNum = 60;
+  const size_t kCapacity = 4;
+  Pipeline pipeline("sampler pipeline");
+  EosPromise observer;
+  pipeline.SetStreamMsgObserver(&observer);
+  auto source = std::make_shared<TestModule>("sampler_source");
+  auto slow = std::make_shared<SlowSink>("sampler_slow");
+  auto sink = std::make_shared<TestModule>("sampler_sink");
+  for (auto module : std::vector<std::shared_ptr<Module>>{source, slow, sink}) {
+    EXPECT_TRUE(pipeline.AddModule(module));
+  }
+  std::string input_link = pipeline.LinkModules(source, slow, kCapacity);
+  std::string output_link = pipeline.LinkModules(slow, sink, kCapacity);
+  std::vector<QueueTelemetry> telemetry;
+  // disabled by default
+  EXPECT_FALSE(pipeline.QueryQueueTelemetry(&telemetry, input_link));
+  EXPECT_EQ("", pipeline.GetBottleneckModule());
+  pipeline.SetQueueSampler(1);
+  auto eos_done = observer.GetDoneFuture();
+  ASSERT_TRUE(pipeline.Start());
+  for (int i = 0; i <= kFrameNum; ++i) {
+    auto data = CNFrameInfo::Create("0", i == kFrameNum);
+    data->channel_idx = 0;
+    EXPECT_TRUE(pipeline.ProvideData(source.get(), data));
+  }
+  EXPECT_EQ(std::future_status::ready, eos_done.wait_for(std::chrono::seconds(10)));
+  EXPECT_TRUE(pipeline.Stop());
+
+  // the source waits for the slow module, the sink waits for frames
+  ASSERT_TRUE(pipeline.QueryQueueTelemetry(&telemetry, input_link));
+  ASSERT_EQ(1u, telemetry.size());
+  EXPECT_EQ(kCapacity, telemetry[0].capacity);
+  EXPECT_GT(telemetry[0].samples, 10u);
+  EXPECT_EQ(kCapacity, telemetry[0].max_depth);
+  EXPECT_EQ(kCapacity, telemetry[0].p50_depth);
+  EXPECT_GT(telemetry[0].at_capacity_percent, 50);
+  EXPECT_GT(telemetry[0].blocked_pushes, 0u);
+  EXPECT_GT(telemetry[0].blocked_ms, 0);
+  ASSERT_TRUE(pipeline.QueryQueueTelemetry(&telemetry, output_link));
+  ASSERT_EQ(1u, telemetry.size());
+  EXPECT_LE(telemetry[0].mean_depth, 1);
+  EXPECT_EQ(0u, telemetry[0].p50_depth);
+  EXPECT_EQ(0u, telemetry[0].blocked_pushes);
+  double percent = 0;
+  EXPECT_EQ(slow->GetName(), pipeline.GetBottleneckModule(&percent));
+  EXPECT_GT(percent, 50);
+  EXPECT_FALSE(pipeline.QueryQueueTelemetry(&telemetry, "no_such_link"));
+
+  // e.g. at the end of a warmup
+  pipeline.ResetQueueTelemetry();
+  ASSERT_TRUE(pipeline.QueryQueueTelemetry(&telemetry, input_link));
+  EXPECT_EQ(0u, telemetry[0].samples);
+  EXPECT_EQ(0u, telemetry[0].max_depth);
+  EXPECT_EQ(0u, telemetry[0].blocked_pushes);
+  EXPECT_EQ(0, telemetry[0].blocked_ms);
+  EXPECT_EQ("", pipeline.GetBottleneckModule());
+}
+
 }  // namespace cnstream
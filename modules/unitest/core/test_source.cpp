@@ -0,0 +1,114 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "cnstream_pipeline.hpp"
+#include "cnstream_source.hpp"
+
+namespace cnstream {
+
+namespace {
+
+/* allocates the stream index only, the streams are driven by SyntheticSource in the source tests */
+class StubHandler : public SourceHandler {
+ public:
+  StubHandler(SourceModule* module, const std::string& stream_id) : SourceHandler(module, stream_id, 0, false) {}
+  bool Open() override { return INVALID_STREAM_IDX != stream_index_; }
+  void Close() override {}
+};  // class StubHandler
+
+class StubSourceModule : public SourceModule {
+ public:
+  explicit StubSourceModule(const std::string& name) : SourceModule(name) {}
+  bool Open(ModuleParamSet paramSet) override { return true; }
+  void Close() override {}
+  std::vector<std::shared_ptr<StubHandler>> handlers_;
+
+ private:
+  std::shared_ptr<SourceHandler> CreateSource(const std::string& stream_id, const std::string& filename,
+                                              int framerate, bool loop) override {
+    auto handler = std::make_shared<StubHandler>(this, stream_id);
+    if (INVALID_STREAM_IDX != handler->GetStreamIndex()) handlers_.push_back(handler);
+    return handler;
+  }
+};  // class StubSourceModule
+
+}  // namespace
+
+TEST(CoreSource, StreamIndex) {
+  const uint32_t default_num = GetMaxStreamNumber();
+  EXPECT_FALSE(SetMaxStreamNumber(0));
+  ASSERT_TRUE(SetMaxStreamNumber(3));
+  EXPECT_EQ(GetMaxStreamNumber(), 3u);
+  auto source = std::make_shared<StubSourceModule>("index_source");
+  for (uint32_t i = 0; i < 3; ++i) EXPECT_EQ(source->AddVideoSource(std::to_string(i), "", 0), 0);
+  // the index space is full
+  EXPECT_EQ(source->AddVideoSource("3", "", 0), -1);
+  EXPECT_FALSE(SetMaxStreamNumber(default_num));
+  for (uint32_t i = 0; i < 3; ++i) EXPECT_EQ(source->handlers_[i]->GetStreamIndex(), i);
+  // the smallest returned index is handed out first
+  source->handlers_.erase(source->handlers_.begin() + 1);
+  EXPECT_EQ(source->RemoveSource("1"), 0);
+  EXPECT_EQ(source->AddVideoSource("4", "", 0), 0);
+  EXPECT_EQ(source->handlers_.back()->GetStreamIndex(), 1u);
+  source->handlers_.clear();
+  for (auto stream_id : {"0", "2", "4"}) EXPECT_EQ(source->RemoveSource(stream_id), 0);
+  EXPECT_TRUE(SetMaxStreamNumber(default_num));
+}
+
+TEST(CoreSource, MaxStreamNumberOfPipelines) {
+  const uint32_t default_num = GetMaxStreamNumber();
+  auto make_pipeline = [](const std::string& name, const std::string& max_stream_num) {
+    std::shared_ptr<Pipeline> pipeline = std::make_shared<Pipeline>(name);
+    auto source = std::make_shared<StubSourceModule>(name + "_source");
+    EXPECT_TRUE(pipeline->AddModule(source));
+    CNModuleConfig config = {};
+    config.name = source->GetName();
+    if (!max_stream_num.empty()) config.parameters = {{"max_stream_num", max_stream_num}};
+    EXPECT_EQ(0, pipeline->AddModuleConfig(config));
+    return pipeline;
+  };
+  EXPECT_FALSE(make_pipeline("zero", "0")->Start());
+  EXPECT_FALSE(make_pipeline("nan", "foo")->Start());
+
+  auto first = make_pipeline("first", "8");
+  ASSERT_TRUE(first->Start());
+  EXPECT_EQ(GetMaxStreamNumber(), 8u);
+  // the running pipeline has sized its modules with 8
+  EXPECT_FALSE(SetMaxStreamNumber(16));
+  EXPECT_FALSE(make_pipeline("second", "16")->Start());
+  auto same = make_pipeline("same", "8");
+  EXPECT_TRUE(same->Start());
+  auto unset = make_pipeline("unset", "");
+  EXPECT_TRUE(unset->Start());
+  EXPECT_TRUE(first->Stop());
+  EXPECT_TRUE(same->Stop());
+  EXPECT_FALSE(SetMaxStreamNumber(16));
+  EXPECT_TRUE(unset->Stop());
+  EXPECT_EQ(GetMaxStreamNumber(), 8u);
+  EXPECT_TRUE(SetMaxStreamNumber(default_num));
+}
+
+}  // namespace cnstream
@@ -0,0 +1,77 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "cnstream_statistic.hpp"
+
+namespace cnstream {
+
+TEST(CoreStatistic, LatencyHistogram) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(0u, histogram.GetStats().count);
+  // 1us to 1000us
+  for (int i = 1; i <= 1000; ++i) histogram.Record(i * 1000);
+  histogram.Record(-1);
+  LatencyStats stats = histogram.GetStats();
+  EXPECT_EQ(1001u, stats.count);
+  EXPECT_NEAR(500, stats.mean_us, 1);
+  const double error = 1.0 / LatencyHistogram::kSubBucketNum;
+  EXPECT_NEAR(500, stats.p50_us, 500 * error);
+  EXPECT_NEAR(900, stats.p90_us, 900 * error);
+  EXPECT_NEAR(990, stats.p99_us, 990 * error);
+  EXPECT_DOUBLE_EQ(1000, stats.max_us);
+  EXPECT_LE(stats.p99_us, stats.max_us);
+
+  // the small latencies are exact
+  histogram.Reset();
+  EXPECT_EQ(0u, histogram.GetStats().count);
+  for (int i = 0; i < 10; ++i) histogram.Record(7);
+  stats = histogram.GetStats();
+  EXPECT_DOUBLE_EQ(0.007, stats.p50_us);
+  EXPECT_DOUBLE_EQ(0.007, stats.max_us);
+
+  // the largest latencies fall in the last buckets
+  histogram.Reset();
+  histogram.Record(INT64_MAX);
+  EXPECT_DOUBLE_EQ(INT64_MAX / 1e3, histogram.GetStats().p99_us);
+}
+
+TEST(CoreStatistic, LatencyHistogramConcurrently) {
+  const int kThreadNum = 4, kRecordNum = 100000;
+  LatencyHistogram histogram;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreadNum; ++t) {
+    threads.emplace_back([&histogram, t] {
+      for (int i = 0; i < kRecordNum; ++i) histogram.Record((t + 1) * 1000);
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  LatencyStats stats = histogram.GetStats();
+  EXPECT_EQ(static_cast<uint64_t>(kThreadNum * kRecordNum), stats.count);
+  EXPECT_DOUBLE_EQ(kThreadNum, stats.max_us);
+  EXPECT_NEAR(2.5, stats.mean_us, 1e-6);
+}
+
+}  // namespace cnstream
@@ -18,20 +18,28 @@
  * THE SOFTWARE.
  *************************************************************************/
 
+#ifndef CNS_HOST_DEVICE
 #include <cnrt.h>
+#endif
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 #include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <ctime>
 #include <functional>
 #include <iomanip>
 #include <iostream>
 #include <memory>
 #include <random>
+#include <thread>
 #include <vector>
 
+#include "cnstream_devmem.hpp"
 #include "cnstream_frame.hpp"
 #include "cnstream_syncmem.hpp"
+#include "host_memory_pool.hpp"
+#include "threadsafe_queue.hpp"
 
 static struct {
   void* cpu_ptr = NULL;
@@ -41,10 +49,12 @@ static struct {
 } g_last_data;
 
 TEST(CoreSyncedMem, SyncedMem) {
+#ifndef CNS_HOST_DEVICE
   cnrtRet_t ret = cnrtInit(0);
   if (CNRT_RET_SUCCESS != ret) {
     LOG(WARNING) << "CnrtInit failed. error code:" << ret;
   }
+#endif
   time_t t;
   t = time(NULL);
   // std::cout << std::put_time(std::localtime(&t), "%Y-%m-%d %H.%M.%S") << std::endl;
@@ -105,7 +115,7 @@ TEST(CoreSyncedMem, SyncedMem) {
       g_last_data.used_cpu = false;
     }
     if (g_last_data.used_mlu) {
-      ASSERT_EQ(CNRT_RET_SUCCESS, cnrtFree(g_last_data.mlu_ptr));
+      cnstream::DevFree(g_last_data.mlu_ptr);
       g_last_data.mlu_ptr = nullptr;
       g_last_data.used_mlu = false;
     }
@@ -129,12 +139,12 @@ TEST(CoreSyncedMem, SyncedMem) {
   funcs.push_back([&] {
     if (memory->GetSize() == 0) return;
     if (g_last_data.used_mlu) {
-      ASSERT_EQ(CNRT_RET_SUCCESS, cnrtFree(g_last_data.mlu_ptr));
+      cnstream::DevFree(g_last_data.mlu_ptr);
       g_last_data.mlu_ptr = nullptr;
     }
     memory->SetMluDevContext(0, ddr_random_number_generator(random_engine));
-    CALL_CNRT_BY_CONTEXT(cnrtMalloc(&g_last_data.mlu_ptr, memory->GetSize()), memory->GetMluDevId(),
-                         memory->GetMluDdrChnId());
+    g_last_data.mlu_ptr = cnstream::DevMalloc(memory->GetSize(), memory->GetMluDevId(), memory->GetMluDdrChnId());
+    ASSERT_NE(nullptr, g_last_data.mlu_ptr);
     g_last_data.used_mlu = true;
     memory->SetMluData(g_last_data.mlu_ptr);
     EXPECT_EQ(memory->GetHead(), cnstream::CNSyncedMemory::HEAD_AT_MLU);
@@ -164,7 +174,7 @@ TEST(CoreSyncedMem, SyncedMem) {
     g_last_data.used_cpu = false;
   }
   if (g_last_data.used_mlu) {
-    ASSERT_EQ(CNRT_RET_SUCCESS, cnrtFree(g_last_data.mlu_ptr));
+    cnstream::DevFree(g_last_data.mlu_ptr);
     g_last_data.mlu_ptr = nullptr;
     g_last_data.used_mlu = false;
   }
@@ -174,3 +184,192 @@ TEST(CoreSyncedMem, SyncedMem) {
   t = time(NULL);
   //  std::cout << std::put_time(std::localtime(&t), "%Y-%m-%d %H.%M.%S") << std::endl;
 }
+
+namespace cnstream {
+
+TEST(CoreSyncedMem, HostMemoryPoolReuse) {
+  SizeClassMemoryPool pool;
+  void* buffer = pool.Alloc(3 << 20);
+  ASSERT_NE(buffer, nullptr);
+  pool.Free(buffer, 3 << 20);
+  // the same size class
+  EXPECT_EQ(pool.Alloc((3 << 20) - 100), buffer);
+  MemoryPoolStats stats = pool.GetStats();
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.misses, 1u);
+  EXPECT_EQ(stats.bytes_in_use, SizeClassMemoryPool::ClassSize(3 << 20));
+  EXPECT_EQ(stats.bytes_cached, 0u);
+  pool.Free(buffer, (3 << 20) - 100);
+  EXPECT_EQ(pool.GetStats().bytes_cached, SizeClassMemoryPool::ClassSize(3 << 20));
+
+  for (size_t size = 1; size <= SizeClassMemoryPool::kMaxClassSize; size = size * 3 / 2 + 1) {
+    size_t class_size = SizeClassMemoryPool::ClassSize(size);
+    EXPECT_GE(class_size, size);
+    if (size > SizeClassMemoryPool::kMinClassSize) {
+      EXPECT_LE(class_size, size + size / 4) << size;
+    }
+  }
+  EXPECT_EQ(SizeClassMemoryPool::ClassSize(SizeClassMemoryPool::kMaxClassSize + 1),
+            SizeClassMemoryPool::kMaxClassSize + 1);
+}
+
+TEST(CoreSyncedMem, HostMemoryPoolCachedBytesLimit) {
+  const size_t kSize = 3 << 20;
+  SizeClassMemoryPool pool(2 * SizeClassMemoryPool::ClassSize(kSize));
+  std::vector<void*> buffers;
+  for (int i = 0; i < 4; ++i) buffers.push_back(pool.Alloc(kSize));
+  for (auto buffer : buffers) pool.Free(buffer, kSize);
+  MemoryPoolStats stats = pool.GetStats();
+  EXPECT_EQ(stats.bytes_in_use, 0u);
+  EXPECT_EQ(stats.bytes_cached, 2 * SizeClassMemoryPool::ClassSize(kSize));
+}
+
+TEST(CoreSyncedMem, HostMemoryPoolHugePages) {
+  const size_t kLarge = 3 << 20, kSmall = 64 << 10;
+  for (auto mode : {HOST_HUGE_PAGE_NONE, HOST_HUGE_PAGE_TRANSPARENT, HOST_HUGE_PAGE_EXPLICIT}) {
+    for (bool numa_local : {false, true}) {
+      HostMemoryPoolOptions options;
+      options.huge_page = mode;
+      options.numa_local = numa_local;
+      std::unique_ptr<MemoryPool> pool(CreateHostMemoryPool(options));
+      // explicit huge pages fall back to transparent ones if none is reserved
+      void* large = pool->Alloc(kLarge);
+      ASSERT_NE(large, nullptr);
+      memset(large, 1, kLarge);
+      if (HOST_HUGE_PAGE_NONE != mode) {
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(large) % SizeClassMemoryPool::kHugePageSize, 0u);
+      }
+      void* small = pool->Alloc(kSmall);
+      ASSERT_NE(small, nullptr);
+      memset(small, 1, kSmall);
+      pool->Free(large, kLarge);
+      pool->Free(small, kSmall);
+      // the cached buffers are reused, on the same node
+      EXPECT_EQ(pool->Alloc(kLarge), large);
+      EXPECT_EQ(pool->Alloc(kSmall), small);
+      MemoryPoolStats stats = pool->GetStats();
+      EXPECT_EQ(stats.hits, 2u);
+      EXPECT_EQ(stats.misses, 2u);
+      pool->Free(large, kLarge);
+      pool->Free(small, kSmall);
+    }
+  }
+}
+
+class CountingPool : public MemoryPool {
+ public:
+  void* Alloc(size_t size) override {
+    ++alloc_cnt;
+    return malloc(size);
+  }
+  void Free(void* ptr, size_t size) override {
+    ++free_cnt;
+    free(ptr);
+  }
+  MemoryPoolStats GetStats() override { return MemoryPoolStats(); }
+  int alloc_cnt = 0, free_cnt = 0;
+};  // class CountingPool
+
+TEST(CoreSyncedMem, SetHostMemoryPool) {
+  CountingPool pool;
+  SetHostMemoryPool(&pool);
+  EXPECT_EQ(GetHostMemoryPool(), &pool);
+  void* data = nullptr;
+  CNStreamMallocHost(&data, 1024);
+  ASSERT_NE(data, nullptr);
+  EXPECT_EQ(pool.alloc_cnt, 1);
+  SetHostMemoryPool(nullptr);
+  EXPECT_NE(GetHostMemoryPool(), &pool);
+  // freed by the pool allocated it
+  CNStreamFreeHost(data);
+  EXPECT_EQ(pool.free_cnt, 1);
+
+  CNSyncedMemory memory(1024);
+  SetHostMemoryPool(&pool);
+  memory.GetCpuData();
+  EXPECT_EQ(pool.alloc_cnt, 2);
+  SetHostMemoryPool(nullptr);
+}
+
+/*
+  Frames go through CopyToSyncMem on a decoder thread and are released on another thread, like in a pipeline.
+  The pool keeps no more buffers than the frames in flight.
+*/
+TEST(CoreSyncedMem, HostMemoryPoolBounded) {
+  const int kWidth = 1920, kHeight = 1080, kFrameNum = 200;
+  std::vector<uint8_t> image(kWidth * kHeight * 3 / 2, 128);
+  uint32_t stream = InternStreamId("soak_stream");
+  ThreadSafeQueue<std::shared_ptr<CNFrameInfo>> queue;
+  std::thread releaser([&] {
+    std::shared_ptr<CNFrameInfo> data;
+    while (true) {
+      queue.WaitAndPop(data);
+      if (!data) break;
+      data.reset();
+    }
+  });
+  const int kMaxQueued = 4;
+  for (int i = 0; i < kFrameNum; ++i) {
+    auto data = CNFrameInfo::Create(stream);
+    data->frame.ctx.dev_type = DevContext::CPU;
+    data->frame.fmt = CN_PIXEL_FORMAT_YUV420_NV12;
+    data->frame.width = kWidth;
+    data->frame.height = kHeight;
+    data->frame.stride[0] = data->frame.stride[1] = kWidth;
+    data->frame.ptr[0] = image.data();
+    data->frame.ptr[1] = image.data() + kWidth * kHeight;
+    data->frame.CopyToSyncMem();
+    queue.Push(data);
+    // at most a few frames in flight
+    while (queue.Size() > kMaxQueued) std::this_thread::yield();
+  }
+  queue.Push(nullptr);
+  releaser.join();
+  MemoryPoolStats stats = GetHostMemoryPool()->GetStats();
+  // queued frames, the frame being released and the frame being created
+  const size_t frame_size = SizeClassMemoryPool::ClassSize(kWidth * kHeight * 3 / 2);
+  EXPECT_LE(stats.bytes_in_use + stats.bytes_cached, (kMaxQueued + 3) * frame_size);
+}
+
+TEST(CoreSyncedMem, Prefetch) {
+  const size_t size = 1 << 20;
+  std::vector<uint8_t> host(size, 0x3c);
+  void* dev = DevMalloc(size, 0, 0);
+  ASSERT_NE(dev, nullptr);
+  ASSERT_TRUE(DevMemcpy(dev, host.data(), size, DEV_MEMCPY_HOST2DEV, 0, 0));
+  {
+    CNSyncedMemory memory(size, 0, 0);
+    memory.SetMluData(dev);
+    memory.PrefetchToCpu();
+    EXPECT_EQ(CNSyncedMemory::SYNCED, memory.GetHead());
+    EXPECT_EQ(memory.own_cpu_data_, true);
+    // prefetched again or to the other side, nothing happens
+    memory.PrefetchToCpu();
+    memory.PrefetchToMlu();
+    EXPECT_EQ(0, memcmp(memory.GetCpuData(), host.data(), size));
+  }
+  {
+    CNSyncedMemory memory(size, 0, 0);
+    memset(memory.GetMutableCpuData(), 0xc3, size);
+    memory.PrefetchToMlu();
+    EXPECT_EQ(CNSyncedMemory::SYNCED, memory.GetHead());
+    ASSERT_TRUE(DevMemcpy(host.data(), memory.GetMluData(), size, DEV_MEMCPY_DEV2HOST, 0, 0));
+    EXPECT_EQ(std::vector<uint8_t>(size, 0xc3), host);
+  }
+  {
+    // released before the prefetch is done
+    CNSyncedMemory memory(size, 0, 0);
+    memory.SetMluData(dev);
+    memory.PrefetchToCpu();
+  }
+  for (int i = 0; i < 4; ++i) {
+    // the notifiers of the prefetches waited for are reused
+    CNSyncedMemory memory(size, 0, 0);
+    memory.SetMluData(dev);
+    memory.PrefetchToCpu();
+    EXPECT_EQ(0, memcmp(memory.GetCpuData(), std::vector<uint8_t>(size, 0x3c).data(), size));
+  }
+  DevFree(dev, 0, 0);
+}
+
+}  // namespace cnstream
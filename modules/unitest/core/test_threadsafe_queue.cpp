@@ -18,8 +18,11 @@
  * THE SOFTWARE.
  *************************************************************************/
 
+#include <atomic>
+#include <chrono>
 #include <cstdlib>
 #include <ctime>
+#include <deque>
 #include <iostream>
 #include <memory>
 #include <thread>
@@ -141,4 +144,92 @@ bool TestThreadsafeQueue() {
 
 TEST(CoreThreadSafeQueue, ThreadsafeQueue) { EXPECT_EQ(true, TestThreadsafeQueue()); }
 
+TEST(CoreThreadSafeQueue, BoundedQueueBlockingPush) {
+  BoundedThreadSafeQueue<int> q(2);
+  EXPECT_TRUE(q.WaitAndPush(0));
+  EXPECT_TRUE(q.WaitAndPush(1));
+  EXPECT_EQ(q.Size(), 2u);
+
+  std::atomic<bool> pushed{false};
+  std::thread producer([&] {
+    EXPECT_TRUE(q.WaitAndPush(2));
+    pushed = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  // queue is full, producer has to wait for free space
+  EXPECT_FALSE(pushed);
+
+  int value = -1;
+  EXPECT_TRUE(q.WaitAndPop(value));
+  EXPECT_EQ(value, 0);
+  producer.join();
+  EXPECT_TRUE(pushed);
+  EXPECT_EQ(q.Size(), 2u);
+}
+
+TEST(CoreThreadSafeQueue, BoundedQueuePushOrDrop) {
+  typedef BoundedThreadSafeQueue<int> Queue;
+  Queue q(2);
+  // drops the first odd value when full, odd values are never pushed to a full queue
+  auto select = [](const std::deque<int>& queue, const int& value) -> int {
+    if (queue.size() < 2) return Queue::kDropNone;
+    for (size_t i = 0; i < queue.size(); ++i) {
+      if (queue[i] % 2) return static_cast<int>(i);
+    }
+    return value % 2 ? Queue::kDropNewValue : Queue::kDropNone;
+  };
+  int dropped = -1;
+  for (int value : {0, 1}) EXPECT_TRUE(q.WaitAndPushOrDrop(value, select, &dropped, std::chrono::microseconds(0)));
+  EXPECT_EQ(dropped, -1);
+  int value = 2;
+  EXPECT_TRUE(q.WaitAndPushOrDrop(value, select, &dropped, std::chrono::microseconds(0)));
+  EXPECT_EQ(dropped, 1);
+  value = 3;
+  EXPECT_TRUE(q.WaitAndPushOrDrop(value, select, &dropped, std::chrono::microseconds(0)));
+  EXPECT_EQ(dropped, 3);
+  // nothing to drop, times out and keeps the value
+  value = 4;
+  EXPECT_FALSE(q.WaitAndPushOrDrop(value, select, &dropped, std::chrono::microseconds(1000)));
+  EXPECT_EQ(value, 4);
+  std::thread consumer([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    int out;
+    EXPECT_TRUE(q.WaitAndPop(out));
+    EXPECT_EQ(out, 0);
+  });
+  EXPECT_TRUE(q.WaitAndPushOrDrop(value, select, &dropped, std::chrono::seconds(10)));
+  consumer.join();
+  EXPECT_EQ(q.Size(), 2u);
+  q.Stop();
+  value = 5;
+  EXPECT_FALSE(q.WaitAndPushOrDrop(value, select, &dropped, std::chrono::microseconds(0)));
+}
+
+TEST(CoreThreadSafeQueue, BoundedQueueStopWakesWaiters) {
+  BoundedThreadSafeQueue<int> full_q(1);
+  BoundedThreadSafeQueue<int> empty_q(1);
+  EXPECT_TRUE(full_q.WaitAndPush(0));
+
+  std::thread producer([&] { EXPECT_FALSE(full_q.WaitAndPush(1)); });
+  std::thread consumer([&] {
+    int value;
+    EXPECT_FALSE(empty_q.WaitAndPop(value));
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  auto start = std::chrono::steady_clock::now();
+  full_q.Stop();
+  empty_q.Stop();
+  producer.join();
+  consumer.join();
+  std::chrono::duration<double, std::milli> wake = std::chrono::steady_clock::now() - start;
+  EXPECT_LT(wake.count(), 20.0);
+
+  // restart
+  empty_q.Start();
+  EXPECT_TRUE(empty_q.WaitAndPush(1));
+  int value = -1;
+  EXPECT_TRUE(empty_q.WaitAndPop(value));
+  EXPECT_EQ(value, 1);
+}
+
 }  // namespace cnstream
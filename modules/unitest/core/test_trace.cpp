@@ -0,0 +1,178 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <rapidjson/document.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "cnstream_trace.hpp"
+
+namespace cnstream {
+
+static int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/* the complete events named by name in the trace file */
+static std::vector<const rapidjson::Value*> FindSpans(const rapidjson::Document& doc, const std::string& name) {
+  std::vector<const rapidjson::Value*> spans;
+  for (auto& event : doc["traceEvents"].GetArray()) {
+    if (std::string("X") == event["ph"].GetString() && name == event["name"].GetString()) spans.push_back(&event);
+  }
+  return spans;
+}
+
+static bool LoadTrace(const std::string& path, rapidjson::Document* doc) {
+  std::ifstream ifs(path);
+  if (!ifs.is_open()) return false;
+  std::string json((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+  return !doc->Parse(json.c_str()).HasParseError() && doc->HasMember("traceEvents");
+}
+
+TEST(CoreTrace, DisabledByDefault) {
+  EXPECT_FALSE(IsTraceEnabled());
+  {
+    CNS_TRACE_SCOPE("test", "trace_disabled_span");
+  }
+  TraceSpan("test", RegisterTraceName("trace_disabled_span"), NowNs() - 1000, NowNs());
+  const std::string path = "trace_disabled.json";
+  ASSERT_TRUE(DumpTrace(path));
+  rapidjson::Document doc;
+  ASSERT_TRUE(LoadTrace(path, &doc));
+  EXPECT_TRUE(FindSpans(doc, "trace_disabled_span").empty());
+  remove(path.c_str());
+}
+
+TEST(CoreTrace, DumpSpans) {
+  EXPECT_EQ(RegisterTraceName("trace_\"quoted\""), RegisterTraceName("trace_\"quoted\""));
+  EXPECT_NE(RegisterTraceName("trace_a"), RegisterTraceName("trace_b"));
+  SetTraceEnabled(true);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 2; ++t) {
+    threads.emplace_back([t] {
+      for (int i = 0; i < 10; ++i) {
+        CNS_TRACE_SCOPE_ARG("test", "trace_span", t * 10 + i);
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  {
+    CNS_TRACE_SCOPE("test", "trace_\"quoted\"");
+  }
+  // ended long ago
+  TraceSpan("test", RegisterTraceName("trace_old_span"), NowNs() - 100e9, NowNs() - 99e9);
+  SetTraceEnabled(false);
+
+  const std::string path = "trace_spans.json";
+  ASSERT_TRUE(DumpTrace(path, 10));
+  rapidjson::Document doc;
+  ASSERT_TRUE(LoadTrace(path, &doc));
+  auto spans = FindSpans(doc, "trace_span");
+  ASSERT_EQ(20u, spans.size());
+  std::vector<bool> args(20, false);
+  for (auto span : spans) {
+    EXPECT_STREQ("test", (*span)["cat"].GetString());
+    EXPECT_GE((*span)["dur"].GetDouble(), 100);
+    args[(*span)["args"]["arg"].GetInt()] = true;
+  }
+  // two threads
+  EXPECT_NE((*spans.front())["tid"].GetInt(), (*spans.back())["tid"].GetInt());
+  for (bool arg : args) EXPECT_TRUE(arg);
+  EXPECT_EQ(1u, FindSpans(doc, "trace_\"quoted\"").size());
+  EXPECT_TRUE(FindSpans(doc, "trace_old_span").empty());
+  remove(path.c_str());
+  EXPECT_FALSE(DumpTrace("/no/such/dir/trace.json"));
+}
+
+TEST(CoreTrace, ExitedThreadsKeepSpans) {
+  SetTraceEnabled(true);
+  // the second thread does not take the ring of the first one, exited already
+  for (int t = 0; t < 2; ++t) {
+    std::thread([t] {
+      for (int i = 0; i < 5; ++i) {
+        CNS_TRACE_SCOPE_ARG("test", "trace_exited_span", t * 5 + i);
+      }
+    }).join();
+  }
+  SetTraceEnabled(false);
+  const std::string path = "trace_exited.json";
+  ASSERT_TRUE(DumpTrace(path));
+  rapidjson::Document doc;
+  ASSERT_TRUE(LoadTrace(path, &doc));
+  EXPECT_EQ(10u, FindSpans(doc, "trace_exited_span").size());
+  remove(path.c_str());
+}
+
+TEST(CoreTrace, RingBufferKeepsLatest) {
+  SetTraceBufferSize(16);
+  SetTraceEnabled(true);
+  // a new thread takes a ring of 16 spans
+  std::thread([] {
+    for (int i = 0; i < 100; ++i) {
+      CNS_TRACE_SCOPE_ARG("test", "trace_ring_span", i);
+    }
+  }).join();
+  SetTraceEnabled(false);
+  SetTraceBufferSize(65536);
+  const std::string path = "trace_ring.json";
+  ASSERT_TRUE(DumpTrace(path));
+  rapidjson::Document doc;
+  ASSERT_TRUE(LoadTrace(path, &doc));
+  auto spans = FindSpans(doc, "trace_ring_span");
+  EXPECT_FALSE(spans.empty());
+  EXPECT_LE(spans.size(), 16u);
+  for (auto span : spans) EXPECT_GE((*span)["args"]["arg"].GetInt(), 100 - 16);
+  remove(path.c_str());
+}
+
+TEST(CoreTrace, DumpOnSignal) {
+  const std::string path = "trace_signal.json";
+  remove(path.c_str());
+  SetTraceEnabled(true);
+  {
+    CNS_TRACE_SCOPE("test", "trace_signal_span");
+  }
+  SetTraceEnabled(false);
+  ASSERT_TRUE(SetTraceDumpSignal(path));
+  ASSERT_EQ(0, raise(SIGUSR2));
+  rapidjson::Document doc;
+  bool loaded = false;
+  for (int i = 0; i < 200 && !loaded; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    loaded = LoadTrace(path, &doc);
+  }
+  ASSERT_TRUE(loaded);
+  EXPECT_EQ(1u, FindSpans(doc, "trace_signal_span").size());
+  signal(SIGUSR2, SIG_DFL);
+  remove(path.c_str());
+}
+
+}  // namespace cnstream
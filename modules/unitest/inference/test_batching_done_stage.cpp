@@ -0,0 +1,137 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+// the h2d and d2h stages only run without a device on the host-emulated backend
+#ifdef CNS_HOST_DEVICE
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "easyinfer/model_loader.h"
+
+#include "batching_done_stage.hpp"
+#include "cnstream_devmem.hpp"
+#include "infer_resource.hpp"
+#include "infer_task.hpp"
+#include "test_base.hpp"
+
+namespace cnstream {
+
+namespace {
+
+#ifdef CNS_MLU100
+const char *g_model_path = "../../samples/data/models/MLU100/Primary_Detector/resnet34ssd/resnet34_ssd.cambricon";
+#elif CNS_MLU270
+const char *g_model_path = "../../samples/data/models/MLU270/Classification/resnet50/resnet50_offline.cambricon";
+#endif
+const char *g_func_name = "subnet0";
+constexpr uint32_t g_batchsize = 4;
+
+std::shared_ptr<edk::ModelLoader> LoadModel() {
+  auto model = std::make_shared<edk::ModelLoader>(GetExePath() + g_model_path, g_func_name);
+  model->InitLayout();
+  return model;
+}
+
+void RunTasks(const std::vector<std::shared_ptr<InferTask>> &tasks) {
+  for (auto &task : tasks) {
+    task->WaitForFrontTasksComplete();
+    EXPECT_EQ(0, task->Execute());
+  }
+}
+
+}  // namespace
+
+TEST(InferBatchingDoneStage, H2DKeepsEveryItemInPlace) {
+  auto model = LoadModel();
+  auto cpu_input_res = std::make_shared<CpuInputResource>(model, g_batchsize);
+  auto mlu_input_res = std::make_shared<MluInputResource>(model, g_batchsize);
+  cpu_input_res->Init();
+  mlu_input_res->Init();
+  IOResValue cpu_value = cpu_input_res->GetDataDirectly();
+  IOResValue mlu_value = mlu_input_res->GetDataDirectly();
+  ASSERT_EQ(cpu_value.datas.size(), mlu_value.datas.size());
+
+  for (size_t input_idx = 0; input_idx < cpu_value.datas.size(); ++input_idx) {
+    for (uint32_t bidx = 0; bidx < g_batchsize; ++bidx) {
+      memset(cpu_value.datas[input_idx].Offset(bidx), static_cast<int>(bidx + 1),
+             cpu_value.datas[input_idx].batch_offset);
+    }
+  }
+
+  H2DBatchingDoneStage stage(model, g_batchsize, 0, cpu_input_res, mlu_input_res);
+  RunTasks(stage.BatchingDone(BatchingDoneInput()));
+
+  for (size_t input_idx = 0; input_idx < mlu_value.datas.size(); ++input_idx) {
+    const size_t item_bytes = cpu_value.datas[input_idx].batch_offset;
+    EXPECT_EQ(item_bytes, mlu_value.datas[input_idx].batch_offset);
+    std::vector<char> item(item_bytes);
+    for (uint32_t bidx = 0; bidx < g_batchsize; ++bidx) {
+      ASSERT_TRUE(DevMemcpy(item.data(), mlu_value.datas[input_idx].Offset(bidx), item_bytes, DEV_MEMCPY_DEV2HOST));
+      EXPECT_EQ(0, memcmp(item.data(), cpu_value.datas[input_idx].Offset(bidx), item_bytes)) << "item " << bidx;
+    }
+  }
+
+  cpu_input_res->Destroy();
+  mlu_input_res->Destroy();
+}
+
+TEST(InferBatchingDoneStage, D2HKeepsEveryItemInPlace) {
+  auto model = LoadModel();
+  auto mlu_output_res = std::make_shared<MluOutputResource>(model, g_batchsize);
+  auto cpu_output_res = std::make_shared<CpuOutputResource>(model, g_batchsize);
+  mlu_output_res->Init();
+  cpu_output_res->Init();
+  IOResValue mlu_value = mlu_output_res->GetDataDirectly();
+  IOResValue cpu_value = cpu_output_res->GetDataDirectly();
+  ASSERT_EQ(cpu_value.datas.size(), mlu_value.datas.size());
+
+  for (size_t output_idx = 0; output_idx < mlu_value.datas.size(); ++output_idx) {
+    std::vector<char> item(mlu_value.datas[output_idx].batch_offset);
+    for (uint32_t bidx = 0; bidx < g_batchsize; ++bidx) {
+      memset(item.data(), static_cast<int>(bidx + 1), item.size());
+      ASSERT_TRUE(DevMemcpy(mlu_value.datas[output_idx].Offset(bidx), item.data(), item.size(), DEV_MEMCPY_HOST2DEV));
+    }
+  }
+
+  D2HBatchingDoneStage stage(model, g_batchsize, 0, mlu_output_res, cpu_output_res);
+  RunTasks(stage.BatchingDone(BatchingDoneInput()));
+
+  for (size_t output_idx = 0; output_idx < cpu_value.datas.size(); ++output_idx) {
+    const size_t item_bytes = cpu_value.datas[output_idx].batch_offset;
+    std::vector<char> expected(item_bytes);
+    for (uint32_t bidx = 0; bidx < g_batchsize; ++bidx) {
+      memset(expected.data(), static_cast<int>(bidx + 1), item_bytes);
+      EXPECT_EQ(0, memcmp(expected.data(), cpu_value.datas[output_idx].Offset(bidx), item_bytes)) << "item " << bidx;
+    }
+  }
+
+  mlu_output_res->Destroy();
+  cpu_output_res->Destroy();
+}
+
+}  // namespace cnstream
+
+#endif  // CNS_HOST_DEVICE
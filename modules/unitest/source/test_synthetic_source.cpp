@@ -0,0 +1,231 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cnstream_pipeline.hpp"
+#include "synthetic_source.hpp"
+#include "test_base.hpp"
+
+namespace cnstream {
+
+namespace {
+
+class SyntheticSink : public Module {
+ public:
+  explicit SyntheticSink(const std::string &name) : Module(name) {}
+  bool Open(ModuleParamSet paramSet) override { return true; }
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> data) override {
+    std::lock_guard<std::mutex> lk(mutex_);
+    frames_[data->frame.stream_id]++;
+    images_.insert(data->frame.data[0]->GetCpuData());
+    EXPECT_EQ(data->frame.width, 64);
+    EXPECT_EQ(data->frame.height, 32);
+    EXPECT_EQ(data->frame.fmt, CN_PIXEL_FORMAT_YUV420_NV12);
+    EXPECT_EQ(data->frame.GetPlanes(), 2);
+    EXPECT_EQ(data->frame.data[1]->GetSize(), 64u * 32 / 2);
+    EXPECT_EQ(128, reinterpret_cast<const uint8_t *>(data->frame.data[1]->GetCpuData())[0]);
+    EXPECT_EQ(3u, data->dets.Size());
+    for (auto &bbox : data->dets.BBoxes()) {
+      EXPECT_TRUE(bbox.x >= 0 && bbox.x + bbox.w <= 1 && bbox.y >= 0 && bbox.y + bbox.h <= 1);
+    }
+    return 0;
+  }
+  std::map<std::string, int> frames_;
+  std::set<const void *> images_;
+  std::mutex mutex_;
+};  // class SyntheticSink
+
+class EosCounter : public StreamMsgObserver {
+ public:
+  void Update(const StreamMsg &msg) override {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (EOS_MSG == msg.type) eos_num_++;
+    cond_.notify_all();
+  }
+  bool Wait(int eos_num, const std::chrono::seconds &timeout) {
+    std::unique_lock<std::mutex> lk(mutex_);
+    return cond_.wait_for(lk, timeout, [&] { return eos_num_ >= eos_num; });
+  }
+
+ private:
+  int eos_num_ = 0;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+};  // class EosCounter
+
+class ChannelCounter : public Module {
+ public:
+  ChannelCounter(const std::string &name, uint32_t chn_num) : Module(name), counts_(chn_num) {
+    for (auto &it : counts_) it.store(0);
+  }
+  bool Open(ModuleParamSet paramSet) override { return true; }
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> data) override {
+    counts_.at(data->channel_idx)++;
+    return 0;
+  }
+  std::vector<std::atomic<uint32_t>> counts_;
+};  // class ChannelCounter
+
+}  // namespace
+
+TEST(SourceSynthetic, OpenClose) {
+  SyntheticSource source("synthetic");
+  ModuleParamSet param;
+  EXPECT_TRUE(source.CheckParamSet(param));
+  EXPECT_TRUE(source.Open(param));
+  EXPECT_EQ(1920, source.GetSourceParam().width);
+  EXPECT_EQ(CN_PIXEL_FORMAT_YUV420_NV12, source.GetSourceParam().fmt);
+
+  param["width"] = "640";
+  param["height"] = "360";
+  param["pixel_format"] = "bgr";
+  param["frame_num"] = "100";
+  param["object_num"] = "5";
+  param["buffer_num"] = "2";
+  EXPECT_TRUE(source.CheckParamSet(param));
+  EXPECT_TRUE(source.Open(param));
+  SyntheticSourceParam p = source.GetSourceParam();
+  EXPECT_EQ(640, p.width);
+  EXPECT_EQ(360, p.height);
+  EXPECT_EQ(CN_PIXEL_FORMAT_BGR24, p.fmt);
+  EXPECT_EQ(100u, p.frame_num);
+  EXPECT_EQ(5u, p.object_num);
+  EXPECT_EQ(2u, p.buffer_num);
+
+  ModuleParamSet bad = param;
+  bad["pixel_format"] = "rgb";
+  EXPECT_FALSE(source.CheckParamSet(bad));
+  EXPECT_FALSE(source.Open(bad));
+  bad = param;
+  bad["width"] = "foo";
+  EXPECT_FALSE(source.CheckParamSet(bad));
+  EXPECT_FALSE(source.Open(bad));
+  bad = param;
+  bad["buffer_num"] = "0";
+  EXPECT_FALSE(source.Open(bad));
+  // YUV420 needs even sizes
+  bad = param;
+  bad["pixel_format"] = "nv21";
+  bad["width"] = "641";
+  EXPECT_FALSE(source.Open(bad));
+  source.Close();
+}
+
+TEST(SourceSynthetic, SendFrames) {
+  const int kFrameNum = 50, kStreamNum = 3;
+  Pipeline pipeline("synthetic pipeline");
+  EosCounter observer;
+  pipeline.SetStreamMsgObserver(&observer);
+  auto source = std::make_shared<SyntheticSource>("synthetic_source");
+  auto sink = std::make_shared<SyntheticSink>("synthetic_sink");
+  EXPECT_TRUE(pipeline.AddModule(source));
+  EXPECT_TRUE(pipeline.AddModule(sink));
+  EXPECT_NE(pipeline.LinkModules(source, sink), "");
+  CNModuleConfig config = {};
+  config.name = source->GetName();
+  config.parameters = {{"width", "64"}, {"height", "32"}, {"frame_num", std::to_string(kFrameNum)},
+                       {"object_num", "3"}, {"buffer_num", "2"}};
+  EXPECT_EQ(0, pipeline.AddModuleConfig(config));
+  ASSERT_TRUE(pipeline.Start());
+  EXPECT_EQ(0, source->AddStreams(kStreamNum, 0));
+  // the stream ids are taken
+  EXPECT_EQ(-1, source->AddStreams(1, 0));
+  EXPECT_TRUE(observer.Wait(kStreamNum, std::chrono::seconds(10)));
+  EXPECT_TRUE(pipeline.Stop());
+
+  ASSERT_EQ(static_cast<size_t>(kStreamNum), sink->frames_.size());
+  for (auto &it : sink->frames_) EXPECT_EQ(kFrameNum, it.second) << it.first;
+  // the frames reuse the pre-allocated images
+  EXPECT_LE(sink->images_.size(), 2u * kStreamNum);
+}
+
+TEST(SourceSynthetic, FrameRate) {
+  const int kFrameNum = 10, kFrameRate = 100;
+  Pipeline pipeline("synthetic pipeline");
+  EosCounter observer;
+  pipeline.SetStreamMsgObserver(&observer);
+  auto source = std::make_shared<SyntheticSource>("synthetic_source");
+  EXPECT_TRUE(pipeline.AddModule(source));
+  CNModuleConfig config = {};
+  config.name = source->GetName();
+  config.parameters = {{"width", "64"}, {"height", "32"}, {"frame_num", std::to_string(kFrameNum)}};
+  EXPECT_EQ(0, pipeline.AddModuleConfig(config));
+  ASSERT_TRUE(pipeline.Start());
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_EQ(0, source->AddVideoSource("synthetic_0", "", kFrameRate));
+  EXPECT_TRUE(observer.Wait(1, std::chrono::seconds(10)));
+  std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  EXPECT_GE(elapsed.count(), 1000.0 * (kFrameNum - 1) / kFrameRate);
+  EXPECT_TRUE(pipeline.Stop());
+}
+
+TEST(SourceSynthetic, ThousandStreamsStress) {
+  const uint32_t kStreamNum = 1024, kFrameNum = 20;
+  const uint32_t default_num = GetMaxStreamNumber();
+  Pipeline pipeline("stress pipeline");
+  EosCounter observer;
+  pipeline.SetStreamMsgObserver(&observer);
+  auto source = std::make_shared<SyntheticSource>("stress_source");
+  auto sink = std::make_shared<ChannelCounter>("stress_sink", kStreamNum);
+  EXPECT_TRUE(pipeline.AddModule(source));
+  EXPECT_TRUE(pipeline.AddModule(sink));
+  EXPECT_TRUE(pipeline.SetModuleParallelism(sink, 8));
+  EXPECT_NE(pipeline.LinkModules(source, sink), "");
+  CNModuleConfig config = {};
+  config.name = source->GetName();
+  config.parameters = {{"max_stream_num", std::to_string(kStreamNum)},
+                       {"width", "64"},
+                       {"height", "32"},
+                       {"frame_num", std::to_string(kFrameNum)},
+                       {"buffer_num", "2"}};
+  EXPECT_EQ(0, pipeline.AddModuleConfig(config));
+  ASSERT_TRUE(pipeline.Start());
+  EXPECT_EQ(GetMaxStreamNumber(), kStreamNum);
+
+  EXPECT_EQ(0, source->AddStreams(kStreamNum, 0));
+  // the index space is full
+  EXPECT_EQ(-1, source->AddStreams(1, 0, false, "extra_"));
+  // every stream thread can be named
+  EXPECT_LT(GetModuleThreadName(source->GetName(), kStreamNum - 1).size(), 16u);
+  EXPECT_TRUE(observer.Wait(kStreamNum, std::chrono::seconds(60)));
+  // the streams are removed when the source is closed
+  EXPECT_TRUE(pipeline.Stop());
+
+  // each stream got an index of its own
+  for (uint32_t i = 0; i < kStreamNum; ++i) EXPECT_EQ(sink->counts_[i].load(), kFrameNum) << i;
+  EXPECT_TRUE(SetMaxStreamNumber(default_num));
+}
+
+}  // namespace cnstream
@@ -29,6 +29,11 @@ class PostprocClassification : public cnstream::Postproc {
   int Execute(const std::vector<float*>& net_outputs, const std::shared_ptr<edk::ModelLoader>& model,
               const cnstream::CNFrameInfoPtr& package) override;
 
+ private:
+  // the class of the frame, drawn by Osd
+  cnstream::CNMetaKey<cnstream::CNInferAttr> classification_key_ =
+      cnstream::RegisterMetaKey<cnstream::CNInferAttr>("classification");
+
   DECLARE_REFLEX_OBJECT_EX(PostprocClassification, cnstream::Postproc)
 };  // classd PostprocClassification
 
@@ -60,9 +65,10 @@ int PostprocClassification::Execute(const std::vector<float*>& net_outputs,
 
   if (0 == label) return -1;
   DLOG(INFO) << "label = " << label + 1 << " score = " << mscore;
-  auto obj = std::make_shared<cnstream::CNInferObject>();
-  obj->id = std::to_string(label);
-  obj->score = mscore;
-  package->objs.push_back(obj);
+  cnstream::CNInferAttr classification;
+  classification.id = 0;
+  classification.value = label;
+  classification.score = mscore;
+  package->meta.Set(classification_key_, classification);
   return 0;
 }
@@ -62,59 +62,19 @@ int PreprocCpu::Execute(const std::vector<float*>& net_inputs, const std::shared
 
   DLOG(INFO) << "[PreprocCpu] do preproc...";
 
-  int width = package->frame.width;
-  int height = package->frame.height;
   int dst_w = input_shapes[0].w;
   int dst_h = input_shapes[0].h;
 
-  uint8_t* img_data = new uint8_t[package->frame.GetBytes()];
-  uint8_t* t = img_data;
-
-  for (int i = 0; i < package->frame.GetPlanes(); ++i) {
-    memcpy(t, package->frame.data[i]->GetCpuData(), package->frame.GetPlaneBytes(i));
-    t += package->frame.GetPlaneBytes(i);
-  }
-
-  // convert color space
-  cv::Mat img;
-  switch (package->frame.fmt) {
-    case cnstream::CNDataFormat::CN_PIXEL_FORMAT_BGR24:
-      img = cv::Mat(height, width, CV_8UC3, img_data);
-      break;
-    case cnstream::CNDataFormat::CN_PIXEL_FORMAT_RGB24:
-      img = cv::Mat(height, width, CV_8UC3, img_data);
-      cv::cvtColor(img, img, cv::COLOR_RGB2BGR);
-      break;
-    case cnstream::CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12: {
-      img = cv::Mat(height * 3 / 2, width, CV_8UC1, img_data);
-      cv::Mat bgr(height, width, CV_8UC3);
-      cv::cvtColor(img, bgr, cv::COLOR_YUV2BGR_NV12);
-      img = bgr;
-    } break;
-    case cnstream::CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV21: {
-      img = cv::Mat(height * 3 / 2, width, CV_8UC1, img_data);
-      cv::Mat bgr(height, width, CV_8UC3);
-      cv::cvtColor(img, bgr, cv::COLOR_YUV2BGR_NV21);
-      img = bgr;
-    } break;
-    default:
-      LOG(WARNING) << "[Encoder] Unsupport pixel format.";
-      delete[] img_data;
-      return -1;
-  }
-
-  // resize if needed
-  if (height != dst_h || width != dst_w) {
-    cv::Mat dst(dst_h, dst_w, CV_8UC3);
-    cv::resize(img, dst, cv::Size(dst_w, dst_h));
-    img.release();
-    img = dst;
+  // converted and resized once per frame, shared with the other modules asking for the same size
+  cv::Mat img = package->frame.GetDerivedImage(cnstream::CN_PIXEL_FORMAT_BGR24, dst_w, dst_h);
+  if (img.empty()) {
+    LOG(WARNING) << "[PreprocCpu] Unsupport pixel format.";
+    return -1;
   }
 
   // since model input data type is float, convert image to float
   cv::Mat dst(dst_h, dst_w, CV_32FC3, net_inputs[0]);
   img.convertTo(dst, CV_32F);
 
-  delete[] img_data;
   return 0;
 }
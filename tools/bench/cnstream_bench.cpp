@@ -0,0 +1,659 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <glog/logging.h>
+#include <rapidjson/prettywriter.h>
+#include <rapidjson/stringbuffer.h>
+
+#include <dirent.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cnstream_pipeline.hpp"
+#include "cnstream_source.hpp"
+#include "cnstream_version.hpp"
+
+/* bumped whenever a field of the report changes meaning or is removed, adding fields keeps it */
+static const int kReportVersion = 1;
+
+struct BenchOptions {
+  std::string config_file;
+  std::string input;
+  std::string output;
+  uint32_t stream_num = 1;
+  int frame_rate = 0;
+  double duration_s = 10;
+  double warmup_s = 1;
+  cnstream::ExecutorType executor = cnstream::EXECUTOR_THREAD_PER_CONVEYOR;
+  std::vector<int> parallelism;  // empty: as configured
+  std::vector<int> queue_size;   // empty: as configured
+};
+
+/* what one run of the pipeline measured, between the end of the warmup and the end of the run */
+struct RunResult {
+  int parallelism = 0;
+  int queue_size = 0;
+  double elapsed_s = 0;
+  uint64_t frames_in = 0;
+  /* the frames reaching a sink, averaged over the sinks */
+  uint64_t frames_out = 0;
+  std::map<std::string, uint64_t> sink_frames;
+  cnstream::LatencyStats end_to_end;
+  uint64_t peak_rss_kb = 0;
+  uint64_t memory_budget_drops = 0;
+  std::map<std::string, uint64_t> link_drops;
+  std::string bottleneck;
+  double bottleneck_percent = 0;
+  struct ModuleResult {
+    std::string name;
+    int parallelism = 0;
+    cnstream::ModuleLatencyStats latency;
+    /* negative if the threads of the module are unknown */
+    double cpu_s = -1;
+  };
+  std::vector<ModuleResult> modules;
+  std::map<std::string, double> thread_cpu_s;
+  /* the threads named like the main thread, SetThreadName failed or was not called */
+  uint32_t unnamed_threads = 0;
+  struct LinkResult {
+    std::string id;
+    /* sampled after the warmup */
+    std::vector<cnstream::QueueTelemetry> conveyors;
+  };
+  std::vector<LinkResult> links;
+};
+
+static void Usage() {
+  std::cout << "Usage:" << std::endl;
+  std::cout << "\t cnstream_bench -c PIPELINE-JSON [OPTION...]" << std::endl;
+  std::cout << "Options: " << std::endl;
+  std::cout << std::left << std::setw(40) << "\t -h, --help"
+            << "Show usage" << std::endl;
+  std::cout << std::left << std::setw(40) << "\t -c, --config"
+            << "The pipeline config file, required" << std::endl;
+  std::cout << std::left << std::setw(40) << "\t -n, --stream-num"
+            << "Streams added to each source module, 1 by default" << std::endl;
+  std::cout << std::left << std::setw(40) << "\t -i, --input"
+            << "The file or url of the streams, not used by SyntheticSource" << std::endl;
+  std::cout << std::left << std::setw(40) << "\t -r, --frame-rate"
+            << "Frames per second of each stream, 0 (unthrottled) by default" << std::endl;
+  std::cout << std::left << std::setw(40) << "\t -d, --duration"
+            << "Seconds measured in each run, 10 by default" << std::endl;
+  std::cout << std::left << std::setw(40) << "\t -w, --warmup"
+            << "Seconds before measuring in each run, 1 by default" << std::endl;
+  std::cout << std::left << std::setw(40) << "\t -e, --executor"
+            << "thread (a thread per conveyor, the default) or work-stealing" << std::endl;
+  std::cout << std::left << std::setw(40) << "\t -p, --parallelism"
+            << "Comma separated values swept for the parallelism of the non-source modules" << std::endl;
+  std::cout << std::left << std::setw(40) << "\t -q, --queue-size"
+            << "Comma separated values swept for the input queue size of the non-source modules" << std::endl;
+  std::cout << std::left << std::setw(40) << "\t -o, --output"
+            << "The report file, stdout by default\n"
+            << std::endl;
+}
+
+static const struct option long_option[] = {{"help", no_argument, nullptr, 'h'},
+                                            {"config", required_argument, nullptr, 'c'},
+                                            {"stream-num", required_argument, nullptr, 'n'},
+                                            {"input", required_argument, nullptr, 'i'},
+                                            {"frame-rate", required_argument, nullptr, 'r'},
+                                            {"duration", required_argument, nullptr, 'd'},
+                                            {"warmup", required_argument, nullptr, 'w'},
+                                            {"executor", required_argument, nullptr, 'e'},
+                                            {"parallelism", required_argument, nullptr, 'p'},
+                                            {"queue-size", required_argument, nullptr, 'q'},
+                                            {"output", required_argument, nullptr, 'o'},
+                                            {nullptr, 0, nullptr, 0}};
+
+template <typename T>
+static bool ParseNumber(const std::string& str, T* value) {
+  std::stringstream ss(str);
+  ss >> *value;
+  return !ss.fail() && ss.eof();
+}
+
+static bool ParseList(const std::string& str, std::vector<int>* values) {
+  std::stringstream ss(str);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    int value = 0;
+    if (!ParseNumber(item, &value) || value <= 0) return false;
+    values->push_back(value);
+  }
+  return !values->empty();
+}
+
+/* utime + stime of each thread of the process, keyed by the thread id */
+/* whether the thread is named by cnstream::GetModuleThreadName for the module */
+static bool IsModuleThread(const std::string& thread_name, const std::string& module_name) {
+  size_t digits = 0;
+  while (digits < thread_name.size() && isdigit(thread_name[thread_name.size() - 1 - digits])) ++digits;
+  /* the index has no leading zeros, the name before it is cut to fit */
+  for (size_t len = 1; len <= digits && len <= 10; ++len) {
+    std::string index = thread_name.substr(thread_name.size() - len);
+    if (len > 1 && '0' == index[0]) continue;
+    uint64_t idx = std::stoull(index);
+    if (idx <= UINT32_MAX && cnstream::GetModuleThreadName(module_name, idx) == thread_name) return true;
+  }
+  return false;
+}
+
+static std::map<std::string, std::pair<std::string, double>> ThreadCpuTimes() {
+  std::map<std::string, std::pair<std::string, double>> times;
+  static const double ticks = sysconf(_SC_CLK_TCK);
+  DIR* dir = opendir("/proc/self/task");
+  if (!dir) return times;
+  while (struct dirent* entry = readdir(dir)) {
+    std::string tid = entry->d_name;
+    if (tid == "." || tid == "..") continue;
+    std::ifstream stat_file("/proc/self/task/" + tid + "/stat");
+    std::string stat((std::istreambuf_iterator<char>(stat_file)), std::istreambuf_iterator<char>());
+    /* the name may contain spaces, the fields after it start from "state" */
+    size_t name_begin = stat.find('('), name_end = stat.rfind(')');
+    if (name_begin == std::string::npos || name_end == std::string::npos) continue;
+    std::stringstream fields(stat.substr(name_end + 2));
+    std::string field;
+    uint64_t utime = 0, stime = 0;
+    for (int i = 3; i <= 15 && fields >> field; ++i) {
+      if (14 == i) ParseNumber(field, &utime);
+      if (15 == i) ParseNumber(field, &stime);
+    }
+    times[tid] = std::make_pair(stat.substr(name_begin + 1, name_end - name_begin - 1), (utime + stime) / ticks);
+  }
+  closedir(dir);
+  return times;
+}
+
+/* the peak RSS is reset at the beginning of each measurement when the kernel allows it */
+static void ResetPeakRss() {
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  if (clear_refs.is_open()) clear_refs << "5";
+}
+
+static uint64_t GetPeakRssKb() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0) {
+      uint64_t kb = 0;
+      std::stringstream(line.substr(6)) >> kb;
+      return kb;
+    }
+  }
+  return 0;
+}
+
+class ErrorObserver : public cnstream::StreamMsgObserver {
+ public:
+  void Update(const cnstream::StreamMsg& msg) override {
+    if (cnstream::ERROR_MSG == msg.type) {
+      LOG(ERROR) << "stream " << msg.stream_id << " failed";
+      failed_.store(true);
+    }
+  }
+  bool Failed() const { return failed_.load(); }
+
+ private:
+  std::atomic<bool> failed_{false};
+};
+
+static bool RunPipeline(const BenchOptions& options, int parallelism, int queue_size, RunResult* result) {
+  std::vector<cnstream::CNModuleConfig> configs;
+  try {
+    configs = cnstream::ParsePipelineJSONFile(options.config_file);
+  } catch (std::string& e) {
+    LOG(ERROR) << e;
+    return false;
+  }
+  /* the modules no other module links to are the sources, the sweeps leave them alone */
+  std::set<std::string> linked;
+  for (auto& config : configs) linked.insert(config.next.begin(), config.next.end());
+  std::vector<std::string> sources, sinks;
+  for (auto& config : configs) {
+    if (config.next.empty()) sinks.push_back(config.name);
+    if (linked.count(config.name)) {
+      if (parallelism > 0) config.parallelism = parallelism;
+      if (queue_size > 0) config.maxInputQueueSize = queue_size;
+    } else {
+      sources.push_back(config.name);
+    }
+  }
+  result->parallelism = parallelism;
+  result->queue_size = queue_size;
+
+  cnstream::Pipeline pipeline("cnstream_bench");
+  ErrorObserver observer;
+  pipeline.SetStreamMsgObserver(&observer);
+  pipeline.SetExecutor(options.executor);
+  if (pipeline.BuildPipeline(configs) != 0) return false;
+  pipeline.SetQueueSampler(10);
+  if (!pipeline.Start()) {
+    LOG(ERROR) << "Pipeline start failed";
+    return false;
+  }
+  bool ret = true;
+  for (auto& name : sources) {
+    auto source = dynamic_cast<cnstream::SourceModule*>(pipeline.GetModule(name));
+    if (nullptr == source) {
+      LOG(ERROR) << "Module [" << name << "] is not linked to by any module, but it is not a source";
+      ret = false;
+      break;
+    }
+    for (uint32_t i = 0; i < options.stream_num && ret; ++i) {
+      /* the streams loop, they run until the pipeline stops */
+      if (source->AddVideoSource(name + "_" + std::to_string(i), options.input, options.frame_rate, true) != 0) {
+        LOG(ERROR) << "Add stream to [" << name << "] failed, the source may need --input";
+        ret = false;
+      }
+    }
+  }
+
+  if (ret) {
+    std::this_thread::sleep_for(std::chrono::duration<double>(options.warmup_s));
+    std::map<std::string, uint64_t> drops_before;
+    for (auto& link_id : pipeline.GetLinkIds()) {
+      cnstream::LinkStatus status;
+      if (!pipeline.QueryLinkStatus(&status, link_id)) continue;
+      for (auto& it : status.drop_count) drops_before[link_id] += it.second;
+    }
+    uint64_t budget_drops_before = pipeline.GetMemoryBudgetStatus().dropped_frames;
+    auto cpu_before = ThreadCpuTimes();
+    pipeline.ResetLatencyStats();
+    pipeline.ResetQueueTelemetry();
+    ResetPeakRss();
+    auto start = std::chrono::steady_clock::now();
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(options.duration_s));
+
+    /* the module threads exit when the pipeline stops, read them before */
+    auto cpu_after = ThreadCpuTimes();
+    result->elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result->peak_rss_kb = GetPeakRssKb();
+    result->end_to_end = pipeline.GetEndToEndLatency();
+    result->memory_budget_drops = pipeline.GetMemoryBudgetStatus().dropped_frames - budget_drops_before;
+    for (auto& link_id : pipeline.GetLinkIds()) {
+      cnstream::LinkStatus status;
+      if (!pipeline.QueryLinkStatus(&status, link_id)) continue;
+      uint64_t drops = 0;
+      for (auto& it : status.drop_count) drops += it.second;
+      result->link_drops[link_id] = drops - drops_before[link_id];
+    }
+    /* the threads which are not named keep the name of the main thread, their time is not given to a module */
+    const std::string main_tid = std::to_string(getpid());
+    const std::string main_name = cpu_after.count(main_tid) ? cpu_after[main_tid].first : "";
+    for (auto& it : cpu_after) {
+      auto before = cpu_before.find(it.first);
+      double cpu_s = it.second.second - (before == cpu_before.end() ? 0 : before->second.second);
+      result->thread_cpu_s[it.second.first] += cpu_s;
+      if (it.first != main_tid && it.second.first == main_name) ++result->unnamed_threads;
+    }
+    LOG_IF(WARNING, result->unnamed_threads) << result->unnamed_threads
+                                             << " threads are not named, the cpu time of the modules may be short";
+    for (auto& config : configs) {
+      RunResult::ModuleResult module;
+      module.name = config.name;
+      module.parallelism = config.parallelism;
+      pipeline.QueryModuleLatency(&module.latency, config.name);
+      if (std::find(sources.begin(), sources.end(), config.name) != sources.end()) {
+        result->frames_in += module.latency.from_source.count;
+      }
+      /* a frame reaching several sinks is counted by each of them */
+      if (std::find(sinks.begin(), sinks.end(), config.name) != sinks.end()) {
+        result->sink_frames[config.name] = module.latency.from_source.count;
+        result->frames_out += module.latency.from_source.count;
+      }
+      result->modules.push_back(module);
+    }
+    if (!sinks.empty()) result->frames_out /= sinks.size();
+    /*
+      the module threads are named by cnstream::GetModuleThreadName, with the conveyor or the stream index.
+      the workers of the work-stealing executor run all the modules, the time of a module is unknown then.
+     */
+    if (cnstream::EXECUTOR_THREAD_PER_CONVEYOR == options.executor) {
+      std::vector<bool> ambiguous(result->modules.size(), false);
+      for (auto& module : result->modules) module.cpu_s = 0;
+      for (auto& it : result->thread_cpu_s) {
+        std::vector<size_t> owners;
+        for (size_t i = 0; i < result->modules.size(); ++i) {
+          if (IsModuleThread(it.first, result->modules[i].name)) owners.push_back(i);
+        }
+        if (1 == owners.size()) result->modules[owners[0]].cpu_s += it.second;
+        /* modules whose names are cut to the same prefix cannot be told apart */
+        if (owners.size() > 1) {
+          for (auto i : owners) ambiguous[i] = true;
+        }
+      }
+      for (size_t i = 0; i < result->modules.size(); ++i) {
+        if (ambiguous[i]) result->modules[i].cpu_s = -1;
+      }
+    }
+  }
+
+  /* the streams send EOS while the pipeline is still running */
+  for (auto& name : sources) {
+    auto source = dynamic_cast<cnstream::SourceModule*>(pipeline.GetModule(name));
+    if (nullptr == source) continue;
+    for (uint32_t i = 0; i < options.stream_num; ++i) source->RemoveSource(name + "_" + std::to_string(i));
+  }
+  pipeline.Stop();
+  if (ret) {
+    result->bottleneck = pipeline.GetBottleneckModule(&result->bottleneck_percent);
+    for (auto& link_id : pipeline.GetLinkIds()) {
+      std::vector<cnstream::QueueTelemetry> telemetry;
+      if (!pipeline.QueryQueueTelemetry(&telemetry, link_id)) continue;
+      RunResult::LinkResult link;
+      link.id = link_id;
+      link.conveyors = telemetry;
+      result->links.push_back(link);
+    }
+  }
+  if (observer.Failed()) ret = false;
+  return ret;
+}
+
+typedef rapidjson::PrettyWriter<rapidjson::StringBuffer> ReportWriter;
+
+static void WriteLatency(ReportWriter* writer, const char* key, const cnstream::LatencyStats& stats) {
+  writer->Key(key);
+  writer->StartObject();
+  writer->Key("count");
+  writer->Uint64(stats.count);
+  writer->Key("mean_us");
+  writer->Double(stats.mean_us);
+  writer->Key("p50_us");
+  writer->Double(stats.p50_us);
+  writer->Key("p90_us");
+  writer->Double(stats.p90_us);
+  writer->Key("p99_us");
+  writer->Double(stats.p99_us);
+  writer->Key("max_us");
+  writer->Double(stats.max_us);
+  writer->EndObject();
+}
+
+static void WriteRun(ReportWriter* writer, const RunResult& run) {
+  writer->StartObject();
+  /* 0 means as configured */
+  writer->Key("parallelism");
+  writer->Int(run.parallelism);
+  writer->Key("queue_size");
+  writer->Int(run.queue_size);
+  writer->Key("elapsed_s");
+  writer->Double(run.elapsed_s);
+  writer->Key("frames_in");
+  writer->Uint64(run.frames_in);
+  writer->Key("frames_out");
+  writer->Uint64(run.frames_out);
+  writer->Key("throughput_fps");
+  writer->Double(run.elapsed_s > 0 ? run.frames_out / run.elapsed_s : 0);
+  writer->Key("sinks");
+  writer->StartArray();
+  for (auto& it : run.sink_frames) {
+    writer->StartObject();
+    writer->Key("name");
+    writer->String(it.first.c_str());
+    writer->Key("frames_out");
+    writer->Uint64(it.second);
+    writer->Key("throughput_fps");
+    writer->Double(run.elapsed_s > 0 ? it.second / run.elapsed_s : 0);
+    writer->EndObject();
+  }
+  writer->EndArray();
+  WriteLatency(writer, "end_to_end", run.end_to_end);
+  writer->Key("peak_rss_kb");
+  writer->Uint64(run.peak_rss_kb);
+
+  uint64_t total_drops = run.memory_budget_drops;
+  for (auto& it : run.link_drops) total_drops += it.second;
+  writer->Key("drops");
+  writer->StartObject();
+  writer->Key("total");
+  writer->Uint64(total_drops);
+  writer->Key("memory_budget");
+  writer->Uint64(run.memory_budget_drops);
+  writer->Key("links");
+  writer->StartObject();
+  for (auto& it : run.link_drops) {
+    writer->Key(it.first.c_str());
+    writer->Uint64(it.second);
+  }
+  writer->EndObject();
+  writer->EndObject();
+
+  writer->Key("bottleneck");
+  writer->StartObject();
+  writer->Key("module");
+  writer->String(run.bottleneck.c_str());
+  writer->Key("percent");
+  writer->Double(run.bottleneck_percent);
+  writer->EndObject();
+
+  writer->Key("modules");
+  writer->StartArray();
+  for (auto& module : run.modules) {
+    writer->StartObject();
+    writer->Key("name");
+    writer->String(module.name.c_str());
+    writer->Key("parallelism");
+    writer->Int(module.parallelism);
+    WriteLatency(writer, "queue", module.latency.queue);
+    WriteLatency(writer, "process", module.latency.process);
+    WriteLatency(writer, "from_source", module.latency.from_source);
+    /* null if unknown, see the threads */
+    writer->Key("cpu_s");
+    if (module.cpu_s < 0) {
+      writer->Null();
+    } else {
+      writer->Double(module.cpu_s);
+    }
+    writer->EndObject();
+  }
+  writer->EndArray();
+
+  writer->Key("links");
+  writer->StartArray();
+  for (auto& link : run.links) {
+    writer->StartObject();
+    writer->Key("id");
+    writer->String(link.id.c_str());
+    writer->Key("conveyors");
+    writer->StartArray();
+    for (auto& conveyor : link.conveyors) {
+      writer->StartObject();
+      writer->Key("capacity");
+      writer->Uint(conveyor.capacity);
+      writer->Key("samples");
+      writer->Uint64(conveyor.samples);
+      writer->Key("mean_depth");
+      writer->Double(conveyor.mean_depth);
+      writer->Key("p50_depth");
+      writer->Uint(conveyor.p50_depth);
+      writer->Key("p90_depth");
+      writer->Uint(conveyor.p90_depth);
+      writer->Key("p99_depth");
+      writer->Uint(conveyor.p99_depth);
+      writer->Key("max_depth");
+      writer->Uint(conveyor.max_depth);
+      writer->Key("at_capacity_percent");
+      writer->Double(conveyor.at_capacity_percent);
+      writer->Key("blocked_pushes");
+      writer->Uint64(conveyor.blocked_pushes);
+      writer->Key("blocked_ms");
+      writer->Double(conveyor.blocked_ms);
+      writer->EndObject();
+    }
+    writer->EndArray();
+    writer->EndObject();
+  }
+  writer->EndArray();
+
+  writer->Key("unnamed_threads");
+  writer->Uint(run.unnamed_threads);
+  /* all the threads of the process, the source threads and the executor workers included */
+  writer->Key("threads");
+  writer->StartArray();
+  for (auto& it : run.thread_cpu_s) {
+    writer->StartObject();
+    writer->Key("name");
+    writer->String(it.first.c_str());
+    writer->Key("cpu_s");
+    writer->Double(it.second);
+    writer->EndObject();
+  }
+  writer->EndArray();
+  writer->EndObject();
+}
+
+static std::string WriteReport(const BenchOptions& options, const std::vector<RunResult>& runs) {
+  rapidjson::StringBuffer buffer;
+  ReportWriter writer(buffer);
+  writer.SetMaxDecimalPlaces(3);
+  writer.StartObject();
+  writer.Key("report_version");
+  writer.Int(kReportVersion);
+  writer.Key("cnstream_version");
+  writer.String(cnstream::VersionString());
+  writer.Key("config");
+  writer.String(options.config_file.c_str());
+  writer.Key("input");
+  writer.String(options.input.c_str());
+  writer.Key("stream_num");
+  writer.Uint(options.stream_num);
+  writer.Key("frame_rate");
+  writer.Int(options.frame_rate);
+  writer.Key("duration_s");
+  writer.Double(options.duration_s);
+  writer.Key("warmup_s");
+  writer.Double(options.warmup_s);
+  writer.Key("executor");
+  writer.String(cnstream::EXECUTOR_WORK_STEALING == options.executor ? "work-stealing" : "thread");
+  writer.Key("runs");
+  writer.StartArray();
+  for (auto& run : runs) WriteRun(&writer, run);
+  writer.EndArray();
+  writer.EndObject();
+  return std::string(buffer.GetString()) + "\n";
+}
+
+int main(int argc, char* argv[]) {
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_logtostderr = true;
+  BenchOptions options;
+  int opt = 0;
+  bool valid = true;
+  while ((opt = getopt_long(argc, argv, "hc:n:i:r:d:w:e:p:q:o:", long_option, nullptr)) != -1) {
+    switch (opt) {
+      case 'h':
+        Usage();
+        return 0;
+      case 'c':
+        options.config_file = optarg;
+        break;
+      case 'n':
+        valid = ParseNumber(std::string(optarg), &options.stream_num) && options.stream_num > 0;
+        break;
+      case 'i':
+        options.input = optarg;
+        break;
+      case 'r':
+        valid = ParseNumber(std::string(optarg), &options.frame_rate) && options.frame_rate >= 0;
+        break;
+      case 'd':
+        valid = ParseNumber(std::string(optarg), &options.duration_s) && options.duration_s > 0;
+        break;
+      case 'w':
+        valid = ParseNumber(std::string(optarg), &options.warmup_s) && options.warmup_s >= 0;
+        break;
+      case 'e':
+        if (std::string(optarg) == "thread") {
+          options.executor = cnstream::EXECUTOR_THREAD_PER_CONVEYOR;
+        } else if (std::string(optarg) == "work-stealing") {
+          options.executor = cnstream::EXECUTOR_WORK_STEALING;
+        } else {
+          valid = false;
+        }
+        break;
+      case 'p':
+        valid = ParseList(optarg, &options.parallelism);
+        break;
+      case 'q':
+        valid = ParseList(optarg, &options.queue_size);
+        break;
+      case 'o':
+        options.output = optarg;
+        break;
+      default:
+        valid = false;
+        break;
+    }
+    if (!valid) {
+      std::cerr << "Invalid option: " << argv[optind - 1] << std::endl;
+      Usage();
+      return 1;
+    }
+  }
+  if (options.config_file.empty()) {
+    Usage();
+    return 1;
+  }
+
+  std::vector<int> parallelism = options.parallelism.empty() ? std::vector<int>{0} : options.parallelism;
+  std::vector<int> queue_size = options.queue_size.empty() ? std::vector<int>{0} : options.queue_size;
+  std::vector<RunResult> runs;
+  for (int p : parallelism) {
+    for (int q : queue_size) {
+      LOG(INFO) << "Run with parallelism " << p << ", queue size " << q << " (0: as configured)";
+      RunResult run;
+      if (!RunPipeline(options, p, q, &run)) {
+        LOG(ERROR) << "Benchmark failed";
+        return 1;
+      }
+      runs.push_back(run);
+    }
+  }
+
+  std::string report = WriteReport(options, runs);
+  if (options.output.empty()) {
+    std::cout << report;
+  } else {
+    std::ofstream ofs(options.output);
+    ofs << report;
+    if (!ofs.good()) {
+      LOG(ERROR) << "Write report to " << options.output << " failed";
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,85 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef HAVE_OPENCV
+#include "opencv2/opencv.hpp"
+#endif
+
+#include "color_convert.hpp"
+#include "microbench.hpp"
+
+namespace cnstream {
+
+namespace {
+
+template <typename Func>
+double BenchMs(Func func, int times) {
+  func();  // warm up
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < times; ++i) func();
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / times;
+}
+
+}  // namespace
+
+CNS_MICROBENCH(color_convert) {
+  const int sizes[][2] = {{1920, 1080}, {3840, 2160}};
+  const int kTimes = 10;
+  std::mt19937 gen(1);
+  std::uniform_int_distribution<int> dist(0, 255);
+  for (auto& size : sizes) {
+    const int width = size[0], height = size[1];
+    std::vector<uint8_t> y(static_cast<size_t>(width) * height), uv(static_cast<size_t>(width) * height / 2);
+    for (auto& v : y) v = static_cast<uint8_t>(dist(gen));
+    for (auto& v : uv) v = static_cast<uint8_t>(dist(gen));
+    std::vector<uint8_t> bgr(static_cast<size_t>(width) * 3 * height);
+    const std::string metric = "NV12 to BGR " + std::to_string(width) + "x" + std::to_string(height);
+#ifdef HAVE_OPENCV
+    // the previous ImageBGR(), copies the planes into one buffer then cv::cvtColor
+    double opencv_ms = BenchMs([&] {
+      std::vector<uint8_t> yuv(y.size() + uv.size());
+      memcpy(yuv.data(), y.data(), y.size());
+      memcpy(yuv.data() + y.size(), uv.data(), uv.size());
+      cv::Mat src(height * 3 / 2, width, CV_8UC1, yuv.data()), dst;
+      cv::cvtColor(src, dst, cv::COLOR_YUV2BGR_NV12);
+    }, kTimes);
+    microbench::Report(metric + ", copy+cvtColor", opencv_ms, "ms");
+#endif
+    const std::pair<ColorConvertKernel, std::string> kernels[] = {
+        {COLOR_CONVERT_SCALAR, "scalar"}, {COLOR_CONVERT_SSE41, "sse4.1"}, {COLOR_CONVERT_AVX2, "avx2"}};
+    for (auto& kernel : kernels) {
+      if (!ColorConvertKernelSupported(kernel.first)) continue;
+      double ms = BenchMs([&] {
+        YUV420spToBGR(y.data(), width, uv.data(), width, false, width, height, bgr.data(), width * 3, kernel.first);
+      }, kTimes);
+      microbench::Report(metric + ", " + kernel.second, ms, "ms");
+    }
+  }
+  return true;
+}
+
+}  // namespace cnstream
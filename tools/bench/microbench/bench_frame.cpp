@@ -0,0 +1,112 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cnstream_frame.hpp"
+#include "microbench.hpp"
+
+namespace cnstream {
+
+namespace {
+
+/* postproc -> track -> osd, the way the modules handle the detections of a frame */
+double RunDetectionsChain(bool compact, int frame_num, int obj_num) {
+  struct DrawObject {
+    int label, track_id;
+    float score, x, y, w, h;
+  };
+  double checksum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int f = 0; f < frame_num; ++f) {
+    auto data = CNFrameInfo::Create("0");
+    std::vector<DrawObject> in;
+    in.reserve(obj_num);
+    if (compact) {
+      // postproc
+      data->dets.Reserve(obj_num);
+      for (int i = 0; i < obj_num; ++i) {
+        data->dets.Add({0.001f * i, 0.002f * i, 0.1f, 0.1f}, 0.5f, i % 80);
+      }
+      // track
+      const CNDetections& dets = data->dets;
+      for (size_t i = 0; i < dets.Size(); ++i) {
+        const CNInferBoundingBox& bbox = dets.BBoxes()[i];
+        in.push_back({dets.ClassIds()[i], -1, dets.Scores()[i], bbox.x, bbox.y, bbox.w, bbox.h});
+      }
+      data->dets.Clear();
+      for (size_t i = 0; i < in.size(); ++i) {
+        data->dets.Add({in[i].x, in[i].y, in[i].w, in[i].h}, in[i].score, in[i].label, static_cast<int>(i));
+      }
+      // osd
+      for (size_t i = 0; i < dets.Size(); ++i) {
+        checksum += dets.ClassIds()[i] + dets.TrackIds()[i] + dets.BBoxes()[i].x;
+      }
+    } else {
+      for (int i = 0; i < obj_num; ++i) {
+        std::shared_ptr<CNInferObject> obj = std::make_shared<CNInferObject>();
+        obj->id = std::to_string(i % 80);
+        obj->score = 0.5f;
+        obj->bbox = {0.001f * i, 0.002f * i, 0.1f, 0.1f};
+        data->objs.push_back(obj);
+      }
+      for (const auto& obj : data->objs) {
+        in.push_back({std::stoi(obj->id), -1, obj->score, obj->bbox.x, obj->bbox.y, obj->bbox.w, obj->bbox.h});
+      }
+      data->objs.clear();
+      for (size_t i = 0; i < in.size(); ++i) {
+        std::shared_ptr<CNInferObject> obj = std::make_shared<CNInferObject>();
+        obj->id = std::to_string(in[i].label);
+        obj->track_id = std::to_string(i);
+        obj->score = in[i].score;
+        obj->bbox = {in[i].x, in[i].y, in[i].w, in[i].h};
+        data->objs.push_back(obj);
+      }
+      for (const auto& obj : data->objs) {
+        checksum += std::stoi(obj->id) + std::stoi(obj->track_id) + obj->bbox.x;
+      }
+    }
+  }
+  double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+  // keeps the reads from being optimized out
+  if (checksum <= 0) return -1;
+  return us / frame_num;
+}
+
+}  // namespace
+
+CNS_MICROBENCH(detections) {
+  const int kFrameNum = 1000, kObjNum = 200;
+  // warm up the frame pool
+  RunDetectionsChain(true, 10, kObjNum);
+  RunDetectionsChain(false, 10, kObjNum);
+  double compact_us = RunDetectionsChain(true, kFrameNum, kObjNum);
+  double objects_us = RunDetectionsChain(false, kFrameNum, kObjNum);
+  if (compact_us < 0 || objects_us < 0) return false;
+  const std::string metric = "postproc -> track -> osd, " + std::to_string(kObjNum) + " objects per frame";
+  microbench::Report(metric + ", CNInferObject", objects_us, "us/frame");
+  microbench::Report(metric + ", CNDetections", compact_us, "us/frame");
+  return true;
+}
+
+}  // namespace cnstream
@@ -0,0 +1,222 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <glog/logging.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cnstream_frame.hpp"
+#include "cnstream_pipeline.hpp"
+#include "microbench.hpp"
+
+namespace cnstream {
+
+namespace {
+
+using microbench::NowNs;
+
+class PassModule : public Module {
+ public:
+  explicit PassModule(const std::string& name) : Module(name) {}
+  bool Open(ModuleParamSet paramSet) override { return true; }
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> data) override { return 0; }
+};  // class PassModule
+
+/* takes frame.timestamp as the time the frame entered the pipeline */
+class LatencyProbe : public Module {
+ public:
+  LatencyProbe(const std::string& name, uint32_t expected) : Module(name), expected_(expected) {}
+  bool Open(ModuleParamSet paramSet) override { return true; }
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> data) override {
+    // called by as many threads as the parallelism
+    total_ns_ += NowNs() - data->frame.timestamp;
+    if (count_.fetch_add(1) + 1 == expected_) done_.set_value();
+    return 0;
+  }
+  std::future<void> GetDoneFuture() { return done_.get_future(); }
+  double AvgLatencyMs() const { return count_ ? total_ns_ / 1e6 / count_ : 0; }
+
+ private:
+  uint32_t expected_ = 0;
+  std::atomic<uint32_t> count_{0};
+  std::atomic<int64_t> total_ns_{0};
+  std::promise<void> done_;
+};  // class LatencyProbe
+
+/* spins for `cost` on each frame */
+class BusyModule : public Module {
+ public:
+  BusyModule(const std::string& name, std::chrono::microseconds cost) : Module(name), cost_(cost) {}
+  bool Open(ModuleParamSet paramSet) override { return true; }
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> data) override {
+    auto end = std::chrono::steady_clock::now() + cost_;
+    while (std::chrono::steady_clock::now() < end) {
+    }
+    return 0;
+  }
+
+ private:
+  std::chrono::microseconds cost_;
+};  // class BusyModule
+
+/*
+  source ---> hop1 ---> hop2 ---> hop3 ---> hop4 ---> probe
+  returns the average added delay per hop in milliseconds, or a negative value if the frames did not arrive.
+ */
+double MeasureChainPerHopLatency(size_t queue_capacity, uint32_t frame_cnt, std::chrono::microseconds interval) {
+  const int kHops = 5;
+  Pipeline pipeline("latency pipeline");
+  auto source = std::make_shared<PassModule>("bench_source");
+  auto probe = std::make_shared<LatencyProbe>("bench_probe", frame_cnt);
+  std::vector<std::shared_ptr<Module>> chain = {source};
+  for (int i = 1; i < kHops; ++i) chain.push_back(std::make_shared<PassModule>("bench_hop" + std::to_string(i)));
+  chain.push_back(probe);
+  for (auto& module : chain) pipeline.AddModule(module);
+  for (size_t i = 0; i + 1 < chain.size(); ++i) pipeline.LinkModules(chain[i], chain[i + 1], queue_capacity);
+  auto done = probe->GetDoneFuture();
+  if (!pipeline.Start()) return -1;
+  for (uint32_t i = 0; i < frame_cnt; ++i) {
+    auto data = CNFrameInfo::Create("0");
+    data->channel_idx = 0;
+    data->frame.frame_id = i;
+    data->frame.timestamp = NowNs();
+    pipeline.ProvideData(source.get(), data);
+    if (interval.count()) std::this_thread::sleep_for(interval);
+  }
+  bool arrived = std::future_status::ready == done.wait_for(std::chrono::seconds(60));
+  pipeline.Stop();
+  if (!arrived) return -1;
+  return probe->AvgLatencyMs() / kHops;
+}
+
+/*
+  source ---> stage1 ... stage8 ---> probe, all at parallelism 16, stage4 is the bottleneck.
+  returns frames per second, or a negative value if the frames did not arrive.
+ */
+double MeasureChainFps(ExecutorType executor_type, uint32_t frame_cnt) {
+  const int kStages = 8;
+  const uint32_t kParallelism = 16, kChnNum = 16;
+  Pipeline pipeline("fps pipeline");
+  pipeline.SetExecutor(executor_type);
+  auto source = std::make_shared<PassModule>("fps_source");
+  auto probe = std::make_shared<LatencyProbe>("fps_probe", frame_cnt);
+  std::vector<std::shared_ptr<Module>> chain = {source};
+  for (int i = 1; i <= kStages; ++i) {
+    auto cost = std::chrono::microseconds(i == kStages / 2 ? 200 : 20);
+    chain.push_back(std::make_shared<BusyModule>("fps_stage" + std::to_string(i), cost));
+  }
+  chain.push_back(probe);
+  for (auto& module : chain) {
+    pipeline.AddModule(module);
+    if (module != source) pipeline.SetModuleParallelism(module, kParallelism);
+  }
+  for (size_t i = 0; i + 1 < chain.size(); ++i) pipeline.LinkModules(chain[i], chain[i + 1]);
+  auto done = probe->GetDoneFuture();
+  if (!pipeline.Start()) return -1;
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < frame_cnt; ++i) {
+    auto data = CNFrameInfo::Create(std::to_string(i % kChnNum));
+    data->channel_idx = i % kChnNum;
+    data->frame.timestamp = NowNs();
+    pipeline.ProvideData(source.get(), data);
+  }
+  bool arrived = std::future_status::ready == done.wait_for(std::chrono::seconds(60));
+  std::chrono::duration<double> dura = std::chrono::steady_clock::now() - start;
+  pipeline.Stop();
+  if (!arrived) return -1;
+  return frame_cnt / dura.count();
+}
+
+/*
+            /--> left  --\
+  source --|             |--> join
+            \--> right --/
+  returns the average time between two frames leaving the join in nanoseconds, the join happens in TransmitData.
+  Or a negative value if the frames did not arrive.
+ */
+double MeasureDiamondNs(uint32_t frame_cnt) {
+  Pipeline pipeline("diamond pipeline");
+  auto source = std::make_shared<PassModule>("diamond_source");
+  auto left = std::make_shared<PassModule>("diamond_left");
+  auto right = std::make_shared<PassModule>("diamond_right");
+  auto join = std::make_shared<LatencyProbe>("diamond_join", frame_cnt);
+  for (auto module : std::vector<std::shared_ptr<Module>>{source, left, right, join}) pipeline.AddModule(module);
+  // the queues hold every frame, the source is never blocked
+  pipeline.LinkModules(source, left, frame_cnt);
+  pipeline.LinkModules(source, right, frame_cnt);
+  pipeline.LinkModules(left, join, frame_cnt);
+  pipeline.LinkModules(right, join, frame_cnt);
+  auto done = join->GetDoneFuture();
+  if (!pipeline.Start()) return -1;
+  int64_t start = NowNs();
+  for (uint32_t i = 0; i < frame_cnt; ++i) {
+    auto data = CNFrameInfo::Create("0");
+    data->channel_idx = 0;
+    data->frame.timestamp = NowNs();
+    pipeline.ProvideData(source.get(), data);
+  }
+  bool arrived = std::future_status::ready == done.wait_for(std::chrono::seconds(60));
+  int64_t end = NowNs();
+  pipeline.Stop();
+  if (!arrived) return -1;
+  return static_cast<double>(end - start) / frame_cnt;
+}
+
+}  // namespace
+
+CNS_MICROBENCH(chain_latency) {
+  // paced source, queues are mostly empty: measures consumer wakeup latency
+  double idle_ms = MeasureChainPerHopLatency(20, 500, std::chrono::microseconds(1000));
+  // unpaced source with short queues: producers are blocked by backpressure most of the time
+  double busy_ms = MeasureChainPerHopLatency(4, 5000, std::chrono::microseconds(0));
+  if (idle_ms < 0 || busy_ms < 0) return false;
+  microbench::Report("6-module chain, added delay per hop, idle", idle_ms, "ms");
+  microbench::Report("6-module chain, added delay per hop, saturated", busy_ms, "ms");
+  return true;
+}
+
+CNS_MICROBENCH(executor_fps) {
+  double thread_fps = MeasureChainFps(EXECUTOR_THREAD_PER_CONVEYOR, 4000);
+  double ws_fps = MeasureChainFps(EXECUTOR_WORK_STEALING, 4000);
+  if (thread_fps < 0 || ws_fps < 0) return false;
+  microbench::Report("10-module chain at parallelism 16, thread-per-conveyor", thread_fps, "fps");
+  microbench::Report("10-module chain at parallelism 16, work-stealing with " +
+                         std::to_string(std::thread::hardware_concurrency()) + " workers",
+                     ws_fps, "fps");
+  return true;
+}
+
+CNS_MICROBENCH(diamond_transmit) {
+  double ns = MeasureDiamondNs(100000);
+  if (ns < 0) return false;
+  microbench::Report("diamond graph, transmit and join per frame", ns, "ns");
+  return true;
+}
+
+}  // namespace cnstream
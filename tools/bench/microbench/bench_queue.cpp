@@ -0,0 +1,74 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lockfree_queue.hpp"
+#include "microbench.hpp"
+#include "threadsafe_queue.hpp"
+
+namespace cnstream {
+
+namespace {
+
+const int kQueueCapacity = 20;
+
+/* one consumer drains `producer_num * count` values, returns throughput in million ops per second */
+double MeasureThroughput(BoundedQueue<int>* queue, int producer_num, int count) {
+  std::vector<std::thread> producers;
+  auto start = std::chrono::steady_clock::now();
+  for (int p = 0; p < producer_num; ++p) {
+    producers.emplace_back([queue, count]() {
+      for (int i = 0; i < count; ++i) queue->WaitAndPush(i);
+    });
+  }
+  int value;
+  for (int i = 0; i < producer_num * count; ++i) queue->WaitAndPop(value);
+  auto end = std::chrono::steady_clock::now();
+  for (auto& it : producers) it.join();
+  std::chrono::duration<double, std::micro> dura = end - start;
+  return producer_num * count / dura.count();
+}
+
+}  // namespace
+
+CNS_MICROBENCH(queue_throughput) {
+  const int total = 400000;
+  for (int producer_num : {1, 4, 16}) {
+    const std::string metric =
+        std::to_string(producer_num) + " producer(s) -> 1 consumer, capacity " + std::to_string(kQueueCapacity);
+    BoundedThreadSafeQueue<int> mutex_queue(kQueueCapacity);
+    BlockingRingQueue<MpmcRingBuffer<int>> mpmc_queue(kQueueCapacity);
+    microbench::Report(metric + ", mutex", MeasureThroughput(&mutex_queue, producer_num, total / producer_num),
+                       "Mops/s");
+    microbench::Report(metric + ", mpmc", MeasureThroughput(&mpmc_queue, producer_num, total / producer_num),
+                       "Mops/s");
+    if (1 == producer_num) {
+      BlockingRingQueue<SpscRingBuffer<int>> spsc_queue(kQueueCapacity);
+      microbench::Report(metric + ", spsc", MeasureThroughput(&spsc_queue, producer_num, total), "Mops/s");
+    }
+  }
+  return true;
+}
+
+}  // namespace cnstream
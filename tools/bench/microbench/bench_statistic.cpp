@@ -0,0 +1,55 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "cnstream_statistic.hpp"
+#include "microbench.hpp"
+
+namespace cnstream {
+
+/*
+  The pipeline stamps a frame 3 times and records 4 latencies for each module it goes through. Measures the cost
+  for a pipeline of 4 modules at 2000 frames per second.
+ */
+CNS_MICROBENCH(latency_tracing) {
+  const int kModuleNum = 4, kFps = 2000, kFrameNum = 100000;
+  LatencyHistogram queue, link_queue, process, from_source;
+  int64_t create_ns = microbench::NowNs();
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kFrameNum * kModuleNum; ++i) {
+    int64_t pop_ns = microbench::NowNs();
+    link_queue.Record(pop_ns - create_ns);
+    queue.Record(pop_ns - create_ns);
+    process.Record(microbench::NowNs() - pop_ns);
+    from_source.Record(microbench::NowNs() - create_ns);
+  }
+  double frame_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                    kFrameNum;
+  const std::string metric = "latency tracing, " + std::to_string(kModuleNum) + " modules";
+  microbench::Report(metric, frame_ns, "ns/frame");
+  microbench::Report(metric + ", share of a core at " + std::to_string(kFps) + " fps", frame_ns * kFps / 1e9 * 100,
+                     "%");
+  return true;
+}
+
+}  // namespace cnstream
@@ -0,0 +1,194 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <glog/logging.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cnstream_devmem.hpp"
+#include "cnstream_frame.hpp"
+#include "cnstream_syncmem.hpp"
+#include "color_convert.hpp"
+#include "microbench.hpp"
+#include "threadsafe_queue.hpp"
+
+namespace cnstream {
+
+namespace {
+
+size_t ResidentBytes() {
+  std::ifstream statm("/proc/self/statm");
+  size_t pages = 0, resident = 0;
+  statm >> pages >> resident;
+  return resident * sysconf(_SC_PAGESIZE);
+}
+
+}  // namespace
+
+/*
+  1080p frames go through CopyToSyncMem on a decoder thread and are released on another thread, like in a
+  pipeline, for 60 seconds unless CNSTREAM_SOAK_SECONDS is set. Fails if the resident memory grows by more than
+  16MB after the first quarter of the run.
+ */
+CNS_MICROBENCH(host_memory_pool_soak) {
+  const char* env = getenv("CNSTREAM_SOAK_SECONDS");
+  const double seconds = env ? atof(env) : 60;
+  if (seconds <= 0) {
+    LOG(ERROR) << "[Soak] invalid CNSTREAM_SOAK_SECONDS: " << env;
+    return false;
+  }
+  const int kWidth = 1920, kHeight = 1080;
+  std::vector<uint8_t> image(kWidth * kHeight * 3 / 2, 128);
+  uint32_t stream = InternStreamId("soak_stream");
+  ThreadSafeQueue<std::shared_ptr<CNFrameInfo>> queue;
+  std::thread releaser([&] {
+    std::shared_ptr<CNFrameInfo> data;
+    while (true) {
+      queue.WaitAndPop(data);
+      if (!data) break;
+      data.reset();
+    }
+  });
+  const int kMaxQueued = 4;
+  size_t rss_after_warm_up = 0;
+  uint64_t frame_cnt = 0;
+  auto start = std::chrono::steady_clock::now();
+  auto last_report = start;
+  while (true) {
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - start).count();
+    if (elapsed >= seconds) break;
+    auto data = CNFrameInfo::Create(stream);
+    data->frame.ctx.dev_type = DevContext::CPU;
+    data->frame.fmt = CN_PIXEL_FORMAT_YUV420_NV12;
+    data->frame.width = kWidth;
+    data->frame.height = kHeight;
+    data->frame.stride[0] = data->frame.stride[1] = kWidth;
+    data->frame.ptr[0] = image.data();
+    data->frame.ptr[1] = image.data() + kWidth * kHeight;
+    data->frame.CopyToSyncMem();
+    queue.Push(data);
+    // at most a few frames in flight
+    while (queue.Size() > kMaxQueued) std::this_thread::yield();
+    ++frame_cnt;
+    // a quarter of the run warms up
+    if (!rss_after_warm_up && elapsed >= seconds / 4) rss_after_warm_up = ResidentBytes();
+    if (std::chrono::duration<double>(now - last_report).count() >= 60) {
+      last_report = now;
+      LOG(INFO) << "[Soak] " << static_cast<int>(elapsed) << "s, " << frame_cnt << " frames, RSS "
+                << ResidentBytes() / (1 << 20) << " MB";
+    }
+  }
+  queue.Push(nullptr);
+  releaser.join();
+  MemoryPoolStats stats = GetHostMemoryPool()->GetStats();
+  size_t rss = ResidentBytes();
+  microbench::Report("1080p frames", frame_cnt / seconds, "fps");
+  microbench::Report("pool hits", stats.hits, "allocs");
+  microbench::Report("pool misses", stats.misses, "allocs");
+  microbench::Report("pool resident", (stats.bytes_in_use + stats.bytes_cached) / (1 << 20), "MB");
+  microbench::Report("RSS after warm up", rss_after_warm_up / (1 << 20), "MB");
+  microbench::Report("RSS at the end", rss / (1 << 20), "MB");
+  if (rss >= rss_after_warm_up + (16 << 20)) {
+    LOG(ERROR) << "[Soak] the resident memory keeps growing";
+    return false;
+  }
+  return true;
+}
+
+/*
+  Copies 4K NV12 frames into pool buffers and converts them to BGR, like the decoder and the first module reading
+  the image do. The huge pages win by fewer TLB misses and page faults on the hosts reserving them.
+ */
+CNS_MICROBENCH(host_memory_pool_huge_pages) {
+  const int kWidth = 3840, kHeight = 2160, kFrames = 20;
+  const size_t frame_size = kWidth * kHeight * 3 / 2;
+  std::vector<uint8_t> image(frame_size, 128);
+  std::vector<uint8_t> bgr(kWidth * kHeight * 3);
+  const char* names[] = {"malloc", "transparent huge pages", "explicit huge pages"};
+  for (auto mode : {HOST_HUGE_PAGE_NONE, HOST_HUGE_PAGE_TRANSPARENT, HOST_HUGE_PAGE_EXPLICIT}) {
+    HostMemoryPoolOptions options;
+    options.huge_page = mode;
+    std::unique_ptr<MemoryPool> pool(CreateHostMemoryPool(options));
+    SetHostMemoryPool(pool.get());
+    double copy_ms = 0, convert_ms = 0;
+    for (int i = 0; i < kFrames; ++i) {
+      auto start = std::chrono::steady_clock::now();
+      uint8_t* buffer = static_cast<uint8_t*>(GetHostMemoryPool()->Alloc(frame_size));
+      memcpy(buffer, image.data(), frame_size);
+      auto copied = std::chrono::steady_clock::now();
+      YUV420spToBGR(buffer, kWidth, buffer + kWidth * kHeight, kWidth, false, kWidth, kHeight, bgr.data(), kWidth * 3);
+      auto converted = std::chrono::steady_clock::now();
+      GetHostMemoryPool()->Free(buffer, frame_size);
+      copy_ms += std::chrono::duration<double, std::milli>(copied - start).count();
+      convert_ms += std::chrono::duration<double, std::milli>(converted - copied).count();
+    }
+    SetHostMemoryPool(nullptr);
+    microbench::Report(std::string("4K NV12, ") + names[mode] + ", copy", frame_size * kFrames / copy_ms / 1e6, "GB/s");
+    microbench::Report(std::string("4K NV12, ") + names[mode] + ", to BGR", convert_ms / kFrames, "ms/frame");
+  }
+  return true;
+}
+
+#ifdef CNS_HOST_DEVICE
+/*
+  The first cpu access of 16MB of device memory copied at 1GB/s, without a prefetch and after a prefetch issued
+  40ms earlier, when the frame was queued for the module.
+ */
+CNS_MICROBENCH(prefetch_hides_copy) {
+  EmulatedDevBandwidth origin = GetEmulatedDevBandwidth();
+  EmulatedDevBandwidth bandwidth;
+  bandwidth.dev2host = 1e9;
+  SetEmulatedDevBandwidth(bandwidth);
+  const size_t size = 16 << 20;
+  void* dev = DevMalloc(size);
+  if (!dev) {
+    SetEmulatedDevBandwidth(origin);
+    return false;
+  }
+  auto access_ms = [&](bool prefetch) {
+    CNSyncedMemory memory(size);
+    memory.SetMluData(dev);
+    if (prefetch) {
+      memory.PrefetchToCpu();
+      // the frame waits in the queue of the module
+      std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    }
+    auto start = std::chrono::steady_clock::now();
+    memory.GetCpuData();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  };
+  microbench::Report("16MB to cpu at 1GB/s, first access", access_ms(false), "ms");
+  microbench::Report("16MB to cpu at 1GB/s, first access after a prefetch", access_ms(true), "ms");
+  SetEmulatedDevBandwidth(origin);
+  DevFree(dev);
+  return true;
+}
+#endif
+
+}  // namespace cnstream
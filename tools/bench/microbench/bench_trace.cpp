@@ -0,0 +1,44 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <chrono>
+
+#include "cnstream_trace.hpp"
+#include "microbench.hpp"
+
+namespace cnstream {
+
+/* the cost of a span while the trace is not enabled, paid by every frame in every module */
+CNS_MICROBENCH(trace_disabled_overhead) {
+  const int kSpanNum = 1000000;
+  bool enabled = IsTraceEnabled();
+  SetTraceEnabled(false);
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kSpanNum; ++i) {
+    CNS_TRACE_SCOPE("bench", "trace_overhead_span");
+  }
+  double span_ns =
+      std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / kSpanNum;
+  SetTraceEnabled(enabled);
+  microbench::Report("disabled trace span", span_ns, "ns");
+  return true;
+}
+
+}  // namespace cnstream
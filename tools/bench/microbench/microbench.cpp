@@ -0,0 +1,102 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <glog/logging.h>
+
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "microbench.hpp"
+
+namespace cnstream {
+
+namespace microbench {
+
+/* sorted by name, so the benchmarks run in the same order whatever the link order */
+static std::map<std::string, BenchFunc>& Registry() {
+  static std::map<std::string, BenchFunc> registry;
+  return registry;
+}
+
+static std::string g_running;
+
+bool Register(const std::string& name, BenchFunc func) { return Registry().emplace(name, func).second; }
+
+void Report(const std::string& metric, double value, const std::string& unit) {
+  std::cout << "[" << g_running << "] " << metric << ": " << value << " " << unit << std::endl;
+}
+
+}  // namespace microbench
+
+}  // namespace cnstream
+
+static void Usage() {
+  std::cout << "Usage:" << std::endl;
+  std::cout << "\t cnstream_microbench [-l] [FILTER...]" << std::endl;
+  std::cout << "Runs the benchmarks whose names contain one of the filters, all of them without a filter."
+            << std::endl;
+  std::cout << "Options: " << std::endl;
+  std::cout << std::left << std::setw(40) << "\t -h, --help"
+            << "Show usage" << std::endl;
+  std::cout << std::left << std::setw(40) << "\t -l, --list"
+            << "List the benchmarks instead of running them" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_logtostderr = true;
+  bool list = false;
+  std::vector<std::string> filters;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "-h" || arg == "--help") {
+      Usage();
+      return 0;
+    } else if (arg == "-l" || arg == "--list") {
+      list = true;
+    } else if (!arg.empty() && arg[0] == '-') {
+      std::cerr << "Invalid option: " << arg << std::endl;
+      Usage();
+      return 1;
+    } else {
+      filters.push_back(arg);
+    }
+  }
+
+  int failed = 0;
+  for (auto& bench : cnstream::microbench::Registry()) {
+    bool matched = filters.empty();
+    for (auto& filter : filters) matched = matched || bench.first.find(filter) != std::string::npos;
+    if (!matched) continue;
+    if (list) {
+      std::cout << bench.first << std::endl;
+      continue;
+    }
+    cnstream::microbench::g_running = bench.first;
+    if (!bench.second()) {
+      LOG(ERROR) << "Benchmark " << bench.first << " failed";
+      ++failed;
+    }
+  }
+  return failed ? 1 : 0;
+}
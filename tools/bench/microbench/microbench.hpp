@@ -0,0 +1,64 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_MICROBENCH_HPP_
+#define CNSTREAM_MICROBENCH_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace cnstream {
+
+namespace microbench {
+
+/* returns false if the benchmark failed, the tool then exits with an error */
+using BenchFunc = bool (*)();
+
+bool Register(const std::string& name, BenchFunc func);
+
+/* prints one measured value of the running benchmark, as "[name] metric: value unit" */
+void Report(const std::string& metric, double value, const std::string& unit);
+
+inline int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace microbench
+
+}  // namespace cnstream
+
+/*
+  Defines and registers a benchmark, run by cnstream_microbench when its name matches a filter:
+
+    CNS_MICROBENCH(queue_throughput) {
+      ...
+      cnstream::microbench::Report("mpmc", mops, "Mops/s");
+      return true;
+    }
+ */
+#define CNS_MICROBENCH(name)                                    \
+  static bool MicroBench_##name();                              \
+  static const bool microbench_##name##_registered =            \
+      cnstream::microbench::Register(#name, MicroBench_##name); \
+  static bool MicroBench_##name()
+
+#endif  // CNSTREAM_MICROBENCH_HPP_